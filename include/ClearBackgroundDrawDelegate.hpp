@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vkme/core/Image.hpp>
+#include <vkme/tools/CompositeRenderer.hpp>
 #include <vkme/VulkanData.hpp>
 #include <vkme/DrawLoop.hpp>
 
@@ -8,6 +9,8 @@ class ClearBackgroundDrawDelegate : public vkme::DrawLoopDelegate, public vkme::
 public:
     void init(vkme::VulkanData * vulkanData);
 
+    void initFrameResources(vkme::core::DescriptorSetAllocator * allocator);
+
     // In this delegate we draw on an image we create, instead of using the swapchain. For that reason we have to
     // implement this function to resize the image we'll use for drawing. If we draw directly to the
     // swapchain, this function may have an empty implementation, but it's mandatory to implement it to make sure that the
@@ -30,7 +33,8 @@ public:
     void cleanup();
 
 protected:
-    std::shared_ptr<vkme::core::Image> _drawImage;
+    vkme::core::ImageHandle _drawImage;
+    std::unique_ptr<vkme::tools::CompositeRenderer> _compositeRenderer;
 
     vkme::VulkanData * _vulkanData;
     
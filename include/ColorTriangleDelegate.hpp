@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vkme/core/Image.hpp>
+#include <vkme/tools/CompositeRenderer.hpp>
 #include <vkme/VulkanData.hpp>
 #include <vkme/DrawLoop.hpp>
 #include <vkme/UserInterface.hpp>
@@ -9,6 +10,8 @@ class ColorTriangleDelegate : public vkme::DrawLoopDelegate, public vkme::UserIn
 public:
     void init(vkme::VulkanData * vulkanData);
 
+    void initFrameResources(vkme::core::DescriptorSetAllocator * allocator);
+
     void cleanup();
     
     void swapchainResized(VkExtent2D newExtent);
@@ -26,7 +29,8 @@ public:
 protected:
     vkme::VulkanData * _vulkanData;
     
-    std::shared_ptr<vkme::core::Image> _drawImage;
+    vkme::core::ImageHandle _drawImage;
+    std::unique_ptr<vkme::tools::CompositeRenderer> _compositeRenderer;
     
     VkPipelineLayout _pipelineLayout;
     VkPipeline _pipeline;
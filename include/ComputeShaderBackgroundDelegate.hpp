@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vkme/core/Image.hpp>
+#include <vkme/tools/CompositeRenderer.hpp>
 #include <vkme/VulkanData.hpp>
 #include <vkme/DrawLoop.hpp>
 #include <vkme/core/DescriptorSetAllocator.hpp>
@@ -18,6 +19,8 @@ class ComputeShaderBackgroundDelegate : public vkme::DrawLoopDelegate, public vk
 public:
     void init(vkme::VulkanData * vulkanData);
 
+    void initFrameResources(vkme::core::DescriptorSetAllocator * allocator);
+
     void init(vkme::VulkanData * vulkanData, vkme::UserInterface * ui);
 
     void cleanup();
@@ -40,21 +43,18 @@ protected:
     vkme::VulkanData * _vulkanData;
 
     // Use this image to render the background, instead of the swapchain
-    std::shared_ptr<vkme::core::Image> _drawImage;
-    
-    // Descriptor allocator and descriptor set to setup the compute shader layout
-    vkme::core::DescriptorSetAllocator _descriptorAllocator;
-    
-    // Descriptor set wrapper
-    std::unique_ptr<vkme::core::DescriptorSet> _drawImageDescriptors;
+    vkme::core::ImageHandle _drawImage;
+    std::unique_ptr<vkme::tools::CompositeRenderer> _compositeRenderer;
     
     // Pipeline to process the compute shader
     VkPipeline _gradientPipeline;
     VkPipelineLayout _gradientPipelineLayout;
     
+    // The descriptor set that passes the draw image to the compute shader is allocated in each
+    // frame, so the draw image can be replaced while the frames in flight use the previous one
     VkDescriptorSetLayout _drawImageDescriptorLayout;
     
-    void drawBackground(VkCommandBuffer cmd, uint32_t currentFrame, VkExtent2D imageExtent);
+    void drawBackground(VkCommandBuffer cmd, uint32_t currentFrame, VkExtent2D imageExtent, vkme::core::FrameResources& frameResources);
     
     void initDescriptors();
     
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vkme/core/Image.hpp>
+#include <vkme/tools/CompositeRenderer.hpp>
+#include <vkme/VulkanData.hpp>
+#include <vkme/DrawLoop.hpp>
+#include <vkme/UserInterface.hpp>
+#include <vkme/geo/mesh_data.hpp>
+#include <vkme/geo/Model.hpp>
+#include <vkme/geo/SceneBVH.hpp>
+#include <vkme/tools/IndirectRenderer.hpp>
+
+// Loads the nodes of a glTF scene and fills a grid with instances of them. All the instances
+// of a mesh share the same mesh buffers, and they are culled and drawn by the IndirectRenderer.
+// The instances are also stored in a SceneBVH, that is used to frame the camera, to count the
+// instances in the frustum and to pick the instance under the mouse cursor. If the device doesn't
+// support the indirect draw features, the instances in the frustum are drawn with Model::draw()
+class InstancedSceneDelegate : public vkme::DrawLoopDelegate, public vkme::UserInterfaceDelegate {
+public:
+    void init(vkme::VulkanData * vulkanData);
+    void initFrameResources(vkme::core::DescriptorSetAllocator * allocator);
+    void swapchainResized(VkExtent2D newExtent);
+    VkImageLayout draw(
+        VkCommandBuffer cmd,
+        uint32_t currentFrame,
+        const vkme::core::Image* colorImage,
+        const vkme::core::Image* depthImage,
+        vkme::core::FrameResources& frameResources
+    );
+    void drawUI();
+
+    void cleanup();
+
+protected:
+    vkme::VulkanData * _vulkanData;
+
+    vkme::core::ImageHandle _drawImage;
+    std::unique_ptr<vkme::tools::CompositeRenderer> _compositeRenderer;
+
+    VkPipelineLayout _pipelineLayout;
+    VkPipeline _pipeline;
+    // Only if the device supports mesh shaders
+    VkPipeline _meshPipeline = VK_NULL_HANDLE;
+
+    // Only if the device supports the indirect draw features
+    std::unique_ptr<vkme::tools::IndirectRenderer> _renderer;
+    // Otherwise, the models are drawn with this pipeline, that reads the view projection matrix
+    // from a uniform buffer
+    VkDescriptorSetLayout _sceneDataLayout = VK_NULL_HANDLE;
+
+    // The instances are stored in the pool, and the scene BVH and the IndirectRenderer reference
+    // them by their handle
+    vkme::geo::ModelPool _models;
+    vkme::geo::SceneBVH _sceneBVH{ _models };
+    std::vector<uint32_t> _frustumInstances;
+    // Index of the picked instance in the scene BVH, or -1
+    int32_t _pickedInstance = -1;
+    uint32_t _pickedSurface = 0;
+    float _pickedDistance = 0.0f;
+
+    // Number of copies of the scene in each side of the grid, and distance between them
+    int32_t _gridSize = 24;
+    float _gridSpacing = 6.0f;
+    bool _rotateCamera = true;
+    float _cameraAngle = 0.0f;
+    // Level of detail selection of the IndirectRenderer. The error is in pixels
+    bool _lodSelection = true;
+    float _maxScreenError = 1.0f;
+
+    glm::mat4 _view;
+    glm::mat4 _proj;
+
+    void initPipeline();
+    void initFallbackPipeline();
+    void initScene();
+
+    void updateCamera(VkExtent2D imageExtent);
+    // The position is in the same units as the size, with the origin at the top left corner
+    void pickInstance(const glm::vec2& position, const glm::vec2& size);
+    void drawGeometry(
+        VkCommandBuffer cmd,
+        VkImageView currentImage,
+        VkExtent2D imageExtent,
+        const vkme::core::Image* depthImage,
+        bool clear,
+        vkme::core::FrameResources& frameResources
+    );
+};
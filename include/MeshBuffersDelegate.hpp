@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vkme/core/Image.hpp>
+#include <vkme/tools/CompositeRenderer.hpp>
 #include <vkme/VulkanData.hpp>
 #include <vkme/DrawLoop.hpp>
 #include <vkme/UserInterface.hpp>
@@ -10,6 +11,8 @@ class MeshBuffersDelegate : public vkme::DrawLoopDelegate, public vkme::UserInte
 public:
     void init(vkme::VulkanData * vulkanData);
 
+    void initFrameResources(vkme::core::DescriptorSetAllocator * allocator);
+
     void cleanup();
     
     void swapchainResized(VkExtent2D newExtent);
@@ -28,7 +31,8 @@ public:
 protected:
     vkme::VulkanData * _vulkanData;
     
-    std::shared_ptr<vkme::core::Image> _drawImage;
+    vkme::core::ImageHandle _drawImage;
+    std::unique_ptr<vkme::tools::CompositeRenderer> _compositeRenderer;
     
     VkPipelineLayout _pipelineLayout;
     VkPipeline _pipeline;
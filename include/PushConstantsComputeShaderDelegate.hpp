@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vkme/core/Image.hpp>
+#include <vkme/tools/CompositeRenderer.hpp>
 #include <vkme/VulkanData.hpp>
 #include <vkme/DrawLoop.hpp>
 #include <vkme/core/DescriptorSetAllocator.hpp>
@@ -16,6 +17,8 @@ class PushConstantsComputeShaderDelegate : public vkme::DrawLoopDelegate, public
 public:
     void init(vkme::VulkanData * vulkanData);
 
+    void initFrameResources(vkme::core::DescriptorSetAllocator * allocator);
+
     void init(vkme::VulkanData * vulkanData, vkme::UserInterface * ui);
 
     void cleanup();
@@ -55,22 +58,19 @@ protected:
     vkme::VulkanData * _vulkanData;
 
     // Use this image to render the background, instead of the swapchain
-    std::shared_ptr<vkme::core::Image> _drawImage;
-    
-    // Descriptor allocator and descriptor set to setup the compute shader layout
-    vkme::core::DescriptorSetAllocator _descriptorAllocator;
-    
-    // Descriptor set wrapper
-    std::unique_ptr<vkme::core::DescriptorSet> _drawImageDescriptors;
+    vkme::core::ImageHandle _drawImage;
+    std::unique_ptr<vkme::tools::CompositeRenderer> _compositeRenderer;
     
     // Pipeline to process the compute shader
     VkPipelineLayout _pipelineLayout;
     std::vector<ComputeEffect> _backgroundEffect;
     int _currentBackgroundEffect = 0;
     
+    // The descriptor set that passes the draw image to the compute shader is allocated in each
+    // frame, so the draw image can be replaced while the frames in flight use the previous one
     VkDescriptorSetLayout _drawImageDescriptorLayout;
     
-    void drawBackground(VkCommandBuffer cmd, uint32_t currentFrame, VkExtent2D imageExtent);
+    void drawBackground(VkCommandBuffer cmd, uint32_t currentFrame, VkExtent2D imageExtent, vkme::core::FrameResources& frameResources);
     
     void initDescriptors();
     
@@ -3,6 +3,7 @@
 #include <vkme/core/Image.hpp>
 #include <vkme/VulkanData.hpp>
 #include <vkme/DrawLoop.hpp>
+#include <vkme/RenderGraph.hpp>
 #include <vkme/UserInterface.hpp>
 #include <vkme/geo/mesh_data.hpp>
 #include <vkme/geo/Model.hpp>
@@ -10,6 +11,9 @@
 #include <vkme/tools/CubemapRenderer.hpp>
 #include <vkme/tools/SkyboxRenderer.hpp>
 #include <vkme/tools/SpecularReflectionCubemapRenderer.hpp>
+#include <vkme/tools/CompositeRenderer.hpp>
+#include <vkme/tools/FrameCapture.hpp>
+#include <vkme/tools/DynamicResolution.hpp>
 
 struct SceneDataCubemap
 {
@@ -58,7 +62,8 @@ public:
 protected:
     vkme::VulkanData * _vulkanData;
     
-    std::shared_ptr<vkme::core::Image> _drawImage;
+    vkme::core::ImageHandle _drawImage;
+    vkme::RenderGraph _renderGraph;
 
     // Convert the equirectangular texture into cube map
     std::unique_ptr<vkme::tools::SphereToCubemapRenderer> _sphereToCubeRenderer;
@@ -91,6 +96,11 @@ protected:
     
     // Resources to draw the sky cubemap
     std::shared_ptr<vkme::tools::SkyboxRenderer> _skyboxRenderer;
+    std::unique_ptr<vkme::tools::CompositeRenderer> _compositeRenderer;
+    std::unique_ptr<vkme::tools::FrameCapture> _frameCapture;
+    std::unique_ptr<vkme::tools::DynamicResolution> _dynamicResolution;
+    bool _captureFrame = false;
+    bool _captureAllFrames = false;
     
     void initSkyResources();
     
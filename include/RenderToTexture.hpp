@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vkme/core/Image.hpp>
+#include <vkme/tools/CompositeRenderer.hpp>
 #include <vkme/VulkanData.hpp>
 #include <vkme/DrawLoop.hpp>
 #include <vkme/UserInterface.hpp>
@@ -23,8 +24,8 @@ struct Scene {
     VkPipeline pipeline;
     std::vector<std::shared_ptr<vkme::geo::Model>> models;
     
-    std::unique_ptr<vkme::core::Buffer> sceneDataBuffer;
-    std::unique_ptr<vkme::core::DescriptorSet> sceneDataDescriptorSet;
+    // Uploaded in each frame, so the projection can change while the frames in flight read
+    // the previous one
     SceneData sceneData;
     VkDescriptorSetLayout sceneDataDescriptorLayout;
     
@@ -33,7 +34,7 @@ struct Scene {
     VkSampler imageSampler;
     
     void initPipeline(vkme::VulkanData*);
-    void initScene(vkme::VulkanData*, vkme::core::DescriptorSetAllocator * dsAllocator, const glm::mat4& proj);
+    void initScene(const glm::mat4& proj);
 };
 
 class RenderToTexture : public vkme::DrawLoopDelegate, public vkme::UserInterfaceDelegate {
@@ -55,7 +56,8 @@ public:
 protected:
     vkme::VulkanData * _vulkanData;
     
-    std::shared_ptr<vkme::core::Image> _drawImage;
+    vkme::core::ImageHandle _drawImage;
+    std::unique_ptr<vkme::tools::CompositeRenderer> _compositeRenderer;
     std::shared_ptr<vkme::core::Image> _rttImage;
 	std::shared_ptr<vkme::core::Image> _rttDepthImage;
     
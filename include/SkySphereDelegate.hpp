@@ -3,9 +3,11 @@
 #include <vkme/core/Image.hpp>
 #include <vkme/VulkanData.hpp>
 #include <vkme/DrawLoop.hpp>
+#include <vkme/RenderGraph.hpp>
 #include <vkme/UserInterface.hpp>
 #include <vkme/geo/mesh_data.hpp>
 #include <vkme/geo/Model.hpp>
+#include <vkme/tools/CompositeRenderer.hpp>
 
 
 class SkySphereDelegate : public vkme::DrawLoopDelegate, public vkme::UserInterfaceDelegate {
@@ -27,7 +29,9 @@ public:
 protected:
     vkme::VulkanData * _vulkanData;
     
-    std::shared_ptr<vkme::core::Image> _drawImage;
+    vkme::core::ImageHandle _drawImage;
+    vkme::RenderGraph _renderGraph;
+    std::unique_ptr<vkme::tools::CompositeRenderer> _compositeRenderer;
     
     VkPipelineLayout _pipelineLayout;
     VkPipeline _pipeline;
@@ -42,8 +46,8 @@ protected:
         glm::mat4 proj;
         glm::mat4 viewProj;
     };
-    std::unique_ptr<vkme::core::Buffer> _sceneDataBuffer;
-    std::unique_ptr<vkme::core::DescriptorSet> _sceneDataDescriptorSet;
+    // The scene data is uploaded in each frame, so the projection can change while the frames
+    // in flight read the previous one
     SceneData _sceneData;
     VkDescriptorSetLayout _sceneDataDescriptorLayout;
     
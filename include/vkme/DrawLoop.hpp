@@ -24,8 +24,11 @@ public:
     virtual void initFrameResources(core::DescriptorSetAllocator* dsAllocator) {}
     
     // This function is called when the swapchain has been resized. Inside this function you can
-    // recreate any resource that depends on the viewport size, because the VulkanData class
-    // ensures that the device is iddle before calling this function.
+    // recreate any resource that depends on the viewport size. The device is not idle when this
+    // function is called, so the frames in flight may still use the old resources: release them
+    // with Image::releasePooledImage() or VulkanData::releaseAfterFramesInFlight(), and
+    // upload the data that depends on the size in each frame instead of updating the buffers and
+    // descriptor sets that the previous frames read.
     //
     // It is mandatory to implement this function to make sure that the delegate will handle the
     // image resizing case, otherwise the rendering may fail. If the delegate does not create any
@@ -34,6 +37,11 @@ public:
     // have to re-create them with the new size, or they have to be rendered using the size of
     // that image, and not the swapchain's size.
     virtual void swapchainResized(VkExtent2D newExtent) = 0;
+    
+    // Return true if the delegate destroys or updates in swapchainResized() resources that the
+    // frames in flight may use. In that case the DrawLoop waits until the device is idle before
+    // calling swapchainResized(), which stalls the GPU in each window resize
+    virtual bool waitIdleOnSwapchainResize() const { return false; }
 
     // Called before create the frame command buffer
     virtual void update(int32_t currentFrame, core::FrameResources&) {}
@@ -50,9 +58,8 @@ public:
     
     void acquireAndPresent();
     
-    // This function is called when the swapchain has been resized. Inside this function you can
-    // recreate any resource that depends on the viewport size, because the VulkanData class
-    // ensures that the device is iddle before calling this function.
+    // This function is called when the swapchain has been resized. It waits for the device to
+    // be idle if the delegate requires it
     void swapchainResized();
     
     void initFrameResources(core::DescriptorSetAllocator* dsAllocator)
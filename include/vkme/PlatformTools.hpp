@@ -34,6 +34,8 @@ class PlatformTools {
 public:
     static std::string shaderPath();
     static std::string assetPath();
+    // Writable directory for the files generated by the engine, such as the mesh cache
+    static std::string cachePath();
 };
 
 }
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <vkme/core/common.hpp>
+#include <vkme/core/Image.hpp>
+#include <vkme/core/Buffer.hpp>
+#include <vkme/core/BarrierBatch.hpp>
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <unordered_map>
+
+namespace vkme {
+
+/*
+ *  Frame graph. Instead of recording the rendering commands, the layout transitions and
+ *  the barriers by hand, each pass declares the images and buffers that it reads and
+ *  writes, and the function that records its commands. When the graph is executed:
+ *
+ *   - The passes that do not contribute to an output resource are culled. The output
+ *     resources are the ones marked with markOutput(), and the passes marked with
+ *     sideEffects() are never culled.
+ *   - The passes are sorted respecting the dependencies between them. Independent passes
+ *     may be reordered to separate the producers from their consumers, so the barriers
+ *     do not stall the pipeline immediately after the work they wait for.
+ *   - Before each pass, the graph records one batch with all the transitions and barriers
+ *     that the pass needs, using the sync state tracked by the images.
+ *
+ *  The graph is usually built again in each frame:
+ *
+ *      _renderGraph.clear();
+ *      _renderGraph.addPass("geometry")
+ *          .write(_drawImage.get(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
+ *          .write(depthImage, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, true)
+ *          .execute([&](VkCommandBuffer cmd) { ... });
+ *      _renderGraph.markOutput(colorImage);
+ *      _renderGraph.execute(cmd);
+ *
+ *  The reference returned by addPass() is only valid until the next call to addPass().
+ */
+class RenderGraph {
+public:
+    class Pass {
+        friend class RenderGraph;
+    public:
+        // Declare an image read. The image will be in this layout when the pass is executed
+        Pass& read(const core::Image* image, VkImageLayout layout);
+        Pass& read(const core::Image* image, const core::Image::SyncState& state);
+
+        // Declare an image write. If discardContents is true, the previous contents of the
+        // image are not preserved, and the passes that produce them could be culled
+        Pass& write(const core::Image* image, VkImageLayout layout, bool discardContents = false);
+        Pass& write(const core::Image* image, const core::Image::SyncState& state, bool discardContents = false);
+
+        Pass& readBuffer(const core::Buffer* buffer, VkPipelineStageFlags2 stageMask, VkAccessFlags2 accessMask);
+        Pass& writeBuffer(const core::Buffer* buffer, VkPipelineStageFlags2 stageMask, VkAccessFlags2 accessMask);
+
+        // The pass will never be culled, for example because it writes to the host or
+        // to a resource that is not managed by the graph
+        Pass& sideEffects();
+
+        Pass& execute(std::function<void(VkCommandBuffer)>&& fn);
+
+        inline const std::string& name() const { return _name; }
+
+    protected:
+        struct Access {
+            const void* resource;
+            const core::Image* image;
+            VkBuffer buffer;
+            core::Image::SyncState state;
+            bool write;
+            bool discard;
+        };
+
+        std::string _name;
+        std::vector<Access> _accesses;
+        std::function<void(VkCommandBuffer)> _execute;
+        bool _sideEffects = false;
+
+        Pass& addAccess(const Access& access);
+    };
+
+    Pass& addPass(const std::string& name);
+
+    // The contents of this resource are used outside the graph, for example the swapchain
+    // image or an image that is read in the next frame
+    void markOutput(const core::Image* image);
+    void markOutput(const core::Buffer* buffer);
+
+    // Cull, sort and record the passes in the command buffer
+    void execute(VkCommandBuffer cmd);
+
+    // Remove all the passes and outputs
+    void clear();
+
+    // The passes in execution order, after the last call to execute(). Useful for debugging
+    inline const std::vector<uint32_t>& executionOrder() const { return _executionOrder; }
+    inline const Pass& pass(uint32_t index) const { return _passes[index]; }
+    inline uint32_t passCount() const { return uint32_t(_passes.size()); }
+
+protected:
+    std::vector<Pass> _passes;
+    std::vector<const void*> _outputs;
+    std::vector<uint32_t> _executionOrder;
+
+    // The images track their own sync state. The buffer state is tracked by the graph during
+    // one execution, so the commands that write a buffer before the graph must make their
+    // writes visible (for example, using Command::immediateSubmit)
+    struct BufferState {
+        VkPipelineStageFlags2 stageMask = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2 accessMask = VK_ACCESS_2_NONE;
+    };
+    std::unordered_map<const void*, BufferState> _bufferStates;
+
+    core::BarrierBatch _barriers;
+
+    void cullPasses(std::vector<bool>& alive);
+    void sortPasses(const std::vector<bool>& alive);
+    void addBarriers(const Pass& pass);
+};
+
+}
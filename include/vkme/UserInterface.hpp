@@ -32,7 +32,14 @@ public:
 
     void newFrame();
     
-    void draw(VkCommandBuffer cmd, VkImageView targetImageView);
+    // The user interface is rendered into an overlay image, that is only updated if the ImGui draw
+    // data has changed since the last frame. The overlay is left in SHADER_READ_ONLY_OPTIMAL layout,
+    // and the CompositeRenderer blends it over the final image. Returns nullptr if the user
+    // interface is empty
+    const core::Image* updateOverlay(VkCommandBuffer cmd);
+    
+    // The swapchain can be recreated with a different number of images
+    void swapchainResized();
 
     void cleanup();
 
@@ -45,11 +52,18 @@ protected:
     VkCommandBuffer _commandBuffer;
     VkCommandPool _commandPool;
     VkDescriptorPool _imguiPool;
+    
+    // Cached user interface image, stored in the VulkanData image pool
+    core::ImageHandle _overlayImage;
+    uint64_t _drawDataHash = 0;
+    bool _overlayDirty = true;
+    bool _overlayEmpty = true;
 
     std::shared_ptr<UserInterfaceDelegate> _delegate;
     
     void initCommands();
     void initImGui();
+    void createOverlayImage();
 };
 
 }
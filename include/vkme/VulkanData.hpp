@@ -9,6 +9,9 @@
 #include <vkme/core/Command.hpp>
 #include <vkme/core/FrameResources.hpp>
 #include <vkme/core/CleanupManager.hpp>
+#include <vkme/core/Buffer.hpp>
+#include <vkme/core/Image.hpp>
+#include <vkme/core/GeometryArena.hpp>
 
 namespace vkme {
 
@@ -34,16 +37,48 @@ public:
     inline core::FrameResources& currentFrameResources() { return _frameResources[_currentFrame % core::FRAME_OVERLAP]; }
     inline const core::FrameResources& currentFrameResources() const { return _frameResources[_currentFrame % core::FRAME_OVERLAP]; }
     inline uint32_t currentFrame() const { return _currentFrame; }
-    inline void nextFrame() { ++_currentFrame; }
+    // Called by the draw loop when the recording of the current frame begins, after its frame
+    // resources have been flushed
+    inline void beginFrame() { _frameStarted = true; }
+    inline void nextFrame() { ++_currentFrame; _frameStarted = false; }
     void iterateFrameResources(std::function<void(core::FrameResources&)> cb);
     
     inline core::CleanupManager& cleanupManager() { return _cleanupManager; }
     
+    // Calls the function when all the frames that have been submitted until now, and the frame
+    // that is being recorded, have finished. Use it to release the resources that are replaced
+    // while the frames in flight may use them
+    void releaseAfterFramesInFlight(std::function<void(VkDevice)>&& fn);
+    
     inline VmaAllocator allocator() const { return _allocator; }
     
+    // Pools of the resources created with Buffer::createPooledBuffer() and
+    // Image::createPooledImage(). The resources that remain in the pools are
+    // destroyed in cleanup(). The images are created and destroyed outside of the
+    // frame recording, so the pointers to them are valid while a frame is recorded
+    inline core::BufferPool& bufferPool() { return _bufferPool; }
+    inline const core::BufferPool& bufferPool() const { return _bufferPool; }
+    inline core::ImagePool& imagePool() { return _imagePool; }
+    inline const core::ImagePool& imagePool() const { return _imagePool; }
+
+    // Shared vertex and index buffers of the meshes (see MeshBuffers)
+    inline core::GeometryArena& geometryArena() { return _geometryArena; }
+    inline const core::GeometryArena& geometryArena() const { return _geometryArena; }
+    
     inline void updateSwapchainSize() { _resizeRequested = true; }
     
-    // This function returns true if the swapchain have been resized
+    // True if the VK_KHR_present_id and VK_KHR_present_wait extensions are enabled
+    inline bool presentWaitSupported() const { return _presentWaitSupported; }
+
+    // True if the VK_EXT_mesh_shader extension is enabled, with the task and mesh shader stages
+    inline bool meshShaderSupported() const { return _meshShaderSupported; }
+
+    // True if the drawIndirectCount, multiDrawIndirect and drawIndirectFirstInstance features are
+    // enabled. They are required by the IndirectRenderer
+    inline bool indirectDrawSupported() const { return _indirectDrawSupported; }
+    
+    // This function returns true if the swapchain have been resized. The swapchain is recreated
+    // without waiting for the device
     bool newFrame();
 
 protected:
@@ -66,12 +101,20 @@ private:
     
     core::FrameResources _frameResources[core::FRAME_OVERLAP];
     uint32_t _currentFrame = 0;
+    bool _frameStarted = false;
     
     core::CleanupManager _cleanupManager;
     
     VmaAllocator _allocator = VK_NULL_HANDLE;
     
+    core::BufferPool _bufferPool;
+    core::ImagePool _imagePool;
+    core::GeometryArena _geometryArena;
+    
     bool _resizeRequested = false;
+    bool _presentWaitSupported = false;
+    bool _meshShaderSupported = false;
+    bool _indirectDrawSupported = false;
 
 
     void createInstance();
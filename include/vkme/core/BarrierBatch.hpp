@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vkme/core/common.hpp>
+#include <vector>
+
+namespace vkme {
+namespace core {
+
+/*
+ *  Collects image, buffer and global memory barriers and records all of them
+ *  with a single vkCmdPipelineBarrier2 call. Adding the barriers that do not
+ *  depend on each other to the same batch allows the driver to resolve all the
+ *  transitions at once, instead of draining the pipeline once per barrier.
+ *
+ *  Do not add two barriers for the same image to the same batch: the barriers
+ *  in a batch are not ordered between them.
+ */
+class BarrierBatch {
+public:
+    // Returns a filled VkImageMemoryBarrier2 structure for all the mipmaps and layers of the image
+    static VkImageMemoryBarrier2 imageBarrier(
+        VkImage               image,
+        VkImageAspectFlags    aspectMask,
+        VkImageLayout         oldLayout,
+        VkImageLayout         newLayout,
+        VkPipelineStageFlags2 srcStageMask,
+        VkAccessFlags2        srcAccessMask,
+        VkPipelineStageFlags2 dstStageMask,
+        VkAccessFlags2        dstAccessMask
+    );
+
+    // Returns only the write accesses. The read accesses do not need to be made available
+    // in the source scope of a barrier
+    static VkAccessFlags2 writeAccesses(VkAccessFlags2 access);
+
+    // Record one barrier without using a batch
+    static void cmdImageBarrier(VkCommandBuffer cmd, const VkImageMemoryBarrier2& barrier);
+
+    void addImageBarrier(
+        VkImage               image,
+        VkImageAspectFlags    aspectMask,
+        VkImageLayout         oldLayout,
+        VkImageLayout         newLayout,
+        VkPipelineStageFlags2 srcStageMask,
+        VkAccessFlags2        srcAccessMask,
+        VkPipelineStageFlags2 dstStageMask,
+        VkAccessFlags2        dstAccessMask
+    );
+
+    void addImageBarrier(const VkImageMemoryBarrier2& barrier);
+
+    void addBufferBarrier(
+        VkBuffer              buffer,
+        VkPipelineStageFlags2 srcStageMask,
+        VkAccessFlags2        srcAccessMask,
+        VkPipelineStageFlags2 dstStageMask,
+        VkAccessFlags2        dstAccessMask,
+        VkDeviceSize          offset = 0,
+        VkDeviceSize          size = VK_WHOLE_SIZE
+    );
+
+    void addMemoryBarrier(
+        VkPipelineStageFlags2 srcStageMask,
+        VkAccessFlags2        srcAccessMask,
+        VkPipelineStageFlags2 dstStageMask,
+        VkAccessFlags2        dstAccessMask
+    );
+
+    // Record all the barriers in the command buffer and clear the batch. It does
+    // nothing if the batch is empty.
+    void flush(VkCommandBuffer cmd);
+
+    void clear();
+
+    inline bool empty() const { return _imageBarriers.empty() && _bufferBarriers.empty() && _memoryBarriers.empty(); }
+
+protected:
+    std::vector<VkImageMemoryBarrier2> _imageBarriers;
+    std::vector<VkBufferMemoryBarrier2> _bufferBarriers;
+    std::vector<VkMemoryBarrier2> _memoryBarriers;
+};
+
+}
+}
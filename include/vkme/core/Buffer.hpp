@@ -1,11 +1,19 @@
 #pragma once
 
 #include <vkme/core/common.hpp>
-#include <vkme/VulkanData.hpp>
+#include <vkme/core/ResourcePool.hpp>
 
 namespace vkme {
+
+class VulkanData;
+
 namespace core {
 
+class Buffer;
+
+using BufferHandle = Handle<Buffer>;
+using BufferPool = ResourcePool<Buffer>;
+
 class Buffer {
 public:
 
@@ -16,6 +24,15 @@ public:
         VmaMemoryUsage memoryUsage
     );
 
+    // Create the buffer in the VulkanData buffer pool. The buffer is owned by the pool
+    // and it must be released using VulkanData::bufferPool().destroy(handle)
+    static BufferHandle createPooledBuffer(
+        VulkanData * vulkanData,
+        size_t allocSize,
+        VkBufferUsageFlags usage,
+        VmaMemoryUsage memoryUsage
+    );
+
     void cleanup();
 
     VkDeviceAddress deviceAddress() const;
@@ -25,11 +42,19 @@ public:
     inline VkBuffer buffer() const { return _buffer; }
     inline VmaAllocation allocation() const { return _allocation; }
     inline VmaAllocationInfo allocationInfo() const { return _info; }
+    inline VkDeviceSize size() const { return _info.size; }
 
 
 protected:
     Buffer() = default;
 
+    void allocate(
+        VulkanData * vulkanData,
+        size_t allocSize,
+        VkBufferUsageFlags usage,
+        VmaMemoryUsage memoryUsage
+    );
+
     VulkanData * _vulkanData;
 
     VkBuffer _buffer = VK_NULL_HANDLE;
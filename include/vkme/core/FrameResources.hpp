@@ -10,6 +10,7 @@ namespace vkme {
 namespace core {
 
 class DescriptorSetAllocator;
+class Image;
 
 struct FrameResources {
     VkCommandPool commandPool;
@@ -20,6 +21,10 @@ struct FrameResources {
     CleanupManager cleanupManager;
     DescriptorSetAllocator* descriptorAllocator;
     
+    // User interface overlay of the current frame, in SHADER_READ_ONLY_OPTIMAL layout, or nullptr
+    // if there is no user interface. The CompositeRenderer blends it over the final image
+    const Image* userInterfaceImage = nullptr;
+    
     void init(VkDevice device, Command * command);
     
     // Remove temporary resources used by this frame
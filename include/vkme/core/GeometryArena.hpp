@@ -0,0 +1,117 @@
+#pragma once
+
+#include <vkme/core/common.hpp>
+#include <vkme/core/Buffer.hpp>
+#include <vkme/core/OffsetAllocator.hpp>
+#include <vkme/core/ResourcePool.hpp>
+
+namespace vkme {
+
+class VulkanData;
+
+namespace core {
+
+enum class ArenaHeap
+{
+    // Storage buffer read with device addresses: vertex and position streams
+    Vertex,
+    // Index buffer
+    Index
+};
+
+// Range of one of the arena heaps. The offset changes when the heap grows or is compacted, so the
+// range is referenced with a handle and the offset is read when it's used
+struct ArenaRegion
+{
+    ArenaHeap heap = ArenaHeap::Vertex;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+
+    // Required by the ResourcePool. The range is released by the arena
+    void cleanup() {}
+};
+
+using ArenaRegionHandle = Handle<ArenaRegion>;
+
+/*
+ *  Shared GPU buffers for the geometry of all the meshes. There is one buffer for the vertex
+ *  streams and another for the indices, and each mesh stream is a region of one of them, managed
+ *  by an OffsetAllocator. The index buffer is bound once for all the meshes that use the same
+ *  index type, and the draws select the mesh with the first index.
+ *
+ *  When a heap is full, it's replaced by a larger one, and the live regions are copied to it
+ *  without gaps. compact() does the same without growing, to remove the fragmentation left by
+ *  the released meshes. The replaced buffers and the released regions are kept until the frames
+ *  in flight have finished, so the device addresses and the buffers must be requested each time
+ *  the commands are recorded.
+ */
+class GeometryArena {
+public:
+    struct Statistics {
+        VkDeviceSize capacity = 0;
+        VkDeviceSize usedSize = 0;
+        uint32_t regionCount = 0;
+        uint32_t freeRangeCount = 0;
+        VkDeviceSize largestFreeRange = 0;
+    };
+
+    void init(VulkanData* vulkanData, VkDeviceSize vertexCapacity = 32 * 1024 * 1024, VkDeviceSize indexCapacity = 8 * 1024 * 1024);
+
+    // Ensures that the heap has a free range of the size, to allocate a batch of regions without
+    // relocating the heap several times
+    void reserve(ArenaHeap heap, VkDeviceSize size);
+
+    ArenaRegionHandle allocate(ArenaHeap heap, VkDeviceSize size);
+
+    // The range is reused when the frames in flight have finished
+    void free(ArenaRegionHandle region);
+
+    // Moves the live regions to the start of new buffers of the same capacity
+    void compact();
+
+    const Buffer* buffer(ArenaHeap heap) const;
+    // Throws an exception if the region has been released
+    VkDeviceSize offset(ArenaRegionHandle region) const;
+    VkDeviceAddress deviceAddress(ArenaRegionHandle region) const;
+
+    // Binds the arena index buffer. The first index of a region is offset(region) / index size
+    void bindIndexBuffer(VkCommandBuffer cmd, VkIndexType indexType) const;
+
+    Statistics statistics(ArenaHeap heap) const;
+
+    // Incremented each time a heap is relocated. The objects that store device addresses or
+    // first indices of the regions must update them when it changes
+    inline uint32_t generation() const { return _generation; }
+
+    void cleanup();
+
+protected:
+    // The vertex regions are read with buffer references, aligned to 16 bytes by default. The
+    // index regions must be aligned to the size of the largest index type
+    static constexpr VkDeviceSize VertexAlignment = 16;
+    static constexpr VkDeviceSize IndexAlignment = 4;
+
+    struct Heap {
+        BufferHandle buffer;
+        VkDeviceAddress address = 0;
+        OffsetAllocator allocator;
+    };
+
+    VulkanData* _vulkanData = nullptr;
+    Heap _heaps[2];
+    ResourcePool<ArenaRegion> _regions;
+    uint32_t _generation = 0;
+
+    inline Heap& heap(ArenaHeap heap) { return _heaps[int(heap)]; }
+    inline const Heap& heap(ArenaHeap heap) const { return _heaps[int(heap)]; }
+
+    static VkDeviceSize alignment(ArenaHeap heap);
+
+    BufferHandle createHeapBuffer(ArenaHeap heap, VkDeviceSize capacity);
+
+    // Creates a new buffer with the capacity and copies the live regions to it, without gaps
+    void relocate(ArenaHeap heap, VkDeviceSize capacity);
+};
+
+}
+}
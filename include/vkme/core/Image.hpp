@@ -2,6 +2,7 @@
 #pragma once
 
 #include <vkme/core/common.hpp>
+#include <vkme/core/ResourcePool.hpp>
 
 namespace vkme {
 
@@ -10,17 +11,44 @@ class VulkanData;
 namespace core {
 
 class Swapchain;
+class Image;
+
+using ImageHandle = Handle<Image>;
+using ImagePool = ResourcePool<Image>;
+
+class BarrierBatch;
 
 class Image {
 public:
+    /*
+     *  Layout of an image, and the pipeline stages and memory accesses that are used
+     *  to work with the image in that layout.
+     */
+    struct SyncState {
+        VkImageLayout         layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags2 stageMask = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2        accessMask = VK_ACCESS_2_NONE;
+    };
+
+    /*
+     *  Returns the minimal stages and accesses needed to use an image in the specified
+     *  layout. For example, COLOR_ATTACHMENT_OPTIMAL returns the color attachment output
+     *  stage with color attachment read and write accesses.
+     */
+    static SyncState syncStateForLayout(VkImageLayout layout);
+
     /*
      *   Add an image transition command to the command buffer to switch from one layout
      *   to another.
      *
-     *   The default configuration of stageMask and accessMask will always work, but will
-     *   leave the queue stopped until the the queue stopped until the transition is complete.
+     *   If the stage masks are not specified, they are inferred from the layouts, using
+     *   syncStateForLayout(). Only the write accesses of the old layout are made available,
+     *   because read accesses do not need to be flushed. If the old layout is UNDEFINED,
+     *   there is no information about the previous use of the image, so the transition waits
+     *   for all the previous commands without flushing any cache.
      *
-     *   It is recommended to fine-tune these parameters for the intended use of the image.
+     *   If the image is used always through the same Image object, it's better to use the
+     *   cmdTransition() member function, that knows the current state of the image.
      */
     static void cmdTransitionImage(
         VkCommandBuffer       cmd,
@@ -28,10 +56,10 @@ public:
         VkImageLayout         oldLayout,
         VkImageLayout         newLayout,
         VkImageAspectFlags    aspectMask = 0,
-        VkPipelineStageFlags2 srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
-        VkAccessFlags2        srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT,
-        VkPipelineStageFlags2 dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
-        VkAccessFlags2        dstAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT
+        VkPipelineStageFlags2 srcStageMask = VK_PIPELINE_STAGE_2_NONE,
+        VkAccessFlags2        srcAccessMask = VK_ACCESS_2_NONE,
+        VkPipelineStageFlags2 dstStageMask = VK_PIPELINE_STAGE_2_NONE,
+        VkAccessFlags2        dstAccessMask = VK_ACCESS_2_NONE
     );
 
     /*
@@ -59,6 +87,21 @@ public:
         uint32_t arrayLayers = 1
     );
     
+    // Create the image in the VulkanData image pool. The image is owned by the pool
+    // and it must be released using VulkanData::imagePool().destroy(handle)
+    static ImageHandle createPooledImage(
+        VulkanData * vulkanData,
+        VkFormat format,
+        VkExtent2D extent,
+        VkImageUsageFlags usage,
+        VkImageAspectFlags aspectFlags = VK_IMAGE_ASPECT_COLOR_BIT,
+        uint32_t arrayLayers = 1
+    );
+    
+    // Destroys the pooled image when the frames in flight have finished, for example when it's
+    // replaced after a swapchain resize (see VulkanData::releaseAfterFramesInFlight())
+    static void releasePooledImage(VulkanData * vulkanData, ImageHandle image);
+    
     static Image* createAllocatedImage(
         VulkanData * vulkanData,
         void* data,
@@ -83,22 +126,60 @@ public:
     
     void cleanup();
 
+    /*
+     *  Tracked transitions: the image stores its current layout and the stages and accesses
+     *  of its last use, so the barrier only waits for what the image really needs.
+     *
+     *  - If discardContents is true, the image is transitioned from UNDEFINED, but the
+     *    barrier still waits for the previous use of the image.
+     *  - Use the BarrierBatch version to record several transitions in one barrier.
+     *  - The tracking state is not part of the logical state of the image, so it can be
+     *    updated through const images, such as the swapchain images passed to the delegates.
+     */
+    void cmdTransition(VkCommandBuffer cmd, VkImageLayout newLayout, bool discardContents = false) const;
+    void cmdTransition(VkCommandBuffer cmd, const SyncState& newState, bool discardContents = false) const;
+    void addTransition(BarrierBatch& batch, VkImageLayout newLayout, bool discardContents = false) const;
+    void addTransition(BarrierBatch& batch, const SyncState& newState, bool discardContents = false) const;
+
+    // Use this function to update the tracked state when the layout is changed outside of the
+    // Image class, for example with cmdTransitionImage(), or by the presentation engine.
+    inline void setSyncState(const SyncState& state) const { _syncState = state; }
+    inline const SyncState& syncState() const { return _syncState; }
+    inline VkImageLayout layout() const { return _syncState.layout; }
+
     inline VkImage image() const { return _image; }
     inline VkImageView imageView() const { return _imageView; }
     inline VmaAllocation allocation() const { return _allocation; }
     inline const VkExtent3D& extent() const { return _extent; }
     inline const VkExtent2D extent2D() const { return VkExtent2D{ _extent.width, _extent.height }; }
     inline VkFormat format() const { return _format; }
+    inline VkImageAspectFlags aspectFlags() const { return _aspectFlags; }
 
 protected:
     // Only allow create images using factory functions
     Image() = default;
     
+    // Builds the barrier to move the image from its current state to newState, and updates the
+    // tracked state. Returns false if no barrier is needed
+    bool transitionBarrier(const SyncState& newState, bool discardContents, VkImageMemoryBarrier2& barrier) const;
+    
+    void allocate(
+        VulkanData * vulkanData,
+        VkFormat format,
+        VkExtent2D extent,
+        VkImageUsageFlags usage,
+        VkImageAspectFlags aspectFlags,
+        uint32_t arrayLayers
+    );
+    
     VkImage _image = VK_NULL_HANDLE;
     VkImageView _imageView = VK_NULL_HANDLE;
     VmaAllocation _allocation = VK_NULL_HANDLE;
     VkExtent3D _extent = { 0, 0 };
     VkFormat _format;
+    VkImageAspectFlags _aspectFlags = VK_IMAGE_ASPECT_COLOR_BIT;
+    
+    mutable SyncState _syncState;
     
     VulkanData * _vulkanData;
 };
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+
+namespace vkme {
+namespace core {
+
+/*
+ *  Allocator of ranges inside a block of memory that is managed somewhere else, for example a
+ *  large GPU buffer. It only keeps the bookkeeping: the free ranges are indexed by offset, to
+ *  merge the neighbours when a range is freed, and by size, to find the smallest free range
+ *  where the allocation fits (best fit).
+ */
+class OffsetAllocator {
+public:
+    static constexpr uint64_t InvalidOffset = ~uint64_t(0);
+
+    OffsetAllocator(uint64_t capacity = 0);
+
+    // Returns InvalidOffset if there is not a free range large enough. The alignment must be a
+    // power of two
+    uint64_t allocate(uint64_t size, uint64_t alignment = 1);
+
+    // Returns false if there is not an allocation at the offset
+    bool free(uint64_t offset);
+
+    // Adds the new space at the end. The capacity can't be reduced
+    void grow(uint64_t capacity);
+
+    // Removes all the allocations
+    void reset(uint64_t capacity);
+
+    inline uint64_t capacity() const { return _capacity; }
+    inline uint64_t usedSize() const { return _usedSize; }
+    inline uint32_t allocationCount() const { return uint32_t(_allocations.size()); }
+    inline uint32_t freeRangeCount() const { return uint32_t(_freeByOffset.size()); }
+    uint64_t largestFreeRange() const;
+
+protected:
+    uint64_t _capacity = 0;
+    uint64_t _usedSize = 0;
+
+    // offset -> size
+    std::map<uint64_t, uint64_t> _freeByOffset;
+    std::multimap<uint64_t, uint64_t> _freeBySize;
+
+    struct Allocation {
+        // The alignment padding is also part of the range
+        uint64_t rangeOffset;
+        uint64_t rangeSize;
+    };
+    std::unordered_map<uint64_t, Allocation> _allocations;
+
+    void insertFreeRange(uint64_t offset, uint64_t size);
+    void eraseFreeRange(std::map<uint64_t, uint64_t>::iterator it);
+};
+
+}
+}
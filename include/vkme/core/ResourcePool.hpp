@@ -0,0 +1,244 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include <functional>
+
+namespace vkme {
+namespace core {
+
+template <class T> class ResourcePool;
+
+/*
+ *  32 bit handle to a resource stored in a ResourcePool. The lower 20 bits store
+ *  the slot index and the upper 12 bits store the slot generation. The generation
+ *  of a slot is incremented each time a resource is destroyed, so a handle that
+ *  outlives its resource can be detected instead of accessing a different resource
+ *  that reused the same slot.
+ *
+ *  The generation 0 is never used by a live resource, so a default constructed
+ *  handle is always invalid.
+ */
+template <class T>
+class Handle {
+public:
+    static constexpr uint32_t IndexBits = 20;
+    static constexpr uint32_t GenerationBits = 12;
+    static constexpr uint32_t IndexMask = (1u << IndexBits) - 1;
+    static constexpr uint32_t GenerationMask = (1u << GenerationBits) - 1;
+    static constexpr uint32_t MaxIndex = IndexMask;
+
+    Handle() = default;
+
+    inline uint32_t index() const { return _value & IndexMask; }
+    inline uint32_t generation() const { return (_value >> IndexBits) & GenerationMask; }
+    inline uint32_t value() const { return _value; }
+    inline bool valid() const { return generation() != 0; }
+
+    inline explicit operator bool() const { return valid(); }
+    inline bool operator==(const Handle& other) const { return _value == other._value; }
+    inline bool operator!=(const Handle& other) const { return _value != other._value; }
+
+    static Handle fromValue(uint32_t value) { Handle h; h._value = value; return h; }
+
+protected:
+    friend class ResourcePool<T>;
+
+    Handle(uint32_t index, uint32_t generation)
+        :_value{ (index & IndexMask) | ((generation & GenerationMask) << IndexBits) }
+    {}
+
+    uint32_t _value = 0;
+};
+
+static_assert(sizeof(Handle<int>) == sizeof(uint32_t), "Resource handles must be 32 bit");
+
+/*
+ *  Generational pool with dense storage. The resources are stored contiguously in
+ *  a vector, so iterating over the live resources (for example to collect statistics,
+ *  to evict or to defragment memory) does not jump over empty slots. The handles point
+ *  to an indirection table of slots, that stores the position of the resource in the
+ *  dense array and the current generation of the slot.
+ *
+ *  When a resource is destroyed, the last resource of the dense array is moved to the
+ *  position of the destroyed one, so the pointers returned by get() are only valid until
+ *  the next call to insert() or destroy(). Store handles, not pointers.
+ *
+ *  The resource type must implement a cleanup() function, that is called when the
+ *  resource is destroyed through the pool.
+ */
+template <class T>
+class ResourcePool {
+public:
+    using HandleType = Handle<T>;
+
+    ResourcePool() = default;
+    ResourcePool(const ResourcePool&) = delete;
+    ResourcePool& operator=(const ResourcePool&) = delete;
+
+    HandleType insert(T&& resource)
+    {
+        uint32_t slotIndex;
+        if (!_freeSlots.empty())
+        {
+            slotIndex = _freeSlots.back();
+            _freeSlots.pop_back();
+        }
+        else
+        {
+            if (_slots.size() > HandleType::MaxIndex)
+            {
+                throw std::runtime_error("ResourcePool::insert(): the maximum number of resources has been reached");
+            }
+            slotIndex = uint32_t(_slots.size());
+            _slots.push_back({ InvalidIndex, 1 });
+        }
+
+        auto& slot = _slots[slotIndex];
+        slot.denseIndex = uint32_t(_dense.size());
+        _dense.emplace_back(std::move(resource));
+        _denseToSlot.push_back(slotIndex);
+
+        return HandleType(slotIndex, slot.generation);
+    }
+
+    // Returns true if the handle points to a live resource of this pool
+    inline bool contains(HandleType handle) const
+    {
+        if (!handle.valid() || handle.index() >= _slots.size())
+        {
+            return false;
+        }
+        const auto& slot = _slots[handle.index()];
+        return slot.generation == handle.generation() && slot.denseIndex != InvalidIndex;
+    }
+
+    // Returns nullptr if the handle is not valid or the resource has been destroyed
+    inline T* get(HandleType handle)
+    {
+        return contains(handle) ? &_dense[_slots[handle.index()].denseIndex] : nullptr;
+    }
+
+    inline const T* get(HandleType handle) const
+    {
+        return contains(handle) ? &_dense[_slots[handle.index()].denseIndex] : nullptr;
+    }
+
+    // Same as get(), but throws an exception if the handle is stale. Use it
+    // where a dangling handle is a programming error.
+    T& at(HandleType handle)
+    {
+        auto result = get(handle);
+        if (result == nullptr)
+        {
+            throw std::runtime_error("ResourcePool::at(): use of an invalid or destroyed resource handle");
+        }
+        return *result;
+    }
+
+    const T& at(HandleType handle) const
+    {
+        auto result = get(handle);
+        if (result == nullptr)
+        {
+            throw std::runtime_error("ResourcePool::at(): use of an invalid or destroyed resource handle");
+        }
+        return *result;
+    }
+
+    // Calls cleanup() on the resource and removes it from the pool. Returns false
+    // if the handle was already invalid.
+    bool destroy(HandleType handle)
+    {
+        if (!contains(handle))
+        {
+            return false;
+        }
+
+        _dense[_slots[handle.index()].denseIndex].cleanup();
+        remove(handle);
+        return true;
+    }
+
+    // Removes the resource from the pool without calling cleanup()
+    bool remove(HandleType handle)
+    {
+        if (!contains(handle))
+        {
+            return false;
+        }
+
+        auto& slot = _slots[handle.index()];
+        uint32_t denseIndex = slot.denseIndex;
+        uint32_t lastIndex = uint32_t(_dense.size() - 1);
+        if (denseIndex != lastIndex)
+        {
+            _dense[denseIndex] = std::move(_dense[lastIndex]);
+            _denseToSlot[denseIndex] = _denseToSlot[lastIndex];
+            _slots[_denseToSlot[denseIndex]].denseIndex = denseIndex;
+        }
+        _dense.pop_back();
+        _denseToSlot.pop_back();
+
+        slot.denseIndex = InvalidIndex;
+        slot.generation = (slot.generation + 1) & HandleType::GenerationMask;
+        if (slot.generation == 0)
+        {
+            slot.generation = 1;
+        }
+        _freeSlots.push_back(handle.index());
+        return true;
+    }
+
+    // Destroy all the resources
+    void clear()
+    {
+        for (auto i = _dense.size(); i > 0; --i)
+        {
+            destroy(handleAt(uint32_t(i - 1)));
+        }
+    }
+
+    inline uint32_t size() const { return uint32_t(_dense.size()); }
+    inline bool empty() const { return _dense.empty(); }
+    inline uint32_t capacity() const { return uint32_t(_slots.size()); }
+
+    // Dense access: index is a position between 0 and size() - 1
+    inline T& operator[](uint32_t denseIndex) { return _dense[denseIndex]; }
+    inline const T& operator[](uint32_t denseIndex) const { return _dense[denseIndex]; }
+    inline HandleType handleAt(uint32_t denseIndex) const
+    {
+        uint32_t slotIndex = _denseToSlot[denseIndex];
+        return HandleType(slotIndex, _slots[slotIndex].generation);
+    }
+
+    inline typename std::vector<T>::iterator begin() { return _dense.begin(); }
+    inline typename std::vector<T>::iterator end() { return _dense.end(); }
+    inline typename std::vector<T>::const_iterator begin() const { return _dense.begin(); }
+    inline typename std::vector<T>::const_iterator end() const { return _dense.end(); }
+
+    void forEach(const std::function<void(HandleType, T&)>& fn)
+    {
+        for (uint32_t i = 0; i < size(); ++i)
+        {
+            fn(handleAt(i), _dense[i]);
+        }
+    }
+
+protected:
+    static constexpr uint32_t InvalidIndex = 0xFFFFFFFF;
+
+    struct Slot {
+        uint32_t denseIndex;
+        uint32_t generation;
+    };
+
+    std::vector<T> _dense;
+    std::vector<uint32_t> _denseToSlot;
+    std::vector<Slot> _slots;
+    std::vector<uint32_t> _freeSlots;
+};
+
+}
+}
@@ -4,6 +4,8 @@
 #include <vkme/core/Image.hpp>
 #include <vector>
 #include <memory>
+#include <deque>
+#include <chrono>
 
 namespace vkme {
 
@@ -15,6 +17,10 @@ class Swapchain {
 public:
     
     void init(VulkanData * vulkanData, uint32_t width, uint32_t height);
+    
+    // The new swapchain is created using the current one as oldSwapchain, so the device does not
+    // need to be idle. The old swapchain, its image views and the depth image are released when
+    // the frames in flight finish, using VulkanData::releaseAfterFramesInFlight()
     void resize(uint32_t width, uint32_t height);
     void cleanup();
     
@@ -32,9 +38,45 @@ public:
         return _colorImages[index];
     }
     
-    inline const Image* depthImage() const { return _depthImage; }
+    // The depth image is stored in the VulkanData image pool
+    const Image* depthImage() const;
+    
+    const VkFormat depthImageFormat() const;
+    
+    // The present mode and the image count are applied the next time the swapchain is created.
+    // The setters request the swapchain recreation to the VulkanData object. If the present mode is
+    // not supported, another mode is used: MAILBOX falls back to IMMEDIATE, IMMEDIATE to MAILBOX
+    // and FIFO_RELAXED to FIFO, that is always available.
+    void setPresentMode(VkPresentModeKHR mode);
+    inline VkPresentModeKHR requestedPresentMode() const { return _requestedPresentMode; }
+    // The present mode actually used
+    inline VkPresentModeKHR presentMode() const { return _presentMode; }
+    std::vector<VkPresentModeKHR> supportedPresentModes() const;
+    
+    // Minimum number of images requested to the presentation engine. Use 0 to use the
+    // surface minimum plus one
+    void setMinImageCount(uint32_t count);
+    inline uint32_t requestedMinImageCount() const { return _requestedMinImageCount; }
+    inline uint32_t minImageCount() const { return _minImageCount; }
+    inline uint32_t imageCount() const { return uint32_t(_images.size()); }
     
-    inline const VkFormat depthImageFormat() const { return _depthImage != nullptr ? _depthImage->format() : VK_FORMAT_UNDEFINED; }
+    // Latency control. These functions only work if VulkanData::presentWaitSupported() is true.
+    //
+    // beginFrame() must be called before reading the input of the frame. If the maximum frame
+    // latency is not zero, it waits until the presentation engine has presented the image of
+    // the frame that is maxFrameLatency frames older than the new one.
+    //
+    // nextPresentId() returns the id to add to the VkPresentInfoKHR of the frame, or zero if
+    // the present id is not supported.
+    //
+    // The latency is the time between beginFrame() and the moment in which the image is
+    // presented. It is measured without blocking, so it has the precision of the frame rate
+    void beginFrame();
+    uint64_t nextPresentId();
+    void updatePresentLatency();
+    inline void setMaxFrameLatency(uint32_t frames) { _maxFrameLatency = frames; }
+    inline uint32_t maxFrameLatency() const { return _maxFrameLatency; }
+    inline float presentLatency() const { return _presentLatency; }
 
 protected:
     VkSwapchainKHR _swapchain;
@@ -45,9 +87,23 @@ protected:
     VkExtent2D _extent;
     
     std::vector<Image *> _colorImages;
-    Image * _depthImage;
+    ImageHandle _depthImage;
 
     VulkanData* _vulkanData = nullptr;
+    
+    VkPresentModeKHR _requestedPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+    VkPresentModeKHR _presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    uint32_t _requestedMinImageCount = 0;
+    uint32_t _minImageCount = 0;
+    
+    using Clock = std::chrono::steady_clock;
+    uint64_t _lastPresentId = 0;
+    uint32_t _maxFrameLatency = 0;
+    float _presentLatency = 0.0f;
+    Clock::time_point _frameStartTime;
+    std::deque<std::pair<uint64_t, Clock::time_point>> _pendingPresents;
+    
+    void build(uint32_t width, uint32_t height, VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE);
 };
 
 }
@@ -62,10 +62,33 @@ void cmdPipelineBarrier2(
     VkCommandBuffer                             commandBuffer,
     const VkDependencyInfo*                     pDependencyInfo);
 
+void cmdSetEvent2(
+    VkCommandBuffer                             commandBuffer,
+    VkEvent                                     event,
+    const VkDependencyInfo*                     pDependencyInfo);
+
 // VK_KHR_copy_commands2
 void cmdBlitImage2(
     VkCommandBuffer                             commandBuffer,
     const VkBlitImageInfo2*                     pBlitImageInfo);
 
+// VK_KHR_present_wait. This extension is optional: check VulkanData::presentWaitSupported()
+// before calling this function
+VkResult waitForPresent(
+    VkDevice                                    device,
+    VkSwapchainKHR                              swapchain,
+    uint64_t                                    presentId,
+    uint64_t                                    timeout);
+
+// VK_EXT_mesh_shader. This extension is optional: check VulkanData::meshShaderSupported()
+// before calling this function
+void cmdDrawMeshTasksIndirect(
+    VkDevice                                    device,
+    VkCommandBuffer                             commandBuffer,
+    VkBuffer                                    buffer,
+    VkDeviceSize                                offset,
+    uint32_t                                    drawCount,
+    uint32_t                                    stride);
+
 }
 }
@@ -28,6 +28,7 @@ public:
     void disableBlending();
     void enableBlendingAdditive();
     void enableBlendingAlphablend();
+    void enableBlendingPremultipliedAlpha();
     
     VkPipelineVertexInputStateCreateInfo vertexInputState = {};
     VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
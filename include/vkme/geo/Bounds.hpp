@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vkme/geo/mesh_data.hpp>
+
+#include <limits>
+#include <vector>
+
+namespace vkme {
+namespace geo {
+
+// Axis aligned bounding box. The default box is empty, with min greater than max, so it can be
+// expanded with any point
+struct BoundingBox
+{
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+
+    // Bounds of the vertices referenced by the indices
+    static BoundingBox fromIndexedVertices(const uint32_t* indices, size_t indexCount, const std::vector<Vertex>& vertices);
+
+    inline bool empty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+    inline glm::vec3 center() const { return (min + max) * 0.5f; }
+    inline glm::vec3 size() const { return max - min; }
+
+    void expand(const glm::vec3& point);
+    void expand(const BoundingBox& box);
+
+    // Area of the faces, used as the cost of the BVH nodes. It's 0 for an empty box
+    float surfaceArea() const;
+
+    bool intersects(const BoundingBox& other) const;
+    bool contains(const glm::vec3& point) const;
+
+    // Bounds of the transformed box, computed from the matrix columns without transforming
+    // the corners (Arvo, Transforming Axis-Aligned Bounding Boxes)
+    BoundingBox transform(const glm::mat4& matrix) const;
+};
+static_assert(sizeof(BoundingBox) == 24, "The bounding box is stored in the mesh cache");
+
+// Bounding sphere of a set of vertices. The center is the center of the bounding box, so it's
+// not the minimal sphere, but it is fast to compute and it does not depend on the vertex order.
+// The layout matches a vec4 in the shaders: center (xyz) and radius (w)
+struct BoundingSphere
+{
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+
+    // Bounds of the vertices referenced by the indices
+    static BoundingSphere fromIndexedVertices(const uint32_t* indices, size_t indexCount, const std::vector<Vertex>& vertices);
+
+    // The radius is scaled by the largest scale of the matrix, so the sphere still contains
+    // the transformed vertices if the scale is not uniform
+    BoundingSphere transform(const glm::mat4& matrix) const;
+};
+static_assert(sizeof(BoundingSphere) == 16, "The bounding sphere layout must match the shaders");
+
+}
+}
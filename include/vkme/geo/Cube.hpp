@@ -9,7 +9,7 @@ namespace geo {
 class Cube : public Model
 {
 public:
-    static std::shared_ptr<Model> createCube(VulkanData* vulkanData, float side, const std::string& name = "cube", const std::vector<std::shared_ptr<Modifier>>& mods = {});
+    static std::shared_ptr<Model> createCube(VulkanData* vulkanData, float side, const std::string& name = "cube", const std::vector<std::shared_ptr<Modifier>>& mods = {}, VertexFormat vertexFormat = VertexFormat::Standard, bool positionStream = false);
     
 };
 
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vkme/geo/mesh_data.hpp>
+
+#include <fastgltf/types.hpp>
+
+#include <cstddef>
+
+namespace vkme {
+namespace geo {
+
+/*
+ *  Bulk reads of the glTF accessors used by the meshes. The accessors that are stored in a
+ *  loaded buffer, in one of the usual component types and without sparse data, are copied or
+ *  converted in a loop over the buffer bytes, directly into the destination vertices. When the
+ *  elements are tightly packed (the stride is the element size) the loops use a constant stride,
+ *  and the 32 bit indices without base vertex are copied with memcpy. The other accessors use the
+ *  fastgltf element iterators.
+ *
+ *  The destination arrays must have accessor.count elements.
+ */
+class GltfAccessorReader {
+public:
+    // Adds baseVertex to each index
+    static void readIndices(const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, uint32_t baseVertex, uint32_t* dst);
+
+    static void readPositions(const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, Vertex* dst);
+    static void readNormals(const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, Vertex* dst);
+    static void readUvs(const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, Vertex* dst);
+    static void readColors(const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, Vertex* dst);
+
+protected:
+    // Returns the address of the first element and the distance between elements, or nullptr if
+    // the accessor can't be read directly from the buffer
+    static const std::byte* directData(const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, size_t& stride);
+};
+
+}
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vkme/geo/mesh_data.hpp>
+#include <vkme/geo/Bounds.hpp>
+#include <vkme/tools/MappedFile.hpp>
+
+#include <string>
+#include <vector>
+
+namespace vkme {
+namespace geo {
+
+/*
+ *  Binary cache of imported meshes. The file stores the vertex, index, position and meshlet streams
+ *  already encoded in the format of the GPU buffers (see EncodedMesh), after welding, modifiers
+ *  and optimization, the surface table of each mesh and the mesh instances of the scene. The
+ *  file name is the cache key, that is a hash of the contents of the source files (including the
+ *  external buffers of the glTF files) and of the import options.
+ *
+ *  The files are memory mapped, so the streams are copied directly from the file to the staging
+ *  buffer. The streams are only valid while the MeshCache object is open.
+ *
+ *  Each store() trims the cache directory: the files written by other versions are removed, and
+ *  then the least recently used files, until the directory fits in MaxSize. Opening a file
+ *  updates its modification time, so that time is used as the last access time.
+ */
+class MeshCache {
+public:
+    // Increment it when the file layout or the encoding of the streams changes
+    static constexpr uint32_t Version = 7;
+    // Maximum size of the cache directory, in bytes
+    static constexpr uint64_t MaxSize = 1024ull * 1024ull * 1024ull;
+
+    struct Surface {
+        uint32_t startIndex;
+        uint32_t indexCount;
+        BoundingSphere boundingSphere;
+        BoundingBox boundingBox;
+        uint32_t meshletOffset;
+        uint32_t meshletCount;
+        uint32_t lodCount;
+        LodLevel lods[LodLevel::MaxLevels];
+    };
+
+    struct Mesh {
+        std::string name;
+        EncodedMesh encodedMesh;
+        std::vector<Surface> surfaces;
+    };
+
+    // Placement of a mesh in the scene, for the formats that have a node hierarchy
+    struct Instance {
+        uint32_t meshIndex;
+        glm::mat4 transform;
+    };
+
+    struct MeshView {
+        std::string name;
+        MeshUploadData uploadData;
+        std::vector<Surface> surfaces;
+    };
+
+    // FNV-1a hash, used to build the cache keys
+    class KeyBuilder {
+    public:
+        KeyBuilder& add(const void* data, size_t size);
+        KeyBuilder& add(const std::string& str);
+
+        template <class T>
+        KeyBuilder& addValue(const T& value) { return add(&value, sizeof(T)); }
+
+        inline uint64_t key() const { return _hash; }
+
+    protected:
+        uint64_t _hash = 0xCBF29CE484222325ull;
+    };
+
+    // Returns false if the file does not exist, or if it was written by another version
+    bool open(uint64_t key);
+    void close();
+
+    inline const std::vector<MeshView>& meshes() const { return _meshes; }
+    inline const std::vector<Instance>& instances() const { return _instances; }
+
+    // Errors are not fatal: the meshes are imported again the next time
+    static void store(uint64_t key, const std::vector<Mesh>& meshes, const std::vector<Instance>& instances = {});
+
+    static std::string filePath(uint64_t key);
+
+    // Removes the files of other versions, the abandoned temporary files and the least recently
+    // used files until the cache fits in maxSize. Errors are ignored
+    static void evict(uint64_t maxSize = MaxSize);
+
+protected:
+    tools::MappedFile _file;
+    std::vector<MeshView> _meshes;
+    std::vector<Instance> _instances;
+};
+
+}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vkme/geo/mesh_data.hpp>
+
+#include <vector>
+
+namespace vkme {
+namespace geo {
+
+/*
+ *  Index and vertex reordering to reduce the cost of the vertex and fragment shaders. The
+ *  functions must be called in this order, because each one keeps most of the work of the
+ *  previous one:
+ *
+ *      1. optimizeVertexCache(): reorders the triangles to reuse the vertices that are still in
+ *         the post-transform cache (Tom Forsyth, Linear-Speed Vertex Cache Optimisation).
+ *      2. optimizeOverdraw(): splits the triangles in clusters that keep the cache efficiency,
+ *         and sorts the clusters to draw first the outer ones (Sander et al, Fast Triangle
+ *         Reordering for Vertex Locality and Reduced Overdraw).
+ *      3. optimizeVertexFetch(): sorts the vertex buffer in the order in which the vertices are
+ *         used, so the vertex fetch reads the memory sequentially.
+ *
+ *  The index based functions work with a range of indices, so they can be used with each surface
+ *  of a model that share the same vertex buffer.
+ */
+class MeshOptimizer {
+public:
+    struct VertexCacheStatistics {
+        uint32_t verticesTransformed = 0;
+        // Average Cache Miss Ratio: transformed vertices per triangle. The ideal value for a
+        // regular mesh is 0.5, and 3 means that there is no vertex reuse at all
+        float acmr = 0.0f;
+        // Average Transformed to Vertex Ratio: transformed vertices per vertex. The ideal value is 1
+        float atvr = 0.0f;
+    };
+
+    struct OverdrawStatistics {
+        uint32_t pixelsCovered = 0;
+        uint32_t pixelsShaded = 0;
+        // Shaded fragments per covered pixel, with early depth test. The ideal value is 1
+        float overdraw = 0.0f;
+    };
+
+    static void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+    // threshold is the maximum ACMR degradation allowed to reduce the overdraw: 1.05 allows the
+    // clusters to have a 5% worse ACMR than the vertex cache optimized mesh
+    static void optimizeOverdraw(uint32_t* indices, size_t indexCount, const std::vector<Vertex>& vertices, float threshold = 1.05f);
+
+    // Sorts the vertices by first use and removes the unused ones. The indices are updated
+    static void optimizeVertexFetch(std::vector<uint32_t>& indices, std::vector<Vertex>& vertices);
+
+    // Simulates a FIFO post-transform cache, that is the one implemented by most of the GPUs
+    static VertexCacheStatistics analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = 16);
+
+    // Rasterizes the mesh from the six axis directions with a small software rasterizer. The back
+    // faces are culled, using counter clockwise front faces
+    static OverdrawStatistics analyzeOverdraw(const uint32_t* indices, size_t indexCount, const std::vector<Vertex>& vertices);
+};
+
+}
+}
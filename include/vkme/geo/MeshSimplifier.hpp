@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vkme/geo/mesh_data.hpp>
+
+#include <vector>
+
+namespace vkme {
+namespace geo {
+
+/*
+ *  Mesh simplification with quadric error metrics (Garland and Heckbert, Surface Simplification
+ *  Using Quadric Error Metrics). The edges are collapsed to one of their vertices, so the result
+ *  only references the vertices of the source mesh: the simplified levels of a surface share the
+ *  vertex buffer with the full detail surface, and only add indices.
+ *
+ *  The collapses are applied in passes. Each pass sorts the candidate edges by error and collapses
+ *  the cheapest ones that do not share triangles, rejecting the collapses that flip a triangle.
+ *  The vertices of the open borders only collapse along the border, and the vertices with several
+ *  copies with different attributes (normal or texture seams) do not move, so the outline of the
+ *  surface and the attribute discontinuities are kept.
+ */
+class MeshSimplifier {
+public:
+    // Simplifies a range of indices until it has targetIndexCount indices or less, or until the
+    // next collapse would move the surface more than targetError, relative to the size of the
+    // bounds of the range. The error of the result is returned in resultError, in object space
+    static std::vector<uint32_t> simplify(
+        const uint32_t* indices,
+        size_t indexCount,
+        const std::vector<Vertex>& vertices,
+        size_t targetIndexCount,
+        float targetError,
+        float* resultError = nullptr
+    );
+};
+
+}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vkme/geo/mesh_data.hpp>
+#include <vkme/geo/Bounds.hpp>
+
+#include <vector>
+
+namespace vkme {
+namespace geo {
+
+// Cluster of triangles of a surface, as it's read by the shaders
+struct Meshlet
+{
+    // Object space bounds of the vertices of the meshlet
+    BoundingSphere boundingSphere;
+    // Normal cone. All the triangles are back facing from the camera positions c that satisfy
+    // dot(center - c, coneAxis) >= coneCutoff * length(center - c) + radius. The cutoff is 1 if
+    // the normals are too spread, so the test never passes
+    glm::vec3 coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    float coneCutoff = 1.0f;
+    // Vertex list (mesh vertex indices) and triangle list (three local 8 bit indices in each
+    // word). See MeshletData for the meaning of the offsets
+    uint32_t vertexOffset = 0;
+    uint32_t triangleOffset = 0;
+    // First index of the triangles in the index buffer, relative to the start of the surface
+    uint32_t firstIndex = 0;
+    uint16_t vertexCount = 0;
+    uint16_t triangleCount = 0;
+};
+static_assert(sizeof(Meshlet) == 48, "The meshlet layout must match the shaders");
+
+/*
+ *  Meshlets of a mesh, for cluster culling and mesh shaders. The meshlets are built with a scan of
+ *  the index buffer, so each one is a range of consecutive triangles of a surface and the order
+ *  produced by MeshOptimizer is kept. Call it after the optimization: the vertex cache order
+ *  is also the most compact order for the clusters.
+ *
+ *  In the vectors, the offsets of the meshlets are indices in vertices and triangles. The GPU
+ *  stream produced by encode() stores the meshlets, the vertex lists and the triangle lists one
+ *  after the other, and the offsets are converted to 32 bit words from the start of the stream.
+ */
+struct MeshletData
+{
+    // The limits recommended for most of the mesh shader implementations
+    static constexpr uint32_t MaxVertices = 64;
+    static constexpr uint32_t MaxTriangles = 124;
+
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> vertices;
+    std::vector<uint32_t> triangles;
+
+    // Appends the meshlets of a range of indices, that must be a surface. The firstIndex of the
+    // meshlets is relative to the first index of the range. Returns the index of the first meshlet
+    uint32_t build(const uint32_t* indices, size_t indexCount, const std::vector<Vertex>& vertices);
+
+    std::vector<uint8_t> encode() const;
+};
+
+}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace vkme {
+namespace geo {
+
+/*
+ *  Decoder of the buffer views compressed with the EXT_meshopt_compression glTF extension. The
+ *  bitstreams are the ones produced by the meshoptimizer encoders:
+ *
+ *      - decodeVertexBuffer(): ATTRIBUTES mode. The vertices are split in blocks, and each byte of
+ *        the vertex is stored as a delta to the previous vertex, packed in groups of 16 values
+ *        with 0, 2, 4 or 8 bits per value. The version 1 of the codec adds a control byte per
+ *        channel of 4 bytes, that selects the bits per value (0 to 8), literal or zero streams,
+ *        and a channel type to apply the deltas to 16 bit values or to xor 32 bit values.
+ *      - decodeIndexBuffer(): TRIANGLES mode. The triangles are coded with a FIFO of recently
+ *        used edges and another of recently used vertices.
+ *      - decodeIndexSequence(): INDICES mode. Each index is a delta to one of two baselines.
+ *
+ *  The filters are applied in place after decoding the buffer, to the elements of byteStride
+ *  bytes. All the functions are thread safe, so several buffer views can be decoded in parallel.
+ *  The decode functions return false if the data is not a valid bitstream.
+ */
+class MeshoptDecoder {
+public:
+    // The vertex size must be a multiple of 4, and not greater than 256
+    static bool decodeVertexBuffer(void* dst, size_t vertexCount, size_t vertexSize, const uint8_t* src, size_t srcSize);
+
+    // The index size is 2 or 4 bytes. The index count of decodeIndexBuffer() is a multiple of 3
+    static bool decodeIndexBuffer(void* dst, size_t indexCount, size_t indexSize, const uint8_t* src, size_t srcSize);
+    static bool decodeIndexSequence(void* dst, size_t indexCount, size_t indexSize, const uint8_t* src, size_t srcSize);
+
+    // Octahedral normals or tangents, stored as 4 snorm8 or 4 snorm16. The stride is 4 or 8
+    static void filterOctahedral(void* data, size_t count, size_t stride);
+    // Quaternions with the largest component omitted, stored as 4 int16. The stride is 8
+    static void filterQuaternion(void* data, size_t count, size_t stride);
+    // Floats stored as a 24 bit mantissa and an 8 bit exponent. The stride is a multiple of 4
+    static void filterExponential(void* data, size_t count, size_t stride);
+};
+
+}
+}
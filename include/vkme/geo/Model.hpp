@@ -5,7 +5,11 @@
 #include <vkme/geo/mesh_data.hpp>
 #include <vkme/VulkanData.hpp>
 #include <vkme/core/DescriptorSetAllocator.hpp>
+#include <vkme/core/ResourcePool.hpp>
 #include <vkme/geo/Modifiers.hpp>
+#include <vkme/geo/MeshCache.hpp>
+#include <vkme/geo/Bounds.hpp>
+#include <vkme/geo/Meshlet.hpp>
 
 #include <vector>
 #include <filesystem>
@@ -15,6 +19,25 @@
 namespace vkme {
 namespace geo {
 
+// Optional data that the loaders generate for each mesh. It's stored in the mesh cache with
+// the rest of the mesh, and it's part of the cache key
+struct ImportOptions
+{
+    // Simplified levels of detail of each surface, that are selected by Model::selectLods() or
+    // by the IndirectRenderer (see Model::buildLods)
+    bool lods = false;
+    // Meshlets with bounds and normal cones of each surface, that the IndirectRenderer culls and
+    // draws as clusters (see Model::buildMeshlets)
+    bool meshlets = false;
+    // Vertex cache, overdraw and vertex fetch optimization of the meshes (see MeshOptimizer)
+    bool optimize = false;
+};
+
+class Model;
+
+using ModelHandle = core::Handle<Model>;
+using ModelPool = core::ResourcePool<Model>;
+
 class Model
 {
 public:
@@ -22,26 +45,82 @@ public:
     {
         uint32_t startIndex;
         uint32_t indexCount;
+        // Object space bounds of the vertices of the surface
+        BoundingSphere boundingSphere;
+        BoundingBox boundingBox;
+        // Range of the surface in the meshlets of the mesh (see MeshBuffers::meshletRegion)
+        uint32_t meshletOffset = 0;
+        uint32_t meshletCount = 0;
+        // Simplified levels, from the most to the least detailed (see buildLods)
+        uint32_t lodCount = 0;
+        LodLevel lods[LodLevel::MaxLevels];
+
+        // The level 0 is the full detail surface
+        inline uint32_t levelCount() const { return lodCount + 1; }
+        LodLevel level(uint32_t index) const;
+
+        // Returns the least detailed level with an error that is not greater than 1 when it's
+        // multiplied by errorScale, that converts the object space error to the allowed screen error
+        uint32_t selectLevel(float errorScale) const;
     };
 
     Model() = default;
     Model(const std::string& name, std::vector<GeoSurface>&& surfaces, MeshBuffers* meshBuffers)
         :_name{ name }, _surfaces{ std::move(surfaces) }, _meshBuffers{ meshBuffers }
     {}
+    Model(const std::string& name, const std::vector<GeoSurface>& surfaces, const std::shared_ptr<MeshBuffers>& meshBuffers)
+        :_name{ name }, _surfaces{ surfaces }, _meshBuffers{ meshBuffers }
+    {}
 
-    static std::vector<std::shared_ptr<Model>> loadGltf(VulkanData* vulkanData, const std::filesystem::path& filePath, bool overrideColors = false);
+    // The packed vertex formats require a vertex shader that decodes them (see PackedVertex).
+    // Use positionStream to store also the positions in a separate stream (see MeshBuffers).
+    // The imported meshes are stored in the mesh cache, and loaded from it the next time (see MeshCache)
+    static std::vector<std::shared_ptr<Model>> loadGltf(
+        VulkanData* vulkanData,
+        const std::filesystem::path& filePath,
+        bool overrideColors = false,
+        VertexFormat vertexFormat = VertexFormat::Standard,
+        bool positionStream = false,
+        const ImportOptions& importOptions = {}
+    );
+    // Returns one model for each node of the default scene that references a mesh, with the world
+    // transform of the node in the model matrix. The nodes that reference the same mesh share
+    // the mesh buffers (see createInstance)
+    static std::vector<std::shared_ptr<Model>> loadGltfScene(
+        VulkanData* vulkanData,
+        const std::filesystem::path& filePath,
+        bool overrideColors = false,
+        VertexFormat vertexFormat = VertexFormat::Standard,
+        bool positionStream = false,
+        const ImportOptions& importOptions = {}
+    );
     static std::vector<std::shared_ptr<Model>> loadObj(
         VulkanData* vulkanData,
         const std::filesystem::path& filePath,
-        const std::vector<std::shared_ptr<Modifier>>& modifiers = {}
+        const std::vector<std::shared_ptr<Modifier>>& modifiers = {},
+        VertexFormat vertexFormat = VertexFormat::Standard,
+        bool positionStream = false,
+        const ImportOptions& importOptions = {}
     );
     static std::vector<std::shared_ptr<Model>> loadObj(
         VulkanData* vulkanData,
         std::istream& inputStream,
         const std::string& name = "obj model",
-        const std::vector<std::shared_ptr<Modifier>>& modifiers = {}
+        const std::vector<std::shared_ptr<Modifier>>& modifiers = {},
+        VertexFormat vertexFormat = VertexFormat::Standard,
+        bool positionStream = false,
+        const ImportOptions& importOptions = {}
     );
 
+    // The instance shares the mesh buffers and copies the surfaces. The material descriptor sets
+    // are not copied, because each instance can use different materials
+    std::shared_ptr<Model> createInstance(const glm::mat4& modelMatrix) const;
+    // Same as above, but the instance is stored in the pool. The pool calls cleanup() when the
+    // instance is destroyed
+    ModelHandle createInstance(ModelPool& pool, const glm::mat4& modelMatrix) const;
+
+    // Releases the reference to the mesh buffers. They are destroyed, and their arena regions
+    // released, when the last instance that shares them is cleaned up or destroyed
     void cleanup();
 
     inline const MeshBuffers* meshBuffers() const { return _meshBuffers.get(); }
@@ -49,14 +128,33 @@ public:
     inline const std::vector<GeoSurface>& surfaces() const { return _surfaces; }
     inline std::vector<GeoSurface>& surfaces() { return _surfaces; }
     inline const GeoSurface& surface(uint32_t index) { return _surfaces[index]; }
+    // Object space bounds of all the surfaces
+    BoundingBox bounds() const;
     inline const glm::mat4& modelMatrix() const { return _modelMatrix; }
     inline glm::mat4& modelMatrix() { return _modelMatrix; }
     inline void setModelMatrix(const glm::mat4& modelMatrix) { _modelMatrix = modelMatrix; }
 
+    // Selects the level of detail of the surfaces drawn by draw(), using the projected error of the
+    // levels at the distance of the surface bounds. maxScreenError is in pixels. The models that are
+    // loaded without ImportOptions::lods only have the full detail level
+    void selectLods(const glm::mat4& view, const glm::mat4& proj, float viewportHeight, float maxScreenError = 1.0f);
+    // Selected level of each surface. It's empty until selectLods() is called
+    inline const std::vector<uint32_t>& surfaceLods() const { return _surfaceLods; }
+    // draw() uses the full detail level again
+    inline void clearLods() { _surfaceLods.clear(); }
+
     void allocateMaterialDescriptorSets(core::DescriptorSetAllocator* allocator, VkDescriptorSetLayout descriptorLayout);
     void updateDescriptorSets(std::function<void(core::DescriptorSet*)>&& updateFunc);
 
-    void draw(VkCommandBuffer cmd, VkPipelineLayout pipelineLayout, core::DescriptorSet* descriptorSets[] = nullptr, uint32_t numDescriptorSets = 0, int32_t pushConstantIndex = 0);
+    // The vertex stream selects the buffer address that is passed to the shader in the push constants
+    void draw(
+        VkCommandBuffer cmd,
+        VkPipelineLayout pipelineLayout,
+        core::DescriptorSet* descriptorSets[] = nullptr,
+        uint32_t numDescriptorSets = 0,
+        int32_t pushConstantIndex = 0,
+        VertexStream vertexStream = VertexStream::Attributes
+    );
 
 protected:
     std::string _name;
@@ -64,8 +162,52 @@ protected:
     std::vector<GeoSurface> _surfaces;
     std::vector<std::unique_ptr<core::DescriptorSet>> _materialDescriptorSets;
     bool _useMaterialDescriptorSets = false;
-    std::unique_ptr<MeshBuffers> _meshBuffers;
-    glm::mat4 _modelMatrix;
+    std::shared_ptr<MeshBuffers> _meshBuffers;
+    glm::mat4 _modelMatrix = glm::mat4(1.0f);
+    std::vector<uint32_t> _surfaceLods;
+
+    // Returns one model for each mesh, and the instances of the default scene
+    static std::vector<std::shared_ptr<Model>> importGltf(
+        VulkanData* vulkanData,
+        const std::filesystem::path& filePath,
+        bool overrideColors,
+        VertexFormat vertexFormat,
+        bool positionStream,
+        const ImportOptions& importOptions,
+        std::vector<MeshCache::Instance>& instances
+    );
+
+    // Returns false if the meshes are not in the cache
+    static bool loadCachedMeshes(
+        VulkanData* vulkanData,
+        uint64_t cacheKey,
+        std::vector<std::shared_ptr<Model>>& result,
+        std::vector<MeshCache::Instance>* instances = nullptr
+    );
+    // Uploads all the meshes in one transfer
+    static std::vector<std::shared_ptr<Model>> uploadModels(VulkanData* vulkanData, const std::vector<MeshCache::Mesh>& meshes);
+    static std::vector<GeoSurface> geoSurfaces(const std::vector<MeshCache::Surface>& surfaces);
+    static MeshCache::Mesh cacheMesh(const std::string& name, EncodedMesh&& encodedMesh, const std::vector<GeoSurface>& surfaces);
+
+    // Vertex cache and overdraw optimization of each surface, and vertex fetch optimization of the
+    // whole mesh
+    static void optimizeMesh(std::vector<uint32_t>& indices, std::vector<Vertex>& vertices, const std::vector<GeoSurface>& surfaces);
+
+    // Call it after the modifiers, that can move the vertices
+    static void updateSurfaceBounds(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, std::vector<GeoSurface>& surfaces);
+
+    // Appends the simplified levels of each surface to the indices, halving the triangles in each
+    // level. Call it after the optimization: the levels use the same vertices
+    static void buildLods(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, std::vector<GeoSurface>& surfaces);
+
+    // Builds the meshlets of each level of the surfaces and stores them in the meshlet stream of
+    // the encoded mesh. Call it after the optimization, that defines the order of the triangles
+    static void buildMeshlets(
+        const std::vector<uint32_t>& indices,
+        const std::vector<Vertex>& vertices,
+        std::vector<GeoSurface>& surfaces,
+        EncodedMesh& encodedMesh
+    );
 };
 
 }
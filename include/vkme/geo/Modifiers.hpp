@@ -2,23 +2,34 @@
 
 #include <vkme/geo/mesh_data.hpp>
 
+#include <string>
+
 namespace vkme {
 namespace geo {
 
 class Modifier {
 public:
     virtual ~Modifier() = default; 
+
+    // The loaders process the meshes in parallel, so apply() can be called from several threads
+    // at the same time, with different meshes
     virtual void apply(std::vector<uint32_t>& indices, std::vector<Vertex>& vertices) = 0;
+
+    // Identifies the modifier and its parameters in the mesh cache key. The models loaded
+    // with a modifier that returns an empty key are not cached
+    virtual std::string cacheKey() const { return ""; }
 };
 
 class FlipFacesModifier : public Modifier {
 public:
     void apply(std::vector<uint32_t>& indices, std::vector<Vertex>& vertices);
+    std::string cacheKey() const;
 };
 
 class FlipNormalsModifier : public Modifier {
 public:
     void apply(std::vector<uint32_t>& indices, std::vector<Vertex>& vertices);
+    std::string cacheKey() const;
 };
 
 class ScaleModifier : public Modifier {
@@ -27,6 +38,7 @@ public:
     ScaleModifier(float sx, float sy, float sz) : _sx { sx }, _sy { sy }, _sz { sz } {}
 
     void apply(std::vector<uint32_t>& indices, std::vector<Vertex>& vertices);
+    std::string cacheKey() const;
     
 protected:
     float _sx, _sy, _sz;
@@ -35,6 +47,7 @@ protected:
 class OverrideColorsModifier : public Modifier {
 public:
     void apply(std::vector<uint32_t>& indices, std::vector<Vertex>& vertices);
+    std::string cacheKey() const;
 };
 
 }
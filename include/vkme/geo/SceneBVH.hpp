@@ -0,0 +1,140 @@
+#pragma once
+
+#include <vkme/geo/Model.hpp>
+#include <vkme/geo/Bounds.hpp>
+
+#include <limits>
+#include <vector>
+
+namespace vkme {
+namespace geo {
+
+/*
+ *  Bounding volume hierarchy of the models of a scene, for the CPU side visibility, picking and
+ *  spatial queries. The leaves store the world space bounds of the models: the bounds of their
+ *  surfaces transformed by the model matrix. The models are referenced by their handle in the
+ *  ModelPool passed to the constructor, and the tree throws an exception if one of them has been
+ *  destroyed while it's in the tree.
+ *
+ *  build() creates the tree with the surface area heuristic, evaluated in bins of the centroids.
+ *  When the models move, refit() updates the bounds of the nodes without changing the tree. It's
+ *  much faster than a new build, but the tree gets worse if the models move far from the place
+ *  where they were when it was built. In that case, or after adding models, call build() again.
+ *
+ *      SceneBVH bvh(modelPool);
+ *      bvh.add(modelHandle);
+ *      bvh.build();
+ *      ...
+ *      modelPool.at(modelHandle).setModelMatrix(matrix);
+ *      bvh.refit();
+ *      bvh.queryFrustum(proj * view, visibleModels);
+ *
+ *  The queries return the indices of the models, in the order in which they were added.
+ */
+class SceneBVH {
+public:
+    struct Ray
+    {
+        glm::vec3 origin;
+        glm::vec3 direction;
+    };
+
+    struct RayHit
+    {
+        uint32_t model = 0;
+        uint32_t surface = 0;
+        // Distance in units of the ray direction
+        float distance = 0.0f;
+    };
+
+    explicit SceneBVH(const ModelPool& modelPool) :_modelPool{ &modelPool } {}
+
+    // Returns the index of the model in the results of the queries
+    uint32_t add(ModelHandle model);
+    void clear();
+
+    inline uint32_t modelCount() const { return uint32_t(_models.size()); }
+    inline ModelHandle model(uint32_t index) const { return _models[index]; }
+    // World space bounds of the model, updated by build() and refit()
+    inline const BoundingBox& modelBounds(uint32_t index) const { return _modelBounds[index]; }
+    // Bounds of all the models
+    inline BoundingBox bounds() const { return _nodes.empty() ? BoundingBox() : _nodes[0].bounds; }
+
+    void build();
+    // Updates the bounds from the current model matrices
+    void refit();
+
+    // The results are appended to the vector. The queries throw an exception if the models
+    // were added after the last build()
+    void queryFrustum(const glm::mat4& viewProjection, std::vector<uint32_t>& result) const;
+    void queryBox(const BoundingBox& box, std::vector<uint32_t>& result) const;
+    void querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& result) const;
+
+    // Nearest surface hit by the ray, tested against the object space bounding boxes of the
+    // surfaces. Returns false if the ray does not hit any surface before maxDistance
+    bool raycast(const Ray& ray, RayHit& hit, float maxDistance = std::numeric_limits<float>::max()) const;
+
+protected:
+    struct Node
+    {
+        BoundingBox bounds;
+        // Interior nodes: index of the first child, the second one is the next node. Leaves:
+        // first index in _leafModels
+        uint32_t first = 0;
+        // Number of models of the leaves, 0 in the interior nodes
+        uint32_t count = 0;
+    };
+
+    const ModelPool* _modelPool;
+    std::vector<ModelHandle> _models;
+    std::vector<BoundingBox> _modelBounds;
+    std::vector<uint32_t> _leafModels;
+    std::vector<Node> _nodes;
+    bool _built = false;
+
+    void updateModelBounds();
+    void buildNode(uint32_t nodeIndex, uint32_t begin, uint32_t end);
+    void collectModels(uint32_t nodeIndex, std::vector<uint32_t>& result) const;
+    void checkBuilt() const;
+
+    // Visits the nodes that pass the test, and appends the models of the leaves that pass it
+    template <class NodeTest>
+    void query(NodeTest&& test, std::vector<uint32_t>& result) const
+    {
+        checkBuilt();
+        if (_nodes.empty())
+        {
+            return;
+        }
+
+        std::vector<uint32_t> stack = { 0 };
+        while (!stack.empty())
+        {
+            auto& node = _nodes[stack.back()];
+            stack.pop_back();
+            if (!test(node.bounds))
+            {
+                continue;
+            }
+            if (node.count > 0)
+            {
+                for (uint32_t i = 0; i < node.count; ++i)
+                {
+                    auto model = _leafModels[node.first + i];
+                    if (test(_modelBounds[model]))
+                    {
+                        result.push_back(model);
+                    }
+                }
+            }
+            else
+            {
+                stack.push_back(node.first);
+                stack.push_back(node.first + 1);
+            }
+        }
+    }
+};
+
+}
+}
@@ -9,7 +9,7 @@ namespace geo {
 class Sphere : public Model
 {
 public:
-    static std::shared_ptr<Model> createUvSphere(VulkanData* vulkanData, float radius, const std::string& name = "sphere", const std::vector<std::shared_ptr<Modifier>>& mods = {});
+    static std::shared_ptr<Model> createUvSphere(VulkanData* vulkanData, float radius, const std::string& name = "sphere", const std::vector<std::shared_ptr<Modifier>>& mods = {}, VertexFormat vertexFormat = VertexFormat::Standard, bool positionStream = false);
     
 };
 
@@ -2,6 +2,10 @@
 
 #include <vkme/core/common.hpp>
 #include <vkme/core/Buffer.hpp>
+#include <vkme/core/GeometryArena.hpp>
+
+#include <vector>
+#include <cstring>
 
 
 namespace vkme {
@@ -39,18 +43,234 @@ protected:
     // TODO: tangent uv2X uv2Y
 };
 
+enum class VertexFormat
+{
+    // Vertex, 48 bytes
+    Standard,
+    // PackedVertex without the color, 12 bytes
+    Packed,
+    // PackedVertex, 16 bytes
+    PackedColor
+};
+
+// Quantized vertex. The position and the texture coordinates are stored as unorm16 relative to the
+// bounds of the mesh (see VertexQuantization), the normal is octahedral encoded in two snorm8, and
+// the color is stored as unorm8. The shaders read it as an array of 32 bit words:
+//
+//      word 0: position x | position y << 16
+//      word 1: position z | normal x << 16 | normal y << 24
+//      word 2: uv x | uv y << 16
+//      word 3: color rgba (only in VertexFormat::PackedColor)
+struct PackedVertex
+{
+    uint16_t position[3];
+    int8_t normal[2];
+    uint16_t uv[2];
+    uint8_t color[4];
+};
+static_assert(sizeof(PackedVertex) == 16, "The packed vertex layout must match the shaders");
+
+// Bounds used to quantize the packed vertices: value = offset + quantized * scale
+struct VertexQuantization
+{
+    glm::vec3 positionOffset = glm::vec3(0.0f);
+    glm::vec3 positionScale = glm::vec3(1.0f);
+    glm::vec2 uvOffset = glm::vec2(0.0f);
+    glm::vec2 uvScale = glm::vec2(1.0f);
+
+    static VertexQuantization fromVertices(const std::vector<Vertex>& vertices);
+
+    PackedVertex pack(const Vertex& vertex) const;
+};
+
+// Simplified level of detail of a surface (see MeshSimplifier). The indices and the meshlets are
+// ranges of the same buffers as the full detail surface. The error is the maximum distance from
+// the simplified to the full detail surface, in object space
+struct LodLevel
+{
+    // Maximum number of simplified levels of a surface, without the full detail level
+    static constexpr uint32_t MaxLevels = 8;
+
+    uint32_t startIndex = 0;
+    uint32_t indexCount = 0;
+    uint32_t meshletOffset = 0;
+    uint32_t meshletCount = 0;
+    float error = 0.0f;
+};
+
+// Vertex attributes that can be stored in a vertex stream
+struct PositionAttribute
+{
+    using Type = glm::vec3;
+    static Type get(const Vertex& vertex) { return vertex.position(); }
+};
+
+struct NormalAttribute
+{
+    using Type = glm::vec3;
+    static Type get(const Vertex& vertex) { return vertex.normal(); }
+};
+
+struct UvAttribute
+{
+    using Type = glm::vec2;
+    static Type get(const Vertex& vertex) { return vertex.uv1(); }
+};
+
+struct ColorAttribute
+{
+    using Type = glm::vec4;
+    static Type get(const Vertex& vertex) { return vertex.color(); }
+};
+
+// Compile time layout of a tightly packed vertex stream: the attributes are stored one after the
+// other, without padding. The shaders must read the stream as an array of floats, because the
+// std430 layout aligns the vec3 arrays to 16 bytes
+template <class... Attributes>
+struct VertexStreamLayout
+{
+    static constexpr size_t stride = (sizeof(typename Attributes::Type) + ...);
+
+    static void write(const Vertex& vertex, uint8_t* dst)
+    {
+        ((writeAttribute<Attributes>(vertex, dst), dst += sizeof(typename Attributes::Type)), ...);
+    }
+
+    static std::vector<uint8_t> build(const std::vector<Vertex>& vertices)
+    {
+        std::vector<uint8_t> result(vertices.size() * stride);
+        for (size_t i = 0; i < vertices.size(); ++i)
+        {
+            write(vertices[i], result.data() + i * stride);
+        }
+        return result;
+    }
+
+protected:
+    template <class Attribute>
+    static void writeAttribute(const Vertex& vertex, uint8_t* dst)
+    {
+        auto value = Attribute::get(vertex);
+        memcpy(dst, &value, sizeof(value));
+    }
+};
+
+// Position only stream, for the passes that do not need the other attributes
+using PositionStreamLayout = VertexStreamLayout<PositionAttribute>;
+static_assert(PositionStreamLayout::stride == 12, "The position stream must be tightly packed");
+
+enum class VertexStream
+{
+    // Vertex buffer, in the mesh vertex format
+    Attributes,
+    // Position stream, with PositionStreamLayout
+    Positions
+};
+
+// Mesh streams in the format of the GPU buffers. The data is not owned by this struct, it can
+// point to an EncodedMesh or to a memory mapped file. positionData and meshletData are nullptr if
+// the mesh does not have these streams
+struct MeshUploadData
+{
+    const void* vertexData = nullptr;
+    size_t vertexDataSize = 0;
+    const void* indexData = nullptr;
+    size_t indexDataSize = 0;
+    const void* positionData = nullptr;
+    size_t positionDataSize = 0;
+    const void* meshletData = nullptr;
+    size_t meshletDataSize = 0;
+    uint32_t meshletCount = 0;
+    uint32_t indexCount = 0;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+    VertexFormat vertexFormat = VertexFormat::Standard;
+    VertexQuantization quantization;
+};
+
+// Vertex, index, position and meshlet streams encoded in the format of the GPU buffers
+struct EncodedMesh
+{
+    std::vector<uint8_t> vertexData;
+    std::vector<uint8_t> indexData;
+    std::vector<uint8_t> positionData;
+    // Optional, see MeshletData::encode()
+    std::vector<uint8_t> meshletData;
+    uint32_t meshletCount = 0;
+    uint32_t indexCount = 0;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+    VertexFormat vertexFormat = VertexFormat::Standard;
+    VertexQuantization quantization;
+
+    // The meshes with less than 65536 vertices use 16 bit indices
+    static EncodedMesh encode(
+        const std::vector<uint32_t>& indices,
+        const std::vector<Vertex>& vertices,
+        VertexFormat vertexFormat = VertexFormat::Standard,
+        bool positionStream = false
+    );
+
+    MeshUploadData uploadData() const;
+};
+
+// Mesh streams stored in the VulkanData geometry arena. The vertex, position and meshlet streams
+// are regions of the vertex heap, read with device addresses, and the indices are a region of
+// the index heap
 class MeshBuffers
 {
 public:
-    core::Buffer* indexBuffer = nullptr;
-    core::Buffer* vertexBuffer = nullptr;
-    VkDeviceAddress vertexBufferAddress = 0;
+    core::ArenaRegionHandle vertexRegion;
+    core::ArenaRegionHandle indexRegion;
+    // Optional position stream
+    core::ArenaRegionHandle positionRegion;
+    // Optional meshlet stream (see MeshletData)
+    core::ArenaRegionHandle meshletRegion;
+    uint32_t meshletCount = 0;
     uint32_t indexCount = 0;
+    // See EncodedMesh::encode()
+    VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+    VertexFormat vertexFormat = VertexFormat::Standard;
+    VertexQuantization quantization;
+
+    MeshBuffers() = default;
+    // The regions are released when the mesh buffers are destroyed, so they can't be copied
+    MeshBuffers(const MeshBuffers&) = delete;
+    MeshBuffers& operator=(const MeshBuffers&) = delete;
+    ~MeshBuffers() { cleanup(); }
 
-    static MeshBuffers* uploadMesh(VulkanData* vulkanData, const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices);
+    static MeshBuffers* uploadMesh(
+        VulkanData* vulkanData,
+        const std::vector<uint32_t>& indices,
+        const std::vector<Vertex>& vertices,
+        VertexFormat vertexFormat = VertexFormat::Standard,
+        bool positionStream = false
+    );
 
+    static MeshBuffers* uploadMeshData(VulkanData* vulkanData, const MeshUploadData& meshData);
+
+    // Uploads all the meshes with one staging buffer and one submit
+    static std::vector<MeshBuffers*> uploadMeshes(VulkanData* vulkanData, const std::vector<MeshUploadData>& meshes);
+
+    // The arena can move the regions, so the addresses and the first index must be requested
+    // each time the commands are recorded. The position address is 0 if the mesh does not have
+    // a position stream, and the same for the meshlet address
+    VkDeviceAddress vertexBufferAddress() const;
+    VkDeviceAddress positionBufferAddress() const;
+    VkDeviceAddress meshletBufferAddress() const;
+
+    // Throws an exception if the mesh does not have the requested stream
+    VkDeviceAddress streamAddress(VertexStream stream) const;
+
+    // Binds the arena index buffer with the index type of the mesh. Add firstIndex() to the
+    // first index of the draws
+    void bindIndexBuffer(VkCommandBuffer cmd) const;
+    uint32_t firstIndex() const;
+
+    // Releases the arena regions after the frames in flight. It's called by the destructor, so it
+    // is only needed to release the regions before the object is destroyed
     void cleanup();
 
+protected:
+    VulkanData* _vulkanData = nullptr;
 };
 
 // This is a very bad idea. I recomend using a uniform buffer instead.
@@ -59,6 +279,15 @@ struct MeshPushConstants
     glm::mat4 modelMatrix;
     VkDeviceAddress vertexBufferAddress;
     int32_t index;
+    // Packed vertices: size of the vertex in 32 bit words, or 0 for the standard vertex format
+    uint32_t packedVertexStride = 0;
+    // Dequantization of the packed vertices. The w component is not used
+    glm::vec4 positionOffset = glm::vec4(0.0f);
+    glm::vec4 positionScale = glm::vec4(1.0f);
+    // Texture coordinates offset (xy) and scale (zw)
+    glm::vec4 uvTransform = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+
+    void setVertexFormat(const MeshBuffers* meshBuffers);
 };
 
 }
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vkme/VulkanData.hpp>
+#include <vkme/core/DescriptorSetAllocator.hpp>
+#include <vkme/core/Image.hpp>
+#include <memory>
+#include <vector>
+
+namespace vkme::tools {
+
+/*
+ *  Writes an HDR image into the swapchain image with a fullscreen triangle, applying the
+ *  exposure, the tonemapping and a dithering to hide the banding of the 8 bit swapchain.
+ *
+ *  This replaces the TRANSFER_SRC/TRANSFER_DST transitions and the blit to copy the draw
+ *  image into the swapchain. The user interface overlay of the frame resources is blended
+ *  over the result in the same pass, so the swapchain image is written only once.
+ *
+ *  The HDR image stores linear colors. The swapchain uses an UNORM format, that is required to
+ *  draw the user interface, so the result is encoded in sRGB in the shader. With an sRGB target
+ *  format the encoding is done by the hardware.
+ *
+ *  The descriptor set is allocated from the frame resources. Call getFrameResourcesRequirements(),
+ *  or initFrameResources(), in the initFrameResources() function of the delegate.
+ */
+class CompositeRenderer {
+public:
+    enum class Tonemap : int32_t {
+        None = 0,
+        Reinhard = 1,
+        ACES = 2
+    };
+
+    CompositeRenderer(VulkanData*);
+
+    static void getFrameResourcesRequirements(std::vector<core::DescriptorSetAllocator::PoolSizeRatio>& requiredRatios);
+
+    // Initializes the frame resources allocator with the requirements of the composite renderer,
+    // and the ratios of the other descriptor sets that the delegate allocates in each frame
+    static void initFrameResources(
+        core::DescriptorSetAllocator* allocator,
+        std::vector<core::DescriptorSetAllocator::PoolSizeRatio> ratios = {},
+        uint32_t maxSets = 10
+    );
+
+    // Creates and initializes a composite renderer that writes in the swapchain image
+    static std::unique_ptr<CompositeRenderer> create(VulkanData* vulkanData, Tonemap tonemap = Tonemap::ACES);
+
+    // targetFormat is the format of the image where the composite is rendered, usually
+    // the swapchain image format
+    void init(VkFormat targetFormat);
+
+    // hdrImage must be in SHADER_READ_ONLY_OPTIMAL layout and targetImage in COLOR_ATTACHMENT_OPTIMAL.
+    // The user interface image of the frame resources must have the size of the target image
+    void draw(
+        VkCommandBuffer cmd,
+        uint32_t currentFrame,
+        const core::Image* hdrImage,
+        const core::Image* targetImage,
+        core::FrameResources& frameResources
+    );
+
+    inline void setExposure(float exposure) { _exposure = exposure; }
+    inline float exposure() const { return _exposure; }
+    inline void setTonemap(Tonemap tonemap) { _tonemap = tonemap; }
+    inline Tonemap tonemap() const { return _tonemap; }
+    inline void setDitherEnabled(bool enabled) { _ditherEnabled = enabled; }
+    inline bool ditherEnabled() const { return _ditherEnabled; }
+
+    // Region of the HDR image that is used, relative to its size. Use it to render the
+    // HDR image at a lower resolution than the swapchain
+    inline void setInputScale(float x, float y) { _inputScale = glm::vec2(x, y); }
+
+protected:
+    VulkanData* _vulkanData;
+
+    VkPipelineLayout _pipelineLayout;
+    VkPipeline _pipeline;
+    VkDescriptorSetLayout _inputImageDSLayout;
+    VkSampler _imageSampler;
+
+    float _exposure = 1.0f;
+    Tonemap _tonemap = Tonemap::ACES;
+    bool _ditherEnabled = true;
+    glm::vec2 _inputScale = glm::vec2(1.0f);
+    bool _encodeSrgb = true;
+
+    struct CompositePushConstants {
+        glm::vec2 uvScale;
+        float exposure;
+        int32_t tonemapOperator;
+        float ditherAmount;
+        uint32_t frameIndex;
+        uint32_t userInterface;
+        uint32_t encodeSrgb;
+    };
+};
+
+}
@@ -37,7 +37,7 @@ protected:
     std::shared_ptr<vkme::geo::Model> _cube;
 
     struct SkySpherePushConstant {
-        VkDeviceAddress vertexBufferAddress;
+        VkDeviceAddress positionBufferAddress;
         int currentFace;
     };
 
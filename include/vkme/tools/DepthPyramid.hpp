@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vkme/VulkanData.hpp>
+#include <vkme/core/DescriptorSetAllocator.hpp>
+#include <vector>
+
+namespace vkme::tools {
+
+/*
+ *  Hierarchical depth buffer, used for occlusion culling. Each texel of a level stores the
+ *  farthest depth of the texels that it covers in the previous level, or in the depth image for
+ *  the level 0. The farthest depth is the maximum with standard depth, and the minimum with
+ *  reversed depth, so the depth convention must match the one of the depth image.
+ *
+ *  The size of each level is the half of the previous one, rounded down, and the last texel of
+ *  a row or a column also covers the texel that is left over in the odd sizes. So the texel of
+ *  the level L that contains the depth pixel p is min(p >> (L + 1), levelSize(L) - 1), and a
+ *  test that reads the texels that contain a pixel rectangle is conservative.
+ *
+ *  The pyramid is stored in the GENERAL layout, and it can be read with texelFetch().
+ */
+class DepthPyramid {
+public:
+    enum class DepthConvention
+    {
+        // 0 at the near plane and 1 at the far plane, drawn with VK_COMPARE_OP_LESS
+        Standard,
+        // 1 at the near plane and 0 at the far plane, drawn with VK_COMPARE_OP_GREATER
+        Reversed
+    };
+
+    DepthPyramid(VulkanData*, DepthConvention depthConvention = DepthConvention::Standard);
+
+    static void getFrameResourcesRequirements(std::vector<core::DescriptorSetAllocator::PoolSizeRatio>& requiredRatios);
+
+    void init();
+
+    // Recreates the pyramid if the depth image size has changed. Call it in each frame before
+    // recording any command or writing any descriptor set that uses the pyramid. The previous
+    // image is released with the frame resources
+    void cmdResize(VkCommandBuffer cmd, VkExtent2D depthExtent, core::FrameResources& frameResources);
+
+    // Builds all the levels. The pyramid must have the size of the depth image (see cmdResize()).
+    // The depth image must have the sampled usage, and it's returned to the depth attachment layout
+    void cmdBuild(VkCommandBuffer cmd, const core::Image* depthImage, core::FrameResources& frameResources);
+
+    inline VkImageView imageView() const { return _imageView; }
+    inline VkSampler sampler() const { return _sampler; }
+    inline VkExtent2D depthExtent() const { return _depthExtent; }
+    inline uint32_t levelCount() const { return uint32_t(_levelViews.size()); }
+    inline DepthConvention depthConvention() const { return _depthConvention; }
+
+    // True if cmdBuild() has been called since the pyramid was created or resized
+    inline bool built() const { return _built; }
+
+    void cleanup();
+
+protected:
+    VulkanData* _vulkanData;
+    DepthConvention _depthConvention;
+
+    VkExtent2D _depthExtent = { 0, 0 };
+    VkImage _image = VK_NULL_HANDLE;
+    VmaAllocation _allocation = VK_NULL_HANDLE;
+    VkImageView _imageView = VK_NULL_HANDLE;
+    std::vector<VkImageView> _levelViews;
+    std::vector<VkExtent2D> _levelExtents;
+    bool _built = false;
+
+    VkSampler _sampler = VK_NULL_HANDLE;
+    VkDescriptorSetLayout _descriptorSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout _pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline _pipeline = VK_NULL_HANDLE;
+
+    struct PushConstants
+    {
+        glm::uvec2 sourceSize;
+        glm::uvec2 targetSize;
+        uint32_t reversedDepth;
+    };
+
+    // Creates the image and records its transition to the GENERAL layout. The previous image
+    // must have been released
+    void createImage(VkCommandBuffer cmd, VkExtent2D depthExtent);
+    // Pushes the destruction of the image to the cleanup manager, or destroys it immediately if
+    // the cleanup manager is null
+    void releaseImage(core::CleanupManager* cleanupManager);
+};
+
+}
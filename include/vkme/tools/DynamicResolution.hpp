@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vkme/VulkanData.hpp>
+
+#include <algorithm>
+
+namespace vkme::tools {
+
+/*
+ *  Adjusts the rendering resolution to keep the GPU frame time under a target. The frame time
+ *  is measured with a pair of timestamp queries per in flight frame, and the results are read
+ *  without waiting: when cmdBeginFrame() is called, the frame fence of that frame resources has
+ *  already been waited, so the queries written FRAME_OVERLAP frames ago are available.
+ *
+ *  The render targets are still allocated at the maximum size. Use renderExtent() to set the
+ *  viewport and the render area of the scene passes, and CompositeRenderer::setInputScale() to
+ *  upscale the rendered region in the composite pass.
+ *
+ *      _dynamicResolution->cmdBeginFrame(cmd, currentFrame);
+ *      auto extent = _dynamicResolution->renderExtent(drawImage->extent2D());
+ *      ... render the scene using extent ...
+ *      _compositeRenderer->setInputScale(_dynamicResolution->scale(), _dynamicResolution->scale());
+ *      ... composite ...
+ *      _dynamicResolution->cmdEndFrame(cmd, currentFrame);
+ */
+class DynamicResolution {
+public:
+    DynamicResolution(VulkanData*);
+
+    void init();
+
+    // Reads the time of the previous use of the frame resources, updates the scale and
+    // writes the start timestamp
+    void cmdBeginFrame(VkCommandBuffer cmd, uint32_t currentFrame);
+
+    // Writes the end timestamp
+    void cmdEndFrame(VkCommandBuffer cmd, uint32_t currentFrame);
+
+    // The scaled extent, rounded to whole pixels and never greater than maxExtent
+    VkExtent2D renderExtent(VkExtent2D maxExtent) const;
+
+    inline float scale() const { return _enabled ? _scale : 1.0f; }
+
+    // Smoothed GPU time, in milliseconds. It is zero if the device does not support timestamps
+    inline float gpuTime() const { return _gpuTime; }
+    inline bool timestampsSupported() const { return _timestampsSupported; }
+
+    inline void setEnabled(bool enabled) { _enabled = enabled; }
+    inline bool enabled() const { return _enabled; }
+    inline void setTargetFrameTime(float ms) { _targetFrameTime = ms; }
+    inline float targetFrameTime() const { return _targetFrameTime; }
+    inline void setMinScale(float minScale) { _minScale = minScale; _scale = std::max(_scale, minScale); }
+    inline float minScale() const { return _minScale; }
+
+protected:
+    VulkanData* _vulkanData;
+
+    VkQueryPool _queryPool = VK_NULL_HANDLE;
+    bool _timestampsSupported = false;
+    float _timestampPeriod = 1.0f;
+
+    // The scale used to render the frame of each query pair, and if it has been written
+    struct FrameQuery {
+        float scale = 1.0f;
+        bool pending = false;
+    };
+    FrameQuery _frameQueries[core::FRAME_OVERLAP];
+
+    bool _enabled = true;
+    float _scale = 1.0f;
+    float _minScale = 0.5f;
+    float _targetFrameTime = 1000.0f / 60.0f;
+    float _gpuTime = 0.0f;
+
+    void updateScale(float frameTime, float frameScale);
+};
+
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vkme/VulkanData.hpp>
+#include <vkme/core/Image.hpp>
+#include <vkme/core/Buffer.hpp>
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace vkme::tools {
+
+/*
+ *  Asynchronous image readback. cmdCapture() copies an image into one of the host visible
+ *  buffers of a ring, and signals an event after the copy. poll() checks the events without
+ *  waiting, and hands the completed buffers to a worker thread that saves them as PNG or EXR
+ *  files, depending on the file extension.
+ *
+ *  The frame never waits for the GPU or for the encoder: if all the buffers of the ring are
+ *  busy, cmdCapture() skips the capture and returns false. To capture all the frames of a
+ *  benchmark, use a ring large enough to cover the encoding time.
+ *
+ *  Supported formats: R16G16B16A16_SFLOAT, R8G8B8A8_UNORM and B8G8R8A8_UNORM
+ */
+class FrameCapture {
+public:
+    FrameCapture(VulkanData*);
+    ~FrameCapture();
+
+    void init(uint32_t ringSize = core::FRAME_OVERLAP + 2);
+
+    // The device must be idle. Pending captures that have not been copied are discarded,
+    // and the captures that are being encoded are finished.
+    void cleanup();
+
+    // The image must be in TRANSFER_SRC_OPTIMAL layout. Use region to capture only the top left
+    // corner of the image, for example, if the image is rendered with dynamic resolution
+    bool cmdCapture(VkCommandBuffer cmd, const core::Image* image, const std::string& path, VkExtent2D region = { 0, 0 });
+
+    // Check the copies that have finished, and send them to the encoder. cmdCapture() also
+    // calls this function, but it must be called once per frame if the capture is not
+    // requested in every frame
+    void poll();
+
+    inline uint32_t capturedFrames() const { return _capturedFrames; }
+    inline uint32_t skippedFrames() const { return _skippedFrames; }
+
+protected:
+    VulkanData* _vulkanData;
+
+    enum class SlotState {
+        Free,
+        Copying,
+        Encoding
+    };
+
+    struct Slot {
+        std::unique_ptr<core::Buffer> buffer;
+        VkEvent event = VK_NULL_HANDLE;
+        SlotState state = SlotState::Free;
+        std::string path;
+        VkFormat format;
+        VkExtent2D extent;
+    };
+    std::vector<Slot> _slots;
+
+    // The worker thread only accesses the slots that are in Encoding state
+    std::thread _worker;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::deque<uint32_t> _encodeQueue;
+    std::vector<uint32_t> _encodedSlots;
+    bool _stopWorker = false;
+
+    uint32_t _capturedFrames = 0;
+    uint32_t _skippedFrames = 0;
+
+    void workerMain();
+    void encode(const Slot& slot);
+    void destroySlot(Slot& slot);
+};
+
+}
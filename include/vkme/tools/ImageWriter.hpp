@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+namespace vkme::tools {
+
+/*
+ *  Minimal image encoders, used to save the images read back from the GPU. The PNG files
+ *  are written without compression, and the EXR files are written as uncompressed scanlines
+ *  with half float channels. Both formats can be opened by any image viewer, and the encoding
+ *  time is dominated by the disk writes, so they can be used to capture every frame.
+ */
+class ImageWriter {
+public:
+    // RGBA, 8 bits per channel, rows tightly packed
+    static void writePNG(const std::string& path, const uint8_t* rgba, uint32_t width, uint32_t height);
+
+    // RGBA, 16 bit float per channel, rows tightly packed
+    static void writeEXR(const std::string& path, const uint16_t* rgbaHalf, uint32_t width, uint32_t height);
+
+    static uint16_t floatToHalf(float value);
+    static float halfToFloat(uint16_t value);
+};
+
+}
@@ -0,0 +1,329 @@
+#pragma once
+
+#include <vkme/VulkanData.hpp>
+#include <vkme/geo/Model.hpp>
+#include <vkme/tools/DepthPyramid.hpp>
+#include <vkme/core/DescriptorSet.hpp>
+#include <vkme/core/ResourcePool.hpp>
+#include <memory>
+#include <vector>
+
+namespace vkme::tools {
+
+// Draw item of the IndirectRenderer: one surface of a model
+struct IndirectObject
+{
+    // The model is stored in the ModelPool of the renderer
+    geo::ModelHandle model;
+    uint32_t surface = 0;
+    uint32_t pipeline = 0;
+    uint32_t materialIndex = 0;
+    glm::mat4 modelMatrix = glm::mat4(1.0f);
+
+    // Required by the ResourcePool. The model is released by the owner of the pool
+    void cleanup() {}
+};
+
+using IndirectObjectHandle = core::Handle<IndirectObject>;
+
+/*
+ *  GPU driven renderer. The data of the objects is stored in a GPU buffer, and a compute pass
+ *  writes the VkDrawIndexedIndirectCommand of each object in the range of its draw bucket. There
+ *  is one bucket for each pipeline, index type and kind of object (see below), and each bucket is
+ *  drawn with one vkCmdDrawIndexedIndirectCount, so the cost of recording the commands depends on
+ *  the number of buckets, not on the number of objects.
+ *
+ *  The first instance of each command is the index of the object, so the vertex shader reads the
+ *  object data with gl_InstanceIndex (see indirect_mesh.vert.glsl). The pipeline layouts must
+ *  include a vertex stage push constant range of sizeof(IndirectRenderer::PushConstants).
+ *
+ *  The objects are culled in two phases, to avoid popping without reading back the visibility:
+ *
+ *      - prepare(): the objects that were visible in the previous frame are tested against the
+ *        frustum. Draw them with draw().
+ *      - cmdCullLate(): builds the depth pyramid from the depth of the first phase, and tests all
+ *        the objects against the frustum and the pyramid. The visible objects that were not drawn
+ *        in the first phase are drawn with the next draw(), loading the color and depth of the
+ *        first phase. The result is the visibility for the next frame.
+ *
+ *  If cmdCullLate() is not called, the objects are only frustum culled. The depth convention of
+ *  the occlusion test is passed to the constructor, and it must match the depth test of the
+ *  pipelines (see DepthPyramid::DepthConvention).
+ *
+ *  The surfaces with at least MinClusterMeshlets meshlets are clustered objects (the loaders only
+ *  build the meshlets with geo::ImportOptions::meshlets). After the object culling, a second
+ *  compute pass culls each meshlet against the frustum, its normal cone and, in the second phase,
+ *  the depth pyramid, with the same two phase scheme. The visible meshlets are:
+ *
+ *      - Drawn with task and mesh shaders (indirect_mesh.task.glsl and indirect_mesh.mesh.glsl),
+ *        if the device supports VK_EXT_mesh_shader and all the pipelines have a mesh pipeline.
+ *        The mesh pipelines use the same layout, and the push constant range must include the
+ *        vertex, task and mesh stages.
+ *      - Otherwise, expanded to one indexed indirect command for each meshlet, that are drawn
+ *        with the vertex pipeline.
+ *
+ *  If the LOD selection is enabled, the culling pass also selects the level of detail of each
+ *  object from the projected error of the levels, and draws its index range or its meshlets.
+ *
+ *      _renderer->setLodSelection(float(viewportHeight));
+ *      _renderer->update(view, proj);
+ *      _renderer->prepare(cmd, depthImage, frameResources);
+ *      ... begin rendering, clearing the depth ...
+ *      _renderer->draw(cmd);
+ *      ... end rendering ...
+ *      _renderer->cmdCullLate(cmd, depthImage, frameResources);
+ *      ... begin rendering, loading the depth ...
+ *      _renderer->draw(cmd);
+ *      ... end rendering ...
+ *
+ *  Only the objects that change are uploaded each frame. Adding or removing objects, or a
+ *  relocation of the geometry arena, uploads all of them and resets the visibility. The objects
+ *  reference the models by their handle in the geo::ModelPool passed to the constructor, so a
+ *  model that is destroyed while it's used by an object is detected when the objects are uploaded.
+ *
+ *  The renderer requires VulkanData::indirectDrawSupported(). The users must provide another
+ *  path when the device doesn't support it (see InstancedSceneDelegate).
+ */
+class IndirectRenderer {
+public:
+    // Levels of detail of the surfaces, including the full detail level
+    static constexpr uint32_t MaxLods = geo::LodLevel::MaxLevels + 1;
+
+    // Object data, as it's read by the shaders
+    struct ObjectData
+    {
+        glm::mat4 modelMatrix;
+        VkDeviceAddress vertexBufferAddress;
+        // Command range of the draw bucket
+        uint32_t drawBucket;
+        uint32_t commandOffset;
+        // See MeshPushConstants
+        uint32_t packedVertexStride;
+        uint32_t materialIndex;
+        // Meshlets of the mesh
+        VkDeviceAddress meshletBufferAddress;
+        glm::vec4 positionOffset;
+        glm::vec4 positionScale;
+        glm::vec4 uvTransform;
+        // Object space bounds of the surface
+        geo::BoundingSphere boundingSphere;
+        // Levels of detail of the surface (see geo::LodLevel): first index in the index buffer,
+        // index count, meshlet offset and meshlet count. The meshlet count is 0 if the object
+        // is not clustered
+        glm::uvec4 lods[MaxLods];
+        float lodErrors[MaxLods];
+        uint32_t lodCount;
+        uint32_t padding[2];
+    };
+    static_assert(sizeof(ObjectData) == 352, "The object data layout must match the shaders");
+
+    // The cluster addresses are only used by the mesh pipelines, and they change in each bucket
+    struct PushConstants
+    {
+        glm::mat4 viewProjection;
+        VkDeviceAddress objectBufferAddress;
+        VkDeviceAddress clusterBufferAddress;
+        VkDeviceAddress clusterCountAddress;
+    };
+
+    // Minimum number of meshlets of the clustered surfaces. The smaller surfaces are culled as
+    // a whole, that is cheaper than a draw for each meshlet
+    static constexpr uint32_t MinClusterMeshlets = 4;
+
+    IndirectRenderer(
+        VulkanData*,
+        const geo::ModelPool& modelPool,
+        DepthPyramid::DepthConvention depthConvention = DepthPyramid::DepthConvention::Standard
+    );
+
+    static void getFrameResourcesRequirements(std::vector<core::DescriptorSetAllocator::PoolSizeRatio>& requiredRatios);
+
+    void init();
+
+    // Camera of the culling and of the vertex shader
+    void update(const glm::mat4& view, const glm::mat4& proj);
+
+    // Enables the selection of the level of detail of the objects in the culling pass, with the
+    // same criteria as geo::Model::selectLods(). It's disabled if the viewport height is 0. The
+    // models must be loaded with geo::ImportOptions::lods to have more than one level
+    void setLodSelection(float viewportHeight, float maxScreenError = 1.0f);
+
+    // Returns the index of the pipeline, that is used to add the objects. The pipeline layout
+    // is used to bind the descriptor sets and the push constants. The mesh pipeline is optional,
+    // and it's used to draw the clustered objects if the device supports mesh shaders
+    uint32_t addPipeline(VkPipeline pipeline, VkPipelineLayout pipelineLayout, VkPipeline meshPipeline = VK_NULL_HANDLE);
+
+    IndirectObjectHandle addObject(
+        geo::ModelHandle model,
+        uint32_t surface,
+        uint32_t pipeline,
+        uint32_t materialIndex = 0
+    );
+    // Adds one object for each surface of the model
+    std::vector<IndirectObjectHandle> addModel(
+        geo::ModelHandle model,
+        uint32_t pipeline,
+        uint32_t materialIndex = 0
+    );
+
+    void removeObject(IndirectObjectHandle object);
+
+    // The model matrix is copied from the model when the object is added
+    void setModelMatrix(IndirectObjectHandle object, const glm::mat4& modelMatrix);
+
+    inline uint32_t objectCount() const { return _objects.size(); }
+    inline uint32_t drawBucketCount() const { return uint32_t(_drawBuckets.size()); }
+    inline uint32_t clusterCount() const { return _clusterCount; }
+
+    // True if the clustered objects are drawn with mesh shaders
+    bool meshShading() const;
+
+    // Uploads the changes and writes the draw commands of the first phase. Call it outside the
+    // rendering scope. The depth pyramid is resized to the depth image here
+    void prepare(VkCommandBuffer cmd, const core::Image* depthImage, core::FrameResources& frameResources);
+
+    // Writes the draw commands of the second phase. Call it outside the rendering scope, after
+    // drawing the first phase in the depth image
+    void cmdCullLate(VkCommandBuffer cmd, const core::Image* depthImage, core::FrameResources& frameResources);
+
+    // Draws all the buckets of the last phase. The descriptor sets are bound once for each pipeline
+    void draw(
+        VkCommandBuffer cmd,
+        core::DescriptorSet* descriptorSets[] = nullptr,
+        uint32_t numDescriptorSets = 0
+    );
+
+    inline const DepthPyramid& depthPyramid() const { return _depthPyramid; }
+
+    void cleanup();
+
+protected:
+    VulkanData* _vulkanData;
+    const geo::ModelPool* _modelPool;
+
+    struct Pipeline
+    {
+        VkPipeline pipeline;
+        VkPipelineLayout layout;
+        VkPipeline meshPipeline;
+    };
+    std::vector<Pipeline> _pipelines;
+
+    // The clustered buckets contain one command for each meshlet of the selected level of the objects
+    struct DrawBucket
+    {
+        uint32_t pipeline;
+        VkIndexType indexType;
+        bool clustered;
+        uint32_t commandOffset;
+        uint32_t commandCount;
+    };
+    std::vector<DrawBucket> _drawBuckets;
+
+    // The dense index of the objects is the index in the object buffer
+    core::ResourcePool<IndirectObject> _objects;
+    std::vector<IndirectObjectHandle> _dirtyObjects;
+    bool _uploadAll = true;
+    uint32_t _arenaGeneration = 0;
+
+    // Meshlets of all the levels of the clustered objects, as (dense object index, meshlet index) pairs
+    uint32_t _clusterCount = 0;
+
+    // Capacities of the buffers. The command, count, cluster draw and task command buffers store
+    // the ranges of the two phases one after the other
+    uint32_t _objectCapacity = 0;
+    uint32_t _commandCapacity = 0;
+    uint32_t _bucketCapacity = 0;
+    uint32_t _clusterCapacity = 0;
+    core::BufferHandle _objectBuffer;
+    core::BufferHandle _commandBuffer;
+    core::BufferHandle _countBuffer;
+    // Visibility bits of each object (see indirect_cull.comp.glsl)
+    core::BufferHandle _visibilityBuffer;
+    core::BufferHandle _clusterBuffer;
+    // One value per cluster: 1 if it was visible in the last culling
+    core::BufferHandle _clusterVisibilityBuffer;
+    // Mesh shading: visible clusters of each bucket, and a VkDrawMeshTasksIndirectCommandEXT for
+    // each bucket, padded to 16 bytes
+    core::BufferHandle _clusterDrawBuffer;
+    core::BufferHandle _taskCommandBuffer;
+    // Phase of the commands that are drawn by draw()
+    uint32_t _drawPhase = 0;
+
+    glm::mat4 _view = glm::mat4(1.0f);
+    glm::mat4 _projection = glm::mat4(1.0f);
+    float _lodViewportHeight = 0.0f;
+    float _lodMaxScreenError = 1.0f;
+    DepthPyramid _depthPyramid;
+
+    // The object and cluster culling pipelines share the layout
+    VkDescriptorSetLayout _cullingDSLayout = VK_NULL_HANDLE;
+    VkPipelineLayout _cullingPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline _cullingPipeline = VK_NULL_HANDLE;
+    VkPipeline _clusterCullingPipeline = VK_NULL_HANDLE;
+
+    // Camera of the current frame, as it's read by the culling shader. Each phase uploads its own copy
+    struct CullData
+    {
+        glm::mat4 view;
+        glm::mat4 projection;
+        // World space, pointing inside
+        glm::vec4 frustumPlanes[6];
+        // World space, the w component is not used
+        glm::vec4 cameraPosition;
+        glm::uvec2 depthSize;
+        uint32_t pyramidLevels;
+        uint32_t occlusionEnabled;
+        // Converts the object space error at distance 1 to the allowed screen error. The LOD
+        // selection is disabled if it's 0
+        float lodErrorScale;
+        uint32_t reversedDepth;
+    };
+
+    struct CullingPushConstants
+    {
+        VkDeviceAddress objectBufferAddress;
+        VkDeviceAddress commandBufferAddress;
+        VkDeviceAddress countBufferAddress;
+        VkDeviceAddress visibilityBufferAddress;
+        VkDeviceAddress cullDataAddress;
+        uint32_t objectCount;
+        uint32_t phase;
+    };
+
+    struct ClusterCullingPushConstants
+    {
+        VkDeviceAddress objectBufferAddress;
+        VkDeviceAddress commandBufferAddress;
+        VkDeviceAddress countBufferAddress;
+        VkDeviceAddress visibilityBufferAddress;
+        VkDeviceAddress cullDataAddress;
+        VkDeviceAddress clusterBufferAddress;
+        VkDeviceAddress clusterVisibilityBufferAddress;
+        VkDeviceAddress clusterDrawBufferAddress;
+        VkDeviceAddress taskCommandBufferAddress;
+        uint32_t clusterCount;
+        uint32_t phase;
+        uint32_t meshShading;
+    };
+
+    void cmdCull(VkCommandBuffer cmd, uint32_t phase, core::FrameResources& frameResources);
+
+    // Throws if the model of the object has been destroyed
+    inline const geo::Model& model(const IndirectObject& object) const { return _modelPool->at(object.model); }
+    // Sorts the objects in buckets and computes the command ranges
+    void updateDrawBuckets();
+    // Number of meshlets of all the levels of the object, or 0 if it's not clustered
+    uint32_t clusterCount(const IndirectObject& object) const;
+    // Commands of the object in its bucket: one, or the meshlets of the largest level
+    uint32_t commandCount(const IndirectObject& object) const;
+    ObjectData objectData(const IndirectObject& object) const;
+
+    // Replaces the buffers if the capacity is not enough. Returns true if they are replaced
+    bool reserveBuffers();
+    void releaseBuffers();
+    void uploadObjects(VkCommandBuffer cmd, core::FrameResources& frameResources);
+    void uploadClusters(VkCommandBuffer cmd, core::FrameResources& frameResources);
+};
+
+}
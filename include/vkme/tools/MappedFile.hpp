@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace vkme::tools {
+
+/*
+ *  Read only memory mapped file. The pages are loaded by the operating system when they are
+ *  accessed, so the data can be copied directly from the file to its destination, for example
+ *  a staging buffer, without reading it into an intermediate buffer.
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    // Returns false if the file does not exist or can't be mapped
+    bool open(const std::string& path);
+    void close();
+
+    inline bool isOpen() const { return _data != nullptr; }
+    inline const uint8_t* data() const { return _data; }
+    inline size_t size() const { return _size; }
+
+protected:
+    const uint8_t* _data = nullptr;
+    size_t _size = 0;
+
+#ifdef _WIN32
+    void* _file = nullptr;
+    void* _mapping = nullptr;
+#endif
+};
+
+}
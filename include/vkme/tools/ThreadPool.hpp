@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <cstddef>
+#include <cstdint>
+
+namespace vkme::tools {
+
+/*
+ *  Pool of worker threads for data parallel jobs, such as decoding the meshes of a model.
+ *  parallelFor() runs the function for each index in the worker threads and in the calling
+ *  thread, and returns when all of them have finished. If any call throws an exception, the
+ *  remaining indices are skipped and the first exception is thrown again in the calling thread.
+ *
+ *  The jobs must not call parallelFor() on the same pool.
+ */
+class ThreadPool {
+public:
+    // By default, one worker for each hardware thread, except the calling thread
+    ThreadPool(uint32_t workerCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void parallelFor(size_t count, const std::function<void(size_t)>& func);
+
+    inline uint32_t workerCount() const { return uint32_t(_workers.size()); }
+
+    // Pool shared by the engine, created the first time it is used
+    static ThreadPool& shared();
+
+protected:
+    std::vector<std::thread> _workers;
+    std::mutex _mutex;
+    std::condition_variable _workAvailable;
+    std::condition_variable _workFinished;
+    bool _stop = false;
+
+    // Current job. The generation wakes up the workers once for each job
+    const std::function<void(size_t)>* _func = nullptr;
+    size_t _count = 0;
+    size_t _nextIndex = 0;
+    size_t _pendingIndices = 0;
+    uint64_t _generation = 0;
+    std::exception_ptr _exception;
+
+    void workerMain();
+
+    // Runs indices of the current job until there are no more. The mutex must be locked
+    void runIndices(std::unique_lock<std::mutex>& lock);
+};
+
+}
@@ -8,8 +8,8 @@ mkdir -p ${OUTPUT_DIR}
 
 for path in ${INPUT_DIR}/*.glsl; do
     file_name=$(basename ${path} .glsl)
-    echo ${GLSLANG} -V ${path} -o ${OUTPUT_DIR}/${file_name}.spv
-    ${GLSLANG} -V ${path} -o ${OUTPUT_DIR}/${file_name}.spv
+    echo ${GLSLANG} -V --target-env vulkan1.2 ${path} -o ${OUTPUT_DIR}/${file_name}.spv
+    ${GLSLANG} -V --target-env vulkan1.2 ${path} -o ${OUTPUT_DIR}/${file_name}.spv
 done
 
 
@@ -16,8 +16,8 @@ echo Building shaders on directory %CD%
 for /f "tokens=*" %%f in ('dir /b /a-d') do (
     REM ejecutar un echo con el nombre del archivo solo si la extensión es .glsl
     if "%%~xf"==".glsl" (
-        echo %GLSLANG% -V %%f -o %OUT_DIR%\%%~nf.spv
-        %GLSLANG% -V %%f -o %OUT_DIR%\%%~nf.spv
+        echo %GLSLANG% -V --target-env vulkan1.2 %%f -o %OUT_DIR%\%%~nf.spv
+        %GLSLANG% -V --target-env vulkan1.2 %%f -o %OUT_DIR%\%%~nf.spv
     )
 )
 
@@ -0,0 +1,91 @@
+#version 450
+
+layout (location = 0) in vec2 inUV;
+
+layout (location = 0) out vec4 outFragColor;
+
+layout (set = 0, binding = 0) uniform sampler2D hdrImage;
+// The user interface overlay has the size of the target image. The colors are premultiplied by
+// the alpha, and ImGui writes them already encoded for the display
+layout (set = 0, binding = 1) uniform sampler2D userInterfaceImage;
+
+layout (push_constant) uniform constants
+{
+    vec2 uvScale;
+    float exposure;
+    int tonemapOperator;
+    float ditherAmount;
+    uint frameIndex;
+    uint userInterface;
+    uint encodeSrgb;
+} PushConstants;
+
+vec3 tonemapReinhard(vec3 color)
+{
+    return color / (color + vec3(1.0));
+}
+
+// Narkowicz 2015, ACES filmic curve approximation
+vec3 tonemapACES(vec3 color)
+{
+    const float a = 2.51;
+    const float b = 0.03;
+    const float c = 2.43;
+    const float d = 0.59;
+    const float e = 0.14;
+    return clamp((color * (a * color + b)) / (color * (c * color + d) + e), 0.0, 1.0);
+}
+
+vec3 linearToSrgb(vec3 color)
+{
+    vec3 low = color * 12.92;
+    vec3 high = 1.055 * pow(color, vec3(1.0 / 2.4)) - 0.055;
+    return mix(high, low, lessThanEqual(color, vec3(0.0031308)));
+}
+
+// Interleaved gradient noise, animated with the frame index to avoid a static pattern
+float noise(vec2 pixel)
+{
+    pixel += 5.588238 * float(PushConstants.frameIndex % 64u);
+    return fract(52.9829189 * fract(dot(pixel, vec2(0.06711056, 0.00583715))));
+}
+
+void main()
+{
+    // With dynamic resolution only a region of the HDR image is rendered. The coordinates are
+    // clamped to the center of the last rendered texel, so the bilinear filter does not read
+    // the pixels outside that region
+    vec2 uv = min(inUV, PushConstants.uvScale - 0.5 / vec2(textureSize(hdrImage, 0)));
+    vec3 color = texture(hdrImage, uv).rgb * PushConstants.exposure;
+
+    if (PushConstants.tonemapOperator == 1)
+    {
+        color = tonemapReinhard(color);
+    }
+    else if (PushConstants.tonemapOperator == 2)
+    {
+        color = tonemapACES(color);
+    }
+
+    color = clamp(color, 0.0, 1.0);
+
+    // The swapchain image uses an UNORM format, so the linear colors are encoded here
+    if (PushConstants.encodeSrgb != 0u)
+    {
+        color = linearToSrgb(color);
+    }
+
+    // Triangular distributed dithering of +/- one quantization step, to hide the banding
+    // of the 8 bit swapchain image in the dark gradients. It's applied after the encoding,
+    // where the quantization steps are uniform
+    float n = noise(gl_FragCoord.xy) + noise(gl_FragCoord.xy + vec2(17.0, 59.0)) - 1.0;
+    color = clamp(color + vec3(n * PushConstants.ditherAmount), 0.0, 1.0);
+
+    if (PushConstants.userInterface != 0u)
+    {
+        vec4 ui = texelFetch(userInterfaceImage, ivec2(gl_FragCoord.xy), 0);
+        color = ui.rgb + color * (1.0 - ui.a);
+    }
+
+    outFragColor = vec4(color, 1.0);
+}
@@ -0,0 +1,23 @@
+#version 450
+
+layout (location = 0) out vec2 outUV;
+
+layout (push_constant) uniform constants
+{
+    vec2 uvScale;
+    float exposure;
+    int tonemapOperator;
+    float ditherAmount;
+    uint frameIndex;
+    uint userInterface;
+    uint encodeSrgb;
+} PushConstants;
+
+// Fullscreen triangle: the three vertices cover the viewport, so there is no diagonal
+// seam and no vertex buffer is needed
+void main()
+{
+    vec2 uv = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    outUV = uv * PushConstants.uvScale;
+    gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+}
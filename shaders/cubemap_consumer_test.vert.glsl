@@ -27,14 +27,57 @@ layout(buffer_reference, std430) readonly buffer VertexBuffer {
     Vertex vertices[];
 };
 
+// See vkme::geo::PackedVertex
+layout(buffer_reference, std430) readonly buffer PackedVertexBuffer {
+    uint words[];
+};
+
 layout(push_constant) uniform constants {
     mat4 worldMatrix;
     VertexBuffer vertexBuffer;
     int index;
+    uint packedVertexStride;
+    vec4 positionOffset;
+    vec4 positionScale;
+    vec4 uvTransform;
 } PushConstants;
 
+vec3 octahedralDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+Vertex unpackVertex(uint vertexIndex) {
+    PackedVertexBuffer packedBuffer = PackedVertexBuffer(PushConstants.vertexBuffer);
+    uint base = vertexIndex * PushConstants.packedVertexStride;
+    uint w0 = packedBuffer.words[base];
+    uint w1 = packedBuffer.words[base + 1];
+    uint w2 = packedBuffer.words[base + 2];
+
+    vec3 position = vec3(w0 & 0xFFFFu, w0 >> 16, w1 & 0xFFFFu);
+    vec2 uv = vec2(w2 & 0xFFFFu, w2 >> 16);
+
+    Vertex vertex;
+    vertex.position = PushConstants.positionOffset.xyz + position * PushConstants.positionScale.xyz;
+    vertex.normal = octahedralDecode(unpackSnorm4x8(w1).zw);
+    uv = PushConstants.uvTransform.xy + uv * PushConstants.uvTransform.zw;
+    vertex.uvX = uv.x;
+    vertex.uvY = uv.y;
+    vertex.color = PushConstants.packedVertexStride > 3 ? unpackUnorm4x8(packedBuffer.words[base + 3]) : vec4(1.0);
+    return vertex;
+}
+
 void main() {
-    Vertex vertex = PushConstants.vertexBuffer.vertices[gl_VertexIndex];
+    Vertex vertex;
+    if (PushConstants.packedVertexStride == 0) {
+        vertex = PushConstants.vertexBuffer.vertices[gl_VertexIndex];
+    }
+    else {
+        vertex = unpackVertex(gl_VertexIndex);
+    }
     mat3 normalMatrix = mat3(transpose(inverse(PushConstants.worldMatrix)));
 
     gl_Position = sceneData.projectionMatrix * sceneData.viewMatrix * PushConstants.worldMatrix * vec4(vertex.position, 1.0);
@@ -0,0 +1,43 @@
+#version 450
+
+layout(local_size_x = 16, local_size_y = 16) in;
+
+// Depth image, or the previous level of the pyramid
+layout(set = 0, binding = 0) uniform sampler2D source;
+layout(set = 0, binding = 1, r32f) uniform writeonly image2D target;
+
+layout(push_constant) uniform constants {
+    uvec2 sourceSize;
+    uvec2 targetSize;
+    // See vkme::tools::DepthPyramid::DepthConvention
+    uint reversedDepth;
+} PushConstants;
+
+void main() {
+    uvec2 texel = gl_GlobalInvocationID.xy;
+    if (any(greaterThanEqual(texel, PushConstants.targetSize))) {
+        return;
+    }
+
+    // Each texel covers two source texels in each direction. The last texel of the odd sizes
+    // also covers the left over one, so no source texel is skipped (see vkme::tools::DepthPyramid)
+    uvec2 first = texel * 2;
+    uvec2 last = min(first + 1, PushConstants.sourceSize - 1);
+    if (texel.x == PushConstants.targetSize.x - 1) {
+        last.x = PushConstants.sourceSize.x - 1;
+    }
+    if (texel.y == PushConstants.targetSize.y - 1) {
+        last.y = PushConstants.sourceSize.y - 1;
+    }
+
+    // The farthest depth is the minimum with reversed depth, and the maximum with standard depth
+    bool reversed = PushConstants.reversedDepth != 0;
+    float depth = reversed ? 1.0 : 0.0;
+    for (uint y = first.y; y <= last.y; ++y) {
+        for (uint x = first.x; x <= last.x; ++x) {
+            float sourceDepth = texelFetch(source, ivec2(x, y), 0).r;
+            depth = reversed ? min(depth, sourceDepth) : max(depth, sourceDepth);
+        }
+    }
+    imageStore(target, ivec2(texel), vec4(depth));
+}
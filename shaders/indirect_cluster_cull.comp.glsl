@@ -0,0 +1,296 @@
+#version 450
+#extension GL_EXT_buffer_reference : require
+#extension GL_EXT_buffer_reference_uvec2 : require
+
+layout(local_size_x = 64) in;
+
+// Depth pyramid, see vkme::tools::DepthPyramid
+layout(set = 0, binding = 0) uniform sampler2D depthPyramid;
+
+// See vkme::tools::IndirectRenderer::MaxLods
+#define MAX_LODS 9
+
+// See vkme::tools::IndirectRenderer::ObjectData
+struct ObjectData {
+    mat4 modelMatrix;
+    uvec2 vertexBufferAddress;
+    uint drawBucket;
+    uint commandOffset;
+    uint packedVertexStride;
+    uint materialIndex;
+    uvec2 meshletBufferAddress;
+    vec4 positionOffset;
+    vec4 positionScale;
+    vec4 uvTransform;
+    // center, radius
+    vec4 boundingSphere;
+    // First index, index count, meshlet offset, meshlet count (0 if the object is not clustered)
+    uvec4 lods[MAX_LODS];
+    float lodErrors[MAX_LODS];
+    uint lodCount;
+};
+
+// See vkme::geo::Meshlet
+struct Meshlet {
+    // center, radius
+    vec4 boundingSphere;
+    // axis, cutoff
+    vec4 cone;
+    uint vertexOffset;
+    uint triangleOffset;
+    uint firstIndex;
+    // vertexCount | triangleCount << 16
+    uint counts;
+};
+
+layout(buffer_reference, std430) readonly buffer MeshletBuffer {
+    Meshlet meshlets[];
+};
+
+// VkDrawIndexedIndirectCommand
+struct DrawCommand {
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
+layout(buffer_reference, std430) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+
+layout(buffer_reference, std430) writeonly buffer CommandBuffer {
+    DrawCommand commands[];
+};
+
+layout(buffer_reference, std430) buffer CountBuffer {
+    uint counts[];
+};
+
+// See indirect_cull.comp.glsl
+layout(buffer_reference, std430) readonly buffer VisibilityBuffer {
+    uint visible[];
+};
+
+// Object index, meshlet index in the meshlet buffer of the object
+layout(buffer_reference, std430) readonly buffer ClusterBuffer {
+    uvec2 clusters[];
+};
+
+// Visible at the end of the last frame
+layout(buffer_reference, std430) buffer ClusterVisibilityBuffer {
+    uint visible[];
+};
+
+layout(buffer_reference, std430) writeonly buffer ClusterDrawBuffer {
+    uvec2 clusters[];
+};
+
+// VkDrawMeshTasksIndirectCommandEXT, padded to 16 bytes
+layout(buffer_reference, std430) buffer TaskCommandBuffer {
+    uvec4 commands[];
+};
+
+// See vkme::tools::IndirectRenderer::CullData
+layout(buffer_reference, std430) readonly buffer CullData {
+    mat4 view;
+    mat4 projection;
+    vec4 frustumPlanes[6];
+    vec4 cameraPosition;
+    uvec2 depthSize;
+    uint pyramidLevels;
+    uint occlusionEnabled;
+    float lodErrorScale;
+    // See vkme::tools::DepthPyramid::DepthConvention
+    uint reversedDepth;
+};
+
+// See vkme::tools::IndirectRenderer::ClusterCullingPushConstants
+layout(push_constant) uniform constants {
+    ObjectBuffer objectBuffer;
+    // The command, count, cluster draw and task command buffers of the current phase
+    CommandBuffer commandBuffer;
+    CountBuffer countBuffer;
+    VisibilityBuffer visibilityBuffer;
+    CullData cullData;
+    ClusterBuffer clusterBuffer;
+    ClusterVisibilityBuffer clusterVisibilityBuffer;
+    ClusterDrawBuffer clusterDrawBuffer;
+    TaskCommandBuffer taskCommandBuffer;
+    uint clusterCount;
+    uint phase;
+    uint meshShading;
+} PushConstants;
+
+// Cluster size of the task shader, see indirect_mesh.task.glsl
+const uint TASK_CLUSTERS = 32;
+
+bool frustumTest(vec3 center, float radius) {
+    for (int i = 0; i < 6; ++i) {
+        vec4 plane = PushConstants.cullData.frustumPlanes[i];
+        if (dot(plane.xyz, center) + plane.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns false if the sphere is behind the depth of the pyramid. The nearest depth of the
+// sphere is the maximum with reversed depth, and the minimum with standard depth
+bool occlusionTest(vec3 center, float radius) {
+    vec3 viewCenter = (PushConstants.cullData.view * vec4(center, 1.0)).xyz;
+    mat4 proj = PushConstants.cullData.projection;
+    bool reversed = PushConstants.cullData.reversedDepth != 0;
+
+    vec2 minUV = vec2(1.0);
+    vec2 maxUV = vec2(0.0);
+    float minDepth = 1.0;
+    float maxDepth = 0.0;
+    for (int i = 0; i < 8; ++i) {
+        vec3 corner = viewCenter + radius * vec3(
+            (i & 1) == 0 ? -1.0 : 1.0,
+            (i & 2) == 0 ? -1.0 : 1.0,
+            (i & 4) == 0 ? -1.0 : 1.0
+        );
+        vec4 clip = proj * vec4(corner, 1.0);
+        if (clip.w <= 0.0) {
+            // The bounds cross the camera plane
+            return true;
+        }
+        vec3 ndc = clip.xyz / clip.w;
+        vec2 uv = ndc.xy * 0.5 + 0.5;
+        minUV = min(minUV, uv);
+        maxUV = max(maxUV, uv);
+        minDepth = min(minDepth, ndc.z);
+        maxDepth = max(maxDepth, ndc.z);
+    }
+    float nearestDepth = reversed ? maxDepth : minDepth;
+    if (reversed ? nearestDepth >= 1.0 : nearestDepth <= 0.0) {
+        // The bounds reach the near plane
+        return true;
+    }
+
+    // Pixel rectangle of the depth image
+    uvec2 depthSize = PushConstants.cullData.depthSize;
+    uvec2 p0 = uvec2(clamp(minUV, 0.0, 1.0) * vec2(depthSize));
+    uvec2 p1 = uvec2(clamp(maxUV, 0.0, 1.0) * vec2(depthSize));
+    p0 = min(p0, depthSize - 1);
+    p1 = min(p1, depthSize - 1);
+
+    // The smallest level in which the rectangle covers at most 2x2 texels
+    uint levels = PushConstants.cullData.pyramidLevels;
+    uint level = 0;
+    while (level + 1 < levels &&
+        (((p1.x >> (level + 1)) - (p0.x >> (level + 1))) > 1 || ((p1.y >> (level + 1)) - (p0.y >> (level + 1))) > 1))
+    {
+        ++level;
+    }
+
+    ivec2 levelSize = textureSize(depthPyramid, int(level));
+    ivec2 t0 = min(ivec2(p0 >> (level + 1)), levelSize - 1);
+    ivec2 t1 = min(ivec2(p1 >> (level + 1)), levelSize - 1);
+    float depth = reversed ? 1.0 : 0.0;
+    for (int y = t0.y; y <= t1.y; ++y) {
+        for (int x = t0.x; x <= t1.x; ++x) {
+            float pyramidDepth = texelFetch(depthPyramid, ivec2(x, y), int(level)).r;
+            depth = reversed ? min(depth, pyramidDepth) : max(depth, pyramidDepth);
+        }
+    }
+    return reversed ? nearestDepth >= depth : nearestDepth <= depth;
+}
+
+// Returns true if all the triangles of the meshlet are back facing. The test is done in world
+// space, with the world space bounds of the meshlet, and the cone axis is transformed with the
+// normal matrix. A non-uniform scale or a shear changes the angles between the normals, so the
+// cutoff of the cone is not valid, and a mirrored matrix flips the winding of the triangles. In
+// these cases the meshlet is not culled
+bool coneTest(ObjectData object, Meshlet meshlet, vec3 center, float radius) {
+    mat3 model = mat3(object.modelMatrix);
+    mat3 gram = transpose(model) * model;
+    float scale2 = gram[0][0];
+    float tolerance = scale2 * 1e-3;
+    if (determinant(model) <= 0.0 ||
+        abs(gram[1][1] - scale2) > tolerance || abs(gram[2][2] - scale2) > tolerance ||
+        abs(gram[0][1]) > tolerance || abs(gram[0][2]) > tolerance || abs(gram[1][2]) > tolerance)
+    {
+        return false;
+    }
+
+    vec3 axis = normalize(transpose(inverse(model)) * meshlet.cone.xyz);
+    vec3 toCenter = center - PushConstants.cullData.cameraPosition.xyz;
+    return dot(toCenter, axis) >= meshlet.cone.w * length(toCenter) + radius;
+}
+
+void main() {
+    uint clusterIndex = gl_GlobalInvocationID.x;
+    if (clusterIndex >= PushConstants.clusterCount) {
+        return;
+    }
+
+    uvec2 cluster = PushConstants.clusterBuffer.clusters[clusterIndex];
+    uint objectIndex = cluster.x;
+    uint visibility = PushConstants.visibilityBuffer.visible[objectIndex];
+
+    // The object culling already rejected the whole object: in the first phase the clusters of the
+    // objects that were not drawn, and in the second phase the clusters of the hidden objects
+    bool objectDrawn = (visibility & 2) != 0;
+    if ((PushConstants.phase == 0 && !objectDrawn) || (PushConstants.phase == 1 && (visibility & 1) == 0)) {
+        return;
+    }
+
+    // Only the meshlets of the level selected by the object culling are drawn
+    ObjectData object = PushConstants.objectBuffer.objects[objectIndex];
+    uvec4 lod = object.lods[visibility >> 2];
+    if (cluster.y - lod.z >= lod.w) {
+        return;
+    }
+
+    MeshletBuffer meshletBuffer = MeshletBuffer(object.meshletBufferAddress);
+    Meshlet meshlet = meshletBuffer.meshlets[cluster.y];
+
+    vec3 center = (object.modelMatrix * vec4(meshlet.boundingSphere.xyz, 1.0)).xyz;
+    float scale = max(
+        max(length(object.modelMatrix[0].xyz), length(object.modelMatrix[1].xyz)),
+        length(object.modelMatrix[2].xyz)
+    );
+    float radius = meshlet.boundingSphere.w * scale;
+
+    bool visible = frustumTest(center, radius) && !coneTest(object, meshlet, center, radius);
+    bool draw;
+    if (PushConstants.phase == 0) {
+        // The clusters that were visible in the previous frame
+        draw = visible && PushConstants.clusterVisibilityBuffer.visible[clusterIndex] != 0;
+    }
+    else {
+        if (visible && PushConstants.cullData.occlusionEnabled != 0) {
+            visible = occlusionTest(center, radius);
+        }
+        // The clusters drawn in the first phase are only drawn again if the object was not drawn
+        bool drawnEarly = objectDrawn && PushConstants.clusterVisibilityBuffer.visible[clusterIndex] != 0;
+        draw = visible && !drawnEarly;
+        PushConstants.clusterVisibilityBuffer.visible[clusterIndex] = visible ? 1 : 0;
+    }
+    if (!draw) {
+        return;
+    }
+
+    uint slot = atomicAdd(PushConstants.countBuffer.counts[object.drawBucket], 1);
+    if (PushConstants.meshShading != 0) {
+        // The task command starts with one workgroup, and one is added for each TASK_CLUSTERS clusters
+        PushConstants.clusterDrawBuffer.clusters[object.commandOffset + slot] = cluster;
+        if (slot > 0 && slot % TASK_CLUSTERS == 0) {
+            atomicAdd(PushConstants.taskCommandBuffer.commands[object.drawBucket].x, 1);
+        }
+    }
+    else {
+        // One indexed draw of the triangles of the meshlet
+        DrawCommand command;
+        command.indexCount = (meshlet.counts >> 16) * 3;
+        command.instanceCount = 1;
+        command.firstIndex = lod.x + meshlet.firstIndex;
+        command.vertexOffset = 0;
+        command.firstInstance = objectIndex;
+        PushConstants.commandBuffer.commands[object.commandOffset + slot] = command;
+    }
+}
@@ -0,0 +1,229 @@
+#version 450
+#extension GL_EXT_buffer_reference : require
+
+layout(local_size_x = 64) in;
+
+// Depth pyramid, see vkme::tools::DepthPyramid
+layout(set = 0, binding = 0) uniform sampler2D depthPyramid;
+
+// See vkme::tools::IndirectRenderer::MaxLods
+#define MAX_LODS 9
+
+// See vkme::tools::IndirectRenderer::ObjectData
+struct ObjectData {
+    mat4 modelMatrix;
+    uvec2 vertexBufferAddress;
+    uint drawBucket;
+    uint commandOffset;
+    uint packedVertexStride;
+    uint materialIndex;
+    uvec2 meshletBufferAddress;
+    vec4 positionOffset;
+    vec4 positionScale;
+    vec4 uvTransform;
+    // center, radius
+    vec4 boundingSphere;
+    // First index, index count, meshlet offset, meshlet count (0 if the object is not clustered)
+    uvec4 lods[MAX_LODS];
+    float lodErrors[MAX_LODS];
+    uint lodCount;
+};
+
+// VkDrawIndexedIndirectCommand
+struct DrawCommand {
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
+layout(buffer_reference, std430) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+
+layout(buffer_reference, std430) writeonly buffer CommandBuffer {
+    DrawCommand commands[];
+};
+
+layout(buffer_reference, std430) buffer CountBuffer {
+    uint counts[];
+};
+
+// Bit 0: visible at the end of the last frame. Bit 1: drawn in the first phase of this frame.
+// Bits 2 and above: level of detail selected in this frame
+layout(buffer_reference, std430) buffer VisibilityBuffer {
+    uint visible[];
+};
+
+// See vkme::tools::IndirectRenderer::CullData
+layout(buffer_reference, std430) readonly buffer CullData {
+    mat4 view;
+    mat4 projection;
+    vec4 frustumPlanes[6];
+    vec4 cameraPosition;
+    uvec2 depthSize;
+    uint pyramidLevels;
+    uint occlusionEnabled;
+    float lodErrorScale;
+    // See vkme::tools::DepthPyramid::DepthConvention
+    uint reversedDepth;
+};
+
+layout(push_constant) uniform constants {
+    ObjectBuffer objectBuffer;
+    // The command and count buffers of the current phase
+    CommandBuffer commandBuffer;
+    CountBuffer countBuffer;
+    VisibilityBuffer visibilityBuffer;
+    CullData cullData;
+    uint objectCount;
+    uint phase;
+} PushConstants;
+
+bool frustumTest(vec3 center, float radius) {
+    for (int i = 0; i < 6; ++i) {
+        vec4 plane = PushConstants.cullData.frustumPlanes[i];
+        if (dot(plane.xyz, center) + plane.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns false if the sphere is behind the depth of the pyramid. The nearest depth of the
+// sphere is the maximum with reversed depth, and the minimum with standard depth
+bool occlusionTest(vec3 center, float radius) {
+    vec3 viewCenter = (PushConstants.cullData.view * vec4(center, 1.0)).xyz;
+    mat4 proj = PushConstants.cullData.projection;
+    bool reversed = PushConstants.cullData.reversedDepth != 0;
+
+    vec2 minUV = vec2(1.0);
+    vec2 maxUV = vec2(0.0);
+    float minDepth = 1.0;
+    float maxDepth = 0.0;
+    for (int i = 0; i < 8; ++i) {
+        vec3 corner = viewCenter + radius * vec3(
+            (i & 1) == 0 ? -1.0 : 1.0,
+            (i & 2) == 0 ? -1.0 : 1.0,
+            (i & 4) == 0 ? -1.0 : 1.0
+        );
+        vec4 clip = proj * vec4(corner, 1.0);
+        if (clip.w <= 0.0) {
+            // The bounds cross the camera plane
+            return true;
+        }
+        vec3 ndc = clip.xyz / clip.w;
+        vec2 uv = ndc.xy * 0.5 + 0.5;
+        minUV = min(minUV, uv);
+        maxUV = max(maxUV, uv);
+        minDepth = min(minDepth, ndc.z);
+        maxDepth = max(maxDepth, ndc.z);
+    }
+    float nearestDepth = reversed ? maxDepth : minDepth;
+    if (reversed ? nearestDepth >= 1.0 : nearestDepth <= 0.0) {
+        // The bounds reach the near plane
+        return true;
+    }
+
+    // Pixel rectangle of the depth image
+    uvec2 depthSize = PushConstants.cullData.depthSize;
+    uvec2 p0 = uvec2(clamp(minUV, 0.0, 1.0) * vec2(depthSize));
+    uvec2 p1 = uvec2(clamp(maxUV, 0.0, 1.0) * vec2(depthSize));
+    p0 = min(p0, depthSize - 1);
+    p1 = min(p1, depthSize - 1);
+
+    // The smallest level in which the rectangle covers at most 2x2 texels
+    uint levels = PushConstants.cullData.pyramidLevels;
+    uint level = 0;
+    while (level + 1 < levels &&
+        (((p1.x >> (level + 1)) - (p0.x >> (level + 1))) > 1 || ((p1.y >> (level + 1)) - (p0.y >> (level + 1))) > 1))
+    {
+        ++level;
+    }
+
+    ivec2 levelSize = textureSize(depthPyramid, int(level));
+    ivec2 t0 = min(ivec2(p0 >> (level + 1)), levelSize - 1);
+    ivec2 t1 = min(ivec2(p1 >> (level + 1)), levelSize - 1);
+    float depth = reversed ? 1.0 : 0.0;
+    for (int y = t0.y; y <= t1.y; ++y) {
+        for (int x = t0.x; x <= t1.x; ++x) {
+            float pyramidDepth = texelFetch(depthPyramid, ivec2(x, y), int(level)).r;
+            depth = reversed ? min(depth, pyramidDepth) : max(depth, pyramidDepth);
+        }
+    }
+    return reversed ? nearestDepth >= depth : nearestDepth <= depth;
+}
+
+// See vkme::geo::Model::selectLods(). The errors of the levels grow with the level
+uint selectLod(ObjectData object, vec3 center, float radius, float scale) {
+    float errorScale = PushConstants.cullData.lodErrorScale;
+    float distance = length(center - PushConstants.cullData.cameraPosition.xyz) - radius;
+    if (errorScale <= 0.0 || distance <= 0.0) {
+        return 0;
+    }
+
+    errorScale *= scale / distance;
+    uint lod = 0;
+    while (lod + 1 < object.lodCount && object.lodErrors[lod + 1] * errorScale <= 1.0) {
+        ++lod;
+    }
+    return lod;
+}
+
+void main() {
+    uint objectIndex = gl_GlobalInvocationID.x;
+    if (objectIndex >= PushConstants.objectCount) {
+        return;
+    }
+
+    ObjectData object = PushConstants.objectBuffer.objects[objectIndex];
+    if (object.lods[0].y == 0) {
+        return;
+    }
+
+    // World space bounds. The radius is scaled by the largest axis scale of the model matrix
+    vec3 center = (object.modelMatrix * vec4(object.boundingSphere.xyz, 1.0)).xyz;
+    float scale = max(
+        max(length(object.modelMatrix[0].xyz), length(object.modelMatrix[1].xyz)),
+        length(object.modelMatrix[2].xyz)
+    );
+    float radius = object.boundingSphere.w * scale;
+
+    bool visible = frustumTest(center, radius);
+    uint visibility = PushConstants.visibilityBuffer.visible[objectIndex];
+    uint lod = selectLod(object, center, radius, scale);
+    bool draw;
+    if (PushConstants.phase == 0) {
+        // The objects that were visible in the previous frame
+        draw = visible && (visibility & 1) != 0;
+        PushConstants.visibilityBuffer.visible[objectIndex] = (visibility & 1) | (draw ? 2 : 0) | (lod << 2);
+    }
+    else {
+        // The objects that were not drawn in the first phase. The result is the visibility of the
+        // next frame
+        if (visible && PushConstants.cullData.occlusionEnabled != 0) {
+            visible = occlusionTest(center, radius);
+        }
+        draw = visible && (visibility & 2) == 0;
+        PushConstants.visibilityBuffer.visible[objectIndex] = (visible ? 1 : 0) | (visibility & 2) | (lod << 2);
+    }
+
+    // The clusters of the object are culled and drawn by indirect_cluster_cull.comp.glsl,
+    // that reads the visibility written here
+    if (!draw || object.lods[0].w != 0) {
+        return;
+    }
+
+    // The commands of each bucket are written without gaps, and the count is the draw count
+    uint slot = atomicAdd(PushConstants.countBuffer.counts[object.drawBucket], 1);
+
+    DrawCommand command;
+    command.indexCount = object.lods[lod].y;
+    command.instanceCount = 1;
+    command.firstIndex = object.lods[lod].x;
+    command.vertexOffset = 0;
+    // The vertex shader reads the object data with gl_InstanceIndex
+    command.firstInstance = objectIndex;
+    PushConstants.commandBuffer.commands[object.commandOffset + slot] = command;
+}
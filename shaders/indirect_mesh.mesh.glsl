@@ -0,0 +1,150 @@
+#version 450
+#extension GL_EXT_mesh_shader : require
+#extension GL_EXT_buffer_reference : require
+
+// See vkme::geo::MeshletData
+#define MAX_VERTICES 64
+#define MAX_TRIANGLES 124
+#define TASK_CLUSTERS 32
+
+layout(local_size_x = 32) in;
+layout(triangles, max_vertices = MAX_VERTICES, max_primitives = MAX_TRIANGLES) out;
+
+// The same outputs as indirect_mesh.vert.glsl, so the fragment shaders are shared
+layout(location = 0) out vec3 outColor[];
+layout(location = 1) out vec2 outUV[];
+
+struct Vertex {
+    vec3 position;
+    float uvX;
+    vec3 normal;
+    float uvY;
+    vec4 color;
+};
+
+layout(buffer_reference, std430) readonly buffer VertexBuffer {
+    Vertex vertices[];
+};
+
+// See vkme::geo::PackedVertex
+layout(buffer_reference, std430) readonly buffer PackedVertexBuffer {
+    uint words[];
+};
+
+// See vkme::geo::Meshlet
+struct Meshlet {
+    vec4 boundingSphere;
+    vec4 cone;
+    uint vertexOffset;
+    uint triangleOffset;
+    uint firstIndex;
+    // vertexCount | triangleCount << 16
+    uint counts;
+};
+
+layout(buffer_reference, std430) readonly buffer MeshletBuffer {
+    Meshlet meshlets[];
+};
+
+// The vertex and triangle lists, with the offsets of the meshlets in 32 bit words
+layout(buffer_reference, std430) readonly buffer MeshletWords {
+    uint words[];
+};
+
+// See vkme::tools::IndirectRenderer::MaxLods
+#define MAX_LODS 9
+
+// See vkme::tools::IndirectRenderer::ObjectData
+struct ObjectData {
+    mat4 modelMatrix;
+    VertexBuffer vertexBuffer;
+    uint drawBucket;
+    uint commandOffset;
+    uint packedVertexStride;
+    uint materialIndex;
+    MeshletBuffer meshletBuffer;
+    vec4 positionOffset;
+    vec4 positionScale;
+    vec4 uvTransform;
+    // center, radius
+    vec4 boundingSphere;
+    // First index, index count, meshlet offset, meshlet count (0 if the object is not clustered)
+    uvec4 lods[MAX_LODS];
+    float lodErrors[MAX_LODS];
+    uint lodCount;
+};
+
+layout(buffer_reference, std430) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+
+layout(push_constant) uniform constants {
+    mat4 viewProjection;
+    ObjectBuffer objectBuffer;
+} PushConstants;
+
+struct TaskPayload {
+    uvec2 clusters[TASK_CLUSTERS];
+};
+
+taskPayloadSharedEXT TaskPayload payload;
+
+vec3 octahedralDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+Vertex unpackVertex(ObjectData object, uint vertexIndex) {
+    PackedVertexBuffer packedBuffer = PackedVertexBuffer(object.vertexBuffer);
+    uint base = vertexIndex * object.packedVertexStride;
+    uint w0 = packedBuffer.words[base];
+    uint w1 = packedBuffer.words[base + 1];
+    uint w2 = packedBuffer.words[base + 2];
+
+    vec3 position = vec3(w0 & 0xFFFFu, w0 >> 16, w1 & 0xFFFFu);
+    vec2 uv = vec2(w2 & 0xFFFFu, w2 >> 16);
+
+    Vertex vertex;
+    vertex.position = object.positionOffset.xyz + position * object.positionScale.xyz;
+    vertex.normal = octahedralDecode(unpackSnorm4x8(w1).zw);
+    uv = object.uvTransform.xy + uv * object.uvTransform.zw;
+    vertex.uvX = uv.x;
+    vertex.uvY = uv.y;
+    vertex.color = object.packedVertexStride > 3 ? unpackUnorm4x8(packedBuffer.words[base + 3]) : vec4(1.0);
+    return vertex;
+}
+
+void main() {
+    uvec2 cluster = payload.clusters[gl_WorkGroupID.x];
+    ObjectData object = PushConstants.objectBuffer.objects[cluster.x];
+    Meshlet meshlet = object.meshletBuffer.meshlets[cluster.y];
+    MeshletWords words = MeshletWords(object.meshletBuffer);
+
+    uint vertexCount = meshlet.counts & 0xFFFFu;
+    uint triangleCount = meshlet.counts >> 16;
+    SetMeshOutputsEXT(vertexCount, triangleCount);
+
+    mat4 transform = PushConstants.viewProjection * object.modelMatrix;
+    for (uint i = gl_LocalInvocationID.x; i < vertexCount; i += gl_WorkGroupSize.x) {
+        uint vertexIndex = words.words[meshlet.vertexOffset + i];
+        Vertex vertex;
+        if (object.packedVertexStride == 0) {
+            vertex = object.vertexBuffer.vertices[vertexIndex];
+        }
+        else {
+            vertex = unpackVertex(object, vertexIndex);
+        }
+
+        gl_MeshVerticesEXT[i].gl_Position = transform * vec4(vertex.position, 1.0);
+        outColor[i] = vertex.color.xyz;
+        outUV[i] = vec2(vertex.uvX, vertex.uvY);
+    }
+
+    for (uint i = gl_LocalInvocationID.x; i < triangleCount; i += gl_WorkGroupSize.x) {
+        uint triangle = words.words[meshlet.triangleOffset + i];
+        gl_PrimitiveTriangleIndicesEXT[i] = uvec3(triangle & 0xFFu, (triangle >> 8) & 0xFFu, (triangle >> 16) & 0xFFu);
+    }
+}
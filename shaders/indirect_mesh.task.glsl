@@ -0,0 +1,45 @@
+#version 450
+#extension GL_EXT_mesh_shader : require
+#extension GL_EXT_buffer_reference : require
+
+// Each workgroup launches the mesh shaders of TASK_CLUSTERS visible clusters of the draw bucket
+#define TASK_CLUSTERS 32
+layout(local_size_x = TASK_CLUSTERS) in;
+
+layout(buffer_reference, std430) readonly buffer ClusterBuffer {
+    uvec2 clusters[];
+};
+
+layout(buffer_reference, std430) readonly buffer CountBuffer {
+    uint count;
+};
+
+// See vkme::tools::IndirectRenderer::PushConstants. The cluster list and the cluster count are the
+// ones written by indirect_cluster_cull.comp.glsl for the current draw bucket
+layout(push_constant) uniform constants {
+    mat4 viewProjection;
+    uvec2 objectBufferAddress;
+    ClusterBuffer clusterBuffer;
+    CountBuffer clusterCount;
+} PushConstants;
+
+// Object index and meshlet index of each mesh shader workgroup
+struct TaskPayload {
+    uvec2 clusters[TASK_CLUSTERS];
+};
+
+taskPayloadSharedEXT TaskPayload payload;
+
+void main() {
+    uint count = PushConstants.clusterCount.count;
+    uint first = gl_WorkGroupID.x * TASK_CLUSTERS;
+    uint clusterIndex = first + gl_LocalInvocationID.x;
+    if (clusterIndex < count) {
+        payload.clusters[gl_LocalInvocationID.x] = PushConstants.clusterBuffer.clusters[clusterIndex];
+    }
+    barrier();
+
+    // The task command has one workgroup even if there are no visible clusters
+    uint taskCount = first < count ? min(count - first, TASK_CLUSTERS) : 0;
+    EmitMeshTasksEXT(taskCount, 1, 1);
+}
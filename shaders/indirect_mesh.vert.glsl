@@ -0,0 +1,99 @@
+#version 450
+#extension GL_EXT_buffer_reference : require
+
+layout(location = 0) out vec3 outColor;
+layout(location = 1) out vec2 outUV;
+
+struct Vertex {
+    vec3 position;
+    float uvX;
+    vec3 normal;
+    float uvY;
+    vec4 color;
+};
+
+layout(buffer_reference, std430) readonly buffer VertexBuffer {
+    Vertex vertices[];
+};
+
+// See vkme::geo::PackedVertex
+layout(buffer_reference, std430) readonly buffer PackedVertexBuffer {
+    uint words[];
+};
+
+// See vkme::tools::IndirectRenderer::MaxLods
+#define MAX_LODS 9
+
+// See vkme::tools::IndirectRenderer::ObjectData
+struct ObjectData {
+    mat4 modelMatrix;
+    VertexBuffer vertexBuffer;
+    uint drawBucket;
+    uint commandOffset;
+    uint packedVertexStride;
+    uint materialIndex;
+    uvec2 meshletBufferAddress;
+    vec4 positionOffset;
+    vec4 positionScale;
+    vec4 uvTransform;
+    // center, radius
+    vec4 boundingSphere;
+    // First index, index count, meshlet offset, meshlet count (0 if the object is not clustered)
+    uvec4 lods[MAX_LODS];
+    float lodErrors[MAX_LODS];
+    uint lodCount;
+};
+
+layout(buffer_reference, std430) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+
+layout(push_constant) uniform constants {
+    mat4 viewProjection;
+    ObjectBuffer objectBuffer;
+} PushConstants;
+
+vec3 octahedralDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+Vertex unpackVertex(ObjectData object, uint vertexIndex) {
+    PackedVertexBuffer packedBuffer = PackedVertexBuffer(object.vertexBuffer);
+    uint base = vertexIndex * object.packedVertexStride;
+    uint w0 = packedBuffer.words[base];
+    uint w1 = packedBuffer.words[base + 1];
+    uint w2 = packedBuffer.words[base + 2];
+
+    vec3 position = vec3(w0 & 0xFFFFu, w0 >> 16, w1 & 0xFFFFu);
+    vec2 uv = vec2(w2 & 0xFFFFu, w2 >> 16);
+
+    Vertex vertex;
+    vertex.position = object.positionOffset.xyz + position * object.positionScale.xyz;
+    vertex.normal = octahedralDecode(unpackSnorm4x8(w1).zw);
+    uv = object.uvTransform.xy + uv * object.uvTransform.zw;
+    vertex.uvX = uv.x;
+    vertex.uvY = uv.y;
+    vertex.color = object.packedVertexStride > 3 ? unpackUnorm4x8(packedBuffer.words[base + 3]) : vec4(1.0);
+    return vertex;
+}
+
+void main() {
+    // The first instance of the indirect command is the object index
+    ObjectData object = PushConstants.objectBuffer.objects[gl_InstanceIndex];
+
+    Vertex vertex;
+    if (object.packedVertexStride == 0) {
+        vertex = object.vertexBuffer.vertices[gl_VertexIndex];
+    }
+    else {
+        vertex = unpackVertex(object, gl_VertexIndex);
+    }
+
+    gl_Position = PushConstants.viewProjection * object.modelMatrix * vec4(vertex.position, 1.0);
+    outColor = vertex.color.xyz;
+    outUV = vec2(vertex.uvX, vertex.uvY);
+}
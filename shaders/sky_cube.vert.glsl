@@ -8,28 +8,27 @@ layout(set = 0, binding = 0) uniform SceneData {
 
 layout(location = 0) out vec3 outNormal;
 
-struct Vertex {
-    vec3 position;
-    float uvX;
-    vec3 normal;
-    float uvY;
-    vec4 color;
-};
-
-layout(buffer_reference, std430) readonly buffer VertexBuffer {
-    Vertex vertices[];
+// Position stream of the mesh (see vkme::geo::PositionStreamLayout). The positions are read as
+// floats because the std430 layout aligns the vec3 arrays to 16 bytes
+layout(buffer_reference, std430) readonly buffer PositionBuffer {
+    float positions[];
 };
 
 layout(push_constant) uniform constants {
     mat4 worldMatrix;
-    VertexBuffer vertexBuffer;
+    PositionBuffer positionBuffer;
     int index;
 } PushConstants;
 
 void main()
 {
-    Vertex vertex = PushConstants.vertexBuffer.vertices[gl_VertexIndex];
+    uint base = uint(gl_VertexIndex) * 3;
+    vec3 position = vec3(
+        PushConstants.positionBuffer.positions[base],
+        PushConstants.positionBuffer.positions[base + 1],
+        PushConstants.positionBuffer.positions[base + 2]
+    );
     mat4 view = mat4(mat3(sceneData.viewMatrix));
-    gl_Position = sceneData.projMatrix * view * vec4(vertex.position, 1.0);
-    outNormal = normalize(vertex.position);
+    gl_Position = sceneData.projMatrix * view * vec4(position, 1.0);
+    outNormal = normalize(position);
 }
@@ -2,19 +2,28 @@
 
 #include <vkme/factory/DescriptorSetLayout.hpp>
 #include <vkme/factory/ComputePipeline.hpp>
+#include <vkme/core/BarrierBatch.hpp>
 
 void ComputeShaderBackgroundDelegate::init(vkme::VulkanData * vulkanData)
 {
     _vulkanData = vulkanData;
     
-    _drawImage = std::shared_ptr<vkme::core::Image>(vkme::core::Image::createAllocatedImage(
+    _drawImage = vkme::core::Image::createPooledImage(
         vulkanData,
         VK_FORMAT_R16G16B16A16_SFLOAT,
         vulkanData->swapchain().extent(),
         VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+            VK_IMAGE_USAGE_SAMPLED_BIT,
         VK_IMAGE_ASPECT_COLOR_BIT
-    ));
+    );
+    
+    // The draw image stores the final linear colors, so it's written in the swapchain image
+    // without tonemapping, only with the sRGB encoding and the dithering
+    _compositeRenderer = vkme::tools::CompositeRenderer::create(
+        vulkanData,
+        vkme::tools::CompositeRenderer::Tonemap::None
+    );
     
     vulkanData->cleanupManager().push([this](VkDevice) {
         this->cleanup();
@@ -25,6 +34,13 @@ void ComputeShaderBackgroundDelegate::init(vkme::VulkanData * vulkanData)
     initPipelines();
 }
 
+void ComputeShaderBackgroundDelegate::initFrameResources(vkme::core::DescriptorSetAllocator * allocator)
+{
+    // The composite renderer allocates its descriptor set from the frame resources, and the
+    // compute shader uses one storage image
+    vkme::tools::CompositeRenderer::initFrameResources(allocator, { { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1 } });
+}
+
 void ComputeShaderBackgroundDelegate::init(vkme::VulkanData * vulkanData, vkme::UserInterface * ui)
 {
     _vulkanData = vulkanData;
@@ -32,24 +48,22 @@ void ComputeShaderBackgroundDelegate::init(vkme::VulkanData * vulkanData, vkme::
 
 void ComputeShaderBackgroundDelegate::cleanup()
 {
-    _drawImage->cleanup();
+    _vulkanData->imagePool().destroy(_drawImage);
 }
 
 void ComputeShaderBackgroundDelegate::swapchainResized(VkExtent2D newExtent)
 {
-    // Resize the target imagge
-    _drawImage->cleanup();
-    _drawImage = std::shared_ptr<vkme::core::Image>(vkme::core::Image::createAllocatedImage(
+    // Resize the target image. The frames in flight may still be using the old one
+    vkme::core::Image::releasePooledImage(_vulkanData, _drawImage);
+    _drawImage = vkme::core::Image::createPooledImage(
         _vulkanData,
         VK_FORMAT_R16G16B16A16_SFLOAT,
         newExtent,
         VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+        VK_IMAGE_USAGE_SAMPLED_BIT,
         VK_IMAGE_ASPECT_COLOR_BIT
-    ));
-
-    // Set the new image to the compute shader descriptor set
-    _drawImageDescriptors->updateImage(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, _drawImage->imageView(), VK_IMAGE_LAYOUT_GENERAL);
+    );
 }
 
 VkImageLayout ComputeShaderBackgroundDelegate::draw(
@@ -61,38 +75,25 @@ VkImageLayout ComputeShaderBackgroundDelegate::draw(
 ) {
     using namespace vkme;
     
+    // The pooled images can move when other images are created or destroyed, so the handle is
+    // resolved in each frame
+    auto& drawImage = _vulkanData->imagePool().at(_drawImage);
+    
     // Transition draw image to render on it
-    core::Image::cmdTransitionImage(
-        cmd,
-        _drawImage->image(),
-        VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_GENERAL
-    );
+    drawImage.cmdTransition(cmd, VK_IMAGE_LAYOUT_GENERAL, true);
     
-    drawBackground(cmd, currentFrame, colorImage->extent2D());
+    drawBackground(cmd, currentFrame, colorImage->extent2D(), frameResources);
     
-    // Transition _drawImage and swapchain image to copy the first one to the second one
-    core::Image::cmdTransitionImage(
-        cmd,
-        _drawImage->image(),
-        VK_IMAGE_LAYOUT_GENERAL,
-        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
-    );
-    core::Image::cmdTransitionImage(
-        cmd,
-        colorImage->image(),
-        VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-    );
+    // Write the draw image into the swapchain image. The composite pass also blends the user
+    // interface overlay, and leaves the swapchain image in the COLOR_ATTACHMENT_OPTIMAL layout
+    core::BarrierBatch barriers;
+    drawImage.addTransition(barriers, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    colorImage->addTransition(barriers, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true);
+    barriers.flush(cmd);
     
-    // Copy drawImage into swapchain image
-    core::Image::cmdCopy(
-        cmd,
-        _drawImage->image(), _drawImage->extent2D(),
-        colorImage->image(), colorImage->extent2D()
-    );
+    _compositeRenderer->draw(cmd, currentFrame, &drawImage, colorImage, frameResources);
     
-    return VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 }
 
 void ComputeShaderBackgroundDelegate::drawUI()
@@ -100,8 +101,17 @@ void ComputeShaderBackgroundDelegate::drawUI()
     ImGui::ShowDemoWindow();
 }
 
-void ComputeShaderBackgroundDelegate::drawBackground(VkCommandBuffer cmd, uint32_t currentFrame, VkExtent2D imageExtent)
+void ComputeShaderBackgroundDelegate::drawBackground(VkCommandBuffer cmd, uint32_t currentFrame, VkExtent2D imageExtent, vkme::core::FrameResources& frameResources)
 {
+    auto& drawImage = _vulkanData->imagePool().at(_drawImage);
+    
+    // Wrapped method: using a vkme::core::DescriptorSet wrapper
+    auto drawImageDescriptors = std::unique_ptr<vkme::core::DescriptorSet>(
+        frameResources.descriptorAllocator->allocate(_drawImageDescriptorLayout)
+    );
+    drawImageDescriptors->updateImage(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, drawImage.imageView(), VK_IMAGE_LAYOUT_GENERAL);
+    
+
     vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _gradientPipeline);
     
     vkCmdBindDescriptorSets(
@@ -110,7 +120,7 @@ void ComputeShaderBackgroundDelegate::drawBackground(VkCommandBuffer cmd, uint32
         _gradientPipelineLayout,
         0,
         1,
-        &(*_drawImageDescriptors),
+        &(*drawImageDescriptors),
         0,
         nullptr
     );
@@ -122,27 +132,13 @@ void ComputeShaderBackgroundDelegate::drawBackground(VkCommandBuffer cmd, uint32
 
 void ComputeShaderBackgroundDelegate::initDescriptors()
 {
-    using namespace vkme::core;
-    std::vector<DescriptorSetAllocator::PoolSizeRatio> sizes = {};
-
-    // One image to pass the draw image to the compute shader
-    sizes.push_back({ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1 });
-    
-    _descriptorAllocator.init(_vulkanData);
-    _descriptorAllocator.initPool(10, sizes);
-    
+    // One image to pass the draw image to the compute shader. The descriptor set is allocated
+    // from the frame resources in drawBackground()
     vkme::factory::DescriptorSetLayout dsFactory;
     dsFactory.addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
     _drawImageDescriptorLayout = dsFactory.build(_vulkanData->device(), VK_SHADER_STAGE_COMPUTE_BIT);
     
-    // Wrapped method: using a vkme::core::DescriptorSet wrapper
-    _drawImageDescriptors = std::unique_ptr<DescriptorSet>(_descriptorAllocator.allocate(_drawImageDescriptorLayout));
-    
-    _drawImageDescriptors->updateImage(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, _drawImage->imageView(), VK_IMAGE_LAYOUT_GENERAL);
-    
     _vulkanData->cleanupManager().push([&](VkDevice dev) {
-        _descriptorAllocator.destroy();
-        
         vkDestroyDescriptorSetLayout(dev, _drawImageDescriptorLayout, nullptr);
     });
 }
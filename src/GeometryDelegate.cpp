@@ -10,14 +10,22 @@
 void GeometryDelegate::init(vkme::VulkanData * vulkanData)
 {
     _vulkanData = vulkanData;
-    _drawImage = std::shared_ptr<vkme::core::Image>(vkme::core::Image::createAllocatedImage(
+    _drawImage = vkme::core::Image::createPooledImage(
         vulkanData,
         VK_FORMAT_R16G16B16A16_SFLOAT,
         vulkanData->swapchain().extent(),
         VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+            VK_IMAGE_USAGE_SAMPLED_BIT,
         VK_IMAGE_ASPECT_COLOR_BIT
-    ));
+    );
+    
+    // The draw image stores the final linear colors, so it's written in the swapchain image
+    // without tonemapping, only with the sRGB encoding and the dithering
+    _compositeRenderer = vkme::tools::CompositeRenderer::create(
+        vulkanData,
+        vkme::tools::CompositeRenderer::Tonemap::None
+    );
     
     vulkanData->cleanupManager().push([this](VkDevice) {
         this->cleanup();
@@ -33,25 +41,29 @@ void GeometryDelegate::init(vkme::VulkanData * vulkanData)
 
 void GeometryDelegate::initFrameResources(vkme::core::DescriptorSetAllocator * allocator)
 {
-    allocator->initPool(
-        1000,
+    // The composite renderer adds the requirements of its descriptor set
+    vkme::tools::CompositeRenderer::initFrameResources(
+        allocator,
         {
-            { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1},
-        }
+            { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1}
+        },
+        1000
     );
 }
 
 void GeometryDelegate::swapchainResized(VkExtent2D newExtent)
 {
-    _drawImage->cleanup();
-    _drawImage = std::shared_ptr<vkme::core::Image>(vkme::core::Image::createAllocatedImage(
+    // The frames in flight may still be using the old draw image
+    vkme::core::Image::releasePooledImage(_vulkanData, _drawImage);
+    _drawImage = vkme::core::Image::createPooledImage(
         _vulkanData,
         VK_FORMAT_R16G16B16A16_SFLOAT,
         newExtent,
         VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+        VK_IMAGE_USAGE_SAMPLED_BIT,
         VK_IMAGE_ASPECT_COLOR_BIT
-    ));
+    );
     
     glm::mat4 proj = glm::perspective(glm::radians(50.0f), float(newExtent.width) / float(newExtent.height), 0.1f, 10.0f);
     proj[1][1] *= -1.0f;
@@ -62,7 +74,7 @@ void GeometryDelegate::swapchainResized(VkExtent2D newExtent)
 
 void GeometryDelegate::cleanup()
 {
-    _drawImage->cleanup();
+    _vulkanData->imagePool().destroy(_drawImage);
 }
 
 VkImageLayout GeometryDelegate::draw(
@@ -74,10 +86,14 @@ VkImageLayout GeometryDelegate::draw(
 ) {
     using namespace vkme;
     
+    // The pooled images can move when other images are created or destroyed, so the handle is
+    // resolved in each frame
+    auto& drawImage = _vulkanData->imagePool().at(_drawImage);
+    
     // Transition draw image to render on it
     core::Image::cmdTransitionImage(
         cmd,
-        _drawImage->image(),
+        drawImage.image(),
         VK_IMAGE_LAYOUT_UNDEFINED,
         VK_IMAGE_LAYOUT_GENERAL
     );
@@ -101,35 +117,31 @@ VkImageLayout GeometryDelegate::draw(
     
     core::Image::cmdTransitionImage(
         cmd,
-        _drawImage->image(),
+        drawImage.image(),
         VK_IMAGE_LAYOUT_GENERAL,
         VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
     );
     
-    drawGeometry(cmd, _drawImage->imageView(), colorImage->extent2D(), depthImage, currentFrame, frameResources);
+    drawGeometry(cmd, drawImage.imageView(), colorImage->extent2D(), depthImage, currentFrame, frameResources);
     
-    // Transition _drawImage and swapchain image to copy the first one to the second one
+    // Write the draw image into the swapchain image. The composite pass also blends the user
+    // interface overlay, and leaves the swapchain image in the COLOR_ATTACHMENT_OPTIMAL layout
     core::Image::cmdTransitionImage(
         cmd,
-        _drawImage->image(),
+        drawImage.image(),
         VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
     );
     core::Image::cmdTransitionImage(
         cmd,
         colorImage->image(),
         VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
     );
     
-    // Copy drawImage into swapchain image
-    core::Image::cmdCopy(
-        cmd,
-        _drawImage->image(), _drawImage->extent2D(),
-        colorImage->image(), colorImage->extent2D()
-    );
+    _compositeRenderer->draw(cmd, currentFrame, &drawImage, colorImage, frameResources);
     
-    return VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 }
 
 void GeometryDelegate::drawUI()
@@ -295,6 +307,8 @@ void GeometryDelegate::initMesh()
 
 void GeometryDelegate::drawBackground(VkCommandBuffer cmd, uint32_t currentFrame, const vkme::core::Image* depthImage)
 {
+    auto& drawImage = _vulkanData->imagePool().at(_drawImage);
+    
     VkClearColorValue clearValue;
     float r = std::abs(std::sin(currentFrame / 90.0f)) * 0.5f;
     float g = std::abs(std::sin(currentFrame / 180.0f)) * 0.5f;
@@ -303,7 +317,7 @@ void GeometryDelegate::drawBackground(VkCommandBuffer cmd, uint32_t currentFrame
     auto clearRange = vkme::core::Image::subresourceRange(VK_IMAGE_ASPECT_COLOR_BIT);
     vkCmdClearColorImage(
         cmd,
-        _drawImage->image(),
+        drawImage.image(),
         VK_IMAGE_LAYOUT_GENERAL,
         &clearValue, 1, &clearRange
     );
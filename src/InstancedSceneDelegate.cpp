@@ -0,0 +1,445 @@
+#include <InstancedSceneDelegate.hpp>
+#include <vkme/factory/GraphicsPipeline.hpp>
+#include <vkme/factory/DescriptorSetLayout.hpp>
+#include <vkme/core/Info.hpp>
+
+#include <vkme/PlatformTools.hpp>
+
+void InstancedSceneDelegate::init(vkme::VulkanData * vulkanData)
+{
+    _vulkanData = vulkanData;
+    _drawImage = vkme::core::Image::createPooledImage(
+        vulkanData,
+        VK_FORMAT_R16G16B16A16_SFLOAT,
+        vulkanData->swapchain().extent(),
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_IMAGE_ASPECT_COLOR_BIT
+    );
+
+    // The draw image stores the final linear colors, so it's written in the swapchain image
+    // without tonemapping, only with the sRGB encoding and the dithering
+    _compositeRenderer = vkme::tools::CompositeRenderer::create(
+        vulkanData,
+        vkme::tools::CompositeRenderer::Tonemap::None
+    );
+
+    vulkanData->cleanupManager().push([this](VkDevice) {
+        this->cleanup();
+    });
+
+    // The occlusion culling must use the same depth convention as the pipeline depth test
+    if (vulkanData->indirectDrawSupported())
+    {
+        _renderer = std::unique_ptr<vkme::tools::IndirectRenderer>(new vkme::tools::IndirectRenderer(
+            vulkanData,
+            _models,
+            vkme::tools::DepthPyramid::DepthConvention::Standard
+        ));
+        _renderer->init();
+        initPipeline();
+    }
+    else
+    {
+        initFallbackPipeline();
+    }
+
+    initScene();
+}
+
+void InstancedSceneDelegate::initFrameResources(vkme::core::DescriptorSetAllocator * allocator)
+{
+    // The composite renderer and the culling passes allocate their descriptor sets from the
+    // frame resources. The fallback path allocates the scene data
+    std::vector<vkme::core::DescriptorSetAllocator::PoolSizeRatio> ratios = {
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 }
+    };
+    vkme::tools::IndirectRenderer::getFrameResourcesRequirements(ratios);
+    vkme::tools::CompositeRenderer::initFrameResources(allocator, ratios);
+}
+
+void InstancedSceneDelegate::swapchainResized(VkExtent2D newExtent)
+{
+    // The frames in flight may still be using the old draw image
+    vkme::core::Image::releasePooledImage(_vulkanData, _drawImage);
+    _drawImage = vkme::core::Image::createPooledImage(
+        _vulkanData,
+        VK_FORMAT_R16G16B16A16_SFLOAT,
+        newExtent,
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_IMAGE_ASPECT_COLOR_BIT
+    );
+}
+
+void InstancedSceneDelegate::cleanup()
+{
+    _vulkanData->imagePool().destroy(_drawImage);
+}
+
+VkImageLayout InstancedSceneDelegate::draw(
+    VkCommandBuffer cmd,
+    uint32_t currentFrame,
+    const vkme::core::Image* colorImage,
+    const vkme::core::Image* depthImage,
+    vkme::core::FrameResources& frameResources
+) {
+    using namespace vkme;
+
+    // The pooled images can move when other images are created or destroyed, so the handle is
+    // resolved in each frame
+    auto& drawImage = _vulkanData->imagePool().at(_drawImage);
+
+    updateCamera(drawImage.extent2D());
+    if (_renderer)
+    {
+        _renderer->prepare(cmd, depthImage, frameResources);
+    }
+
+    // The first phase clears the draw image, so the previous contents are discarded
+    drawImage.cmdTransition(cmd, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true);
+    drawGeometry(cmd, drawImage.imageView(), drawImage.extent2D(), depthImage, true, frameResources);
+
+    // The objects that were occluded in the previous frame are tested against the depth of the
+    // first phase, and the visible ones are drawn over it
+    if (_renderer)
+    {
+        _renderer->cmdCullLate(cmd, depthImage, frameResources);
+        drawImage.cmdTransition(cmd, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        drawGeometry(cmd, drawImage.imageView(), drawImage.extent2D(), depthImage, false, frameResources);
+    }
+
+    // Write the draw image into the swapchain image. The composite pass also blends the user
+    // interface overlay, and leaves the swapchain image in the COLOR_ATTACHMENT_OPTIMAL layout
+    drawImage.cmdTransition(cmd, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    core::Image::cmdTransitionImage(
+        cmd,
+        colorImage->image(),
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+    );
+
+    _compositeRenderer->draw(cmd, currentFrame, &drawImage, colorImage, frameResources);
+
+    return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+}
+
+void InstancedSceneDelegate::drawUI()
+{
+    if (ImGui::Begin("Instanced scene"))
+    {
+        ImGui::Text("Instances: %d", int32_t(_models.size()));
+        ImGui::Text("Instances in the frustum: %d", int32_t(_frustumInstances.size()));
+        if (_renderer)
+        {
+            ImGui::Text("Objects: %d", int32_t(_renderer->objectCount()));
+            ImGui::Text("Draw buckets: %d", int32_t(_renderer->drawBucketCount()));
+            ImGui::Text("Clusters: %d", int32_t(_renderer->clusterCount()));
+            ImGui::Text("Mesh shading: %s", _renderer->meshShading() ? "yes" : "no");
+        }
+        else
+        {
+            ImGui::Text("Indirect draw not supported: the instances are drawn one by one");
+        }
+        ImGui::Checkbox("Rotate camera", &_rotateCamera);
+        ImGui::Checkbox("LOD selection", &_lodSelection);
+        ImGui::SliderFloat("Max screen error", &_maxScreenError, 0.5f, 16.0f);
+        if (_pickedInstance >= 0)
+        {
+            ImGui::Text("Picked instance: %d, surface %d, distance %.2f", _pickedInstance, int32_t(_pickedSurface), _pickedDistance);
+        }
+        else
+        {
+            ImGui::Text("Click an instance to pick it");
+        }
+    }
+    ImGui::End();
+
+    auto& io = ImGui::GetIO();
+    if (!io.WantCaptureMouse && ImGui::IsMouseClicked(ImGuiMouseButton_Left))
+    {
+        pickInstance(glm::vec2(io.MousePos.x, io.MousePos.y), glm::vec2(io.DisplaySize.x, io.DisplaySize.y));
+    }
+}
+
+void InstancedSceneDelegate::initPipeline()
+{
+    // The mesh pipeline uses the same layout, so the push constants are also visible in the
+    // task and mesh stages
+    bool meshShader = _vulkanData->meshShaderSupported();
+    VkPushConstantRange bufferRange = {};
+    bufferRange.offset = 0;
+    bufferRange.size = sizeof(vkme::tools::IndirectRenderer::PushConstants);
+    bufferRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    if (meshShader)
+    {
+        bufferRange.stageFlags |= VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT;
+    }
+
+    auto layoutInfo = vkme::core::Info::pipelineLayoutInfo();
+    layoutInfo.pPushConstantRanges = &bufferRange;
+    layoutInfo.pushConstantRangeCount = 1;
+
+    VK_ASSERT(vkCreatePipelineLayout(_vulkanData->device(), &layoutInfo, nullptr, &_pipelineLayout));
+
+    vkme::factory::GraphicsPipeline plFactory(this->_vulkanData);
+    plFactory.addShader("indirect_mesh.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
+    plFactory.addShader("simple_vertex_color.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+    plFactory.setColorAttachmentFormat(VK_FORMAT_R16G16B16A16_SFLOAT);
+    plFactory.setDepthFormat(_vulkanData->swapchain().depthImageFormat());
+    plFactory.enableDepthtest(true, VK_COMPARE_OP_LESS);
+    plFactory.inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    plFactory.setCullMode(true, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+    _pipeline = plFactory.build(_pipelineLayout);
+
+    if (meshShader)
+    {
+        vkme::factory::GraphicsPipeline meshFactory(this->_vulkanData);
+        meshFactory.addShader("indirect_mesh.task.spv", VK_SHADER_STAGE_TASK_BIT_EXT);
+        meshFactory.addShader("indirect_mesh.mesh.spv", VK_SHADER_STAGE_MESH_BIT_EXT);
+        meshFactory.addShader("simple_vertex_color.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+        meshFactory.setColorAttachmentFormat(VK_FORMAT_R16G16B16A16_SFLOAT);
+        meshFactory.setDepthFormat(_vulkanData->swapchain().depthImageFormat());
+        meshFactory.enableDepthtest(true, VK_COMPARE_OP_LESS);
+        meshFactory.setCullMode(true, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+        _meshPipeline = meshFactory.build(_pipelineLayout);
+    }
+
+    _renderer->addPipeline(_pipeline, _pipelineLayout, _meshPipeline);
+
+    _vulkanData->cleanupManager().push([&](VkDevice dev) {
+        vkDestroyPipeline(dev, _pipeline, nullptr);
+        if (_meshPipeline != VK_NULL_HANDLE)
+        {
+            vkDestroyPipeline(dev, _meshPipeline, nullptr);
+        }
+        vkDestroyPipelineLayout(dev, _pipelineLayout, nullptr);
+    });
+}
+
+void InstancedSceneDelegate::initFallbackPipeline()
+{
+    vkme::factory::DescriptorSetLayout dsFactory;
+    dsFactory.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+    _sceneDataLayout = dsFactory.build(_vulkanData->device(), VK_SHADER_STAGE_VERTEX_BIT);
+
+    // Model::draw() writes the push constants of the vertex stage
+    VkPushConstantRange bufferRange = {};
+    bufferRange.offset = 0;
+    bufferRange.size = sizeof(vkme::geo::MeshPushConstants);
+    bufferRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    auto layoutInfo = vkme::core::Info::pipelineLayoutInfo();
+    layoutInfo.pPushConstantRanges = &bufferRange;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pSetLayouts = &_sceneDataLayout;
+    layoutInfo.setLayoutCount = 1;
+
+    VK_ASSERT(vkCreatePipelineLayout(_vulkanData->device(), &layoutInfo, nullptr, &_pipelineLayout));
+
+    vkme::factory::GraphicsPipeline plFactory(this->_vulkanData);
+    plFactory.addShader("scene_mesh.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
+    plFactory.addShader("simple_vertex_color.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+    plFactory.setColorAttachmentFormat(VK_FORMAT_R16G16B16A16_SFLOAT);
+    plFactory.setDepthFormat(_vulkanData->swapchain().depthImageFormat());
+    plFactory.enableDepthtest(true, VK_COMPARE_OP_LESS);
+    plFactory.inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    plFactory.setCullMode(true, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+    _pipeline = plFactory.build(_pipelineLayout);
+
+    _vulkanData->cleanupManager().push([&](VkDevice dev) {
+        vkDestroyPipeline(dev, _pipeline, nullptr);
+        vkDestroyPipelineLayout(dev, _pipelineLayout, nullptr);
+        vkDestroyDescriptorSetLayout(dev, _sceneDataLayout, nullptr);
+    });
+}
+
+void InstancedSceneDelegate::initScene()
+{
+    std::string assetsPath = vkme::PlatformTools::assetPath() + "basicmesh.glb";
+
+    // The levels of detail are selected by the culling pass, and the meshlets are generated to
+    // cull and draw the surfaces as clusters. The grid draws thousands of instances, so the
+    // meshes are also optimized for the vertex cache
+    vkme::geo::ImportOptions importOptions;
+    importOptions.lods = true;
+    importOptions.meshlets = true;
+    importOptions.optimize = true;
+    auto sceneModels = vkme::geo::Model::loadGltfScene(
+        _vulkanData,
+        assetsPath,
+        true,
+        vkme::geo::VertexFormat::Standard,
+        false,
+        importOptions
+    );
+
+    // The scene is copied in each cell of the grid. The copies share the mesh buffers of the
+    // scene nodes, so each mesh is stored only once
+    float offset = float(_gridSize - 1) * _gridSpacing * 0.5f;
+    for (int32_t x = 0; x < _gridSize; ++x)
+    {
+        for (int32_t z = 0; z < _gridSize; ++z)
+        {
+            auto cellMatrix = glm::translate(
+                glm::mat4(1.0f),
+                glm::vec3(float(x) * _gridSpacing - offset, 0.0f, float(z) * _gridSpacing - offset)
+            );
+            for (auto& node : sceneModels)
+            {
+                auto instance = node->createInstance(_models, cellMatrix * node->modelMatrix());
+                if (_renderer)
+                {
+                    _renderer->addModel(instance, 0);
+                }
+                _sceneBVH.add(instance);
+            }
+        }
+    }
+
+    // The instances don't move, so the tree is built once
+    _sceneBVH.build();
+
+    // The scene models are not used to draw, so they release their reference to the mesh buffers
+    for (auto& node : sceneModels)
+    {
+        node->cleanup();
+    }
+
+    // The pool calls cleanup() on the instances
+    _vulkanData->cleanupManager().push([&](VkDevice) {
+        _models.clear();
+    });
+}
+
+void InstancedSceneDelegate::updateCamera(VkExtent2D imageExtent)
+{
+    if (_rotateCamera)
+    {
+        _cameraAngle += 0.002f;
+    }
+
+    // The camera orbits around the bounds of the scene
+    auto bounds = _sceneBVH.bounds();
+    auto center = bounds.center();
+    float distance = glm::length(bounds.size()) * 0.6f;
+    glm::vec3 eye = center + glm::vec3(std::sin(_cameraAngle), 0.4f, std::cos(_cameraAngle)) * distance;
+    _view = glm::lookAt(eye, center, glm::vec3(0.0f, 1.0f, 0.0f));
+    _proj = glm::perspective(glm::radians(60.0f), float(imageExtent.width) / float(imageExtent.height), 0.1f, distance * 3.0f);
+    _proj[1][1] *= -1.0f;
+
+    _frustumInstances.clear();
+    _sceneBVH.queryFrustum(_proj * _view, _frustumInstances);
+    if (_renderer)
+    {
+        _renderer->update(_view, _proj);
+        _renderer->setLodSelection(_lodSelection ? float(imageExtent.height) : 0.0f, _maxScreenError);
+    }
+    else
+    {
+        // Only the instances in the frustum are drawn, so the other levels are not updated
+        for (auto instance : _frustumInstances)
+        {
+            auto& model = _models.at(_sceneBVH.model(instance));
+            if (_lodSelection)
+            {
+                model.selectLods(_view, _proj, float(imageExtent.height), _maxScreenError);
+            }
+            else
+            {
+                model.clearLods();
+            }
+        }
+    }
+}
+
+void InstancedSceneDelegate::pickInstance(const glm::vec2& position, const glm::vec2& size)
+{
+    // The projection is flipped in the y axis, so the y coordinate of the normalized device
+    // coordinates grows down, as the window coordinates
+    glm::vec2 ndc = position / size * 2.0f - 1.0f;
+    auto inverseViewProj = glm::inverse(_proj * _view);
+    glm::vec4 nearPoint = inverseViewProj * glm::vec4(ndc, 0.0f, 1.0f);
+    glm::vec4 farPoint = inverseViewProj * glm::vec4(ndc, 1.0f, 1.0f);
+
+    vkme::geo::SceneBVH::Ray ray;
+    ray.origin = glm::vec3(nearPoint) / nearPoint.w;
+    ray.direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - ray.origin);
+
+    vkme::geo::SceneBVH::RayHit hit;
+    if (_sceneBVH.raycast(ray, hit))
+    {
+        _pickedInstance = int32_t(hit.model);
+        _pickedSurface = hit.surface;
+        _pickedDistance = hit.distance;
+    }
+    else
+    {
+        _pickedInstance = -1;
+    }
+}
+
+void InstancedSceneDelegate::drawGeometry(
+    VkCommandBuffer cmd,
+    VkImageView currentImage,
+    VkExtent2D imageExtent,
+    const vkme::core::Image* depthImage,
+    bool clear,
+    vkme::core::FrameResources& frameResources
+) {
+    VkClearValue clearValue = {};
+    clearValue.color = { { 0.05f, 0.05f, 0.1f, 1.0f } };
+    auto colorAttachment = vkme::core::Info::attachmentInfo(currentImage, clear ? &clearValue : nullptr);
+    auto depthAttachment = vkme::core::Info::depthAttachmentInfo(depthImage->imageView(), 1.0f);
+    if (!clear)
+    {
+        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    }
+    auto renderInfo = vkme::core::Info::renderingInfo(imageExtent, &colorAttachment, &depthAttachment);
+
+    vkme::core::cmdBeginRendering(cmd, &renderInfo);
+
+    VkViewport viewport = {};
+    viewport.x = 0.0f; viewport.y = 0.0f;
+    viewport.width = float(imageExtent.width); viewport.height = float(imageExtent.height);
+    viewport.minDepth = 0.0f; viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+    VkRect2D scissor = {};
+    scissor.extent = imageExtent;
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+    if (_renderer)
+    {
+        // The visible objects of the current phase are drawn with one indirect command for each
+        // draw bucket
+        _renderer->draw(cmd);
+    }
+    else
+    {
+        // The instances in the frustum of the scene BVH are drawn one by one
+        auto sceneDataBuffer = vkme::core::Buffer::createAllocatedBuffer(
+            _vulkanData,
+            sizeof(glm::mat4),
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            VMA_MEMORY_USAGE_CPU_TO_GPU
+        );
+        *reinterpret_cast<glm::mat4*>(sceneDataBuffer->allocatedData()) = _proj * _view;
+        frameResources.cleanupManager.push([sceneDataBuffer](VkDevice) {
+            sceneDataBuffer->cleanup();
+            delete sceneDataBuffer;
+        });
+
+        auto sceneDS = std::unique_ptr<vkme::core::DescriptorSet>(
+            frameResources.descriptorAllocator->allocate(_sceneDataLayout)
+        );
+        sceneDS->updateBuffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, sceneDataBuffer, sizeof(glm::mat4), 0);
+        vkme::core::DescriptorSet* ds[] = { sceneDS.get() };
+
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipeline);
+        for (auto instance : _frustumInstances)
+        {
+            _models.at(_sceneBVH.model(instance)).draw(cmd, _pipelineLayout, ds, 1);
+        }
+    }
+
+    vkme::core::cmdEndRendering(cmd);
+}
@@ -7,14 +7,22 @@
 void MeshBuffersDelegate::init(vkme::VulkanData * vulkanData)
 {
     _vulkanData = vulkanData;
-    _drawImage = std::shared_ptr<vkme::core::Image>(vkme::core::Image::createAllocatedImage(
+    _drawImage = vkme::core::Image::createPooledImage(
         vulkanData,
         VK_FORMAT_R16G16B16A16_SFLOAT,
         vulkanData->swapchain().extent(),
         VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+            VK_IMAGE_USAGE_SAMPLED_BIT,
         VK_IMAGE_ASPECT_COLOR_BIT
-    ));
+    );
+    
+    // The draw image stores the final linear colors, so it's written in the swapchain image
+    // without tonemapping, only with the sRGB encoding and the dithering
+    _compositeRenderer = vkme::tools::CompositeRenderer::create(
+        vulkanData,
+        vkme::tools::CompositeRenderer::Tonemap::None
+    );
     
     vulkanData->cleanupManager().push([this](VkDevice) {
         this->cleanup();
@@ -25,23 +33,30 @@ void MeshBuffersDelegate::init(vkme::VulkanData * vulkanData)
     initPipeline();
 }
 
+void MeshBuffersDelegate::initFrameResources(vkme::core::DescriptorSetAllocator * allocator)
+{
+    // The composite renderer allocates its descriptor set from the frame resources
+    vkme::tools::CompositeRenderer::initFrameResources(allocator);
+}
+
 void MeshBuffersDelegate::cleanup()
 {
-    _drawImage->cleanup();
+    _vulkanData->imagePool().destroy(_drawImage);
 }
 
 void MeshBuffersDelegate::swapchainResized(VkExtent2D newExtent)
 {
-    // Resize the target imagge
-    _drawImage->cleanup();
-    _drawImage = std::shared_ptr<vkme::core::Image>(vkme::core::Image::createAllocatedImage(
+    // Resize the target image. The frames in flight may still be using the old one
+    vkme::core::Image::releasePooledImage(_vulkanData, _drawImage);
+    _drawImage = vkme::core::Image::createPooledImage(
         _vulkanData,
         VK_FORMAT_R16G16B16A16_SFLOAT,
         newExtent,
         VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+        VK_IMAGE_USAGE_SAMPLED_BIT,
         VK_IMAGE_ASPECT_COLOR_BIT
-    ));
+    );
 }
 
 
@@ -54,10 +69,14 @@ VkImageLayout MeshBuffersDelegate::draw(
 ) {
     using namespace vkme;
     
+    // The pooled images can move when other images are created or destroyed, so the handle is
+    // resolved in each frame
+    auto& drawImage = _vulkanData->imagePool().at(_drawImage);
+    
     // Transition draw image to render on it
     core::Image::cmdTransitionImage(
         cmd,
-        _drawImage->image(),
+        drawImage.image(),
         VK_IMAGE_LAYOUT_UNDEFINED,
         VK_IMAGE_LAYOUT_GENERAL
     );
@@ -66,35 +85,31 @@ VkImageLayout MeshBuffersDelegate::draw(
     
     core::Image::cmdTransitionImage(
         cmd,
-        _drawImage->image(),
+        drawImage.image(),
         VK_IMAGE_LAYOUT_GENERAL,
         VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
     );
     
-    drawGeometry(cmd, _drawImage->imageView(), colorImage->extent2D());
+    drawGeometry(cmd, drawImage.imageView(), colorImage->extent2D());
     
-    // Transition _drawImage and swapchain image to copy the first one to the second one
+    // Write the draw image into the swapchain image. The composite pass also blends the user
+    // interface overlay, and leaves the swapchain image in the COLOR_ATTACHMENT_OPTIMAL layout
     core::Image::cmdTransitionImage(
         cmd,
-        _drawImage->image(),
+        drawImage.image(),
         VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
     );
     core::Image::cmdTransitionImage(
         cmd,
         colorImage->image(),
         VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
     );
     
-    // Copy drawImage into swapchain image
-    core::Image::cmdCopy(
-        cmd,
-        _drawImage->image(), _drawImage->extent2D(),
-        colorImage->image(), colorImage->extent2D()
-    );
+    _compositeRenderer->draw(cmd, currentFrame, &drawImage, colorImage, frameResources);
     
-    return VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 }
 
 void MeshBuffersDelegate::drawUI()
@@ -162,6 +177,8 @@ void MeshBuffersDelegate::initMesh()
 
 void MeshBuffersDelegate::drawBackground(VkCommandBuffer cmd, uint32_t currentFrame)
 {
+    auto& drawImage = _vulkanData->imagePool().at(_drawImage);
+    
     // Clear image
     VkClearColorValue clearValue;
     float flash = std::abs(std::sin(currentFrame / 120.0f));
@@ -169,7 +186,7 @@ void MeshBuffersDelegate::drawBackground(VkCommandBuffer cmd, uint32_t currentFr
     auto clearRange = vkme::core::Image::subresourceRange(VK_IMAGE_ASPECT_COLOR_BIT);
     vkCmdClearColorImage(
         cmd,
-        _drawImage->image(),
+        drawImage.image(),
         VK_IMAGE_LAYOUT_GENERAL,
         &clearValue, 1, &clearRange
     );
@@ -199,11 +216,11 @@ void MeshBuffersDelegate::drawGeometry(VkCommandBuffer cmd, VkImageView currentI
     
     vkme::geo::MeshPushConstants pushConstants;
     pushConstants.modelMatrix = glm::mat4(1.0f);
-    pushConstants.vertexBufferAddress = _rectangle->vertexBufferAddress;
+    pushConstants.vertexBufferAddress = _rectangle->vertexBufferAddress();
     vkCmdPushConstants(cmd, _pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(vkme::geo::MeshPushConstants), &pushConstants);
-    vkCmdBindIndexBuffer(cmd, _rectangle->indexBuffer->buffer(), 0, VK_INDEX_TYPE_UINT32);
+    _rectangle->bindIndexBuffer(cmd);
     
-    vkCmdDrawIndexed(cmd, _rectangle->indexCount, 1, 0, 0, 0);
+    vkCmdDrawIndexed(cmd, _rectangle->indexCount, 1, _rectangle->firstIndex(), 0, 0);
     
     vkme::core::cmdEndRendering(cmd);
 }
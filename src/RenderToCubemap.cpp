@@ -86,19 +86,36 @@ void RenderToCubemap::init(vkme::VulkanData * vulkanData)
     _vulkanData = vulkanData;
 
 	// The second scene will be rendered to this image
-    _drawImage = std::shared_ptr<vkme::core::Image>(vkme::core::Image::createAllocatedImage(
+    _drawImage = vkme::core::Image::createPooledImage(
         vulkanData,
         VK_FORMAT_R16G16B16A16_SFLOAT,
         vulkanData->swapchain().extent(),
         VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+            VK_IMAGE_USAGE_SAMPLED_BIT,
         VK_IMAGE_ASPECT_COLOR_BIT
-    ));
+    );
     
     vulkanData->cleanupManager().push([this](VkDevice) {
         this->cleanup();
     });
     
+    // Tonemap and write the draw image in the swapchain image
+    _compositeRenderer = vkme::tools::CompositeRenderer::create(vulkanData);
+    
+    // Screenshots and frame capture
+    _frameCapture = std::unique_ptr<vkme::tools::FrameCapture>(
+        new vkme::tools::FrameCapture(vulkanData)
+    );
+    _frameCapture->init();
+    
+    // The draw image is allocated with the swapchain size, and the scene is rendered in a
+    // region of it that depends on the GPU frame time
+    _dynamicResolution = std::unique_ptr<vkme::tools::DynamicResolution>(
+        new vkme::tools::DynamicResolution(vulkanData)
+    );
+    _dynamicResolution->init();
+    
     // Init the descriptor set allocator
     _descriptorSetAllocator = std::unique_ptr<vkme::core::DescriptorSetAllocator>(
         new vkme::core::DescriptorSetAllocator()
@@ -146,20 +163,22 @@ void RenderToCubemap::initFrameResources(vkme::core::DescriptorSetAllocator * al
 
 	vkme::tools::SpecularReflectionCubemapRenderer::getFrameResourcesRequirements(ratios);
     
-    allocator->initPool(10, ratios);
+    vkme::tools::CompositeRenderer::initFrameResources(allocator, ratios);
 }
 
 void RenderToCubemap::swapchainResized(VkExtent2D newExtent)
 {
-    _drawImage->cleanup();
-    _drawImage = std::shared_ptr<vkme::core::Image>(vkme::core::Image::createAllocatedImage(
+    // The frames in flight may still be using the old draw image
+    vkme::core::Image::releasePooledImage(_vulkanData, _drawImage);
+    _drawImage = vkme::core::Image::createPooledImage(
         _vulkanData,
         VK_FORMAT_R16G16B16A16_SFLOAT,
         newExtent,
         VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+        VK_IMAGE_USAGE_SAMPLED_BIT,
         VK_IMAGE_ASPECT_COLOR_BIT
-    ));
+    );
     
     auto proj = glm::perspective(glm::radians(50.0f), float(newExtent.width) / float(newExtent.height), 0.1f, 10.0f);
     proj[1][1] *= -1.0f;
@@ -171,7 +190,8 @@ void RenderToCubemap::swapchainResized(VkExtent2D newExtent)
 
 void RenderToCubemap::cleanup()
 {
-    _drawImage->cleanup();
+    _frameCapture->cleanup();
+    _vulkanData->imagePool().destroy(_drawImage);
 }
 
 void RenderToCubemap::update(int32_t currentFrame, vkme::core::FrameResources& frameResources)
@@ -192,7 +212,19 @@ VkImageLayout RenderToCubemap::draw(
     vkme::core::FrameResources& frameResources
 ) {
     using namespace vkme;
-
+    
+    // The pooled images can move when other images are created or destroyed, so the handle is
+    // resolved in each frame
+    auto& drawImage = _vulkanData->imagePool().at(_drawImage);
+    
+    // Measure the GPU time of the whole frame, and update the render scale from the time
+    // of the last frame that used these frame resources
+    _dynamicResolution->cmdBeginFrame(cmd, currentFrame);
+    auto renderExtent = _dynamicResolution->renderExtent(drawImage.extent2D());
+    _compositeRenderer->setInputScale(
+        float(renderExtent.width) / float(drawImage.extent().width),
+        float(renderExtent.height) / float(drawImage.extent().height)
+    );
 
 	// Update the sphere to cube renderer. This is only needed if the equirectangular texture changes,
 	// but here we are updating it every frame as an example
@@ -256,62 +288,55 @@ VkImageLayout RenderToCubemap::draw(
         m->setModelMatrix(modelMatrix);
     }
 
-    // Transition draw image to render on it
-    core::Image::cmdTransitionImage(
-        cmd,
-        _drawImage->image(),
-        VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_GENERAL
-    );
+    // The render graph records the layout transitions and barriers between the passes.
+    // The depth image is cleared by the geometry pass, so its contents can be discarded
+    _renderGraph.clear();
     
-    core::Image::cmdTransitionImage(
-        cmd,
-        depthImage->image(),
-        VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_GENERAL,
-        VK_IMAGE_ASPECT_DEPTH_BIT
-    );
+    _renderGraph.addPass("background")
+        .write(&drawImage, VK_IMAGE_LAYOUT_GENERAL, true)
+        .execute([&](VkCommandBuffer cmd) {
+            drawBackground(cmd, currentFrame, &drawImage);
+        });
     
-    drawBackground(cmd, currentFrame, _drawImage.get());
+    _renderGraph.addPass("geometry")
+        .write(&drawImage, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
+        .write(depthImage, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, true)
+        .execute([&](VkCommandBuffer cmd) {
+            drawGeometry(cmd, drawImage.imageView(), renderExtent, depthImage, currentFrame, frameResources, _scene);
+        });
     
-    core::Image::cmdTransitionImage(
-        cmd,
-        depthImage->image(),
-        VK_IMAGE_LAYOUT_GENERAL,
-        VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL
-    );
+    // The capture reads the HDR image, before the tonemapping
+    if (_captureFrame || _captureAllFrames)
+    {
+        auto capturePath = "frame_" + std::to_string(currentFrame) + ".exr";
+        _renderGraph.addPass("capture")
+            .read(&drawImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
+            .sideEffects()
+            .execute([&, capturePath](VkCommandBuffer cmd) {
+                _frameCapture->cmdCapture(cmd, &drawImage, capturePath, renderExtent);
+            });
+        _captureFrame = false;
+    }
+    else
+    {
+        _frameCapture->poll();
+    }
     
-    core::Image::cmdTransitionImage(
-        cmd,
-        _drawImage->image(),
-        VK_IMAGE_LAYOUT_GENERAL,
-        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
-    );
+    // Tonemap the draw image into the swapchain image, and blend the user interface overlay
+    // over it in the same pass
+    _renderGraph.addPass("composite")
+        .read(&drawImage, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+        .write(colorImage, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true)
+        .execute([&](VkCommandBuffer cmd) {
+            _compositeRenderer->draw(cmd, currentFrame, &drawImage, colorImage, frameResources);
+        });
     
-    drawGeometry(cmd, _drawImage->imageView(), colorImage->extent2D(), depthImage, currentFrame, frameResources, _scene);
+    _renderGraph.markOutput(colorImage);
+    _renderGraph.execute(cmd);
     
-    // Transition _drawImage and swapchain image to copy the first one to the second one
-    core::Image::cmdTransitionImage(
-        cmd,
-        _drawImage->image(),
-        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
-    );
-    core::Image::cmdTransitionImage(
-        cmd,
-        colorImage->image(),
-        VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-    );
-    
-    // Copy drawImage into swapchain image
-    core::Image::cmdCopy(
-        cmd,
-        _drawImage->image(), _drawImage->extent2D(),
-        colorImage->image(), colorImage->extent2D()
-    );
+    _dynamicResolution->cmdEndFrame(cmd, currentFrame);
     
-    return VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 }
 
 void RenderToCubemap::drawUI()
@@ -413,6 +438,68 @@ void RenderToCubemap::drawUI()
 			_specularReflectionRenderer->setSampleCount(sampleCount);
 		}
         
+        if (ImGui::CollapsingHeader("Dynamic Resolution"))
+        {
+            bool enabled = _dynamicResolution->enabled();
+            float targetTime = _dynamicResolution->targetFrameTime();
+            float minScale = _dynamicResolution->minScale();
+            ImGui::Checkbox("Enabled", &enabled);
+            ImGui::SliderFloat("Target GPU time (ms)", &targetTime, 1.0f, 50.0f);
+            ImGui::SliderFloat("Minimum scale", &minScale, 0.25f, 1.0f);
+            _dynamicResolution->setEnabled(enabled);
+            _dynamicResolution->setTargetFrameTime(targetTime);
+            _dynamicResolution->setMinScale(minScale);
+            if (_dynamicResolution->timestampsSupported())
+            {
+                ImGui::Text("GPU time: %.2f ms, scale: %.2f", _dynamicResolution->gpuTime(), _dynamicResolution->scale());
+            }
+            else
+            {
+                ImGui::Text("GPU timestamps are not supported");
+            }
+        }
+        
+        if (ImGui::CollapsingHeader("Presentation"))
+        {
+            auto& swapchain = _vulkanData->swapchain();
+            const char* modeNames[] = { "Immediate", "Mailbox", "FIFO", "FIFO relaxed" };
+            int mode = int(swapchain.requestedPresentMode());
+            if (ImGui::Combo("Present mode", &mode, modeNames, IM_ARRAYSIZE(modeNames)))
+            {
+                swapchain.setPresentMode(VkPresentModeKHR(mode));
+            }
+            ImGui::Text("Current present mode: %s", modeNames[std::min(int(swapchain.presentMode()), 3)]);
+            
+            int imageCount = int(swapchain.requestedMinImageCount());
+            if (ImGui::SliderInt("Min image count (0: default)", &imageCount, 0, 4))
+            {
+                swapchain.setMinImageCount(uint32_t(imageCount));
+            }
+            ImGui::Text("Swapchain images: %u", swapchain.imageCount());
+            
+            if (_vulkanData->presentWaitSupported())
+            {
+                int maxLatency = int(swapchain.maxFrameLatency());
+                ImGui::SliderInt("Max frame latency (0: no limit)", &maxLatency, 0, 3);
+                swapchain.setMaxFrameLatency(uint32_t(maxLatency));
+                ImGui::Text("Input to present latency: %.2f ms", swapchain.presentLatency());
+            }
+            else
+            {
+                ImGui::Text("VK_KHR_present_wait is not supported");
+            }
+        }
+        
+        if (ImGui::CollapsingHeader("Frame Capture"))
+        {
+            if (ImGui::Button("Capture frame"))
+            {
+                _captureFrame = true;
+            }
+            ImGui::Checkbox("Capture all frames", &_captureAllFrames);
+            ImGui::Text("Captured: %u, skipped: %u", _frameCapture->capturedFrames(), _frameCapture->skippedFrames());
+        }
+        
     }
     ImGui::End();
 }
@@ -491,13 +578,15 @@ void RenderToCubemap::initMeshScene(SceneCubemap& scene)
 
     std::string assetsPath = vkme::PlatformTools::assetPath() + "taza.obj";
 
+    // The scene shader decodes the packed vertices
+    auto vertexFormat = vkme::geo::VertexFormat::Packed;
     auto basicMesh = vkme::geo::Model::loadObj(_vulkanData, assetsPath, {
 		std::shared_ptr<vkme::geo::Modifier>(new vkme::geo::ScaleModifier(0.5f))
-    });
+    }, vertexFormat);
 
     scene.models = {
-        vkme::geo::Cube::createCube(_vulkanData, 1.0f),
-        vkme::geo::Sphere::createUvSphere(_vulkanData, 0.25f)
+        vkme::geo::Cube::createCube(_vulkanData, 1.0f, "cube", {}, vertexFormat),
+        vkme::geo::Sphere::createUvSphere(_vulkanData, 0.25f, "sphere", {}, vertexFormat)
     };
 
     for (auto m : basicMesh)
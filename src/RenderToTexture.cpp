@@ -57,14 +57,8 @@ void Scene::initPipeline(vkme::VulkanData* vulkanData)
     });
 }
 
-void Scene::initScene(vkme::VulkanData* vulkanData, vkme::core::DescriptorSetAllocator * dsAllocator, const glm::mat4& proj)
+void Scene::initScene(const glm::mat4& proj)
 {
-    // Allocate scene data descriptor set
-    sceneDataDescriptorSet = std::unique_ptr<vkme::core::DescriptorSet>(
-        dsAllocator->allocate(sceneDataDescriptorLayout)
-    );
-    
-    // Update scene data buffer
     glm::mat4 view = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 2.0f));
     
     sceneData.view = view;
@@ -73,28 +67,6 @@ void Scene::initScene(vkme::VulkanData* vulkanData, vkme::core::DescriptorSetAll
     sceneData.ambientColor = glm::vec4(0.2f, 0.2f, 0.2f, 1.0f);
     sceneData.sunlightColor = glm::vec4(0.8f, 0.8f, 0.8f, 1.0f);
     sceneData.sunlightDirection = glm::vec4(4.0f, 4.0f, -2.0f, 1.0f);
-    
-    sceneDataBuffer = std::unique_ptr<vkme::core::Buffer>(vkme::core::Buffer::createAllocatedBuffer(
-        vulkanData,
-        sizeof(SceneData),
-        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-        VMA_MEMORY_USAGE_CPU_TO_GPU
-    ));
-    
-    vulkanData->cleanupManager().push([&](VkDevice) {
-        sceneDataBuffer->cleanup();
-    });
-    
-    SceneData* sceneDataPtr = reinterpret_cast<SceneData*>(sceneDataBuffer->allocatedData());
-    *sceneDataPtr = sceneData;
-    
-    sceneDataDescriptorSet->updateBuffer(
-        0, // binding
-        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-        sceneDataBuffer.get(),
-        sizeof(SceneData),
-        0
-    );
 }
     
 void RenderToTexture::init(vkme::VulkanData * vulkanData)
@@ -102,14 +74,22 @@ void RenderToTexture::init(vkme::VulkanData * vulkanData)
     _vulkanData = vulkanData;
 
 	// The second scene will be rendered to this image
-    _drawImage = std::shared_ptr<vkme::core::Image>(vkme::core::Image::createAllocatedImage(
+    _drawImage = vkme::core::Image::createPooledImage(
         vulkanData,
         VK_FORMAT_R16G16B16A16_SFLOAT,
         vulkanData->swapchain().extent(),
         VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+            VK_IMAGE_USAGE_SAMPLED_BIT,
         VK_IMAGE_ASPECT_COLOR_BIT
-    ));
+    );
+    
+    // The draw image stores the final linear colors, so it's written in the swapchain image
+    // without tonemapping, only with the sRGB encoding and the dithering
+    _compositeRenderer = vkme::tools::CompositeRenderer::create(
+        vulkanData,
+        vkme::tools::CompositeRenderer::Tonemap::None
+    );
 
 	// The first image will be rendered into this image
     _rttImage = std::shared_ptr<vkme::core::Image>(vkme::core::Image::createAllocatedImage(
@@ -157,58 +137,37 @@ void RenderToTexture::init(vkme::VulkanData * vulkanData)
 
 void RenderToTexture::initFrameResources(vkme::core::DescriptorSetAllocator * allocator)
 {
+    // The composite renderer allocates its descriptor set from the frame resources, and the
+    // scene data of both scenes is uploaded in each frame
+    vkme::tools::CompositeRenderer::initFrameResources(allocator, { { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 } });
 }
 
 void RenderToTexture::swapchainResized(VkExtent2D newExtent)
 {
-    _drawImage->cleanup();
-    _drawImage = std::shared_ptr<vkme::core::Image>(vkme::core::Image::createAllocatedImage(
+    // The frames in flight may still be using the old draw image
+    vkme::core::Image::releasePooledImage(_vulkanData, _drawImage);
+    _drawImage = vkme::core::Image::createPooledImage(
         _vulkanData,
         VK_FORMAT_R16G16B16A16_SFLOAT,
         newExtent,
         VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+        VK_IMAGE_USAGE_SAMPLED_BIT,
         VK_IMAGE_ASPECT_COLOR_BIT
-    ));
-    
-    glm::mat4 proj = glm::perspective(glm::radians(50.0f), 1.0f, 0.1f, 10.0f);
-    proj[1][1] *= -1.0f;
-    proj[0][0] *= -1.0f;
-    _scene1.sceneData.proj = proj;
-    _scene1.sceneData.viewProj = proj * _scene1.sceneData.view;
-
-    SceneData* sceneDataPtr = reinterpret_cast<SceneData*>(_scene1.sceneDataBuffer->allocatedData());
-    *sceneDataPtr = _scene1.sceneData;
-    
-    _scene1.sceneDataDescriptorSet->updateBuffer(
-        0, // binding
-        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-        _scene1.sceneDataBuffer.get(),
-        sizeof(SceneData),
-        0
     );
-
-    proj = glm::perspective(glm::radians(50.0f), float(newExtent.width) / float(newExtent.height), 0.1f, 10.0f);
+    
+    // The first scene is rendered to a texture with a fixed size, so only the projection of the
+    // second one changes
+    glm::mat4 proj = glm::perspective(glm::radians(50.0f), float(newExtent.width) / float(newExtent.height), 0.1f, 10.0f);
     proj[1][1] *= -1.0f;
     proj[0][0] *= -1.0f;
     _scene2.sceneData.proj = proj;
     _scene2.sceneData.viewProj = proj * _scene2.sceneData.view;
-
-    sceneDataPtr = reinterpret_cast<SceneData*>(_scene2.sceneDataBuffer->allocatedData());
-    *sceneDataPtr = _scene2.sceneData;
-
-    _scene2.sceneDataDescriptorSet->updateBuffer(
-        0,
-        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-        _scene2.sceneDataBuffer.get(),
-        sizeof(SceneData),
-        0
-    );
 }
 
 void RenderToTexture::cleanup()
 {
-    _drawImage->cleanup();
+    _vulkanData->imagePool().destroy(_drawImage);
 	_rttImage->cleanup();
 	_rttDepthImage->cleanup();
 }
@@ -221,6 +180,10 @@ VkImageLayout RenderToTexture::draw(
     vkme::core::FrameResources& frameResources
 ) {
     using namespace vkme;
+    
+    // The pooled images can move when other images are created or destroyed, so the handle is
+    // resolved in each frame
+    auto& drawImage = _vulkanData->imagePool().at(_drawImage);
 
     // Update the scene 1 object model matrix
     for (auto& m : _scene1.models) {
@@ -308,7 +271,7 @@ VkImageLayout RenderToTexture::draw(
     // Transition draw image to render on it
     core::Image::cmdTransitionImage(
         cmd,
-        _drawImage->image(),
+        drawImage.image(),
         VK_IMAGE_LAYOUT_UNDEFINED,
         VK_IMAGE_LAYOUT_GENERAL
     );
@@ -321,7 +284,7 @@ VkImageLayout RenderToTexture::draw(
         VK_IMAGE_ASPECT_DEPTH_BIT
     );
     
-    drawBackground(cmd, currentFrame, _drawImage.get());
+    drawBackground(cmd, currentFrame, &drawImage);
     
     core::Image::cmdTransitionImage(
         cmd,
@@ -332,35 +295,31 @@ VkImageLayout RenderToTexture::draw(
     
     core::Image::cmdTransitionImage(
         cmd,
-        _drawImage->image(),
+        drawImage.image(),
         VK_IMAGE_LAYOUT_GENERAL,
         VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
     );
     
-    drawGeometry(cmd, _drawImage->imageView(), colorImage->extent2D(), depthImage, currentFrame, frameResources, _scene2);
+    drawGeometry(cmd, drawImage.imageView(), colorImage->extent2D(), depthImage, currentFrame, frameResources, _scene2);
     
-    // Transition _drawImage and swapchain image to copy the first one to the second one
+    // Write the draw image into the swapchain image. The composite pass also blends the user
+    // interface overlay, and leaves the swapchain image in the COLOR_ATTACHMENT_OPTIMAL layout
     core::Image::cmdTransitionImage(
         cmd,
-        _drawImage->image(),
+        drawImage.image(),
         VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
     );
     core::Image::cmdTransitionImage(
         cmd,
         colorImage->image(),
         VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
     );
     
-    // Copy drawImage into swapchain image
-    core::Image::cmdCopy(
-        cmd,
-        _drawImage->image(), _drawImage->extent2D(),
-        colorImage->image(), colorImage->extent2D()
-    );
+    _compositeRenderer->draw(cmd, currentFrame, &drawImage, colorImage, frameResources);
     
-    return VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 }
 
 void RenderToTexture::drawUI()
@@ -416,13 +375,13 @@ void RenderToTexture::initScenes()
     proj[1][1] *= -1.0f;
     proj[0][0] *= -1.0f;
     _scene1.initPipeline(_vulkanData);
-    _scene1.initScene(_vulkanData, _descriptorSetAllocator.get(), proj);
+    _scene1.initScene(proj);
 
     proj = glm::perspective(glm::radians(50.0f), float(viewportExtent.width) / float(viewportExtent.height), 0.1f, 10.0f);
     proj[1][1] *= -1.0f;
     proj[0][0] *= -1.0f;
     _scene2.initPipeline(_vulkanData);
-	_scene2.initScene(_vulkanData, _descriptorSetAllocator.get(), proj);
+	_scene2.initScene(proj);
 }
 
 void RenderToTexture::initMeshScene1(Scene& scene)
@@ -542,6 +501,29 @@ void RenderToTexture::drawGeometry(
     vkme::core::FrameResources& frameResources,
     Scene& scene
 ) {
+    auto sceneDataBuffer = vkme::core::Buffer::createAllocatedBuffer(
+        _vulkanData,
+        sizeof(SceneData),
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VMA_MEMORY_USAGE_CPU_TO_GPU
+    );
+    *reinterpret_cast<SceneData*>(sceneDataBuffer->allocatedData()) = scene.sceneData;
+    frameResources.cleanupManager.push([sceneDataBuffer](VkDevice) {
+        sceneDataBuffer->cleanup();
+        delete sceneDataBuffer;
+    });
+    
+    auto sceneDataDescriptorSet = std::unique_ptr<vkme::core::DescriptorSet>(
+        frameResources.descriptorAllocator->allocate(scene.sceneDataDescriptorLayout)
+    );
+    sceneDataDescriptorSet->updateBuffer(
+        0, // binding
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+        sceneDataBuffer,
+        sizeof(SceneData),
+        0
+    );
+
     auto colorAttachment = vkme::core::Info::attachmentInfo(currentImage, nullptr);
     auto depthAttachment = vkme::core::Info::depthAttachmentInfo(depthImage->imageView(), 1.0);
     auto renderInfo = vkme::core::Info::renderingInfo(imageExtent, &colorAttachment, &depthAttachment);
@@ -555,7 +537,7 @@ void RenderToTexture::drawGeometry(
     for (auto m : scene.models)
     {
         vkme::core::DescriptorSet* ds[] = {
-            scene.sceneDataDescriptorSet.get()
+            sceneDataDescriptorSet.get()
         };
         m->draw(cmd, scene.pipelineLayout, ds, 1);
     }
@@ -10,14 +10,17 @@
 void SkySphereDelegate::init(vkme::VulkanData * vulkanData)
 {
     _vulkanData = vulkanData;
-    _drawImage = std::shared_ptr<vkme::core::Image>(vkme::core::Image::createAllocatedImage(
+    _drawImage = vkme::core::Image::createPooledImage(
         vulkanData,
         VK_FORMAT_R16G16B16A16_SFLOAT,
         vulkanData->swapchain().extent(),
-        VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+            VK_IMAGE_USAGE_SAMPLED_BIT,
         VK_IMAGE_ASPECT_COLOR_BIT
-    ));
+    );
+    
+    // Tonemap and write the draw image in the swapchain image
+    _compositeRenderer = vkme::tools::CompositeRenderer::create(vulkanData);
     
     vulkanData->cleanupManager().push([this](VkDevice) {
         this->cleanup();
@@ -33,41 +36,34 @@ void SkySphereDelegate::init(vkme::VulkanData * vulkanData)
 
 void SkySphereDelegate::initFrameResources(vkme::core::DescriptorSetAllocator * allocator)
 {
+    // The composite renderer allocates its descriptor set from the frame resources, and the
+    // scene data is uploaded in each frame
+    vkme::tools::CompositeRenderer::initFrameResources(allocator, { { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 } });
 }
 
 void SkySphereDelegate::swapchainResized(VkExtent2D newExtent)
 {
-    _drawImage->cleanup();
-    _drawImage = std::shared_ptr<vkme::core::Image>(vkme::core::Image::createAllocatedImage(
+    // The frames in flight may still be using the old draw image
+    vkme::core::Image::releasePooledImage(_vulkanData, _drawImage);
+    _drawImage = vkme::core::Image::createPooledImage(
         _vulkanData,
         VK_FORMAT_R16G16B16A16_SFLOAT,
         newExtent,
-        VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+            VK_IMAGE_USAGE_SAMPLED_BIT,
         VK_IMAGE_ASPECT_COLOR_BIT
-    ));
+    );
     
     glm::mat4 proj = glm::perspective(glm::radians(50.0f), float(newExtent.width) / float(newExtent.height), 0.1f, 10.0f);
     proj[1][1] *= -1.0f;
     proj[0][0] *= -1.0f;
     _sceneData.proj = proj;
     _sceneData.viewProj = proj * _sceneData.view;
-
-    SceneData* sceneDataPtr = reinterpret_cast<SceneData*>(_sceneDataBuffer->allocatedData());
-    *sceneDataPtr = _sceneData;
-    
-    _sceneDataDescriptorSet->updateBuffer(
-        0, // binding
-        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-        _sceneDataBuffer.get(),
-        sizeof(SceneData),
-        0
-    );
 }
 
 void SkySphereDelegate::cleanup()
 {
-    _drawImage->cleanup();
+    _vulkanData->imagePool().destroy(_drawImage);
 }
 
 VkImageLayout SkySphereDelegate::draw(
@@ -79,62 +75,40 @@ VkImageLayout SkySphereDelegate::draw(
 ) {
     using namespace vkme;
     
-    // Transition draw image to render on it
-    core::Image::cmdTransitionImage(
-        cmd,
-        _drawImage->image(),
-        VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_GENERAL
-    );
-    
-    core::Image::cmdTransitionImage(
-        cmd,
-        depthImage->image(),
-        VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_GENERAL,
-        VK_IMAGE_ASPECT_DEPTH_BIT
-    );
-    
-    drawBackground(cmd, currentFrame, depthImage);
+    // The pooled images can move when other images are created or destroyed, so the handle is
+    // resolved in each frame
+    auto& drawImage = _vulkanData->imagePool().at(_drawImage);
     
-    core::Image::cmdTransitionImage(
-        cmd,
-        depthImage->image(),
-        VK_IMAGE_LAYOUT_GENERAL,
-        VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL
-    );
+    // The render graph records the layout transitions and barriers between the passes.
+    // The depth image is cleared by the geometry pass, so its contents can be discarded
+    _renderGraph.clear();
     
-    core::Image::cmdTransitionImage(
-        cmd,
-        _drawImage->image(),
-        VK_IMAGE_LAYOUT_GENERAL,
-        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
-    );
+    _renderGraph.addPass("background")
+        .write(&drawImage, VK_IMAGE_LAYOUT_GENERAL, true)
+        .execute([&](VkCommandBuffer cmd) {
+            drawBackground(cmd, currentFrame, depthImage);
+        });
     
-    drawGeometry(cmd, _drawImage->imageView(), colorImage->extent2D(), depthImage, currentFrame, frameResources);
+    _renderGraph.addPass("geometry")
+        .write(&drawImage, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
+        .write(depthImage, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, true)
+        .execute([&](VkCommandBuffer cmd) {
+            drawGeometry(cmd, drawImage.imageView(), colorImage->extent2D(), depthImage, currentFrame, frameResources);
+        });
     
-    // Transition _drawImage and swapchain image to copy the first one to the second one
-    core::Image::cmdTransitionImage(
-        cmd,
-        _drawImage->image(),
-        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
-    );
-    core::Image::cmdTransitionImage(
-        cmd,
-        colorImage->image(),
-        VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-    );
+    // Tonemap the draw image into the swapchain image, and blend the user interface overlay
+    // over it in the same pass
+    _renderGraph.addPass("composite")
+        .read(&drawImage, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+        .write(colorImage, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true)
+        .execute([&](VkCommandBuffer cmd) {
+            _compositeRenderer->draw(cmd, currentFrame, &drawImage, colorImage, frameResources);
+        });
     
-    // Copy drawImage into swapchain image
-    core::Image::cmdCopy(
-        cmd,
-        _drawImage->image(), _drawImage->extent2D(),
-        colorImage->image(), colorImage->extent2D()
-    );
+    _renderGraph.markOutput(colorImage);
+    _renderGraph.execute(cmd);
     
-    return VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 }
 
 void SkySphereDelegate::drawUI()
@@ -240,12 +214,6 @@ void SkySphereDelegate::initPipeline()
 
 void SkySphereDelegate::initScene()
 {
-    // Allocate scene data descriptor set
-    _sceneDataDescriptorSet = std::unique_ptr<vkme::core::DescriptorSet>(
-        _descriptorSetAllocator->allocate(_sceneDataDescriptorLayout)
-    );
-    
-    // Update scene data buffer
     auto viewportExtent = _vulkanData->swapchain().extent();
     glm::mat4 view = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 5.0f));
     glm::mat4 proj = glm::perspective(glm::radians(50.0f), float(viewportExtent.width) / float(viewportExtent.height), 0.1f, 10.0f);
@@ -255,28 +223,6 @@ void SkySphereDelegate::initScene()
     _sceneData.view = view;
     _sceneData.proj = proj;
     _sceneData.viewProj = proj * view;
-    
-    _sceneDataBuffer = std::unique_ptr<vkme::core::Buffer>(vkme::core::Buffer::createAllocatedBuffer(
-        _vulkanData,
-        sizeof(SceneData),
-        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-        VMA_MEMORY_USAGE_CPU_TO_GPU
-    ));
-    
-    _vulkanData->cleanupManager().push([&](VkDevice) {
-        _sceneDataBuffer->cleanup();
-    });
-    
-    SceneData* sceneDataPtr = reinterpret_cast<SceneData*>(_sceneDataBuffer->allocatedData());
-    *sceneDataPtr = _sceneData;
-    
-    _sceneDataDescriptorSet->updateBuffer(
-        0, // binding
-        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-        _sceneDataBuffer.get(),
-        sizeof(SceneData),
-        0
-    );
 }
 
 void SkySphereDelegate::initMesh()
@@ -333,6 +279,8 @@ void SkySphereDelegate::initMesh()
 
 void SkySphereDelegate::drawBackground(VkCommandBuffer cmd, uint32_t currentFrame, const vkme::core::Image* depthImage)
 {
+    auto& drawImage = _vulkanData->imagePool().at(_drawImage);
+    
     VkClearColorValue clearValue;
     float r = std::abs(std::sin(currentFrame / 90.0f)) * 0.5f;
     float g = std::abs(std::sin(currentFrame / 180.0f)) * 0.5f;
@@ -341,7 +289,7 @@ void SkySphereDelegate::drawBackground(VkCommandBuffer cmd, uint32_t currentFram
     auto clearRange = vkme::core::Image::subresourceRange(VK_IMAGE_ASPECT_COLOR_BIT);
     vkCmdClearColorImage(
         cmd,
-        _drawImage->image(),
+        drawImage.image(),
         VK_IMAGE_LAYOUT_GENERAL,
         &clearValue, 1, &clearRange
     );
@@ -374,6 +322,29 @@ void SkySphereDelegate::drawGeometry(
         m->setModelMatrix(modelMatrix);
     }
 
+    auto sceneDataBuffer = vkme::core::Buffer::createAllocatedBuffer(
+        _vulkanData,
+        sizeof(SceneData),
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VMA_MEMORY_USAGE_CPU_TO_GPU
+    );
+    *reinterpret_cast<SceneData*>(sceneDataBuffer->allocatedData()) = _sceneData;
+    frameResources.cleanupManager.push([sceneDataBuffer](VkDevice) {
+        sceneDataBuffer->cleanup();
+        delete sceneDataBuffer;
+    });
+    
+    auto sceneDataDescriptorSet = std::unique_ptr<vkme::core::DescriptorSet>(
+        frameResources.descriptorAllocator->allocate(_sceneDataDescriptorLayout)
+    );
+    sceneDataDescriptorSet->updateBuffer(
+        0, // binding
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+        sceneDataBuffer,
+        sizeof(SceneData),
+        0
+    );
+
     auto colorAttachment = vkme::core::Info::attachmentInfo(currentImage, nullptr);
     auto depthAttachment = vkme::core::Info::depthAttachmentInfo(depthImage->imageView(), 1.0);
     auto renderInfo = vkme::core::Info::renderingInfo(imageExtent, &colorAttachment, &depthAttachment);
@@ -387,7 +358,7 @@ void SkySphereDelegate::drawGeometry(
     for (auto m : _models)
     {
         vkme::core::DescriptorSet* ds[] = {
-            _sceneDataDescriptorSet.get()
+            sceneDataDescriptorSet.get()
         };
         m->draw(cmd, _pipelineLayout, ds, 1);
     }
@@ -8,14 +8,22 @@
 void TexturesTestDelegate::init(vkme::VulkanData * vulkanData)
 {
     _vulkanData = vulkanData;
-    _drawImage = std::shared_ptr<vkme::core::Image>(vkme::core::Image::createAllocatedImage(
+    _drawImage = vkme::core::Image::createPooledImage(
         vulkanData,
         VK_FORMAT_R16G16B16A16_SFLOAT,
         vulkanData->swapchain().extent(),
         VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+            VK_IMAGE_USAGE_SAMPLED_BIT,
         VK_IMAGE_ASPECT_COLOR_BIT
-    ));
+    );
+    
+    // The draw image stores the final linear colors, so it's written in the swapchain image
+    // without tonemapping, only with the sRGB encoding and the dithering
+    _compositeRenderer = vkme::tools::CompositeRenderer::create(
+        vulkanData,
+        vkme::tools::CompositeRenderer::Tonemap::None
+    );
     
     vulkanData->cleanupManager().push([this](VkDevice) {
         this->cleanup();
@@ -37,15 +45,17 @@ void TexturesTestDelegate::initFrameResources(vkme::core::DescriptorSetAllocator
     // that reason we are using this function to configure the pool in the allocator.
     // You also can store the descritor pool outside the frame resources, if you dont want to
     // use per-frame data. In this case, you don't need to use this function
-    allocator->initPool(
-        1000,   // Each pool can store up to 1000 descriptor set
+    // The composite renderer adds the requirements of its descriptor set
+    vkme::tools::CompositeRenderer::initFrameResources(
+        allocator,
         {  // Each descriptor set can contain
             { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1},         // One uniform buffer. We are using it to pass the SceneData struct
             
             // Now this descriptor set is allocated from the _materialDescriptorAllocator, so
             // we don't need this kind of descriptor in the frame resources
             // { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1 } // One combined image sampler. We are using it to pass the texture
-        }
+        },
+        1000    // Each pool can store up to 1000 descriptor set
     );
     
     // Note: if you may store more than one type of descriptor set layout, you must specify the
@@ -61,16 +71,17 @@ void TexturesTestDelegate::initFrameResources(vkme::core::DescriptorSetAllocator
 
 void TexturesTestDelegate::swapchainResized(VkExtent2D newExtent)
 {
-    // Resize the target imagge
-    _drawImage->cleanup();
-    _drawImage = std::shared_ptr<vkme::core::Image>(vkme::core::Image::createAllocatedImage(
+    // Resize the target image. The frames in flight may still be using the old one
+    vkme::core::Image::releasePooledImage(_vulkanData, _drawImage);
+    _drawImage = vkme::core::Image::createPooledImage(
         _vulkanData,
         VK_FORMAT_R16G16B16A16_SFLOAT,
         newExtent,
         VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+        VK_IMAGE_USAGE_SAMPLED_BIT,
         VK_IMAGE_ASPECT_COLOR_BIT
-    ));
+    );
     
     // Resize the projection matrix
     /// First update the projection matrix to match the
@@ -83,7 +94,7 @@ void TexturesTestDelegate::swapchainResized(VkExtent2D newExtent)
 
 void TexturesTestDelegate::cleanup()
 {
-    _drawImage->cleanup();
+    _vulkanData->imagePool().destroy(_drawImage);
 }
 
 VkImageLayout TexturesTestDelegate::draw(
@@ -95,10 +106,14 @@ VkImageLayout TexturesTestDelegate::draw(
 ) {
     using namespace vkme;
     
+    // The pooled images can move when other images are created or destroyed, so the handle is
+    // resolved in each frame
+    auto& drawImage = _vulkanData->imagePool().at(_drawImage);
+    
     // Transition draw image to render on it
     core::Image::cmdTransitionImage(
         cmd,
-        _drawImage->image(),
+        drawImage.image(),
         VK_IMAGE_LAYOUT_UNDEFINED,
         VK_IMAGE_LAYOUT_GENERAL
     );
@@ -107,35 +122,31 @@ VkImageLayout TexturesTestDelegate::draw(
     
     core::Image::cmdTransitionImage(
         cmd,
-        _drawImage->image(),
+        drawImage.image(),
         VK_IMAGE_LAYOUT_GENERAL,
         VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
     );
     
-    drawGeometry(cmd, _drawImage->imageView(), colorImage->extent2D(), depthImage, currentFrame, frameResources);
+    drawGeometry(cmd, drawImage.imageView(), colorImage->extent2D(), depthImage, currentFrame, frameResources);
     
-    // Transition _drawImage and swapchain image to copy the first one to the second one
+    // Write the draw image into the swapchain image. The composite pass also blends the user
+    // interface overlay, and leaves the swapchain image in the COLOR_ATTACHMENT_OPTIMAL layout
     core::Image::cmdTransitionImage(
         cmd,
-        _drawImage->image(),
+        drawImage.image(),
         VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
     );
     core::Image::cmdTransitionImage(
         cmd,
         colorImage->image(),
         VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
     );
     
-    // Copy drawImage into swapchain image
-    core::Image::cmdCopy(
-        cmd,
-        _drawImage->image(), _drawImage->extent2D(),
-        colorImage->image(), colorImage->extent2D()
-    );
+    _compositeRenderer->draw(cmd, currentFrame, &drawImage, colorImage, frameResources);
     
-    return VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 }
 
 void TexturesTestDelegate::drawUI()
@@ -335,6 +346,8 @@ void TexturesTestDelegate::initMesh()
 
 void TexturesTestDelegate::drawBackground(VkCommandBuffer cmd, uint32_t currentFrame)
 {
+    auto& drawImage = _vulkanData->imagePool().at(_drawImage);
+    
     // Clear image
     VkClearColorValue clearValue;
     float flash = std::abs(std::sin(currentFrame / 120.0f));
@@ -342,7 +355,7 @@ void TexturesTestDelegate::drawBackground(VkCommandBuffer cmd, uint32_t currentF
     auto clearRange = vkme::core::Image::subresourceRange(VK_IMAGE_ASPECT_COLOR_BIT);
     vkCmdClearColorImage(
         cmd,
-        _drawImage->image(),
+        drawImage.image(),
         VK_IMAGE_LAYOUT_GENERAL,
         &clearValue, 1, &clearRange
     );
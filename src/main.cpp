@@ -14,6 +14,7 @@
 #include <SkySphereDelegate.hpp>
 #include <RenderToTexture.hpp>
 #include <RenderToCubemap.hpp>
+#include <InstancedSceneDelegate.hpp>
 
 int main(int argc, char** argv) {
     vkme::MainLoop app;
@@ -36,6 +37,7 @@ int main(int argc, char** argv) {
     //auto delegate = std::shared_ptr<SkySphereDelegate>(new SkySphereDelegate());
     //auto delegate = std::shared_ptr<RenderToTexture>(new RenderToTexture());
     auto delegate = std::shared_ptr<RenderToCubemap>(new RenderToCubemap());
+    //auto delegate = std::shared_ptr<InstancedSceneDelegate>(new InstancedSceneDelegate());
     app.setDrawLoopDelegate(delegate);
     app.setUIDelegate(delegate);
     
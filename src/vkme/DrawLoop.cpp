@@ -46,6 +46,11 @@ void DrawLoop::swapchainResized()
 {
     if (_drawDelegate)
     {
+        if (_drawDelegate->waitIdleOnSwapchainResize())
+        {
+            vkDeviceWaitIdle(_vulkanData->device());
+        }
+        
         auto newExtent = _vulkanData->swapchain().extent();
         _drawDelegate->swapchainResized(newExtent);
     }
@@ -59,7 +64,7 @@ void DrawLoop::acquireAndPresent()
     
     // Vulkan objects
     VkDevice dev = _vulkanData->device();
-    auto swapchainData = _vulkanData->swapchain();
+    auto& swapchainData = _vulkanData->swapchain();
     auto swapchain = swapchainData.swapchain();
     auto graphicsQueue = _vulkanData->command().graphicsQueue();
     
@@ -71,9 +76,8 @@ void DrawLoop::acquireAndPresent()
     auto renderSemaphore = frameRes.renderSemaphore;
 
     VK_ASSERT(vkWaitForFences(dev, 1, &frameFence, true, 10000000000));
-    VK_ASSERT(vkResetFences(dev, 1, &frameFence));
     
-      frameRes.flushFrameData();
+    frameRes.flushFrameData();
     
     uint32_t swapchainImageIndex;
     auto acquireResult = core::acquireNextImage(dev, swapchain, 10000000000, swapchainSemaphore, nullptr, &swapchainImageIndex);
@@ -86,6 +90,11 @@ void DrawLoop::acquireAndPresent()
         _vulkanData->updateSwapchainSize();
         return;
     }
+    
+    // The fence is reset only if the frame is going to be submitted, otherwise the next
+    // frame that uses these resources would wait for it forever
+    VK_ASSERT(vkResetFences(dev, 1, &frameFence));
+    _vulkanData->beginFrame();
 
 	if (_drawDelegate.get())
 	{
@@ -99,12 +108,19 @@ void DrawLoop::acquireAndPresent()
     
     VK_ASSERT(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
     
-    core::Image::cmdTransitionImage(
-        cmd,
-        depthImage->image(),
+    // The depth buffer is cleared in each frame, so its previous contents can be discarded. The
+    // swapchain image is available at the color attachment output stage, when the swapchain
+    // semaphore is signaled.
+    depthImage->cmdTransition(cmd, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, true);
+    swapchainImage->setSyncState({
         VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL
-    );
+        VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_ACCESS_2_NONE
+    });
+    
+    // The user interface is cached in an overlay image, that the composite pass of the delegate
+    // blends over the final image
+    frameRes.userInterfaceImage = _userInterface->updateOverlay(cmd);
     
     auto lastSwapchainLayout = draw(
         cmd,
@@ -114,28 +130,12 @@ void DrawLoop::acquireAndPresent()
     );
     //auto lastSwapchainLayout = draw(cmd, swapchainImage, swapchainData.extent(), swapchainData.depthImage());
     
-    if (lastSwapchainLayout != VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL) {
-        core::Image::cmdTransitionImage(
-            cmd,
-            swapchainImage->image(),
-            lastSwapchainLayout,
-            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
-        );
+    // The delegates that do not use the tracked transitions only report the last layout
+    if (swapchainImage->layout() != lastSwapchainLayout)
+    {
+        swapchainImage->setSyncState(core::Image::syncStateForLayout(lastSwapchainLayout));
     }
-    
-    // TODO: Instead of using the swapchain image to render the user interface, we could use another image
-    // and combine it with the swap chain here
-    _userInterface->draw(
-        cmd,
-        swapchainImage->imageView()
-    );
-    
-    core::Image::cmdTransitionImage(
-        cmd,
-        swapchainImage->image(),
-        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-        VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
-    );
+    swapchainImage->cmdTransition(cmd, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
     
     // End command buffer
     VK_ASSERT(vkEndCommandBuffer(cmd));
@@ -155,12 +155,26 @@ void DrawLoop::acquireAndPresent()
 
     // Present frame
     auto presentInfo = core::Info::presentInfo(swapchain, renderSemaphore, swapchainImageIndex);
+    VkPresentIdKHR presentId = {};
+    presentId.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+    presentId.swapchainCount = 1;
+    uint64_t presentIdValue = _vulkanData->swapchain().nextPresentId();
+    presentId.pPresentIds = &presentIdValue;
+    if (presentIdValue != 0)
+    {
+        presentInfo.pNext = &presentId;
+    }
     auto presentResult = core::queuePresent(graphicsQueue, &presentInfo);
     if (presentResult == VK_ERROR_OUT_OF_DATE_KHR || presentResult == VK_SUBOPTIMAL_KHR)
     {
         _vulkanData->updateSwapchainSize();
     }
     
+    if (_vulkanData->presentWaitSupported())
+    {
+        _vulkanData->swapchain().updatePresentLatency();
+    }
+    
     // Next frame
     _vulkanData->nextFrame();
 }
@@ -28,6 +28,13 @@ int32_t vkme::MainLoop::run()
     
     while (!quit)
     {
+        // Wait for the presentation of the previous frames before reading the input, if
+        // the swapchain has a maximum frame latency
+        if (!stopRendering)
+        {
+            _vulkanData.swapchain().beginFrame();
+        }
+        
         while (SDL_PollEvent(&event) != 0)
         {
             if (event.type == SDL_QUIT)
@@ -64,6 +71,7 @@ int32_t vkme::MainLoop::run()
         
         if (_vulkanData.newFrame())
         {
+            _userInterface.swapchainResized();
             _drawLoop.swapchainResized();
         }
         
@@ -1,6 +1,8 @@
 
 #include <vkme/PlatformTools.hpp>
 
+#include <filesystem>
+
 #ifdef MINI_ENGINE_IS_MAC
 
 #include <CoreFoundation/CoreFoundation.h>
@@ -50,3 +52,9 @@ std::string vkme::PlatformTools::assetPath()
     return "assets/";
 #endif
 }
+
+std::string vkme::PlatformTools::cachePath()
+{
+    // The application bundle and the working directory may not be writable
+    return (std::filesystem::temp_directory_path() / "vkme_cache").string() + "/";
+}
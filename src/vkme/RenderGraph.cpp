@@ -0,0 +1,315 @@
+
+#include <vkme/RenderGraph.hpp>
+
+#include <unordered_set>
+#include <algorithm>
+
+namespace vkme {
+
+RenderGraph::Pass& RenderGraph::Pass::read(const core::Image* image, VkImageLayout layout)
+{
+    return read(image, core::Image::syncStateForLayout(layout));
+}
+
+RenderGraph::Pass& RenderGraph::Pass::read(const core::Image* image, const core::Image::SyncState& state)
+{
+    return addAccess({ image, image, VK_NULL_HANDLE, state, false, false });
+}
+
+RenderGraph::Pass& RenderGraph::Pass::write(const core::Image* image, VkImageLayout layout, bool discardContents)
+{
+    return write(image, core::Image::syncStateForLayout(layout), discardContents);
+}
+
+RenderGraph::Pass& RenderGraph::Pass::write(const core::Image* image, const core::Image::SyncState& state, bool discardContents)
+{
+    return addAccess({ image, image, VK_NULL_HANDLE, state, true, discardContents });
+}
+
+RenderGraph::Pass& RenderGraph::Pass::readBuffer(const core::Buffer* buffer, VkPipelineStageFlags2 stageMask, VkAccessFlags2 accessMask)
+{
+    return addAccess({ buffer, nullptr, buffer->buffer(), { VK_IMAGE_LAYOUT_UNDEFINED, stageMask, accessMask }, false, false });
+}
+
+RenderGraph::Pass& RenderGraph::Pass::writeBuffer(const core::Buffer* buffer, VkPipelineStageFlags2 stageMask, VkAccessFlags2 accessMask)
+{
+    return addAccess({ buffer, nullptr, buffer->buffer(), { VK_IMAGE_LAYOUT_UNDEFINED, stageMask, accessMask }, true, false });
+}
+
+RenderGraph::Pass& RenderGraph::Pass::sideEffects()
+{
+    _sideEffects = true;
+    return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::execute(std::function<void(VkCommandBuffer)>&& fn)
+{
+    _execute = std::move(fn);
+    return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::addAccess(const Access& access)
+{
+    if (access.resource == nullptr)
+    {
+        throw std::runtime_error("RenderGraph::Pass: null resource in pass '" + _name + "'");
+    }
+
+    // A resource used twice in the same pass is merged in one access, because all the
+    // barriers of a pass are recorded in the same batch
+    for (auto& a : _accesses)
+    {
+        if (a.resource == access.resource)
+        {
+            if (a.state.layout != access.state.layout)
+            {
+                throw std::runtime_error("RenderGraph::Pass: the image is used with two different layouts in pass '" + _name + "'");
+            }
+            a.state.stageMask |= access.state.stageMask;
+            a.state.accessMask |= access.state.accessMask;
+            a.discard = a.discard && access.discard;
+            a.write = a.write || access.write;
+            return *this;
+        }
+    }
+    _accesses.push_back(access);
+    return *this;
+}
+
+RenderGraph::Pass& RenderGraph::addPass(const std::string& name)
+{
+    _passes.push_back(Pass());
+    _passes.back()._name = name;
+    return _passes.back();
+}
+
+void RenderGraph::markOutput(const core::Image* image)
+{
+    _outputs.push_back(image);
+}
+
+void RenderGraph::markOutput(const core::Buffer* buffer)
+{
+    _outputs.push_back(buffer);
+}
+
+void RenderGraph::clear()
+{
+    _passes.clear();
+    _outputs.clear();
+    _executionOrder.clear();
+    _bufferStates.clear();
+    _barriers.clear();
+}
+
+void RenderGraph::execute(VkCommandBuffer cmd)
+{
+    std::vector<bool> alive;
+    cullPasses(alive);
+    sortPasses(alive);
+
+    for (auto index : _executionOrder)
+    {
+        auto& pass = _passes[index];
+        addBarriers(pass);
+        _barriers.flush(cmd);
+
+        if (pass._execute)
+        {
+            pass._execute(cmd);
+        }
+    }
+}
+
+void RenderGraph::cullPasses(std::vector<bool>& alive)
+{
+    alive.assign(_passes.size(), false);
+
+    // Walk the passes backwards from the outputs. A pass is needed if it writes a resource
+    // whose contents are needed by a later pass or by the outside of the graph
+    std::unordered_set<const void*> needed(_outputs.begin(), _outputs.end());
+    for (auto i = _passes.size(); i > 0; --i)
+    {
+        auto& pass = _passes[i - 1];
+        bool isAlive = pass._sideEffects;
+        for (auto& access : pass._accesses)
+        {
+            if (access.write && needed.find(access.resource) != needed.end())
+            {
+                isAlive = true;
+                break;
+            }
+        }
+
+        if (!isAlive)
+        {
+            continue;
+        }
+        alive[i - 1] = true;
+
+        // The contents written before a discarding write are not needed anymore, unless
+        // this pass also reads them
+        for (auto& access : pass._accesses)
+        {
+            if (access.discard)
+            {
+                needed.erase(access.resource);
+            }
+        }
+        for (auto& access : pass._accesses)
+        {
+            if (!access.discard)
+            {
+                needed.insert(access.resource);
+            }
+        }
+    }
+}
+
+void RenderGraph::sortPasses(const std::vector<bool>& alive)
+{
+    auto passCount = _passes.size();
+    std::vector<std::vector<uint32_t>> dependents(passCount);
+    std::vector<uint32_t> dependencyCount(passCount, 0);
+
+    auto addDependency = [&](uint32_t from, uint32_t to) {
+        auto& d = dependents[from];
+        if (std::find(d.begin(), d.end(), to) == d.end())
+        {
+            d.push_back(to);
+            ++dependencyCount[to];
+        }
+    };
+
+    // Build the dependencies in declaration order. Any access that changes the layout of
+    // an image is a write, because the layout transition modifies the image.
+    struct ResourceState {
+        int32_t lastWriter = -1;
+        std::vector<uint32_t> readers;
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    };
+    std::unordered_map<const void*, ResourceState> resources;
+    for (uint32_t i = 0; i < passCount; ++i)
+    {
+        if (!alive[i])
+        {
+            continue;
+        }
+
+        for (auto& access : _passes[i]._accesses)
+        {
+            auto it = resources.find(access.resource);
+            if (it == resources.end())
+            {
+                ResourceState initialState;
+                initialState.layout = access.image ? access.image->layout() : VK_IMAGE_LAYOUT_UNDEFINED;
+                it = resources.emplace(access.resource, initialState).first;
+            }
+            auto& state = it->second;
+
+            bool modifies = access.write || (access.image && access.state.layout != state.layout);
+            if (state.lastWriter >= 0 && uint32_t(state.lastWriter) != i)
+            {
+                addDependency(uint32_t(state.lastWriter), i);
+            }
+
+            if (modifies)
+            {
+                for (auto reader : state.readers)
+                {
+                    if (reader != i)
+                    {
+                        addDependency(reader, i);
+                    }
+                }
+                state.readers.clear();
+                state.lastWriter = int32_t(i);
+            }
+            else
+            {
+                state.readers.push_back(i);
+            }
+            state.layout = access.state.layout;
+        }
+    }
+
+    // Topological sort. From the passes that are ready, the first one that does not depend
+    // on the last scheduled pass is executed first, so the work that is waiting on a barrier
+    // is separated from the work it waits for. Otherwise the declaration order is kept.
+    _executionOrder.clear();
+    std::vector<uint32_t> ready;
+    for (uint32_t i = 0; i < passCount; ++i)
+    {
+        if (alive[i] && dependencyCount[i] == 0)
+        {
+            ready.push_back(i);
+        }
+    }
+
+    while (!ready.empty())
+    {
+        size_t selected = 0;
+        if (!_executionOrder.empty())
+        {
+            auto& lastDependents = dependents[_executionOrder.back()];
+            for (size_t r = 0; r < ready.size(); ++r)
+            {
+                if (std::find(lastDependents.begin(), lastDependents.end(), ready[r]) == lastDependents.end())
+                {
+                    selected = r;
+                    break;
+                }
+            }
+        }
+
+        auto passIndex = ready[selected];
+        ready.erase(ready.begin() + selected);
+        _executionOrder.push_back(passIndex);
+
+        for (auto dependent : dependents[passIndex])
+        {
+            if (--dependencyCount[dependent] == 0)
+            {
+                // Keep the ready list in declaration order
+                ready.insert(std::upper_bound(ready.begin(), ready.end(), dependent), dependent);
+            }
+        }
+    }
+}
+
+void RenderGraph::addBarriers(const Pass& pass)
+{
+    for (auto& access : pass._accesses)
+    {
+        if (access.image)
+        {
+            access.image->addTransition(_barriers, access.state, access.discard);
+            continue;
+        }
+
+        auto& state = _bufferStates[access.resource];
+        auto pendingWrites = core::BarrierBatch::writeAccesses(state.accessMask);
+        if (pendingWrites != VK_ACCESS_2_NONE || (access.write && state.stageMask != VK_PIPELINE_STAGE_2_NONE))
+        {
+            // Read after write, write after write or write after read. In the last case,
+            // pendingWrites is empty and the barrier is only an execution dependency
+            _barriers.addBufferBarrier(
+                access.buffer,
+                state.stageMask,
+                pendingWrites,
+                access.state.stageMask,
+                access.state.accessMask
+            );
+            state.stageMask = access.state.stageMask;
+            state.accessMask = access.state.accessMask;
+        }
+        else
+        {
+            // Read after read: accumulate the readers, so the next write waits for all of them
+            state.stageMask |= access.state.stageMask;
+            state.accessMask |= access.state.accessMask;
+        }
+    }
+}
+
+}
@@ -3,8 +3,62 @@
 #include <vkme/core/Info.hpp>
 #include <vkme/PlatformTools.hpp>
 
+#include <algorithm>
+#include <cstring>
+
 namespace vkme {
 
+// Hash of the draw data, used to know if the user interface has changed. It processes
+// eight bytes at a time, because the vertex buffers of a complex user interface may
+// contain thousands of vertices
+static void hashBytes(uint64_t& hash, const void* data, size_t size)
+{
+    auto bytes = reinterpret_cast<const uint8_t*>(data);
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ word) * 0x100000001B3ull;
+        hash ^= hash >> 29;
+    }
+    for (; i < size; ++i)
+    {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    }
+}
+
+template <class T>
+static void hashValue(uint64_t& hash, const T& value)
+{
+    hashBytes(hash, &value, sizeof(T));
+}
+
+static uint64_t hashDrawData(const ImDrawData* drawData)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    hashValue(hash, drawData->DisplayPos);
+    hashValue(hash, drawData->DisplaySize);
+    hashValue(hash, drawData->FramebufferScale);
+    for (int i = 0; i < drawData->CmdListsCount; ++i)
+    {
+        const ImDrawList* cmdList = drawData->CmdLists[i];
+        hashBytes(hash, cmdList->VtxBuffer.Data, size_t(cmdList->VtxBuffer.Size) * sizeof(ImDrawVert));
+        hashBytes(hash, cmdList->IdxBuffer.Data, size_t(cmdList->IdxBuffer.Size) * sizeof(ImDrawIdx));
+        for (const auto& drawCmd : cmdList->CmdBuffer)
+        {
+            // The fields are hashed one by one, to skip the padding of the structure
+            hashValue(hash, drawCmd.ClipRect);
+            hashValue(hash, drawCmd.TextureId);
+            hashValue(hash, drawCmd.VtxOffset);
+            hashValue(hash, drawCmd.IdxOffset);
+            hashValue(hash, drawCmd.ElemCount);
+            hashValue(hash, drawCmd.UserCallback);
+        }
+    }
+    return hash;
+}
+
 void UserInterface::init(VulkanData* vulkanData)
 {
     _vulkanData = vulkanData;
@@ -15,6 +69,12 @@ void UserInterface::init(VulkanData* vulkanData)
     VK_ASSERT(vkCreateFence(_vulkanData->device(), &fenceInfo, nullptr, &_uiFence));
     
     initImGui();
+    
+    createOverlayImage();
+    
+    _vulkanData->cleanupManager().push([&](VkDevice) {
+        _vulkanData->imagePool().destroy(_overlayImage);
+    });
 }
 
 void UserInterface::processEvent(SDL_Event * event)
@@ -33,27 +93,61 @@ void UserInterface::newFrame()
     }
 
     ImGui::Render();
+    
+    auto drawData = ImGui::GetDrawData();
+    auto hash = hashDrawData(drawData);
+    if (hash != _drawDataHash)
+    {
+        _drawDataHash = hash;
+        _overlayDirty = true;
+    }
+    _overlayEmpty = drawData->TotalVtxCount == 0;
 }
 
-void UserInterface::draw(VkCommandBuffer cmd, VkImageView targetImageView)
+const core::Image* UserInterface::updateOverlay(VkCommandBuffer cmd)
 {
-    auto colorAttachment = core::Info::attachmentInfo(
-        targetImageView,
-        nullptr,
-        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
-    );
-    auto extent = _vulkanData->swapchain().extent();
-    auto renderingInfo = core::Info::renderingInfo(
-        extent,
-        &colorAttachment,
-        nullptr
-    );
+    auto& overlayImage = _vulkanData->imagePool().at(_overlayImage);
+    if (_overlayDirty)
+    {
+        // The overlay is cleared to transparent and the user interface is rendered with
+        // alpha blending, so the resulting colors are premultiplied by the alpha
+        overlayImage.cmdTransition(cmd, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true);
+        VkClearValue clearValue = {};
+        clearValue.color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
+        auto overlayAttachment = core::Info::attachmentInfo(
+            overlayImage.imageView(),
+            &clearValue,
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+        );
+        auto overlayRenderingInfo = core::Info::renderingInfo(
+            overlayImage.extent2D(),
+            &overlayAttachment,
+            nullptr
+        );
+        vkme::core::cmdBeginRendering(cmd, &overlayRenderingInfo);
+        ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmd);
+        vkme::core::cmdEndRendering(cmd);
+        
+        _overlayDirty = false;
+    }
+    
+    if (_overlayEmpty)
+    {
+        return nullptr;
+    }
     
-    vkme::core::cmdBeginRendering(cmd, &renderingInfo);
+    overlayImage.cmdTransition(cmd, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    return &overlayImage;
+}
 
-    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmd);
+void UserInterface::swapchainResized()
+{
+    ImGui_ImplVulkan_SetMinImageCount(std::max(_vulkanData->swapchain().minImageCount(), 2u));
+    
+    // The frames in flight may still be reading the old overlay
+    core::Image::releasePooledImage(_vulkanData, _overlayImage);
     
-    vkme::core::cmdEndRendering(cmd);
+    createOverlayImage();
 }
 
 void UserInterface::cleanup()
@@ -108,8 +202,10 @@ void UserInterface::initImGui()
     initInfo.Device = _vulkanData->device();
     initInfo.Queue = _vulkanData->command().graphicsQueue();
     initInfo.DescriptorPool = _imguiPool;
-    initInfo.MinImageCount = 3;
-    initInfo.ImageCount = 3;
+    // ImageCount is the number of vertex buffers that ImGui uses in a ring, so it depends
+    // on the number of frames in flight, not on the swapchain images
+    initInfo.MinImageCount = std::max(_vulkanData->swapchain().minImageCount(), 2u);
+    initInfo.ImageCount = std::max(initInfo.MinImageCount, core::FRAME_OVERLAP + 1);
     initInfo.UseDynamicRendering = true;
     initInfo.PipelineRenderingCreateInfo = {};
     initInfo.PipelineRenderingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
@@ -126,4 +222,18 @@ void UserInterface::initImGui()
     });
 }
 
+void UserInterface::createOverlayImage()
+{
+    // The overlay uses the swapchain format, that is the format used to build the ImGui pipeline
+    _overlayImage = core::Image::createPooledImage(
+        _vulkanData,
+        _vulkanData->swapchain().imageFormat(),
+        _vulkanData->swapchain().extent(),
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_IMAGE_ASPECT_COLOR_BIT
+    );
+    
+    _overlayDirty = true;
+}
+
 }
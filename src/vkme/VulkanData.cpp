@@ -18,6 +18,7 @@ void VulkanData::init(SDL_Window * window)
     createMemoryAllocator();
     _swapchain.init(this, uint32_t(width), uint32_t(height));
     createFrameResources();
+    _geometryArena.init(this);
 }
 
 void VulkanData::cleanup()
@@ -29,6 +30,10 @@ void VulkanData::cleanup()
     cleanupFrameResources();
     
     _swapchain.cleanup();
+    
+    _geometryArena.cleanup();
+    _bufferPool.clear();
+    _imagePool.clear();
 
     vmaDestroyAllocator(_allocator);
 
@@ -44,8 +49,6 @@ bool VulkanData::newFrame()
 {
     if (_resizeRequested)
     {
-        vkDeviceWaitIdle(_device);
-
         int w, h;
         SDL_GetWindowSize(_window, &w, &h);
         _swapchain.resize(uint32_t(w), uint32_t(h));
@@ -103,6 +106,42 @@ void VulkanData::createDevicesAndQueues()
         .set_surface(_surface)
         .select()
         .value();
+    
+    // Optional extensions to measure and limit the latency
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures = {};
+    presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    presentIdFeatures.presentId = true;
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures = {};
+    presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    presentWaitFeatures.presentWait = true;
+    _presentWaitSupported =
+        physicalDevice.enable_extensions_if_present({
+            VK_KHR_PRESENT_ID_EXTENSION_NAME,
+            VK_KHR_PRESENT_WAIT_EXTENSION_NAME
+        }) &&
+        physicalDevice.enable_extension_features_if_present(presentIdFeatures) &&
+        physicalDevice.enable_extension_features_if_present(presentWaitFeatures);
+
+    // Optional mesh shading, for the cluster rendering of the IndirectRenderer
+    VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures = {};
+    meshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+    meshShaderFeatures.taskShader = true;
+    meshShaderFeatures.meshShader = true;
+    _meshShaderSupported =
+        physicalDevice.enable_extension_if_present(VK_EXT_MESH_SHADER_EXTENSION_NAME) &&
+        physicalDevice.enable_extension_features_if_present(meshShaderFeatures);
+
+    // Optional GPU driven rendering (see IndirectRenderer). Some portability implementations,
+    // like MoltenVK, don't support drawIndirectCount
+    VkPhysicalDeviceFeatures indirectFeatures = {};
+    indirectFeatures.multiDrawIndirect = true;
+    indirectFeatures.drawIndirectFirstInstance = true;
+    VkPhysicalDeviceVulkan12Features indirectFeatures12 = {};
+    indirectFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    indirectFeatures12.drawIndirectCount = true;
+    _indirectDrawSupported =
+        physicalDevice.enable_features_if_present(indirectFeatures) &&
+        physicalDevice.enable_extension_features_if_present(indirectFeatures12);
 
     vkb::DeviceBuilder deviceBuilder{ physicalDevice };
 
@@ -140,6 +179,28 @@ void VulkanData::cleanupFrameResources()
     }
 }
 
+void VulkanData::releaseAfterFramesInFlight(std::function<void(VkDevice)>&& fn)
+{
+    if (_frameStarted)
+    {
+        // The frame that is being recorded may use the resources, and its frame resources are
+        // flushed after waiting for its fence
+        currentFrameResources().cleanupManager.push(std::move(fn));
+        return;
+    }
+    
+    if (_currentFrame == 0)
+    {
+        // No frame has been submitted
+        fn(_device);
+        return;
+    }
+    
+    // The frame resources of the last submitted frame are flushed after waiting for its
+    // fence. At that point, the previous frames have also finished
+    _frameResources[(_currentFrame - 1) % core::FRAME_OVERLAP].cleanupManager.push(std::move(fn));
+}
+
 void VulkanData::iterateFrameResources(std::function<void(core::FrameResources&)> cb)
 {
     for (auto i = 0; i < core::FRAME_OVERLAP; ++i)
@@ -0,0 +1,150 @@
+
+#include <vkme/core/BarrierBatch.hpp>
+#include <vkme/core/Image.hpp>
+
+namespace vkme {
+namespace core {
+
+VkImageMemoryBarrier2 BarrierBatch::imageBarrier(
+    VkImage               image,
+    VkImageAspectFlags    aspectMask,
+    VkImageLayout         oldLayout,
+    VkImageLayout         newLayout,
+    VkPipelineStageFlags2 srcStageMask,
+    VkAccessFlags2        srcAccessMask,
+    VkPipelineStageFlags2 dstStageMask,
+    VkAccessFlags2        dstAccessMask
+) {
+    VkImageMemoryBarrier2 imageBarrier = {};
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+    imageBarrier.srcStageMask = srcStageMask;
+    imageBarrier.srcAccessMask = srcAccessMask;
+    imageBarrier.dstStageMask = dstStageMask;
+    imageBarrier.dstAccessMask = dstAccessMask;
+    imageBarrier.oldLayout = oldLayout;
+    imageBarrier.newLayout = newLayout;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.subresourceRange = Image::subresourceRange(aspectMask);
+    imageBarrier.image = image;
+    return imageBarrier;
+}
+
+VkAccessFlags2 BarrierBatch::writeAccesses(VkAccessFlags2 access)
+{
+    return access & (
+        VK_ACCESS_2_SHADER_WRITE_BIT |
+        VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+        VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+        VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+        VK_ACCESS_2_TRANSFER_WRITE_BIT |
+        VK_ACCESS_2_HOST_WRITE_BIT |
+        VK_ACCESS_2_MEMORY_WRITE_BIT
+    );
+}
+
+void BarrierBatch::cmdImageBarrier(VkCommandBuffer cmd, const VkImageMemoryBarrier2& barrier)
+{
+    VkDependencyInfo dependencies = {};
+    dependencies.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependencies.imageMemoryBarrierCount = 1;
+    dependencies.pImageMemoryBarriers = &barrier;
+    
+    cmdPipelineBarrier2(cmd, &dependencies);
+}
+
+void BarrierBatch::addImageBarrier(
+    VkImage               image,
+    VkImageAspectFlags    aspectMask,
+    VkImageLayout         oldLayout,
+    VkImageLayout         newLayout,
+    VkPipelineStageFlags2 srcStageMask,
+    VkAccessFlags2        srcAccessMask,
+    VkPipelineStageFlags2 dstStageMask,
+    VkAccessFlags2        dstAccessMask
+) {
+    _imageBarriers.push_back(imageBarrier(
+        image,
+        aspectMask,
+        oldLayout,
+        newLayout,
+        srcStageMask,
+        srcAccessMask,
+        dstStageMask,
+        dstAccessMask
+    ));
+}
+
+void BarrierBatch::addImageBarrier(const VkImageMemoryBarrier2& barrier)
+{
+    _imageBarriers.push_back(barrier);
+}
+
+void BarrierBatch::addBufferBarrier(
+    VkBuffer              buffer,
+    VkPipelineStageFlags2 srcStageMask,
+    VkAccessFlags2        srcAccessMask,
+    VkPipelineStageFlags2 dstStageMask,
+    VkAccessFlags2        dstAccessMask,
+    VkDeviceSize          offset,
+    VkDeviceSize          size
+) {
+    VkBufferMemoryBarrier2 bufferBarrier = {};
+    bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+    bufferBarrier.srcStageMask = srcStageMask;
+    bufferBarrier.srcAccessMask = srcAccessMask;
+    bufferBarrier.dstStageMask = dstStageMask;
+    bufferBarrier.dstAccessMask = dstAccessMask;
+    bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.buffer = buffer;
+    bufferBarrier.offset = offset;
+    bufferBarrier.size = size;
+    _bufferBarriers.push_back(bufferBarrier);
+}
+
+void BarrierBatch::addMemoryBarrier(
+    VkPipelineStageFlags2 srcStageMask,
+    VkAccessFlags2        srcAccessMask,
+    VkPipelineStageFlags2 dstStageMask,
+    VkAccessFlags2        dstAccessMask
+) {
+    VkMemoryBarrier2 memoryBarrier = {};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    memoryBarrier.srcStageMask = srcStageMask;
+    memoryBarrier.srcAccessMask = srcAccessMask;
+    memoryBarrier.dstStageMask = dstStageMask;
+    memoryBarrier.dstAccessMask = dstAccessMask;
+    _memoryBarriers.push_back(memoryBarrier);
+}
+
+void BarrierBatch::flush(VkCommandBuffer cmd)
+{
+    if (empty())
+    {
+        return;
+    }
+
+    VkDependencyInfo dependencies = {};
+    dependencies.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependencies.imageMemoryBarrierCount = uint32_t(_imageBarriers.size());
+    dependencies.pImageMemoryBarriers = _imageBarriers.data();
+    dependencies.bufferMemoryBarrierCount = uint32_t(_bufferBarriers.size());
+    dependencies.pBufferMemoryBarriers = _bufferBarriers.data();
+    dependencies.memoryBarrierCount = uint32_t(_memoryBarriers.size());
+    dependencies.pMemoryBarriers = _memoryBarriers.data();
+
+    cmdPipelineBarrier2(cmd, &dependencies);
+
+    clear();
+}
+
+void BarrierBatch::clear()
+{
+    _imageBarriers.clear();
+    _bufferBarriers.clear();
+    _memoryBarriers.clear();
+}
+
+}
+}
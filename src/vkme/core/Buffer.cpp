@@ -1,5 +1,6 @@
 
 #include <vkme/core/Buffer.hpp>
+#include <vkme/VulkanData.hpp>
 
 namespace vkme {
 namespace core {
@@ -11,8 +12,28 @@ Buffer* Buffer::createAllocatedBuffer(
     VmaMemoryUsage memoryUsage
 ) {
     auto buffer = new Buffer();
-    
-    buffer->_vulkanData = vulkanData;
+    buffer->allocate(vulkanData, allocSize, usage, memoryUsage);
+    return buffer;
+}
+
+BufferHandle Buffer::createPooledBuffer(
+    VulkanData * vulkanData,
+    size_t allocSize,
+    VkBufferUsageFlags usage,
+    VmaMemoryUsage memoryUsage
+) {
+    Buffer buffer;
+    buffer.allocate(vulkanData, allocSize, usage, memoryUsage);
+    return vulkanData->bufferPool().insert(std::move(buffer));
+}
+
+void Buffer::allocate(
+    VulkanData * vulkanData,
+    size_t allocSize,
+    VkBufferUsageFlags usage,
+    VmaMemoryUsage memoryUsage
+) {
+    _vulkanData = vulkanData;
     
     VkBufferCreateInfo bufferInfo = {};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -27,12 +48,10 @@ Buffer* Buffer::createAllocatedBuffer(
         vulkanData->allocator(),
         &bufferInfo,
         &allocInfo,
-        &buffer->_buffer,
-        &buffer->_allocation,
-        &buffer->_info
+        &_buffer,
+        &_allocation,
+        &_info
     ));
-    
-    return buffer;
 }
 
 void Buffer::cleanup()
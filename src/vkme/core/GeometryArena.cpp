@@ -0,0 +1,238 @@
+#include <vkme/core/GeometryArena.hpp>
+#include <vkme/VulkanData.hpp>
+
+#include <vector>
+#include <algorithm>
+
+namespace vkme {
+namespace core {
+
+void GeometryArena::init(VulkanData* vulkanData, VkDeviceSize vertexCapacity, VkDeviceSize indexCapacity)
+{
+    _vulkanData = vulkanData;
+
+    VkDeviceSize capacities[2] = { vertexCapacity, indexCapacity };
+    for (auto heapType : { ArenaHeap::Vertex, ArenaHeap::Index })
+    {
+        auto& h = heap(heapType);
+        h.buffer = createHeapBuffer(heapType, capacities[int(heapType)]);
+        h.address = _vulkanData->bufferPool().at(h.buffer).deviceAddress();
+        h.allocator.reset(capacities[int(heapType)]);
+    }
+}
+
+void GeometryArena::reserve(ArenaHeap heapType, VkDeviceSize size)
+{
+    auto& h = heap(heapType);
+    auto align = alignment(heapType);
+    if (h.allocator.largestFreeRange() >= size + align)
+    {
+        return;
+    }
+
+    // After the relocation the regions are packed, so the only waste is the alignment padding
+    VkDeviceSize packedSize = 0;
+    for (auto& region : _regions)
+    {
+        if (region.heap == heapType)
+        {
+            packedSize += (region.size + align - 1) & ~(align - 1);
+        }
+    }
+
+    VkDeviceSize requiredSize = packedSize + size + align;
+    VkDeviceSize capacity = std::max(h.allocator.capacity(), VkDeviceSize(1024 * 1024));
+    while (capacity < requiredSize)
+    {
+        capacity *= 2;
+    }
+    // If the capacity does not change, the relocation only removes the fragmentation
+    relocate(heapType, capacity);
+}
+
+ArenaRegionHandle GeometryArena::allocate(ArenaHeap heapType, VkDeviceSize size)
+{
+    // The empty streams also get a region, so the meshes don't need to handle them
+    size = std::max(size, VkDeviceSize(1));
+    auto& h = heap(heapType);
+    auto offset = h.allocator.allocate(size, alignment(heapType));
+    if (offset == OffsetAllocator::InvalidOffset)
+    {
+        reserve(heapType, size);
+        offset = h.allocator.allocate(size, alignment(heapType));
+        if (offset == OffsetAllocator::InvalidOffset)
+        {
+            throw std::runtime_error("GeometryArena::allocate(): could not allocate the region");
+        }
+    }
+
+    ArenaRegion region;
+    region.heap = heapType;
+    region.offset = offset;
+    region.size = size;
+    return _regions.insert(std::move(region));
+}
+
+void GeometryArena::free(ArenaRegionHandle region)
+{
+    if (!_regions.contains(region))
+    {
+        return;
+    }
+
+    // The region is still live until then, so it's also moved if the heap is relocated
+    _vulkanData->releaseAfterFramesInFlight([this, region](VkDevice) {
+        auto r = _regions.get(region);
+        if (r != nullptr)
+        {
+            heap(r->heap).allocator.free(r->offset);
+            _regions.remove(region);
+        }
+    });
+}
+
+void GeometryArena::compact()
+{
+    for (auto heapType : { ArenaHeap::Vertex, ArenaHeap::Index })
+    {
+        relocate(heapType, heap(heapType).allocator.capacity());
+    }
+}
+
+const Buffer* GeometryArena::buffer(ArenaHeap heapType) const
+{
+    return _vulkanData ? _vulkanData->bufferPool().get(heap(heapType).buffer) : nullptr;
+}
+
+VkDeviceSize GeometryArena::offset(ArenaRegionHandle region) const
+{
+    return _regions.at(region).offset;
+}
+
+VkDeviceAddress GeometryArena::deviceAddress(ArenaRegionHandle region) const
+{
+    auto& r = _regions.at(region);
+    return heap(r.heap).address + r.offset;
+}
+
+void GeometryArena::bindIndexBuffer(VkCommandBuffer cmd, VkIndexType indexType) const
+{
+    vkCmdBindIndexBuffer(cmd, buffer(ArenaHeap::Index)->buffer(), 0, indexType);
+}
+
+GeometryArena::Statistics GeometryArena::statistics(ArenaHeap heapType) const
+{
+    auto& allocator = heap(heapType).allocator;
+    Statistics result;
+    result.capacity = allocator.capacity();
+    result.usedSize = allocator.usedSize();
+    result.regionCount = allocator.allocationCount();
+    result.freeRangeCount = allocator.freeRangeCount();
+    result.largestFreeRange = allocator.largestFreeRange();
+    return result;
+}
+
+void GeometryArena::cleanup()
+{
+    if (_vulkanData == nullptr)
+    {
+        return;
+    }
+
+    for (auto& h : _heaps)
+    {
+        _vulkanData->bufferPool().destroy(h.buffer);
+        h.buffer = {};
+        h.address = 0;
+        h.allocator.reset(0);
+    }
+    _regions.clear();
+    _vulkanData = nullptr;
+}
+
+VkDeviceSize GeometryArena::alignment(ArenaHeap heapType)
+{
+    return heapType == ArenaHeap::Vertex ? VertexAlignment : IndexAlignment;
+}
+
+BufferHandle GeometryArena::createHeapBuffer(ArenaHeap heapType, VkDeviceSize capacity)
+{
+    // The heaps are also copied to the new buffers when they are relocated, and the index heap can
+    // be read by the compute shaders
+    VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+        VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+    if (heapType == ArenaHeap::Index)
+    {
+        usage |= VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+    }
+    return Buffer::createPooledBuffer(_vulkanData, capacity, usage, VMA_MEMORY_USAGE_GPU_ONLY);
+}
+
+void GeometryArena::relocate(ArenaHeap heapType, VkDeviceSize capacity)
+{
+    auto& h = heap(heapType);
+    auto newBuffer = createHeapBuffer(heapType, capacity);
+
+    // The regions are packed in the order of the old offsets, to keep the locality
+    std::vector<ArenaRegion*> regions;
+    for (auto& region : _regions)
+    {
+        if (region.heap == heapType)
+        {
+            regions.push_back(&region);
+        }
+    }
+    std::sort(regions.begin(), regions.end(), [](auto a, auto b) { return a->offset < b->offset; });
+
+    OffsetAllocator allocator(capacity);
+    std::vector<VkBufferCopy> copies;
+    for (auto region : regions)
+    {
+        VkBufferCopy copy = {};
+        copy.srcOffset = region->offset;
+        copy.dstOffset = allocator.allocate(region->size, alignment(heapType));
+        copy.size = region->size;
+        if (copy.dstOffset == OffsetAllocator::InvalidOffset)
+        {
+            _vulkanData->bufferPool().destroy(newBuffer);
+            throw std::runtime_error("GeometryArena::relocate(): the capacity is smaller than the live regions");
+        }
+        copies.push_back(copy);
+    }
+    for (size_t i = 0; i < regions.size(); ++i)
+    {
+        regions[i]->offset = copies[i].dstOffset;
+    }
+
+    if (!copies.empty())
+    {
+        // The pool pointers are requested after creating the new buffer
+        auto oldBuffer = h.buffer;
+        _vulkanData->command().immediateSubmit([&](VkCommandBuffer cmd) {
+            vkCmdCopyBuffer(
+                cmd,
+                _vulkanData->bufferPool().at(oldBuffer).buffer(),
+                _vulkanData->bufferPool().at(newBuffer).buffer(),
+                uint32_t(copies.size()),
+                copies.data()
+            );
+        });
+    }
+
+    // The frames in flight may still read the old buffer
+    auto vulkanData = _vulkanData;
+    auto oldBuffer = h.buffer;
+    _vulkanData->releaseAfterFramesInFlight([vulkanData, oldBuffer](VkDevice) {
+        vulkanData->bufferPool().destroy(oldBuffer);
+    });
+
+    h.buffer = newBuffer;
+    h.address = _vulkanData->bufferPool().at(newBuffer).deviceAddress();
+    h.allocator = std::move(allocator);
+    ++_generation;
+}
+
+}
+}
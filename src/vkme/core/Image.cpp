@@ -3,6 +3,7 @@
 #include <vkme/core/Image.hpp>
 #include <vkme/core/Info.hpp>
 #include <vkme/core/Buffer.hpp>
+#include <vkme/core/BarrierBatch.hpp>
 
 #include <vkme/VulkanData.hpp>
 
@@ -11,6 +12,73 @@
 namespace vkme {
 namespace core {
 
+static bool isDepthLayout(VkImageLayout layout)
+{
+    return layout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL ||
+        layout == VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL ||
+        layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL ||
+        layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+}
+
+Image::SyncState Image::syncStateForLayout(VkImageLayout layout)
+{
+    SyncState state;
+    state.layout = layout;
+    switch (layout)
+    {
+    case VK_IMAGE_LAYOUT_UNDEFINED:
+    case VK_IMAGE_LAYOUT_PREINITIALIZED:
+        state.stageMask = VK_PIPELINE_STAGE_2_NONE;
+        state.accessMask = VK_ACCESS_2_NONE;
+        break;
+    case VK_IMAGE_LAYOUT_GENERAL:
+        // In this engine, the general layout is used to clear images and to write them
+        // as storage images in compute shaders
+        state.stageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+        state.accessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+            VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        break;
+    case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+        state.stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+        state.accessMask = VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+        break;
+    case VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL:
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+        state.stageMask = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+        state.accessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        break;
+    case VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL:
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+        state.stageMask = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT |
+            VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        state.accessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+        break;
+    case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+        state.stageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        state.accessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+        break;
+    case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+        state.stageMask = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+        state.accessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+        break;
+    case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+        state.stageMask = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+        state.accessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        break;
+    case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+        // The presentation engine is synchronized using the render semaphore. The barrier
+        // only has to complete the layout transition before the semaphore is signaled.
+        state.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        state.accessMask = VK_ACCESS_2_NONE;
+        break;
+    default:
+        state.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        state.accessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+        break;
+    }
+    return state;
+}
+
 void Image::cmdTransitionImage(
     VkCommandBuffer       cmd,
     VkImage               image,
@@ -22,29 +90,102 @@ void Image::cmdTransitionImage(
     VkPipelineStageFlags2 dstStageMask,
     VkAccessFlags2        dstAccessMask
 ) {
-    VkImageMemoryBarrier2 imageBarrier = {};
-    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
-    imageBarrier.srcStageMask = srcStageMask;
-    imageBarrier.srcAccessMask = srcAccessMask;
-    imageBarrier.dstStageMask = dstStageMask;
-    imageBarrier.dstAccessMask = dstStageMask; 
-    imageBarrier.oldLayout = oldLayout;
-    imageBarrier.newLayout = newLayout;
+    if (srcStageMask == VK_PIPELINE_STAGE_2_NONE)
+    {
+        if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED)
+        {
+            // The previous use of the image is unknown: execution dependency only
+            srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+            srcAccessMask = VK_ACCESS_2_NONE;
+        }
+        else
+        {
+            auto srcState = syncStateForLayout(oldLayout);
+            srcStageMask = srcState.stageMask;
+            srcAccessMask = BarrierBatch::writeAccesses(srcState.accessMask);
+        }
+    }
+    
+    if (dstStageMask == VK_PIPELINE_STAGE_2_NONE)
+    {
+        auto dstState = syncStateForLayout(newLayout);
+        dstStageMask = dstState.stageMask;
+        dstAccessMask = dstState.accessMask;
+    }
 
     if (aspectMask == 0) {
-        aspectMask = newLayout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL ?
+        aspectMask = isDepthLayout(newLayout) || isDepthLayout(oldLayout) ?
             VK_IMAGE_ASPECT_DEPTH_BIT :
             VK_IMAGE_ASPECT_COLOR_BIT;
     }
-    imageBarrier.subresourceRange = Image::subresourceRange(aspectMask);
-    imageBarrier.image = image;
+    
+    BarrierBatch::cmdImageBarrier(cmd, BarrierBatch::imageBarrier(
+        image,
+        aspectMask,
+        oldLayout,
+        newLayout,
+        srcStageMask,
+        srcAccessMask,
+        dstStageMask,
+        dstAccessMask
+    ));
+}
+
+void Image::cmdTransition(VkCommandBuffer cmd, VkImageLayout newLayout, bool discardContents) const
+{
+    cmdTransition(cmd, syncStateForLayout(newLayout), discardContents);
+}
+
+void Image::cmdTransition(VkCommandBuffer cmd, const SyncState& newState, bool discardContents) const
+{
+    VkImageMemoryBarrier2 barrier;
+    if (transitionBarrier(newState, discardContents, barrier))
+    {
+        BarrierBatch::cmdImageBarrier(cmd, barrier);
+    }
+}
+
+void Image::addTransition(BarrierBatch& batch, VkImageLayout newLayout, bool discardContents) const
+{
+    addTransition(batch, syncStateForLayout(newLayout), discardContents);
+}
+
+void Image::addTransition(BarrierBatch& batch, const SyncState& newState, bool discardContents) const
+{
+    VkImageMemoryBarrier2 barrier;
+    if (transitionBarrier(newState, discardContents, barrier))
+    {
+        batch.addImageBarrier(barrier);
+    }
+}
 
-    VkDependencyInfo dependencies = {};
-    dependencies.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
-    dependencies.imageMemoryBarrierCount = 1;
-    dependencies.pImageMemoryBarriers = &imageBarrier;
+bool Image::transitionBarrier(const SyncState& newState, bool discardContents, VkImageMemoryBarrier2& barrier) const
+{
+    auto srcAccess = BarrierBatch::writeAccesses(_syncState.accessMask);
     
-    cmdPipelineBarrier2(cmd, &dependencies);
+    // Read after read in the same layout: there is no hazard, so we only need to
+    // accumulate the new readers, to make the next write wait for all of them
+    if (!discardContents && _syncState.layout == newState.layout &&
+        srcAccess == VK_ACCESS_2_NONE && BarrierBatch::writeAccesses(newState.accessMask) == VK_ACCESS_2_NONE)
+    {
+        _syncState.stageMask |= newState.stageMask;
+        _syncState.accessMask |= newState.accessMask;
+        return false;
+    }
+    
+    barrier = BarrierBatch::imageBarrier(
+        _image,
+        _aspectFlags,
+        discardContents ? VK_IMAGE_LAYOUT_UNDEFINED : _syncState.layout,
+        newState.layout,
+        _syncState.stageMask,
+        srcAccess,
+        newState.stageMask,
+        newState.accessMask
+    );
+    
+    _syncState = newState;
+    return true;
 }
 
 VkImageSubresourceRange Image::subresourceRange(VkImageAspectFlags aspectMask)
@@ -109,14 +250,50 @@ Image* Image::createAllocatedImage(
 )
 {
     auto result = new Image();
-    result->_vulkanData = vulkanData;
-    result->_extent = { extent.width, extent.height, 1 };
-    result->_format = format;
+    result->allocate(vulkanData, format, extent, usage, aspectFlags, arrayLayers);
+    return result;
+}
+
+ImageHandle Image::createPooledImage(
+    VulkanData * vulkanData,
+    VkFormat format,
+    VkExtent2D extent,
+    VkImageUsageFlags usage,
+    VkImageAspectFlags aspectFlags,
+    uint32_t arrayLayers
+)
+{
+    Image image;
+    image.allocate(vulkanData, format, extent, usage, aspectFlags, arrayLayers);
+    return vulkanData->imagePool().insert(std::move(image));
+}
+
+void Image::releasePooledImage(VulkanData * vulkanData, ImageHandle image)
+{
+    vulkanData->releaseAfterFramesInFlight([vulkanData, image](VkDevice) {
+        vulkanData->imagePool().destroy(image);
+    });
+}
+
+void Image::allocate(
+    VulkanData * vulkanData,
+    VkFormat format,
+    VkExtent2D extent,
+    VkImageUsageFlags usage,
+    VkImageAspectFlags aspectFlags,
+    uint32_t arrayLayers
+)
+{
+    _vulkanData = vulkanData;
+    _extent = { extent.width, extent.height, 1 };
+    _format = format;
+    _aspectFlags = aspectFlags;
+    _syncState = {};
     
     auto imgInfo = Info::imageCreateInfo(
-        result->_format,
+        _format,
         usage,
-        result->_extent,
+        _extent,
         arrayLayers
     );
 
@@ -134,20 +311,18 @@ Image* Image::createAllocatedImage(
         alloc,
         &imgInfo,
         &allocInfo,
-        &result->_image,
-        &result->_allocation,
+        &_image,
+        &_allocation,
         nullptr
     );
     
-    auto imgViewInfo = Info::imageViewCreateInfo(format, result->_image, aspectFlags);
+    auto imgViewInfo = Info::imageViewCreateInfo(format, _image, aspectFlags);
     if (arrayLayers == 6)
     {
         imgViewInfo.viewType = VK_IMAGE_VIEW_TYPE_CUBE;
         imgViewInfo.subresourceRange.layerCount = 6;
     }
-    VK_ASSERT(vkCreateImageView(vulkanData->device(), &imgViewInfo, nullptr, &result->_imageView));
-    
-    return result;
+    VK_ASSERT(vkCreateImageView(vulkanData->device(), &imgViewInfo, nullptr, &_imageView));
 }
 
 Image* Image::createAllocatedImage(
@@ -181,12 +356,7 @@ Image* Image::createAllocatedImage(
     );
     
     vulkanData->command().immediateSubmit([&](VkCommandBuffer cmd) {
-        Image::cmdTransitionImage(
-            cmd,
-            image->image(),
-            VK_IMAGE_LAYOUT_UNDEFINED,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-        );
+        image->cmdTransition(cmd, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
         
         VkBufferImageCopy copyRgn = {};
         copyRgn.imageSubresource.aspectMask = aspectFlags;
@@ -204,12 +374,7 @@ Image* Image::createAllocatedImage(
             &copyRgn
         );
         
-        Image::cmdTransitionImage(
-            cmd,
-            image->image(),
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-        );
+        image->cmdTransition(cmd, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
     });
     
     uploadBuffer->cleanup();
@@ -226,6 +391,7 @@ Image* Image::wrapSwapchainImage(
     result->_image = swapchain->image(swapchainImageIndex);
     result->_imageView = swapchain->imageView(swapchainImageIndex);
     result->_format = swapchain->imageFormat();
+    result->_aspectFlags = VK_IMAGE_ASPECT_COLOR_BIT;
     result->_extent = VkExtent3D{
         swapchain->extent().width,
         swapchain->extent().height,
@@ -0,0 +1,148 @@
+#include <vkme/core/OffsetAllocator.hpp>
+
+#include <stdexcept>
+#include <iterator>
+
+namespace vkme {
+namespace core {
+
+OffsetAllocator::OffsetAllocator(uint64_t capacity)
+{
+    reset(capacity);
+}
+
+uint64_t OffsetAllocator::allocate(uint64_t size, uint64_t alignment)
+{
+    if (size == 0 || alignment == 0 || (alignment & (alignment - 1)) != 0)
+    {
+        return InvalidOffset;
+    }
+
+    // The smallest free range that is large enough, once the start is aligned
+    for (auto it = _freeBySize.lower_bound(size); it != _freeBySize.end(); ++it)
+    {
+        uint64_t rangeOffset = it->second;
+        uint64_t rangeSize = it->first;
+        uint64_t offset = (rangeOffset + alignment - 1) & ~(alignment - 1);
+        uint64_t padding = offset - rangeOffset;
+        if (padding + size > rangeSize)
+        {
+            continue;
+        }
+
+        eraseFreeRange(_freeByOffset.find(rangeOffset));
+        uint64_t usedSize = padding + size;
+        if (usedSize < rangeSize)
+        {
+            insertFreeRange(rangeOffset + usedSize, rangeSize - usedSize);
+        }
+        _allocations[offset] = { rangeOffset, usedSize };
+        _usedSize += usedSize;
+        return offset;
+    }
+    return InvalidOffset;
+}
+
+bool OffsetAllocator::free(uint64_t offset)
+{
+    auto allocation = _allocations.find(offset);
+    if (allocation == _allocations.end())
+    {
+        return false;
+    }
+
+    uint64_t rangeOffset = allocation->second.rangeOffset;
+    uint64_t rangeSize = allocation->second.rangeSize;
+    _usedSize -= rangeSize;
+    _allocations.erase(allocation);
+
+    // Merge with the free ranges before and after
+    auto next = _freeByOffset.lower_bound(rangeOffset);
+    if (next != _freeByOffset.begin())
+    {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == rangeOffset)
+        {
+            rangeOffset = previous->first;
+            rangeSize += previous->second;
+            eraseFreeRange(previous);
+        }
+    }
+    if (next != _freeByOffset.end() && rangeOffset + rangeSize == next->first)
+    {
+        rangeSize += next->second;
+        eraseFreeRange(next);
+    }
+    insertFreeRange(rangeOffset, rangeSize);
+    return true;
+}
+
+void OffsetAllocator::grow(uint64_t capacity)
+{
+    if (capacity < _capacity)
+    {
+        throw std::runtime_error("OffsetAllocator::grow(): the capacity can't be reduced");
+    }
+    if (capacity == _capacity)
+    {
+        return;
+    }
+
+    uint64_t offset = _capacity;
+    uint64_t size = capacity - _capacity;
+    _capacity = capacity;
+
+    // Merge with the last free range, if it reaches the end
+    if (!_freeByOffset.empty())
+    {
+        auto last = std::prev(_freeByOffset.end());
+        if (last->first + last->second == offset)
+        {
+            offset = last->first;
+            size += last->second;
+            eraseFreeRange(last);
+        }
+    }
+    insertFreeRange(offset, size);
+}
+
+void OffsetAllocator::reset(uint64_t capacity)
+{
+    _capacity = capacity;
+    _usedSize = 0;
+    _freeByOffset.clear();
+    _freeBySize.clear();
+    _allocations.clear();
+    if (capacity > 0)
+    {
+        insertFreeRange(0, capacity);
+    }
+}
+
+uint64_t OffsetAllocator::largestFreeRange() const
+{
+    return _freeBySize.empty() ? 0 : _freeBySize.rbegin()->first;
+}
+
+void OffsetAllocator::insertFreeRange(uint64_t offset, uint64_t size)
+{
+    _freeByOffset[offset] = size;
+    _freeBySize.insert({ size, offset });
+}
+
+void OffsetAllocator::eraseFreeRange(std::map<uint64_t, uint64_t>::iterator it)
+{
+    auto sizeRange = _freeBySize.equal_range(it->second);
+    for (auto sizeIt = sizeRange.first; sizeIt != sizeRange.second; ++sizeIt)
+    {
+        if (sizeIt->second == it->first)
+        {
+            _freeBySize.erase(sizeIt);
+            break;
+        }
+    }
+    _freeByOffset.erase(it);
+}
+
+}
+}
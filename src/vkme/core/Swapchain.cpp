@@ -9,83 +9,185 @@ void Swapchain::init(VulkanData * vulkanData, uint32_t width, uint32_t height)
 {
 	_vulkanData = vulkanData;
 
-	vkb::SwapchainBuilder builder{
-		vulkanData->physicalDevice(),
-		vulkanData->device(),
-		vulkanData->surface()
-	};
+	build(width, height);
+}
 
-	// TODO: IMGUI have an that prevents to use the specified image format 
-	// if dynamic rendering is used. It is necesary to use this format to draw the UI
-	// prevent this error
-	//_imageFormat = VK_FORMAT_R8G8B8A8_UNORM;
-    _imageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+void Swapchain::resize(uint32_t width, uint32_t height)
+{
+    auto oldSwapchain = _swapchain;
+    auto oldImageViews = _imageViews;
+    auto oldColorImages = _colorImages;
+    auto oldDepthImage = _depthImage;
+    
+    build(width, height, oldSwapchain);
+    
+    // The old swapchain is retired, but the frames in flight may still use its images
+    auto vulkanData = _vulkanData;
+    _vulkanData->releaseAfterFramesInFlight([=](VkDevice dev) {
+        for (auto img : oldColorImages)
+        {
+            delete img;
+        }
+        
+        vulkanData->imagePool().destroy(oldDepthImage);
+        
+        for (auto view : oldImageViews)
+        {
+            vkDestroyImageView(dev, view, nullptr);
+        }
+        destroySwapchain(dev, oldSwapchain, nullptr);
+    });
+}
 
-	VkSurfaceFormatKHR desiredFormat = {};
-	desiredFormat.format = _imageFormat;
-	desiredFormat.colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
-	vkb::Swapchain vkbSwapchain = builder
-		.set_desired_format(desiredFormat)
-		.set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR)
-		.set_desired_extent(width, height)
-		.add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT)
-		.build()
-		.value();
+const Image* Swapchain::depthImage() const
+{
+    return _vulkanData != nullptr ? _vulkanData->imagePool().get(_depthImage) : nullptr;
+}
 
-	_extent = vkbSwapchain.extent;
-	_swapchain = vkbSwapchain.swapchain;
-	_images = vkbSwapchain.get_images().value();
-	_imageViews = vkbSwapchain.get_image_views().value();
- 
-    _depthImage = Image::createAllocatedImage(
-        vulkanData,
-        VK_FORMAT_D32_SFLOAT,
-        _extent,
-        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-        VK_IMAGE_ASPECT_DEPTH_BIT
-    );
-    
-    // Array of core::Image wrappers
-    _colorImages.clear();
-    for (auto i = 0; i < _images.size(); ++i)
+const VkFormat Swapchain::depthImageFormat() const
+{
+    auto image = depthImage();
+    return image != nullptr ? image->format() : VK_FORMAT_UNDEFINED;
+}
+
+void Swapchain::setPresentMode(VkPresentModeKHR mode)
+{
+    if (mode != _requestedPresentMode)
     {
-        _colorImages.push_back(Image::wrapSwapchainImage(this, i));
+        _requestedPresentMode = mode;
+        _vulkanData->updateSwapchainSize();
     }
 }
 
-void Swapchain::resize(uint32_t width, uint32_t height)
+std::vector<VkPresentModeKHR> Swapchain::supportedPresentModes() const
+{
+    uint32_t count = 0;
+    vkGetPhysicalDeviceSurfacePresentModesKHR(_vulkanData->physicalDevice(), _vulkanData->surface(), &count, nullptr);
+    std::vector<VkPresentModeKHR> modes(count);
+    vkGetPhysicalDeviceSurfacePresentModesKHR(_vulkanData->physicalDevice(), _vulkanData->surface(), &count, modes.data());
+    return modes;
+}
+
+void Swapchain::setMinImageCount(uint32_t count)
+{
+    if (count != _requestedMinImageCount)
+    {
+        _requestedMinImageCount = count;
+        _vulkanData->updateSwapchainSize();
+    }
+}
+
+void Swapchain::beginFrame()
 {
-    cleanup();
+    if (_vulkanData->presentWaitSupported() && _maxFrameLatency > 0 && _lastPresentId >= _maxFrameLatency)
+    {
+        // The timeout prevents a dead lock if the window is hidden and the
+        // presentation engine does not present the images
+        auto waitResult = waitForPresent(
+            _vulkanData->device(),
+            _swapchain,
+            _lastPresentId + 1 - _maxFrameLatency,
+            100000000
+        );
+        if (waitResult != VK_SUCCESS && waitResult != VK_TIMEOUT && waitResult != VK_SUBOPTIMAL_KHR)
+        {
+            // The swapchain is out of date, it will be recreated
+            _vulkanData->updateSwapchainSize();
+        }
+    }
+    _frameStartTime = Clock::now();
+}
+
+uint64_t Swapchain::nextPresentId()
+{
+    if (!_vulkanData->presentWaitSupported())
+    {
+        return 0;
+    }
     
-    vkb::SwapchainBuilder builder{
+    ++_lastPresentId;
+    _pendingPresents.push_back({ _lastPresentId, _frameStartTime });
+    return _lastPresentId;
+}
+
+void Swapchain::updatePresentLatency()
+{
+    while (!_pendingPresents.empty())
+    {
+        auto& pending = _pendingPresents.front();
+        if (waitForPresent(_vulkanData->device(), _swapchain, pending.first, 0) != VK_SUCCESS)
+        {
+            break;
+        }
+        
+        float latency = std::chrono::duration<float, std::milli>(Clock::now() - pending.second).count();
+        _presentLatency = _presentLatency == 0.0f ? latency : _presentLatency * 0.9f + latency * 0.1f;
+        _pendingPresents.pop_front();
+    }
+}
+
+void Swapchain::build(uint32_t width, uint32_t height, VkSwapchainKHR oldSwapchain)
+{
+	vkb::SwapchainBuilder builder{
 		_vulkanData->physicalDevice(),
 		_vulkanData->device(),
 		_vulkanData->surface()
 	};
- 
+
+	// TODO: IMGUI have an that prevents to use the specified image format 
+	// if dynamic rendering is used. It is necesary to use this format to draw the UI
+	// prevent this error
+	//_imageFormat = VK_FORMAT_R8G8B8A8_UNORM;
     _imageFormat = VK_FORMAT_B8G8R8A8_UNORM;
-    
-    VkSurfaceFormatKHR desiredFormat = {};
+
+	VkSurfaceFormatKHR desiredFormat = {};
 	desiredFormat.format = _imageFormat;
 	desiredFormat.colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
-	vkb::Swapchain vkbSwapchain = builder
+	builder
 		.set_desired_format(desiredFormat)
-		.set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR)
+		.set_desired_present_mode(_requestedPresentMode)
 		.set_desired_extent(width, height)
 		.add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT)
-		.build()
-		.value();
+		.set_old_swapchain(oldSwapchain);
+	
+	// Fallback present modes, in order of preference. FIFO is always supported
+	switch (_requestedPresentMode)
+	{
+	case VK_PRESENT_MODE_MAILBOX_KHR:
+		builder.add_fallback_present_mode(VK_PRESENT_MODE_IMMEDIATE_KHR);
+		break;
+	case VK_PRESENT_MODE_IMMEDIATE_KHR:
+		builder.add_fallback_present_mode(VK_PRESENT_MODE_MAILBOX_KHR);
+		break;
+	default:
+		break;
+	}
+	builder.add_fallback_present_mode(VK_PRESENT_MODE_FIFO_KHR);
+	
+	if (_requestedMinImageCount > 0)
+	{
+		builder.set_desired_min_image_count(_requestedMinImageCount);
+	}
+	
+	vkb::Swapchain vkbSwapchain = builder.build().value();
 
 	_extent = vkbSwapchain.extent;
 	_swapchain = vkbSwapchain.swapchain;
 	_images = vkbSwapchain.get_images().value();
 	_imageViews = vkbSwapchain.get_image_views().value();
+	_presentMode = vkbSwapchain.present_mode;
+	_minImageCount = vkbSwapchain.requested_min_image_count;
+	
+	// The present ids are related to the swapchain
+	_lastPresentId = 0;
+	_pendingPresents.clear();
  
-    _depthImage = Image::createAllocatedImage(
+    _depthImage = Image::createPooledImage(
         _vulkanData,
         VK_FORMAT_D32_SFLOAT,
         _extent,
-        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+        // The depth is also sampled to build the depth pyramid (see DepthPyramid)
+        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
         VK_IMAGE_ASPECT_DEPTH_BIT
     );
     
@@ -104,10 +206,13 @@ void Swapchain::cleanup()
         // This images should not be cleared because they are wrappers
         // of the swapchain images and image views, that are cleared
         // later in this function
+        for (auto img : _colorImages)
+        {
+            delete img;
+        }
         _colorImages.clear();
         
-        _depthImage->cleanup();
-        delete _depthImage;
+        _vulkanData->imagePool().destroy(_depthImage);
         
         destroySwapchain(_vulkanData->device(), _swapchain, nullptr);
 
@@ -107,6 +107,18 @@ void cmdPipelineBarrier2(
 #endif
 }
 
+void cmdSetEvent2(
+    VkCommandBuffer                             commandBuffer,
+    VkEvent                                     event,
+    const VkDependencyInfo*                     pDependencyInfo
+) {
+#ifdef MINI_ENGINE_IS_WINDOWS
+    vkCmdSetEvent2(commandBuffer, event, pDependencyInfo);
+#else
+    vkCmdSetEvent2KHR(commandBuffer, event, pDependencyInfo);
+#endif
+}
+
 // VK_KHR_copy_commands2
 void cmdBlitImage2(
     VkCommandBuffer                             commandBuffer,
@@ -119,6 +131,41 @@ void cmdBlitImage2(
 #endif
 }
 
+// VK_KHR_present_wait
+VkResult waitForPresent(
+    VkDevice                                    device,
+    VkSwapchainKHR                              swapchain,
+    uint64_t                                    presentId,
+    uint64_t                                    timeout
+) {
+    // This function is not exported by the loader, on any platform. The engine uses
+    // only one device, so the function pointer is loaded once
+    static auto pfnWaitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(
+        vkGetDeviceProcAddr(device, "vkWaitForPresentKHR")
+    );
+    if (!pfnWaitForPresent)
+    {
+        return VK_ERROR_EXTENSION_NOT_PRESENT;
+    }
+    return pfnWaitForPresent(device, swapchain, presentId, timeout);
+}
+
+// VK_EXT_mesh_shader
+void cmdDrawMeshTasksIndirect(
+    VkDevice                                    device,
+    VkCommandBuffer                             commandBuffer,
+    VkBuffer                                    buffer,
+    VkDeviceSize                                offset,
+    uint32_t                                    drawCount,
+    uint32_t                                    stride
+) {
+    // Same as waitForPresent(): the function is loaded once, for the only device of the engine
+    static auto pfnDrawMeshTasksIndirect = reinterpret_cast<PFN_vkCmdDrawMeshTasksIndirectEXT>(
+        vkGetDeviceProcAddr(device, "vkCmdDrawMeshTasksIndirectEXT")
+    );
+    pfnDrawMeshTasksIndirect(commandBuffer, buffer, offset, drawCount, stride);
+}
+
 
 }
 }
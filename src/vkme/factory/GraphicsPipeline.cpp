@@ -161,6 +161,21 @@ void GraphicsPipeline::enableBlendingAlphablend()
     colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
 }
 
+void GraphicsPipeline::enableBlendingPremultipliedAlpha()
+{
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT |
+        VK_COLOR_COMPONENT_G_BIT |
+        VK_COLOR_COMPONENT_B_BIT |
+        VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = VK_TRUE;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+}
+
 VkPipeline GraphicsPipeline::build(VkPipelineLayout layout)
 {
     VkPipelineViewportStateCreateInfo viewportInfo = {};
@@ -0,0 +1,112 @@
+#include <vkme/geo/Bounds.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace vkme {
+namespace geo {
+
+BoundingBox BoundingBox::fromIndexedVertices(const uint32_t* indices, size_t indexCount, const std::vector<Vertex>& vertices)
+{
+    BoundingBox result;
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        result.expand(vertices[indices[i]].position());
+    }
+    return result;
+}
+
+void BoundingBox::expand(const glm::vec3& point)
+{
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+}
+
+void BoundingBox::expand(const BoundingBox& box)
+{
+    min = glm::min(min, box.min);
+    max = glm::max(max, box.max);
+}
+
+float BoundingBox::surfaceArea() const
+{
+    if (empty())
+    {
+        return 0.0f;
+    }
+    auto d = size();
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+bool BoundingBox::intersects(const BoundingBox& other) const
+{
+    return min.x <= other.max.x && max.x >= other.min.x &&
+        min.y <= other.max.y && max.y >= other.min.y &&
+        min.z <= other.max.z && max.z >= other.min.z;
+}
+
+bool BoundingBox::contains(const glm::vec3& point) const
+{
+    return point.x >= min.x && point.x <= max.x &&
+        point.y >= min.y && point.y <= max.y &&
+        point.z >= min.z && point.z <= max.z;
+}
+
+BoundingBox BoundingBox::transform(const glm::mat4& matrix) const
+{
+    if (empty())
+    {
+        return *this;
+    }
+
+    // Each component of the result is the translation plus the minimum and maximum of the
+    // products of the matrix elements by the bounds of the box
+    BoundingBox result;
+    result.min = glm::vec3(matrix[3]);
+    result.max = glm::vec3(matrix[3]);
+    for (int c = 0; c < 3; ++c)
+    {
+        auto a = glm::vec3(matrix[c]) * min[c];
+        auto b = glm::vec3(matrix[c]) * max[c];
+        result.min += glm::min(a, b);
+        result.max += glm::max(a, b);
+    }
+    return result;
+}
+
+BoundingSphere BoundingSphere::fromIndexedVertices(const uint32_t* indices, size_t indexCount, const std::vector<Vertex>& vertices)
+{
+    BoundingSphere result;
+    if (indexCount == 0)
+    {
+        return result;
+    }
+
+    result.center = BoundingBox::fromIndexedVertices(indices, indexCount, vertices).center();
+    float radius2 = 0.0f;
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        auto d = vertices[indices[i]].position() - result.center;
+        radius2 = std::max(radius2, glm::dot(d, d));
+    }
+    result.radius = std::sqrt(radius2);
+    return result;
+}
+
+BoundingSphere BoundingSphere::transform(const glm::mat4& matrix) const
+{
+    float scale2 = std::max({
+        glm::dot(glm::vec3(matrix[0]), glm::vec3(matrix[0])),
+        glm::dot(glm::vec3(matrix[1]), glm::vec3(matrix[1])),
+        glm::dot(glm::vec3(matrix[2]), glm::vec3(matrix[2]))
+    });
+
+    BoundingSphere result;
+    result.center = glm::vec3(matrix * glm::vec4(center, 1.0f));
+    result.radius = radius * std::sqrt(scale2);
+    return result;
+}
+
+}
+}
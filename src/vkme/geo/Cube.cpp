@@ -49,7 +49,7 @@ f 2/16/5 1/1/5 3/17/5 4/14/5
 f 6/18/6 5/19/6 1/1/6 2/13/6
 )"""";
 
-std::shared_ptr<Model> Cube::createCube(VulkanData* vulkanData, float side, const std::string& name, const std::vector<std::shared_ptr<Modifier>>& mods)
+std::shared_ptr<Model> Cube::createCube(VulkanData* vulkanData, float side, const std::string& name, const std::vector<std::shared_ptr<Modifier>>& mods, VertexFormat vertexFormat, bool positionStream)
 {
     std::stringstream objStream(cube_objData);
     
@@ -59,7 +59,7 @@ std::shared_ptr<Model> Cube::createCube(VulkanData* vulkanData, float side, cons
         modifiers.push_back(std::unique_ptr<Modifier>(new ScaleModifier(side)));
     }
     
-    auto result = Model::loadObj(vulkanData, objStream, name, modifiers)[0];
+    auto result = Model::loadObj(vulkanData, objStream, name, modifiers, vertexFormat, positionStream)[0];
     
     return result;
 }
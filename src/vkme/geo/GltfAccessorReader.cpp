@@ -0,0 +1,237 @@
+#include <vkme/geo/GltfAccessorReader.hpp>
+
+#include <fastgltf/glm_element_traits.hpp>
+#include <fastgltf/tools.hpp>
+
+#include <cstring>
+#include <limits>
+
+namespace vkme {
+namespace geo {
+
+template <class T>
+static inline T loadComponent(const std::byte* src)
+{
+    // The glTF buffers are not always aligned to the component size
+    T value;
+    memcpy(&value, src, sizeof(T));
+    return value;
+}
+
+// Calls write(index, components) for each element, with the components converted to float. The
+// normalized integer components are mapped to [0, 1]. The lambda is inlined, so the loop has no
+// calls for each element. With Packed the stride is the element size, known at compile time
+template <class T, uint32_t N, bool Packed, class WriteFunc>
+static void convertElements(const std::byte* src, size_t stride, size_t count, bool normalized, WriteFunc write)
+{
+    const size_t elementStride = Packed ? sizeof(T) * N : stride;
+    const float scale = normalized && std::numeric_limits<T>::is_integer ?
+        1.0f / float(std::numeric_limits<T>::max()) : 1.0f;
+    for (size_t i = 0; i < count; ++i)
+    {
+        float components[N];
+        for (uint32_t c = 0; c < N; ++c)
+        {
+            components[c] = float(loadComponent<T>(src + i * elementStride + c * sizeof(T))) * scale;
+        }
+        write(i, components);
+    }
+}
+
+template <class T, uint32_t N, class WriteFunc>
+static void convertElements(const std::byte* src, size_t stride, size_t count, bool normalized, WriteFunc write)
+{
+    if (stride == sizeof(T) * N)
+    {
+        convertElements<T, N, true>(src, stride, count, normalized, write);
+    }
+    else
+    {
+        convertElements<T, N, false>(src, stride, count, normalized, write);
+    }
+}
+
+// Dispatches the component types that are used by the vertex attributes. Returns false if the
+// accessor must be read with the fastgltf iterators
+template <uint32_t N, class WriteFunc>
+static bool convertAccessor(const std::byte* src, size_t stride, const fastgltf::Accessor& accessor, WriteFunc write)
+{
+    if (src == nullptr || fastgltf::getNumComponents(accessor.type) != N)
+    {
+        return false;
+    }
+
+    switch (accessor.componentType)
+    {
+    case fastgltf::ComponentType::Float:
+        convertElements<float, N>(src, stride, accessor.count, false, write);
+        return true;
+    case fastgltf::ComponentType::UnsignedByte:
+        if (!accessor.normalized) return false;
+        convertElements<uint8_t, N>(src, stride, accessor.count, true, write);
+        return true;
+    case fastgltf::ComponentType::UnsignedShort:
+        if (!accessor.normalized) return false;
+        convertElements<uint16_t, N>(src, stride, accessor.count, true, write);
+        return true;
+    default:
+        return false;
+    }
+}
+
+template <class T, bool Packed>
+static void convertIndices(const std::byte* src, size_t stride, size_t count, uint32_t baseVertex, uint32_t* dst)
+{
+    const size_t indexStride = Packed ? sizeof(T) : stride;
+    for (size_t i = 0; i < count; ++i)
+    {
+        dst[i] = uint32_t(loadComponent<T>(src + i * indexStride)) + baseVertex;
+    }
+}
+
+template <class T>
+static void convertIndices(const std::byte* src, size_t stride, size_t count, uint32_t baseVertex, uint32_t* dst)
+{
+    if (stride != sizeof(T))
+    {
+        convertIndices<T, false>(src, stride, count, baseVertex, dst);
+    }
+    else if (sizeof(T) == sizeof(uint32_t) && baseVertex == 0)
+    {
+        // The indices of the first primitive are copied as they are
+        memcpy(dst, src, count * sizeof(uint32_t));
+    }
+    else
+    {
+        convertIndices<T, true>(src, stride, count, baseVertex, dst);
+    }
+}
+
+const std::byte* GltfAccessorReader::directData(const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, size_t& stride)
+{
+    if (accessor.sparse.has_value() || !accessor.bufferViewIndex.has_value() || accessor.count == 0)
+    {
+        return nullptr;
+    }
+
+    auto& bufferView = asset.bufferViews[accessor.bufferViewIndex.value()];
+    if (bufferView.meshoptCompression)
+    {
+        return nullptr;
+    }
+
+    auto bufferData = fastgltf::DefaultBufferDataAdapter()(asset.buffers[bufferView.bufferIndex]);
+    if (bufferData == nullptr)
+    {
+        return nullptr;
+    }
+
+    size_t elementSize = fastgltf::getElementByteSize(accessor.type, accessor.componentType);
+    stride = bufferView.byteStride.has_value() ? bufferView.byteStride.value() : elementSize;
+
+    // The iterators handle the accessors that exceed the buffer view
+    if (elementSize == 0 || accessor.byteOffset + (accessor.count - 1) * stride + elementSize > bufferView.byteLength)
+    {
+        return nullptr;
+    }
+    return bufferData + bufferView.byteOffset + accessor.byteOffset;
+}
+
+void GltfAccessorReader::readIndices(const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, uint32_t baseVertex, uint32_t* dst)
+{
+    size_t stride = 0;
+    auto src = directData(asset, accessor, stride);
+    if (src != nullptr && fastgltf::getNumComponents(accessor.type) == 1)
+    {
+        switch (accessor.componentType)
+        {
+        case fastgltf::ComponentType::UnsignedByte:
+            convertIndices<uint8_t>(src, stride, accessor.count, baseVertex, dst);
+            return;
+        case fastgltf::ComponentType::UnsignedShort:
+            convertIndices<uint16_t>(src, stride, accessor.count, baseVertex, dst);
+            return;
+        case fastgltf::ComponentType::UnsignedInt:
+            convertIndices<uint32_t>(src, stride, accessor.count, baseVertex, dst);
+            return;
+        default:
+            break;
+        }
+    }
+
+    fastgltf::iterateAccessorWithIndex<std::uint32_t>(asset, accessor,
+        [&](std::uint32_t index, size_t i) {
+            dst[i] = index + baseVertex;
+        });
+}
+
+void GltfAccessorReader::readPositions(const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, Vertex* dst)
+{
+    size_t stride = 0;
+    auto src = directData(asset, accessor, stride);
+    auto write = [dst](size_t i, const float* v) {
+        dst[i].setPosition(glm::vec3(v[0], v[1], v[2]));
+    };
+    if (!convertAccessor<3>(src, stride, accessor, write))
+    {
+        fastgltf::iterateAccessorWithIndex<glm::vec3>(asset, accessor,
+            [&](glm::vec3 v, size_t i) {
+                dst[i].setPosition(v);
+            });
+    }
+}
+
+void GltfAccessorReader::readNormals(const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, Vertex* dst)
+{
+    size_t stride = 0;
+    auto src = directData(asset, accessor, stride);
+    auto write = [dst](size_t i, const float* n) {
+        dst[i].setNormal(glm::vec3(n[0], n[1], n[2]));
+    };
+    // The normalized integer normals are signed, so only the float ones are converted here
+    if (accessor.componentType != fastgltf::ComponentType::Float || !convertAccessor<3>(src, stride, accessor, write))
+    {
+        fastgltf::iterateAccessorWithIndex<glm::vec3>(asset, accessor,
+            [&](glm::vec3 n, size_t i) {
+                dst[i].setNormal(n);
+            });
+    }
+}
+
+void GltfAccessorReader::readUvs(const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, Vertex* dst)
+{
+    size_t stride = 0;
+    auto src = directData(asset, accessor, stride);
+    auto write = [dst](size_t i, const float* uv) {
+        dst[i].setUv1(glm::vec2(uv[0], uv[1]));
+    };
+    if (!convertAccessor<2>(src, stride, accessor, write))
+    {
+        fastgltf::iterateAccessorWithIndex<glm::vec2>(asset, accessor,
+            [&](glm::vec2 uv, size_t i) {
+                dst[i].setUv1(uv);
+            });
+    }
+}
+
+void GltfAccessorReader::readColors(const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, Vertex* dst)
+{
+    size_t stride = 0;
+    auto src = directData(asset, accessor, stride);
+    auto writeRgba = [dst](size_t i, const float* c) {
+        dst[i].setColor(glm::vec4(c[0], c[1], c[2], c[3]));
+    };
+    auto writeRgb = [dst](size_t i, const float* c) {
+        dst[i].setColor(glm::vec4(c[0], c[1], c[2], 1.0f));
+    };
+    if (!convertAccessor<4>(src, stride, accessor, writeRgba) && !convertAccessor<3>(src, stride, accessor, writeRgb))
+    {
+        fastgltf::iterateAccessorWithIndex<glm::vec4>(asset, accessor,
+            [&](glm::vec4 c, size_t i) {
+                dst[i].setColor(c);
+            });
+    }
+}
+
+}
+}
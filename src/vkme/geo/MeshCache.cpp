@@ -0,0 +1,410 @@
+#include <vkme/geo/MeshCache.hpp>
+#include <vkme/PlatformTools.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+
+namespace vkme {
+namespace geo {
+
+static const char cacheMagic[4] = { 'V', 'K', 'M', 'C' };
+
+// The blobs are aligned, so the records can also be read directly from the mapped file
+static constexpr size_t blobAlignment = 16;
+
+struct CacheFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t meshCount;
+    uint32_t instanceCount;
+    uint64_t instancesOffset;
+};
+
+struct CacheMeshRecord {
+    uint64_t vertexDataOffset;
+    uint64_t vertexDataSize;
+    uint64_t indexDataOffset;
+    uint64_t indexDataSize;
+    uint64_t positionDataOffset;
+    uint64_t positionDataSize;
+    uint64_t meshletDataOffset;
+    uint64_t meshletDataSize;
+    uint64_t surfacesOffset;
+    uint64_t nameOffset;
+    uint32_t surfaceCount;
+    uint32_t nameSize;
+    uint32_t indexCount;
+    uint32_t indexType;
+    uint32_t vertexFormat;
+    uint32_t meshletCount;
+    // position offset, position scale, uv offset, uv scale
+    float quantization[10];
+};
+
+struct CacheInstanceRecord {
+    uint32_t meshIndex;
+    uint32_t reserved[3];
+    // Column major
+    float transform[16];
+};
+
+static size_t alignOffset(size_t offset)
+{
+    return (offset + blobAlignment - 1) & ~(blobAlignment - 1);
+}
+
+// Placement of a blob in the file. The data is owned by the meshes that are being stored
+struct Blob {
+    size_t offset;
+    const void* data;
+    size_t size;
+};
+
+MeshCache::KeyBuilder& MeshCache::KeyBuilder::add(const void* data, size_t size)
+{
+    auto bytes = reinterpret_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        _hash = (_hash ^ bytes[i]) * 0x100000001B3ull;
+    }
+    return *this;
+}
+
+MeshCache::KeyBuilder& MeshCache::KeyBuilder::add(const std::string& str)
+{
+    // The size separates the consecutive strings
+    addValue(uint64_t(str.size()));
+    return add(str.data(), str.size());
+}
+
+std::string MeshCache::filePath(uint64_t key)
+{
+    std::ostringstream name;
+    name << PlatformTools::cachePath() << "mesh_" << std::hex << std::setw(16) << std::setfill('0') << key << ".vkmesh";
+    return name.str();
+}
+
+bool MeshCache::open(uint64_t key)
+{
+    close();
+    if (!_file.open(filePath(key)))
+    {
+        return false;
+    }
+
+    auto data = _file.data();
+    auto size = _file.size();
+    auto inRange = [&](uint64_t offset, uint64_t blobSize) {
+        return offset <= size && blobSize <= size - offset;
+    };
+
+    CacheFileHeader header;
+    if (size < sizeof(header))
+    {
+        close();
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, cacheMagic, 4) != 0 || header.version != Version || header.key != key ||
+        !inRange(sizeof(header), uint64_t(header.meshCount) * sizeof(CacheMeshRecord)))
+    {
+        close();
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header.meshCount; ++i)
+    {
+        CacheMeshRecord record;
+        memcpy(&record, data + sizeof(header) + i * sizeof(CacheMeshRecord), sizeof(record));
+        if (!inRange(record.vertexDataOffset, record.vertexDataSize) ||
+            !inRange(record.indexDataOffset, record.indexDataSize) ||
+            !inRange(record.positionDataOffset, record.positionDataSize) ||
+            !inRange(record.meshletDataOffset, record.meshletDataSize) ||
+            !inRange(record.surfacesOffset, uint64_t(record.surfaceCount) * sizeof(Surface)) ||
+            !inRange(record.nameOffset, record.nameSize))
+        {
+            std::cerr << "MeshCache: invalid cache file " << filePath(key) << std::endl;
+            close();
+            return false;
+        }
+
+        MeshView mesh;
+        mesh.name = std::string(reinterpret_cast<const char*>(data + record.nameOffset), record.nameSize);
+        mesh.surfaces.resize(record.surfaceCount);
+        memcpy(mesh.surfaces.data(), data + record.surfacesOffset, record.surfaceCount * sizeof(Surface));
+
+        auto& upload = mesh.uploadData;
+        upload.vertexData = data + record.vertexDataOffset;
+        upload.vertexDataSize = record.vertexDataSize;
+        upload.indexData = data + record.indexDataOffset;
+        upload.indexDataSize = record.indexDataSize;
+        upload.positionData = record.positionDataSize > 0 ? data + record.positionDataOffset : nullptr;
+        upload.positionDataSize = record.positionDataSize;
+        upload.meshletData = record.meshletDataSize > 0 ? data + record.meshletDataOffset : nullptr;
+        upload.meshletDataSize = record.meshletDataSize;
+        upload.meshletCount = record.meshletCount;
+        upload.indexCount = record.indexCount;
+        upload.indexType = VkIndexType(record.indexType);
+        upload.vertexFormat = VertexFormat(record.vertexFormat);
+
+        auto q = record.quantization;
+        upload.quantization.positionOffset = glm::vec3(q[0], q[1], q[2]);
+        upload.quantization.positionScale = glm::vec3(q[3], q[4], q[5]);
+        upload.quantization.uvOffset = glm::vec2(q[6], q[7]);
+        upload.quantization.uvScale = glm::vec2(q[8], q[9]);
+
+        _meshes.push_back(std::move(mesh));
+    }
+
+    if (!inRange(header.instancesOffset, uint64_t(header.instanceCount) * sizeof(CacheInstanceRecord)))
+    {
+        std::cerr << "MeshCache: invalid cache file " << filePath(key) << std::endl;
+        close();
+        return false;
+    }
+    for (uint32_t i = 0; i < header.instanceCount; ++i)
+    {
+        CacheInstanceRecord record;
+        memcpy(&record, data + header.instancesOffset + i * sizeof(CacheInstanceRecord), sizeof(record));
+        if (record.meshIndex >= _meshes.size())
+        {
+            std::cerr << "MeshCache: invalid cache file " << filePath(key) << std::endl;
+            close();
+            return false;
+        }
+
+        Instance instance;
+        instance.meshIndex = record.meshIndex;
+        for (int c = 0; c < 4; ++c)
+        {
+            instance.transform[c] = glm::vec4(
+                record.transform[c * 4], record.transform[c * 4 + 1], record.transform[c * 4 + 2], record.transform[c * 4 + 3]
+            );
+        }
+        _instances.push_back(instance);
+    }
+
+    // The modification time is the last access time for evict()
+    std::error_code error;
+    std::filesystem::last_write_time(filePath(key), std::filesystem::file_time_type::clock::now(), error);
+    return true;
+}
+
+void MeshCache::close()
+{
+    _meshes.clear();
+    _instances.clear();
+    _file.close();
+}
+
+void MeshCache::store(uint64_t key, const std::vector<Mesh>& meshes, const std::vector<Instance>& instances)
+{
+    CacheFileHeader header = {};
+    memcpy(header.magic, cacheMagic, 4);
+    header.version = Version;
+    header.key = key;
+    header.meshCount = uint32_t(meshes.size());
+    header.instanceCount = uint32_t(instances.size());
+
+    // The blobs are written directly from the encoded meshes, in the order in which they are
+    // placed here, so the mesh data is not copied to an intermediate file buffer
+    std::vector<Blob> blobs;
+    size_t fileSize = sizeof(header) + meshes.size() * sizeof(CacheMeshRecord);
+    auto placeBlob = [&](const void* data, size_t size) {
+        size_t offset = alignOffset(fileSize);
+        blobs.push_back({ offset, data, size });
+        fileSize = offset + size;
+        return offset;
+    };
+
+    std::vector<CacheMeshRecord> records(meshes.size());
+    for (size_t i = 0; i < meshes.size(); ++i)
+    {
+        auto& mesh = meshes[i];
+        auto& encoded = mesh.encodedMesh;
+        auto& record = records[i];
+        record = {};
+        record.vertexDataSize = encoded.vertexData.size();
+        record.vertexDataOffset = placeBlob(encoded.vertexData.data(), encoded.vertexData.size());
+        record.indexDataSize = encoded.indexData.size();
+        record.indexDataOffset = placeBlob(encoded.indexData.data(), encoded.indexData.size());
+        record.positionDataSize = encoded.positionData.size();
+        record.positionDataOffset = placeBlob(encoded.positionData.data(), encoded.positionData.size());
+        record.meshletDataSize = encoded.meshletData.size();
+        record.meshletDataOffset = placeBlob(encoded.meshletData.data(), encoded.meshletData.size());
+        record.meshletCount = encoded.meshletCount;
+        record.surfaceCount = uint32_t(mesh.surfaces.size());
+        record.surfacesOffset = placeBlob(mesh.surfaces.data(), mesh.surfaces.size() * sizeof(Surface));
+        record.nameSize = uint32_t(mesh.name.size());
+        record.nameOffset = placeBlob(mesh.name.data(), mesh.name.size());
+        record.indexCount = encoded.indexCount;
+        record.indexType = uint32_t(encoded.indexType);
+        record.vertexFormat = uint32_t(encoded.vertexFormat);
+
+        auto& q = encoded.quantization;
+        float quantization[10] = {
+            q.positionOffset.x, q.positionOffset.y, q.positionOffset.z,
+            q.positionScale.x, q.positionScale.y, q.positionScale.z,
+            q.uvOffset.x, q.uvOffset.y,
+            q.uvScale.x, q.uvScale.y
+        };
+        memcpy(record.quantization, quantization, sizeof(quantization));
+    }
+    std::vector<CacheInstanceRecord> instanceRecords(instances.size());
+    for (size_t i = 0; i < instances.size(); ++i)
+    {
+        auto& record = instanceRecords[i];
+        record = {};
+        record.meshIndex = instances[i].meshIndex;
+        for (int c = 0; c < 4; ++c)
+        {
+            for (int r = 0; r < 4; ++r)
+            {
+                record.transform[c * 4 + r] = instances[i].transform[c][r];
+            }
+        }
+    }
+    header.instancesOffset = placeBlob(instanceRecords.data(), instanceRecords.size() * sizeof(CacheInstanceRecord));
+
+    // Write to a temporary file and rename it, so other processes never map a partial file
+    auto path = filePath(key);
+    auto tempPath = path + ".tmp";
+    std::error_code error;
+    std::filesystem::create_directories(PlatformTools::cachePath(), error);
+    {
+        std::ofstream output(tempPath, std::ios::binary);
+        if (!output.is_open())
+        {
+            std::cerr << "MeshCache: could not write cache file " << tempPath << std::endl;
+            return;
+        }
+        output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        output.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(CacheMeshRecord));
+        const char padding[blobAlignment] = {};
+        size_t position = sizeof(header) + records.size() * sizeof(CacheMeshRecord);
+        for (auto& blob : blobs)
+        {
+            output.write(padding, blob.offset - position);
+            output.write(reinterpret_cast<const char*>(blob.data), blob.size);
+            position = blob.offset + blob.size;
+        }
+        if (!output)
+        {
+            std::cerr << "MeshCache: could not write cache file " << tempPath << std::endl;
+            output.close();
+            std::filesystem::remove(tempPath, error);
+            return;
+        }
+    }
+    std::filesystem::rename(tempPath, path, error);
+    if (error)
+    {
+        std::cerr << "MeshCache: could not write cache file " << path << ": " << error.message() << std::endl;
+        std::filesystem::remove(tempPath, error);
+        return;
+    }
+
+    evict();
+}
+
+void MeshCache::evict(uint64_t maxSize)
+{
+    namespace fs = std::filesystem;
+
+    struct CacheEntry {
+        fs::path path;
+        uint64_t size;
+        fs::file_time_type lastAccess;
+    };
+
+    // The temporary files of other processes may still be being written
+    const auto tempFileLifetime = std::chrono::hours(1);
+    const auto now = fs::file_time_type::clock::now();
+
+    std::error_code error;
+    fs::directory_iterator it(PlatformTools::cachePath(), error);
+    if (error)
+    {
+        return;
+    }
+
+    std::vector<CacheEntry> entries;
+    uint64_t totalSize = 0;
+    for (; it != fs::directory_iterator(); it.increment(error))
+    {
+        if (error)
+        {
+            break;
+        }
+        auto path = it->path();
+        auto fileName = path.filename().string();
+        if (fileName.compare(0, 5, "mesh_") != 0 || !it->is_regular_file(error))
+        {
+            continue;
+        }
+        auto lastWrite = it->last_write_time(error);
+        if (error)
+        {
+            continue;
+        }
+
+        if (path.extension() == ".tmp")
+        {
+            if (now - lastWrite > tempFileLifetime)
+            {
+                fs::remove(path, error);
+            }
+            continue;
+        }
+        if (path.extension() != ".vkmesh")
+        {
+            continue;
+        }
+
+        CacheFileHeader header = {};
+        {
+            std::ifstream input(path, std::ios::binary);
+            input.read(reinterpret_cast<char*>(&header), sizeof(header));
+        }
+        if (memcmp(header.magic, cacheMagic, 4) != 0 || header.version != Version)
+        {
+            fs::remove(path, error);
+            continue;
+        }
+
+        auto size = it->file_size(error);
+        if (error)
+        {
+            continue;
+        }
+        entries.push_back({ path, size, lastWrite });
+        totalSize += size;
+    }
+
+    if (totalSize <= maxSize)
+    {
+        return;
+    }
+    std::sort(entries.begin(), entries.end(), [](const CacheEntry& a, const CacheEntry& b) {
+        return a.lastAccess < b.lastAccess;
+    });
+    // The most recent file is kept, even if it doesn't fit alone
+    for (size_t i = 0; i + 1 < entries.size() && totalSize > maxSize; ++i)
+    {
+        // A file that is mapped by other process can't be removed in Windows, but it's still in use
+        if (fs::remove(entries[i].path, error))
+        {
+            totalSize -= entries[i].size;
+        }
+    }
+}
+
+}
+}
@@ -0,0 +1,485 @@
+#include <vkme/geo/MeshOptimizer.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace vkme {
+namespace geo {
+
+// Size of the cache simulated by the vertex cache optimization. It is larger than the real
+// caches, because the algorithm scores the recently used vertices and not the exact cache state
+constexpr int FORSYTH_CACHE_SIZE = 32;
+
+// Size of the FIFO cache used to measure the ACMR and to split the overdraw clusters
+constexpr uint32_t FIFO_CACHE_SIZE = 16;
+
+static float vertexScore(int cachePosition, uint32_t remainingTriangles)
+{
+    if (remainingTriangles == 0)
+    {
+        // The vertex is not used by any other triangle
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        if (cachePosition < 3)
+        {
+            // The vertices of the last triangle have a fixed score, to avoid that the
+            // next triangle uses always the same edge
+            score = 0.75f;
+        }
+        else
+        {
+            float scale = 1.0f / float(FORSYTH_CACHE_SIZE - 3);
+            score = std::pow(1.0f - float(cachePosition - 3) * scale, 1.5f);
+        }
+    }
+
+    // Boost the vertices with few remaining triangles, to finish them and avoid isolated triangles
+    score += 2.0f / std::sqrt(float(remainingTriangles));
+    return score;
+}
+
+void MeshOptimizer::optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // Triangles that use each vertex, stored in a single array
+    std::vector<uint32_t> triangleOffsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+    {
+        ++triangleOffsets[indices[i] + 1];
+    }
+    std::vector<uint32_t> remainingTriangles(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        remainingTriangles[v] = triangleOffsets[v + 1];
+        triangleOffsets[v + 1] += triangleOffsets[v];
+    }
+    std::vector<uint32_t> vertexTriangles(triangleCount * 3);
+    std::vector<uint32_t> fillOffsets(triangleOffsets.begin(), triangleOffsets.end() - 1);
+    for (uint32_t t = 0; t < triangleCount; ++t)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            vertexTriangles[fillOffsets[indices[t * 3 + k]]++] = t;
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        vertexScores[v] = vertexScore(-1, remainingTriangles[v]);
+    }
+
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    int64_t bestTriangle = 0;
+    for (uint32_t t = 0; t < triangleCount; ++t)
+    {
+        triangleScores[t] =
+            vertexScores[indices[t * 3]] +
+            vertexScores[indices[t * 3 + 1]] +
+            vertexScores[indices[t * 3 + 2]];
+        if (triangleScores[t] > triangleScores[bestTriangle])
+        {
+            bestTriangle = t;
+        }
+    }
+
+    std::vector<uint32_t> result;
+    result.reserve(triangleCount * 3);
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> newCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+    size_t cursor = 0;
+
+    while (result.size() < triangleCount * 3)
+    {
+        if (bestTriangle < 0)
+        {
+            // There is no triangle that uses the cached vertices: continue with the next
+            // triangle in the original order
+            while (emitted[cursor])
+            {
+                ++cursor;
+            }
+            bestTriangle = int64_t(cursor);
+        }
+
+        auto triangle = uint32_t(bestTriangle);
+        emitted[triangle] = true;
+
+        newCache.clear();
+        for (int k = 0; k < 3; ++k)
+        {
+            auto v = indices[triangle * 3 + k];
+            result.push_back(v);
+            if (std::find(newCache.begin(), newCache.end(), v) != newCache.end())
+            {
+                // Degenerate triangle
+                continue;
+            }
+            newCache.push_back(v);
+
+            // Remove the triangle from the remaining triangles of the vertex
+            auto begin = vertexTriangles.begin() + triangleOffsets[v];
+            auto end = begin + remainingTriangles[v];
+            auto it = std::find(begin, end, triangle);
+            while (it != end)
+            {
+                std::iter_swap(it, end - 1);
+                --end;
+                --remainingTriangles[v];
+                it = std::find(begin, end, triangle);
+            }
+        }
+
+        // The vertices of the emitted triangle go to the front of the cache
+        size_t emittedCount = newCache.size();
+        for (auto v : cache)
+        {
+            auto emittedEnd = newCache.begin() + emittedCount;
+            if (std::find(newCache.begin(), emittedEnd, v) == emittedEnd)
+            {
+                newCache.push_back(v);
+            }
+        }
+
+        // Update the scores of the vertices that are in the cache, or that have been evicted,
+        // and the scores of their triangles
+        for (size_t i = 0; i < newCache.size(); ++i)
+        {
+            auto v = newCache[i];
+            int position = i < FORSYTH_CACHE_SIZE ? int(i) : -1;
+            cachePosition[v] = position;
+            float score = vertexScore(position, remainingTriangles[v]);
+            float delta = score - vertexScores[v];
+            vertexScores[v] = score;
+
+            auto begin = vertexTriangles.begin() + triangleOffsets[v];
+            for (auto it = begin; it != begin + remainingTriangles[v]; ++it)
+            {
+                triangleScores[*it] += delta;
+            }
+        }
+        if (newCache.size() > FORSYTH_CACHE_SIZE)
+        {
+            newCache.resize(FORSYTH_CACHE_SIZE);
+        }
+
+        // The next triangle is the best one of the triangles that use the cached vertices
+        bestTriangle = -1;
+        float bestScore = -1.0f;
+        for (auto v : newCache)
+        {
+            auto begin = vertexTriangles.begin() + triangleOffsets[v];
+            for (auto it = begin; it != begin + remainingTriangles[v]; ++it)
+            {
+                if (triangleScores[*it] > bestScore)
+                {
+                    bestScore = triangleScores[*it];
+                    bestTriangle = *it;
+                }
+            }
+        }
+
+        std::swap(cache, newCache);
+    }
+
+    std::copy(result.begin(), result.end(), indices);
+}
+
+void MeshOptimizer::optimizeOverdraw(uint32_t* indices, size_t indexCount, const std::vector<Vertex>& vertices, float threshold)
+{
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2)
+    {
+        return;
+    }
+
+    auto globalStatistics = analyzeVertexCache(indices, indexCount, vertices.size(), FIFO_CACHE_SIZE);
+    float maxAcmr = globalStatistics.acmr * threshold;
+
+    // Split the triangles in clusters. Each cluster starts with an empty cache, so it can
+    // be drawn in any order, and it ends as soon as its ACMR is below the threshold
+    std::vector<uint32_t> clusterStarts = { 0 };
+    std::vector<uint32_t> timestamps(vertices.size(), 0);
+    uint32_t timestamp = FIFO_CACHE_SIZE + 1;
+    uint32_t clusterMisses = 0;
+    for (uint32_t t = 0; t < triangleCount; ++t)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            auto v = indices[t * 3 + k];
+            if (timestamp - timestamps[v] > FIFO_CACHE_SIZE)
+            {
+                timestamps[v] = timestamp++;
+                ++clusterMisses;
+            }
+        }
+
+        uint32_t clusterTriangles = t + 1 - clusterStarts.back();
+        if (t + 1 < triangleCount && float(clusterMisses) <= maxAcmr * float(clusterTriangles))
+        {
+            clusterStarts.push_back(t + 1);
+            clusterMisses = 0;
+            // Flush the cache
+            timestamp += FIFO_CACHE_SIZE + 1;
+        }
+    }
+    clusterStarts.push_back(uint32_t(triangleCount));
+
+    if (clusterStarts.size() <= 2)
+    {
+        return;
+    }
+
+    // The clusters that are far from the center and face outwards usually occlude the other
+    // clusters, so they are drawn first
+    auto triangleNormalAndCentroid = [&](uint32_t t, glm::vec3& normal, glm::vec3& centroid) {
+        auto& a = vertices[indices[t * 3]].position();
+        auto& b = vertices[indices[t * 3 + 1]].position();
+        auto& c = vertices[indices[t * 3 + 2]].position();
+        // The length of the normal is twice the triangle area, so it can be used as weight
+        normal = glm::cross(b - a, c - a);
+        centroid = (a + b + c) / 3.0f;
+    };
+
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (uint32_t t = 0; t < triangleCount; ++t)
+    {
+        glm::vec3 normal, centroid;
+        triangleNormalAndCentroid(t, normal, centroid);
+        float area = glm::length(normal);
+        meshCentroid += centroid * area;
+        meshArea += area;
+    }
+    if (meshArea > 0.0f)
+    {
+        meshCentroid /= meshArea;
+    }
+
+    size_t clusterCount = clusterStarts.size() - 1;
+    std::vector<float> sortKeys(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c)
+    {
+        glm::vec3 clusterNormal(0.0f);
+        glm::vec3 clusterCentroid(0.0f);
+        float clusterArea = 0.0f;
+        for (uint32_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t)
+        {
+            glm::vec3 normal, centroid;
+            triangleNormalAndCentroid(t, normal, centroid);
+            float area = glm::length(normal);
+            clusterNormal += normal;
+            clusterCentroid += centroid * area;
+            clusterArea += area;
+        }
+
+        float normalLength = glm::length(clusterNormal);
+        if (clusterArea > 0.0f && normalLength > 0.0f)
+        {
+            clusterCentroid /= clusterArea;
+            sortKeys[c] = glm::dot(clusterCentroid - meshCentroid, clusterNormal / normalLength);
+        }
+        else
+        {
+            sortKeys[c] = 0.0f;
+        }
+    }
+
+    std::vector<uint32_t> clusterOrder(clusterCount);
+    std::iota(clusterOrder.begin(), clusterOrder.end(), 0);
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](uint32_t a, uint32_t b) {
+        return sortKeys[a] > sortKeys[b];
+    });
+
+    std::vector<uint32_t> result;
+    result.reserve(triangleCount * 3);
+    for (auto c : clusterOrder)
+    {
+        result.insert(result.end(), indices + clusterStarts[c] * 3, indices + clusterStarts[c + 1] * 3);
+    }
+    std::copy(result.begin(), result.end(), indices);
+}
+
+void MeshOptimizer::optimizeVertexFetch(std::vector<uint32_t>& indices, std::vector<Vertex>& vertices)
+{
+    constexpr uint32_t unused = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> remap(vertices.size(), unused);
+    std::vector<Vertex> result;
+    result.reserve(vertices.size());
+
+    for (auto& index : indices)
+    {
+        if (remap[index] == unused)
+        {
+            remap[index] = uint32_t(result.size());
+            result.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices.swap(result);
+}
+
+MeshOptimizer::VertexCacheStatistics MeshOptimizer::analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+    VertexCacheStatistics result;
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+    {
+        return result;
+    }
+
+    // A vertex is in the cache if less than cacheSize vertices have been added after it
+    std::vector<uint32_t> timestamps(vertexCount, 0);
+    std::vector<bool> used(vertexCount, false);
+    uint32_t timestamp = cacheSize + 1;
+    uint32_t uniqueVertices = 0;
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+    {
+        auto v = indices[i];
+        if (timestamp - timestamps[v] > cacheSize)
+        {
+            timestamps[v] = timestamp++;
+            ++result.verticesTransformed;
+        }
+        if (!used[v])
+        {
+            used[v] = true;
+            ++uniqueVertices;
+        }
+    }
+
+    result.acmr = float(result.verticesTransformed) / float(triangleCount);
+    result.atvr = float(result.verticesTransformed) / float(uniqueVertices);
+    return result;
+}
+
+MeshOptimizer::OverdrawStatistics MeshOptimizer::analyzeOverdraw(const uint32_t* indices, size_t indexCount, const std::vector<Vertex>& vertices)
+{
+    constexpr int gridSize = 256;
+
+    OverdrawStatistics result;
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+    {
+        return result;
+    }
+
+    glm::vec3 minBounds(std::numeric_limits<float>::max());
+    glm::vec3 maxBounds(std::numeric_limits<float>::lowest());
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+    {
+        minBounds = glm::min(minBounds, vertices[indices[i]].position());
+        maxBounds = glm::max(maxBounds, vertices[indices[i]].position());
+    }
+    auto size = maxBounds - minBounds;
+    float extent = std::max(size.x, std::max(size.y, size.z));
+    if (extent <= 0.0f)
+    {
+        return result;
+    }
+    float scale = float(gridSize) / extent;
+
+    std::vector<float> depthBuffer(gridSize * gridSize);
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        int uAxis = (axis + 1) % 3;
+        int vAxis = (axis + 2) % 3;
+        for (float direction : { 1.0f, -1.0f })
+        {
+            std::fill(depthBuffer.begin(), depthBuffer.end(), std::numeric_limits<float>::max());
+
+            for (size_t t = 0; t < triangleCount; ++t)
+            {
+                // Back face culling, with counter clockwise front faces
+                auto& a = vertices[indices[t * 3]].position();
+                auto& b = vertices[indices[t * 3 + 1]].position();
+                auto& c = vertices[indices[t * 3 + 2]].position();
+                if (glm::cross(b - a, c - a)[axis] * direction <= 0.0f)
+                {
+                    continue;
+                }
+
+                glm::vec3 p[3];
+                for (int k = 0; k < 3; ++k)
+                {
+                    auto& pos = vertices[indices[t * 3 + k]].position();
+                    p[k] = glm::vec3(
+                        (pos[uAxis] - minBounds[uAxis]) * scale,
+                        (pos[vAxis] - minBounds[vAxis]) * scale,
+                        // The closest fragments have the smallest depth
+                        -direction * pos[axis]
+                    );
+                }
+
+                auto edge = [](const glm::vec3& a, const glm::vec3& b, float x, float y) {
+                    return (b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x);
+                };
+                float area = edge(p[0], p[1], p[2].x, p[2].y);
+                if (std::abs(area) < 1e-8f)
+                {
+                    continue;
+                }
+                // The projection flips the winding of some of the views
+                float sign = area > 0.0f ? 1.0f : -1.0f;
+
+                int minX = std::max(int(std::floor(std::min({ p[0].x, p[1].x, p[2].x }))), 0);
+                int maxX = std::min(int(std::ceil(std::max({ p[0].x, p[1].x, p[2].x }))), gridSize - 1);
+                int minY = std::max(int(std::floor(std::min({ p[0].y, p[1].y, p[2].y }))), 0);
+                int maxY = std::min(int(std::ceil(std::max({ p[0].y, p[1].y, p[2].y }))), gridSize - 1);
+                for (int y = minY; y <= maxY; ++y)
+                {
+                    for (int x = minX; x <= maxX; ++x)
+                    {
+                        float px = float(x) + 0.5f;
+                        float py = float(y) + 0.5f;
+                        float w0 = edge(p[1], p[2], px, py) * sign;
+                        float w1 = edge(p[2], p[0], px, py) * sign;
+                        float w2 = edge(p[0], p[1], px, py) * sign;
+                        if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+                        {
+                            continue;
+                        }
+
+                        float depth = (w0 * p[0].z + w1 * p[1].z + w2 * p[2].z) / (area * sign);
+                        float& stored = depthBuffer[y * gridSize + x];
+                        if (depth < stored)
+                        {
+                            stored = depth;
+                            ++result.pixelsShaded;
+                        }
+                    }
+                }
+            }
+
+            for (auto depth : depthBuffer)
+            {
+                if (depth != std::numeric_limits<float>::max())
+                {
+                    ++result.pixelsCovered;
+                }
+            }
+        }
+    }
+
+    result.overdraw = result.pixelsCovered > 0 ? float(result.pixelsShaded) / float(result.pixelsCovered) : 0.0f;
+    return result;
+}
+
+}
+}
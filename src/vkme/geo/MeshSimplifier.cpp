@@ -0,0 +1,422 @@
+#include <vkme/geo/MeshSimplifier.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace vkme {
+namespace geo {
+
+// Weight of the planes that keep the open borders in place, relative to the triangle planes
+constexpr float BORDER_WEIGHT = 10.0f;
+
+// Minimum cosine of the angle between the normal of a triangle before and after a collapse. The
+// collapses that rotate a triangle more than that are rejected, to avoid folds
+constexpr float MIN_FLIP_COSINE = 0.2f;
+
+enum class VertexKind : uint8_t
+{
+    Manifold,
+    // Vertex of an open border. It only collapses along the border
+    Border,
+    // Attribute seam, non manifold or complex border vertex. It never moves
+    Locked
+};
+
+// Sum of the squared distances to a set of weighted planes
+struct Quadric
+{
+    // Symmetric matrix: a2 ab ac ad b2 bc bd c2 cd d2
+    double m[10] = {};
+    double weight = 0.0;
+
+    static Quadric fromPlane(const glm::vec3& normal, float distance, float weight)
+    {
+        double a = normal.x, b = normal.y, c = normal.z, d = distance, w = weight;
+        Quadric result;
+        result.m[0] = w * a * a; result.m[1] = w * a * b; result.m[2] = w * a * c; result.m[3] = w * a * d;
+        result.m[4] = w * b * b; result.m[5] = w * b * c; result.m[6] = w * b * d;
+        result.m[7] = w * c * c; result.m[8] = w * c * d;
+        result.m[9] = w * d * d;
+        result.weight = w;
+        return result;
+    }
+
+    Quadric& operator+=(const Quadric& other)
+    {
+        for (int i = 0; i < 10; ++i)
+        {
+            m[i] += other.m[i];
+        }
+        weight += other.weight;
+        return *this;
+    }
+
+    // Weighted mean of the squared distances from the point to the planes
+    float error(const glm::vec3& p) const
+    {
+        if (weight <= 0.0)
+        {
+            return 0.0f;
+        }
+        double x = p.x, y = p.y, z = p.z;
+        double result =
+            m[0] * x * x + m[4] * y * y + m[7] * z * z +
+            2.0 * (m[1] * x * y + m[2] * x * z + m[5] * y * z) +
+            2.0 * (m[3] * x + m[6] * y + m[8] * z) +
+            m[9];
+        return float(std::max(result, 0.0) / weight);
+    }
+};
+
+// Exact position, used to find the copies of the vertices. The bits are compared, so 0 and -0
+// are different positions, but the hash is consistent with the comparison
+struct PositionKey
+{
+    uint32_t bits[3];
+
+    explicit PositionKey(const glm::vec3& position) { memcpy(bits, &position, sizeof(bits)); }
+
+    bool operator==(const PositionKey& other) const { return memcmp(bits, other.bits, sizeof(bits)) == 0; }
+};
+
+struct PositionKeyHash
+{
+    size_t operator()(const PositionKey& key) const
+    {
+        return size_t(key.bits[0]) * 73856093u ^ size_t(key.bits[1]) * 19349663u ^ size_t(key.bits[2]) * 83492791u;
+    }
+};
+
+static uint64_t edgeKey(uint32_t a, uint32_t b)
+{
+    return (uint64_t(a) << 32) | b;
+}
+
+std::vector<uint32_t> MeshSimplifier::simplify(
+    const uint32_t* indices,
+    size_t indexCount,
+    const std::vector<Vertex>& vertices,
+    size_t targetIndexCount,
+    float targetError,
+    float* resultError
+) {
+    if (resultError)
+    {
+        *resultError = 0.0f;
+    }
+
+    // The simplification works with the vertices used by the range, with local indices
+    std::vector<uint32_t> localVertices(indices, indices + indexCount);
+    std::sort(localVertices.begin(), localVertices.end());
+    localVertices.erase(std::unique(localVertices.begin(), localVertices.end()), localVertices.end());
+    uint32_t vertexCount = uint32_t(localVertices.size());
+
+    // Positions relative to the bounds, so the errors do not depend on the size of the mesh
+    glm::vec3 minPosition(std::numeric_limits<float>::max());
+    glm::vec3 maxPosition(std::numeric_limits<float>::lowest());
+    for (auto v : localVertices)
+    {
+        minPosition = glm::min(minPosition, vertices[v].position());
+        maxPosition = glm::max(maxPosition, vertices[v].position());
+    }
+    auto size = maxPosition - minPosition;
+    float extent = std::max(std::max(size.x, size.y), size.z);
+    if (vertexCount == 0 || extent <= 0.0f)
+    {
+        extent = 1.0f;
+    }
+    std::vector<glm::vec3> positions(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; ++v)
+    {
+        positions[v] = (vertices[localVertices[v]].position() - minPosition) / extent;
+    }
+
+    // The copies of a vertex with different attributes are represented by the first one
+    std::vector<uint32_t> positionRemap(vertexCount);
+    std::vector<uint32_t> wedgeCount(vertexCount, 0);
+    {
+        std::unordered_map<PositionKey, uint32_t, PositionKeyHash> firstVertex;
+        for (uint32_t v = 0; v < vertexCount; ++v)
+        {
+            auto it = firstVertex.emplace(PositionKey(vertices[localVertices[v]].position()), v).first;
+            positionRemap[v] = it->second;
+            ++wedgeCount[it->second];
+        }
+    }
+
+    // Local triangles, without the ones that are degenerate in position
+    std::vector<uint32_t> triangles;
+    triangles.reserve(indexCount);
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        uint32_t t[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            t[k] = uint32_t(std::lower_bound(localVertices.begin(), localVertices.end(), indices[i + k]) - localVertices.begin());
+        }
+        uint32_t r0 = positionRemap[t[0]], r1 = positionRemap[t[1]], r2 = positionRemap[t[2]];
+        if (r0 != r1 && r1 != r2 && r0 != r2)
+        {
+            triangles.insert(triangles.end(), t, t + 3);
+        }
+    }
+
+    // Directed edges between the representative vertices
+    auto buildEdges = [&](std::unordered_map<uint64_t, uint32_t>& edges) {
+        edges.clear();
+        for (size_t i = 0; i < triangles.size(); i += 3)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                ++edges[edgeKey(positionRemap[triangles[i + k]], positionRemap[triangles[i + (k + 1) % 3]])];
+            }
+        }
+    };
+    std::unordered_map<uint64_t, uint32_t> edges;
+    buildEdges(edges);
+
+    std::vector<VertexKind> kind(vertexCount, VertexKind::Manifold);
+    {
+        std::vector<uint32_t> borderOut(vertexCount, 0);
+        std::vector<uint32_t> borderIn(vertexCount, 0);
+        for (auto& edge : edges)
+        {
+            uint32_t a = uint32_t(edge.first >> 32);
+            uint32_t b = uint32_t(edge.first & 0xFFFFFFFF);
+            if (edge.second > 1)
+            {
+                kind[a] = VertexKind::Locked;
+                kind[b] = VertexKind::Locked;
+            }
+            else if (edges.find(edgeKey(b, a)) == edges.end())
+            {
+                ++borderOut[a];
+                ++borderIn[b];
+            }
+        }
+        for (uint32_t v = 0; v < vertexCount; ++v)
+        {
+            if (positionRemap[v] != v || wedgeCount[v] > 1)
+            {
+                kind[v] = VertexKind::Locked;
+            }
+            else if (kind[v] != VertexKind::Locked && (borderOut[v] > 0 || borderIn[v] > 0))
+            {
+                // A border vertex must have one edge to the previous and one to the next border vertex
+                kind[v] = borderOut[v] == 1 && borderIn[v] == 1 ? VertexKind::Border : VertexKind::Locked;
+            }
+        }
+    }
+
+    // Quadrics of the triangle planes weighted by area, and of the planes perpendicular to the borders
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < triangles.size(); i += 3)
+    {
+        uint32_t r[3] = { positionRemap[triangles[i]], positionRemap[triangles[i + 1]], positionRemap[triangles[i + 2]] };
+        auto normal = glm::cross(positions[r[1]] - positions[r[0]], positions[r[2]] - positions[r[0]]);
+        float doubleArea = glm::length(normal);
+        if (doubleArea == 0.0f)
+        {
+            continue;
+        }
+        normal /= doubleArea;
+        auto plane = Quadric::fromPlane(normal, -glm::dot(normal, positions[r[0]]), doubleArea * 0.5f);
+        for (int k = 0; k < 3; ++k)
+        {
+            quadrics[r[k]] += plane;
+
+            uint32_t a = r[k];
+            uint32_t b = r[(k + 1) % 3];
+            if (edges.find(edgeKey(b, a)) == edges.end())
+            {
+                auto edge = positions[b] - positions[a];
+                auto borderNormal = glm::cross(edge, normal);
+                float length = glm::length(borderNormal);
+                if (length > 0.0f)
+                {
+                    borderNormal /= length;
+                    auto borderPlane = Quadric::fromPlane(
+                        borderNormal,
+                        -glm::dot(borderNormal, positions[a]),
+                        glm::dot(edge, edge) * BORDER_WEIGHT
+                    );
+                    quadrics[a] += borderPlane;
+                    quadrics[b] += borderPlane;
+                }
+            }
+        }
+    }
+
+    struct Collapse
+    {
+        uint32_t from;
+        uint32_t to;
+        float error;
+    };
+
+    auto canCollapse = [&](uint32_t from, uint32_t to) {
+        if (kind[from] == VertexKind::Locked || positionRemap[to] == from)
+        {
+            return false;
+        }
+        if (kind[from] == VertexKind::Border)
+        {
+            // Only along the border: the edge does not have an opposite edge
+            uint32_t r = positionRemap[to];
+            bool forward = edges.find(edgeKey(from, r)) != edges.end() && edges.find(edgeKey(r, from)) == edges.end();
+            bool backward = edges.find(edgeKey(r, from)) != edges.end() && edges.find(edgeKey(from, r)) == edges.end();
+            return forward || backward;
+        }
+        return true;
+    };
+
+    float errorLimit = targetError * targetError;
+    float maxError = 0.0f;
+    size_t targetTriangles = targetIndexCount / 3;
+    std::vector<uint32_t> triangleOffsets(vertexCount + 1);
+    std::vector<uint32_t> vertexTriangles;
+    std::vector<uint8_t> passLocked(vertexCount);
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<Collapse> collapses;
+    while (triangles.size() / 3 > targetTriangles)
+    {
+        // Triangles that use each vertex, stored in a single array
+        std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+        for (auto v : triangles)
+        {
+            ++triangleOffsets[v + 1];
+        }
+        std::partial_sum(triangleOffsets.begin(), triangleOffsets.end(), triangleOffsets.begin());
+        vertexTriangles.resize(triangles.size());
+        {
+            std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+            for (size_t i = 0; i < triangles.size(); ++i)
+            {
+                vertexTriangles[fill[triangles[i]]++] = uint32_t(i / 3);
+            }
+        }
+
+        collapses.clear();
+        for (size_t i = 0; i < triangles.size(); i += 3)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                uint32_t a = triangles[i + k];
+                uint32_t b = triangles[i + (k + 1) % 3];
+                if (canCollapse(a, b))
+                {
+                    Quadric q = quadrics[a];
+                    q += quadrics[positionRemap[b]];
+                    collapses.push_back({ a, b, q.error(positions[b]) });
+                }
+                if (canCollapse(b, a))
+                {
+                    Quadric q = quadrics[b];
+                    q += quadrics[positionRemap[a]];
+                    collapses.push_back({ b, a, q.error(positions[a]) });
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+        // The triangles of the collapsed vertices are locked until the next pass, so the
+        // adjacency of the unlocked vertices is still valid
+        std::fill(passLocked.begin(), passLocked.end(), 0);
+        std::iota(remap.begin(), remap.end(), 0);
+        size_t removedTriangles = 0;
+        size_t appliedCollapses = 0;
+        for (auto& collapse : collapses)
+        {
+            if (collapse.error > errorLimit || triangles.size() / 3 - removedTriangles <= targetTriangles)
+            {
+                break;
+            }
+            if (passLocked[collapse.from] || passLocked[collapse.to])
+            {
+                continue;
+            }
+
+            uint32_t target = positionRemap[collapse.to];
+            bool flip = false;
+            for (uint32_t j = triangleOffsets[collapse.from]; j < triangleOffsets[collapse.from + 1] && !flip; ++j)
+            {
+                auto t = &triangles[vertexTriangles[j] * 3];
+                if (positionRemap[t[0]] == target || positionRemap[t[1]] == target || positionRemap[t[2]] == target)
+                {
+                    // The triangle is removed
+                    continue;
+                }
+                glm::vec3 before[3];
+                glm::vec3 after[3];
+                for (int k = 0; k < 3; ++k)
+                {
+                    before[k] = positions[t[k]];
+                    after[k] = t[k] == collapse.from ? positions[collapse.to] : before[k];
+                }
+                auto n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+                auto n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+                flip = glm::dot(n0, n1) < MIN_FLIP_COSINE * glm::length(n0) * glm::length(n1);
+            }
+            if (flip)
+            {
+                continue;
+            }
+
+            remap[collapse.from] = collapse.to;
+            quadrics[target] += quadrics[collapse.from];
+            for (uint32_t j = triangleOffsets[collapse.from]; j < triangleOffsets[collapse.from + 1]; ++j)
+            {
+                auto t = &triangles[vertexTriangles[j] * 3];
+                bool removed = false;
+                for (int k = 0; k < 3; ++k)
+                {
+                    passLocked[t[k]] = 1;
+                    removed = removed || positionRemap[t[k]] == target;
+                }
+                removedTriangles += removed ? 1 : 0;
+            }
+            passLocked[collapse.to] = 1;
+            maxError = std::max(maxError, collapse.error);
+            ++appliedCollapses;
+        }
+        if (appliedCollapses == 0)
+        {
+            break;
+        }
+
+        size_t write = 0;
+        for (size_t i = 0; i < triangles.size(); i += 3)
+        {
+            uint32_t t[3] = { remap[triangles[i]], remap[triangles[i + 1]], remap[triangles[i + 2]] };
+            uint32_t r0 = positionRemap[t[0]], r1 = positionRemap[t[1]], r2 = positionRemap[t[2]];
+            if (r0 != r1 && r1 != r2 && r0 != r2)
+            {
+                triangles[write++] = t[0];
+                triangles[write++] = t[1];
+                triangles[write++] = t[2];
+            }
+        }
+        triangles.resize(write);
+        buildEdges(edges);
+    }
+
+    if (resultError)
+    {
+        *resultError = std::sqrt(maxError) * extent;
+    }
+
+    std::vector<uint32_t> result(triangles.size());
+    for (size_t i = 0; i < triangles.size(); ++i)
+    {
+        result[i] = localVertices[triangles[i]];
+    }
+    return result;
+}
+
+}
+}
@@ -0,0 +1,157 @@
+#include <vkme/geo/Meshlet.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace vkme {
+namespace geo {
+
+// Maximum angle between the normals and the cone axis, as the cosine. With wider cones the cluster
+// is almost never back facing, so the test is disabled
+constexpr float MIN_CONE_COSINE = 0.1f;
+
+static void computeNormalCone(Meshlet& meshlet, const MeshletData& data, const std::vector<Vertex>& vertices)
+{
+    std::vector<glm::vec3> normals;
+    glm::vec3 axis(0.0f);
+    for (uint32_t t = 0; t < meshlet.triangleCount; ++t)
+    {
+        auto triangle = data.triangles[meshlet.triangleOffset + t];
+        auto& v0 = vertices[data.vertices[meshlet.vertexOffset + (triangle & 0xFF)]];
+        auto& v1 = vertices[data.vertices[meshlet.vertexOffset + ((triangle >> 8) & 0xFF)]];
+        auto& v2 = vertices[data.vertices[meshlet.vertexOffset + ((triangle >> 16) & 0xFF)]];
+
+        auto normal = glm::cross(v1.position() - v0.position(), v2.position() - v0.position());
+        float length = glm::length(normal);
+        if (length == 0.0f)
+        {
+            // Degenerate triangles are never rasterized
+            continue;
+        }
+        // The vertex normals point outside, so the cone does not depend on the winding convention
+        if (glm::dot(normal, v0.normal() + v1.normal() + v2.normal()) < 0.0f)
+        {
+            normal = -normal;
+        }
+        normal /= length;
+        normals.push_back(normal);
+        axis += normal;
+    }
+
+    float axisLength = glm::length(axis);
+    if (normals.empty() || axisLength == 0.0f)
+    {
+        return;
+    }
+    axis /= axisLength;
+
+    float minCosine = 1.0f;
+    for (auto& normal : normals)
+    {
+        minCosine = std::min(minCosine, glm::dot(axis, normal));
+    }
+    if (minCosine <= MIN_CONE_COSINE)
+    {
+        return;
+    }
+
+    // The cutoff is the sine of the cone angle: the test is conservative because
+    // sin(a + b) <= sin(a) + sin(b), where b is the angle of the bounding sphere
+    meshlet.coneAxis = axis;
+    meshlet.coneCutoff = std::sqrt(1.0f - minCosine * minCosine);
+}
+
+uint32_t MeshletData::build(const uint32_t* indices, size_t indexCount, const std::vector<Vertex>& vertices)
+{
+    uint32_t firstMeshlet = uint32_t(meshlets.size());
+    if (indexCount < 3)
+    {
+        return firstMeshlet;
+    }
+
+    // Local index of the vertices in the current meshlet
+    constexpr uint32_t notUsed = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> localIndex(vertices.size(), notUsed);
+
+    auto finishMeshlet = [&](Meshlet& meshlet) {
+        for (uint32_t v = 0; v < meshlet.vertexCount; ++v)
+        {
+            localIndex[this->vertices[meshlet.vertexOffset + v]] = notUsed;
+        }
+        meshlet.boundingSphere = BoundingSphere::fromIndexedVertices(
+            this->vertices.data() + meshlet.vertexOffset,
+            meshlet.vertexCount,
+            vertices
+        );
+        computeNormalCone(meshlet, *this, vertices);
+        meshlets.push_back(meshlet);
+    };
+
+    Meshlet meshlet;
+    meshlet.vertexOffset = uint32_t(this->vertices.size());
+    meshlet.triangleOffset = uint32_t(triangles.size());
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        uint32_t newVertices = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            // The repeated vertices of a degenerate triangle are counted once
+            bool repeated = (k > 0 && indices[i + k] == indices[i]) || (k > 1 && indices[i + k] == indices[i + 1]);
+            if (localIndex[indices[i + k]] == notUsed && !repeated)
+            {
+                ++newVertices;
+            }
+        }
+
+        if (meshlet.vertexCount + newVertices > MaxVertices || meshlet.triangleCount + 1u > MaxTriangles)
+        {
+            finishMeshlet(meshlet);
+            meshlet = Meshlet();
+            meshlet.vertexOffset = uint32_t(this->vertices.size());
+            meshlet.triangleOffset = uint32_t(triangles.size());
+            meshlet.firstIndex = uint32_t(i);
+        }
+
+        uint32_t triangle = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            auto& local = localIndex[indices[i + k]];
+            if (local == notUsed)
+            {
+                local = meshlet.vertexCount++;
+                this->vertices.push_back(indices[i + k]);
+            }
+            triangle |= local << (k * 8);
+        }
+        triangles.push_back(triangle);
+        ++meshlet.triangleCount;
+    }
+    finishMeshlet(meshlet);
+
+    return firstMeshlet;
+}
+
+std::vector<uint8_t> MeshletData::encode() const
+{
+    size_t meshletSize = meshlets.size() * sizeof(Meshlet);
+    size_t verticesSize = vertices.size() * sizeof(uint32_t);
+    std::vector<uint8_t> result(meshletSize + verticesSize + triangles.size() * sizeof(uint32_t));
+
+    uint32_t vertexBase = uint32_t(meshletSize / sizeof(uint32_t));
+    uint32_t triangleBase = uint32_t((meshletSize + verticesSize) / sizeof(uint32_t));
+    auto dst = reinterpret_cast<Meshlet*>(result.data());
+    for (size_t i = 0; i < meshlets.size(); ++i)
+    {
+        dst[i] = meshlets[i];
+        dst[i].vertexOffset += vertexBase;
+        dst[i].triangleOffset += triangleBase;
+    }
+    memcpy(result.data() + meshletSize, vertices.data(), verticesSize);
+    memcpy(result.data() + meshletSize + verticesSize, triangles.data(), triangles.size() * sizeof(uint32_t));
+    return result;
+}
+
+}
+}
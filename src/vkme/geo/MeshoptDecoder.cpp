@@ -0,0 +1,578 @@
+#include <vkme/geo/MeshoptDecoder.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+namespace vkme {
+namespace geo {
+
+// The high nibble of the first byte identifies the codec, and the low nibble the version
+constexpr uint8_t VERTEX_HEADER = 0xA0;
+constexpr uint8_t INDEX_HEADER = 0xE0;
+constexpr uint8_t SEQUENCE_HEADER = 0xD0;
+
+constexpr size_t VERTEX_BLOCK_SIZE_BYTES = 8192;
+constexpr size_t VERTEX_BLOCK_MAX_SIZE = 256;
+constexpr size_t BYTE_GROUP_SIZE = 16;
+// Maximum size of an encoded byte group: 8 bytes of 4 bit values, and 16 escaped values
+constexpr size_t BYTE_GROUP_DECODE_LIMIT = 24;
+// The tail is padded to a minimum size, that is different in each version
+constexpr size_t VERTEX_TAIL_MIN_SIZE_V0 = 32;
+constexpr size_t VERTEX_TAIL_MIN_SIZE_V1 = 24;
+
+// Bits per value of the byte group modes. In the version 1 the control byte of each channel
+// selects the modes 0-3 or 1-4 of the table
+constexpr int BYTE_GROUP_BITS_V0[4] = { 0, 2, 4, 8 };
+constexpr int BYTE_GROUP_BITS_V1[5] = { 0, 1, 2, 4, 8 };
+
+// The index codes reference the last 16 edges and vertices
+constexpr size_t FIFO_SIZE = 16;
+// Size of the table of the most common vertex codes, at the end of the triangle stream
+constexpr size_t CODEAUX_TABLE_SIZE = 16;
+constexpr size_t SEQUENCE_TAIL_SIZE = 4;
+
+template <class T>
+static inline T unzigzag(T v)
+{
+    return T(T(0 - (v & 1)) ^ (v >> 1));
+}
+
+static inline uint32_t unzigzag32(uint32_t v)
+{
+    return (v >> 1) ^ uint32_t(-int32_t(v & 1));
+}
+
+static inline uint32_t rotate(uint32_t v, int r)
+{
+    return (v << r) | (v >> ((32 - r) & 31));
+}
+
+// Decodes 16 values with 0, 1, 2, 4 or 8 bits each. The values with all the bits set are escaped,
+// and the real value is stored in the following bytes
+static const uint8_t* decodeBytesGroup(const uint8_t* data, uint8_t* dst, int bits)
+{
+    switch (bits)
+    {
+    case 0:
+        memset(dst, 0, BYTE_GROUP_SIZE);
+        return data;
+    case 8:
+        memcpy(dst, data, BYTE_GROUP_SIZE);
+        return data + BYTE_GROUP_SIZE;
+    default:
+    {
+        const uint32_t escape = (1u << bits) - 1;
+        const uint8_t* extra = data + BYTE_GROUP_SIZE * bits / 8;
+        for (size_t i = 0; i < BYTE_GROUP_SIZE; ++i)
+        {
+            // The first value is in the high bits
+            size_t bitOffset = i * bits;
+            uint32_t value = (data[bitOffset / 8] >> (8 - bits - bitOffset % 8)) & escape;
+            if (value == escape)
+            {
+                value = *extra++;
+            }
+            dst[i] = uint8_t(value);
+        }
+        return extra;
+    }
+    }
+}
+
+static const uint8_t* decodeBytes(const uint8_t* data, const uint8_t* dataEnd, uint8_t* dst, size_t count, const int* bits)
+{
+    // Two bits for each group, with the first group in the low bits
+    size_t headerSize = (count / BYTE_GROUP_SIZE + 3) / 4;
+    if (size_t(dataEnd - data) < headerSize)
+    {
+        return nullptr;
+    }
+    const uint8_t* header = data;
+    data += headerSize;
+
+    for (size_t i = 0; i < count; i += BYTE_GROUP_SIZE)
+    {
+        if (size_t(dataEnd - data) < BYTE_GROUP_DECODE_LIMIT)
+        {
+            return nullptr;
+        }
+        size_t group = i / BYTE_GROUP_SIZE;
+        int mode = (header[group / 4] >> ((group % 4) * 2)) & 3;
+        data = decodeBytesGroup(data, dst + i, bits[mode]);
+    }
+    return data;
+}
+
+// Rebuilds the values of one 4 byte channel from the byte streams. The values of T bytes are
+// stored as zigzag deltas to the previous vertex or, with Xor, rotated and xored with it
+template <class T, bool Xor>
+static void decodeDeltas(const uint8_t* streams, uint8_t* dst, size_t vertexCount, size_t vertexSize, const uint8_t* lastVertex, int rot)
+{
+    for (size_t k = 0; k < 4; k += sizeof(T))
+    {
+        T previous = 0;
+        for (size_t j = 0; j < sizeof(T); ++j)
+        {
+            previous |= T(lastVertex[k + j]) << (8 * j);
+        }
+
+        for (size_t i = 0; i < vertexCount; ++i)
+        {
+            T value = 0;
+            for (size_t j = 0; j < sizeof(T); ++j)
+            {
+                value |= T(streams[i + vertexCount * j]) << (8 * j);
+            }
+            value = Xor ? T(rotate(uint32_t(value), rot)) ^ previous : T(unzigzag(value) + previous);
+
+            for (size_t j = 0; j < sizeof(T); ++j)
+            {
+                dst[i * vertexSize + k + j] = uint8_t(value >> (8 * j));
+            }
+            previous = value;
+        }
+        streams += vertexCount * sizeof(T);
+    }
+}
+
+// The version 1 blocks start with a control byte per channel of 4 bytes, that selects the
+// modes of the byte streams. The channel type of the tail selects how the deltas are applied
+static const uint8_t* decodeVertexBlock(
+    const uint8_t* data,
+    const uint8_t* dataEnd,
+    uint8_t* dst,
+    size_t vertexCount,
+    size_t vertexSize,
+    uint8_t lastVertex[VERTEX_BLOCK_MAX_SIZE],
+    const uint8_t* channels,
+    int version
+) {
+    // The streams of the 4 bytes of a channel. The groups are decoded with the aligned count,
+    // so each stream can write up to the aligned size
+    uint8_t streams[VERTEX_BLOCK_MAX_SIZE * 4];
+    size_t alignedCount = (vertexCount + BYTE_GROUP_SIZE - 1) & ~(BYTE_GROUP_SIZE - 1);
+
+    size_t controlSize = version == 0 ? 0 : vertexSize / 4;
+    if (size_t(dataEnd - data) < controlSize)
+    {
+        return nullptr;
+    }
+    const uint8_t* control = data;
+    data += controlSize;
+
+    for (size_t k = 0; k < vertexSize; k += 4)
+    {
+        uint8_t controlByte = version == 0 ? 0 : control[k / 4];
+        for (size_t j = 0; j < 4; ++j)
+        {
+            int mode = (controlByte >> (j * 2)) & 3;
+            uint8_t* stream = streams + j * vertexCount;
+            if (mode == 3)
+            {
+                // Literal bytes
+                if (size_t(dataEnd - data) < vertexCount)
+                {
+                    return nullptr;
+                }
+                memcpy(stream, data, vertexCount);
+                data += vertexCount;
+            }
+            else if (mode == 2)
+            {
+                // All the deltas are zero
+                memset(stream, 0, vertexCount);
+            }
+            else
+            {
+                const int* bits = version == 0 ? BYTE_GROUP_BITS_V0 : BYTE_GROUP_BITS_V1 + mode;
+                data = decodeBytes(data, dataEnd, stream, alignedCount, bits);
+                if (data == nullptr)
+                {
+                    return nullptr;
+                }
+            }
+        }
+
+        // Byte deltas, 16 bit deltas, or 32 bit xor with the rotation in the high nibble
+        int channel = version == 0 ? 0 : channels[k / 4];
+        switch (channel & 3)
+        {
+        case 0:
+            decodeDeltas<uint8_t, false>(streams, dst + k, vertexCount, vertexSize, lastVertex + k, 0);
+            break;
+        case 1:
+            decodeDeltas<uint16_t, false>(streams, dst + k, vertexCount, vertexSize, lastVertex + k, 0);
+            break;
+        case 2:
+            decodeDeltas<uint32_t, true>(streams, dst + k, vertexCount, vertexSize, lastVertex + k, (32 - (channel >> 4)) & 31);
+            break;
+        default:
+            return nullptr;
+        }
+    }
+    memcpy(lastVertex, dst + (vertexCount - 1) * vertexSize, vertexSize);
+    return data;
+}
+
+bool MeshoptDecoder::decodeVertexBuffer(void* dst, size_t vertexCount, size_t vertexSize, const uint8_t* src, size_t srcSize)
+{
+    if (vertexSize == 0 || vertexSize > VERTEX_BLOCK_MAX_SIZE || vertexSize % 4 != 0)
+    {
+        return false;
+    }
+    if (srcSize < 1 || (src[0] & 0xF0) != VERTEX_HEADER)
+    {
+        return false;
+    }
+    int version = src[0] & 0x0F;
+    if (version > 1)
+    {
+        return false;
+    }
+
+    const uint8_t* data = src + 1;
+    const uint8_t* dataEnd = src + srcSize;
+
+    // The tail contains the channel types in the version 1, and the first vertex used as the
+    // base of the deltas
+    size_t tailSize = vertexSize + (version == 0 ? 0 : vertexSize / 4);
+    size_t tailPaddedSize = std::max(tailSize, version == 0 ? VERTEX_TAIL_MIN_SIZE_V0 : VERTEX_TAIL_MIN_SIZE_V1);
+    if (size_t(dataEnd - data) < tailPaddedSize)
+    {
+        return false;
+    }
+    const uint8_t* tail = dataEnd - tailSize;
+    const uint8_t* channels = version == 0 ? nullptr : tail;
+    uint8_t lastVertex[VERTEX_BLOCK_MAX_SIZE];
+    memcpy(lastVertex, tail + (version == 0 ? 0 : vertexSize / 4), vertexSize);
+
+    size_t blockSize = std::min((VERTEX_BLOCK_SIZE_BYTES / vertexSize) & ~(BYTE_GROUP_SIZE - 1), VERTEX_BLOCK_MAX_SIZE);
+    auto vertexData = static_cast<uint8_t*>(dst);
+    for (size_t offset = 0; offset < vertexCount; offset += blockSize)
+    {
+        size_t count = std::min(blockSize, vertexCount - offset);
+        data = decodeVertexBlock(data, dataEnd, vertexData + offset * vertexSize, count, vertexSize, lastVertex, channels, version);
+        if (data == nullptr)
+        {
+            return false;
+        }
+    }
+    return size_t(dataEnd - data) == tailPaddedSize;
+}
+
+static uint32_t decodeVByte(const uint8_t*& data)
+{
+    uint8_t lead = *data++;
+    if (lead < 128)
+    {
+        return lead;
+    }
+
+    // Up to 5 bytes, with 7 bits each, and the high bit set in all the bytes except the last one
+    uint32_t result = lead & 127;
+    uint32_t shift = 7;
+    for (int i = 0; i < 4; ++i)
+    {
+        uint8_t group = *data++;
+        result |= uint32_t(group & 127) << shift;
+        shift += 7;
+        if (group < 128)
+        {
+            break;
+        }
+    }
+    return result;
+}
+
+static inline uint32_t decodeIndex(const uint8_t*& data, uint32_t last)
+{
+    return last + unzigzag32(decodeVByte(data));
+}
+
+static inline void writeIndex(void* dst, size_t i, size_t indexSize, uint32_t index)
+{
+    if (indexSize == 2)
+    {
+        static_cast<uint16_t*>(dst)[i] = uint16_t(index);
+    }
+    else
+    {
+        static_cast<uint32_t*>(dst)[i] = index;
+    }
+}
+
+// FIFOs of the recently used edges and vertices. The offset is the next position to write
+struct IndexDecoderState
+{
+    uint32_t edges[FIFO_SIZE][2];
+    uint32_t vertices[FIFO_SIZE];
+    size_t edgeOffset = 0;
+    size_t vertexOffset = 0;
+
+    IndexDecoderState()
+    {
+        memset(edges, 0xFF, sizeof(edges));
+        memset(vertices, 0xFF, sizeof(vertices));
+    }
+
+    inline void pushEdge(uint32_t a, uint32_t b)
+    {
+        edges[edgeOffset][0] = a;
+        edges[edgeOffset][1] = b;
+        edgeOffset = (edgeOffset + 1) % FIFO_SIZE;
+    }
+
+    inline void pushVertex(uint32_t v, bool condition = true)
+    {
+        vertices[vertexOffset] = v;
+        vertexOffset = (vertexOffset + (condition ? 1 : 0)) % FIFO_SIZE;
+    }
+
+    // The distance 0 is the last vertex written
+    inline uint32_t vertex(size_t distance) const
+    {
+        return vertices[(vertexOffset - 1 - distance) % FIFO_SIZE];
+    }
+};
+
+bool MeshoptDecoder::decodeIndexBuffer(void* dst, size_t indexCount, size_t indexSize, const uint8_t* src, size_t srcSize)
+{
+    if (indexCount % 3 != 0 || (indexSize != 2 && indexSize != 4))
+    {
+        return false;
+    }
+    if (srcSize < 1 + indexCount / 3 + CODEAUX_TABLE_SIZE || (src[0] & 0xF0) != INDEX_HEADER)
+    {
+        return false;
+    }
+    int version = src[0] & 0x0F;
+    if (version > 1)
+    {
+        return false;
+    }
+
+    IndexDecoderState state;
+    uint32_t next = 0;
+    uint32_t last = 0;
+    // The version 1 uses the vertex codes 13 and 14 for the indices next to the last one
+    int maxFifoVertexCode = version >= 1 ? 13 : 15;
+
+    // One code byte per triangle, followed by the additional data, and the code table
+    const uint8_t* code = src + 1;
+    const uint8_t* data = code + indexCount / 3;
+    const uint8_t* dataSafeEnd = src + srcSize - CODEAUX_TABLE_SIZE;
+    const uint8_t* codeauxTable = dataSafeEnd;
+
+    for (size_t i = 0; i < indexCount; i += 3)
+    {
+        // A triangle reads at most 16 bytes, so it can't exceed the code table
+        if (data > dataSafeEnd)
+        {
+            return false;
+        }
+
+        uint8_t codeTri = *code++;
+        uint32_t a, b, c;
+        if (codeTri < 0xF0)
+        {
+            // The triangle reuses an edge of the FIFO
+            int fe = codeTri >> 4;
+            auto& edge = state.edges[(state.edgeOffset - 1 - fe) % FIFO_SIZE];
+            a = edge[0];
+            b = edge[1];
+
+            int fec = codeTri & 15;
+            if (fec < maxFifoVertexCode)
+            {
+                bool isNext = fec == 0;
+                c = isNext ? next : state.vertex(fec);
+                next += isNext ? 1 : 0;
+                state.pushVertex(c, isNext);
+            }
+            else
+            {
+                // 13 and 14 are -1 and +1 relative to the last free index
+                last = c = fec != 15 ? last + (fec - (fec ^ 3)) : decodeIndex(data, last);
+                state.pushVertex(c);
+            }
+            state.pushEdge(c, b);
+            state.pushEdge(a, c);
+        }
+        else if (codeTri < 0xFE)
+        {
+            // The vertex codes are in the table. The first vertex is always the next one
+            uint8_t codeaux = codeauxTable[codeTri & 15];
+            int feb = codeaux >> 4;
+            int fec = codeaux & 15;
+
+            a = next++;
+            b = feb == 0 ? next : state.vertex(feb - 1);
+            next += feb == 0 ? 1 : 0;
+            c = fec == 0 ? next : state.vertex(fec - 1);
+            next += fec == 0 ? 1 : 0;
+
+            state.pushVertex(a);
+            state.pushVertex(b, feb == 0);
+            state.pushVertex(c, fec == 0);
+            state.pushEdge(b, a);
+            state.pushEdge(c, b);
+            state.pushEdge(a, c);
+        }
+        else
+        {
+            // The vertex codes are in the data stream
+            uint8_t codeaux = *data++;
+            int fea = codeTri == 0xFE ? 0 : 15;
+            int feb = codeaux >> 4;
+            int fec = codeaux & 15;
+
+            if (codeaux == 0)
+            {
+                next = 0;
+            }
+
+            a = fea == 0 ? next++ : 0;
+            b = feb == 0 ? next++ : state.vertex(feb - 1);
+            c = fec == 0 ? next++ : state.vertex(fec - 1);
+
+            if (fea == 15) last = a = decodeIndex(data, last);
+            if (feb == 15) last = b = decodeIndex(data, last);
+            if (fec == 15) last = c = decodeIndex(data, last);
+
+            state.pushVertex(a);
+            state.pushVertex(b, feb == 0 || feb == 15);
+            state.pushVertex(c, fec == 0 || fec == 15);
+            state.pushEdge(b, a);
+            state.pushEdge(c, b);
+            state.pushEdge(a, c);
+        }
+
+        writeIndex(dst, i, indexSize, a);
+        writeIndex(dst, i + 1, indexSize, b);
+        writeIndex(dst, i + 2, indexSize, c);
+    }
+
+    // All the data must be used, up to the code table
+    return data == dataSafeEnd;
+}
+
+bool MeshoptDecoder::decodeIndexSequence(void* dst, size_t indexCount, size_t indexSize, const uint8_t* src, size_t srcSize)
+{
+    if (indexSize != 2 && indexSize != 4)
+    {
+        return false;
+    }
+    if (srcSize < 1 + indexCount + SEQUENCE_TAIL_SIZE || (src[0] & 0xF0) != SEQUENCE_HEADER || (src[0] & 0x0F) > 1)
+    {
+        return false;
+    }
+
+    const uint8_t* data = src + 1;
+    const uint8_t* dataSafeEnd = src + srcSize - SEQUENCE_TAIL_SIZE;
+    uint32_t last[2] = { 0, 0 };
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        if (data >= dataSafeEnd)
+        {
+            return false;
+        }
+
+        // The low bit selects the baseline, and the rest is the zigzag encoded delta
+        uint32_t v = decodeVByte(data);
+        uint32_t baseline = v & 1;
+        uint32_t index = last[baseline] + unzigzag32(v >> 1);
+        last[baseline] = index;
+        writeIndex(dst, i, indexSize, index);
+    }
+    return data == dataSafeEnd;
+}
+
+template <class T>
+static void filterOctahedralComponents(T* data, size_t count)
+{
+    const float maxValue = float((1 << (sizeof(T) * 8 - 1)) - 1);
+    for (size_t i = 0; i < count; ++i)
+    {
+        // The z component stores the value of 1.0, so the result keeps the same precision
+        float x = float(data[i * 4]);
+        float y = float(data[i * 4 + 1]);
+        float z = float(data[i * 4 + 2]) - std::fabs(x) - std::fabs(y);
+
+        // Unfold the lower hemisphere
+        float t = std::min(z, 0.0f);
+        x += x >= 0.0f ? t : -t;
+        y += y >= 0.0f ? t : -t;
+
+        float scale = maxValue / std::sqrt(x * x + y * y + z * z);
+        data[i * 4] = T(std::lround(x * scale));
+        data[i * 4 + 1] = T(std::lround(y * scale));
+        data[i * 4 + 2] = T(std::lround(z * scale));
+    }
+}
+
+void MeshoptDecoder::filterOctahedral(void* data, size_t count, size_t stride)
+{
+    if (stride == 4)
+    {
+        filterOctahedralComponents(static_cast<int8_t*>(data), count);
+    }
+    else if (stride == 8)
+    {
+        filterOctahedralComponents(static_cast<int16_t*>(data), count);
+    }
+}
+
+void MeshoptDecoder::filterQuaternion(void* data, size_t count, size_t stride)
+{
+    if (stride != 8)
+    {
+        return;
+    }
+
+    auto components = static_cast<int16_t*>(data);
+    const float scale = 1.0f / std::sqrt(2.0f);
+    for (size_t i = 0; i < count; ++i)
+    {
+        int16_t* q = components + i * 4;
+
+        // The last component stores the range of the others in the high bits, and the index of
+        // the omitted component in the two low bits
+        float range = scale / float(q[3] | 3);
+        float x = float(q[0]) * range;
+        float y = float(q[1]) * range;
+        float z = float(q[2]) * range;
+        float w = std::sqrt(std::max(1.0f - x * x - y * y - z * z, 0.0f));
+
+        int omitted = q[3] & 3;
+        int16_t xi = int16_t(std::lround(x * 32767.0f));
+        int16_t yi = int16_t(std::lround(y * 32767.0f));
+        int16_t zi = int16_t(std::lround(z * 32767.0f));
+        int16_t wi = int16_t(std::lround(w * 32767.0f));
+        q[(omitted + 1) & 3] = xi;
+        q[(omitted + 2) & 3] = yi;
+        q[(omitted + 3) & 3] = zi;
+        q[omitted] = wi;
+    }
+}
+
+void MeshoptDecoder::filterExponential(void* data, size_t count, size_t stride)
+{
+    auto values = static_cast<uint32_t*>(data);
+    for (size_t i = 0; i < count * stride / 4; ++i)
+    {
+        // Signed 24 bit mantissa and signed 8 bit exponent
+        int32_t mantissa = int32_t(values[i] << 8) >> 8;
+        int32_t exponent = int32_t(values[i]) >> 24;
+
+        // ldexp(mantissa, exponent), with the power of two built directly
+        uint32_t powerBits = uint32_t(exponent + 127) << 23;
+        float power;
+        memcpy(&power, &powerBits, sizeof(power));
+        float result = power * float(mantissa);
+        memcpy(&values[i], &result, sizeof(result));
+    }
+}
+
+}
+}
@@ -1,5 +1,12 @@
 
 #include <vkme/geo/Model.hpp>
+#include <vkme/geo/MeshOptimizer.hpp>
+#include <vkme/geo/MeshSimplifier.hpp>
+#include <vkme/geo/MeshCache.hpp>
+#include <vkme/geo/GltfAccessorReader.hpp>
+#include <vkme/geo/MeshoptDecoder.hpp>
+#include <vkme/tools/MappedFile.hpp>
+#include <vkme/tools/ThreadPool.hpp>
 
 #include "stb_image.h"
 #include <iostream>
@@ -16,25 +23,284 @@
 #include <tiny_obj_loader.h>
 
 #include <fstream>
+#include <sstream>
+#include <iterator>
+#include <unordered_map>
+#include <algorithm>
 
 
 namespace vkme {
 namespace geo {
 
-std::vector<std::shared_ptr<Model>> Model::loadGltf(VulkanData* vulkanData, const std::filesystem::path& filePath, bool overrideColors)
+// Each level has half the triangles of the previous one. The simplification stops at this size,
+// or if it can't remove at least a tenth of the triangles of the previous level. The limits are
+// low, so the meshes of a few hundred triangles still have four or more levels
+constexpr size_t MIN_LOD_TRIANGLES = 16;
+constexpr float MIN_LOD_REDUCTION = 0.9f;
+
+// Maximum error of each simplification step, relative to the size of the surface. The coarse
+// levels can have large errors, because they are only selected if the error is small on screen
+constexpr float MAX_LOD_STEP_ERROR = 0.25f;
+
+std::vector<std::shared_ptr<Model>> Model::loadGltf(
+    VulkanData* vulkanData,
+    const std::filesystem::path& filePath,
+    bool overrideColors,
+    VertexFormat vertexFormat,
+    bool positionStream,
+    const ImportOptions& importOptions
+) {
+    std::vector<MeshCache::Instance> instances;
+    return importGltf(vulkanData, filePath, overrideColors, vertexFormat, positionStream, importOptions, instances);
+}
+
+std::vector<std::shared_ptr<Model>> Model::loadGltfScene(
+    VulkanData* vulkanData,
+    const std::filesystem::path& filePath,
+    bool overrideColors,
+    VertexFormat vertexFormat,
+    bool positionStream,
+    const ImportOptions& importOptions
+) {
+    std::vector<MeshCache::Instance> instances;
+    auto meshes = importGltf(vulkanData, filePath, overrideColors, vertexFormat, positionStream, importOptions, instances);
+
+    std::vector<std::shared_ptr<Model>> result;
+    result.reserve(instances.size());
+    for (auto& instance : instances)
+    {
+        result.push_back(meshes[instance.meshIndex]->createInstance(instance.transform));
+    }
+    return result;
+}
+
+static glm::mat4 gltfNodeTransform(const fastgltf::Node& node)
 {
+    if (auto trs = std::get_if<fastgltf::Node::TRS>(&node.transform))
+    {
+        // The glTF quaternions are stored as x, y, z, w
+        glm::vec3 translation(trs->translation[0], trs->translation[1], trs->translation[2]);
+        glm::quat rotation(trs->rotation[3], trs->rotation[0], trs->rotation[1], trs->rotation[2]);
+        glm::vec3 scale(trs->scale[0], trs->scale[1], trs->scale[2]);
+        return glm::translate(glm::mat4(1.0f), translation) * glm::toMat4(rotation) * glm::scale(glm::mat4(1.0f), scale);
+    }
+
+    // Column major, the same as glm
+    glm::mat4 result;
+    auto& matrix = std::get<fastgltf::Node::TransformMatrix>(node.transform);
+    for (int c = 0; c < 4; ++c)
+    {
+        result[c] = glm::vec4(matrix[c * 4], matrix[c * 4 + 1], matrix[c * 4 + 2], matrix[c * 4 + 3]);
+    }
+    return result;
+}
+
+// Maps the external files of the buffers, and replaces their URI sources with views of the
+// mapped data. The files must stay open while the asset is used
+static void mapExternalBuffers(
+    fastgltf::Asset& gltf,
+    const std::filesystem::path& directory,
+    std::vector<std::unique_ptr<tools::MappedFile>>& files
+) {
+    for (auto& buffer : gltf.buffers)
+    {
+        auto uri = std::get_if<fastgltf::sources::URI>(&buffer.data);
+        if (uri == nullptr)
+        {
+            continue;
+        }
+
+        auto path = directory / uri->uri.fspath();
+        auto file = std::make_unique<tools::MappedFile>();
+        if (!uri->uri.isLocalPath() || !file->open(path.string()) ||
+            uri->fileByteOffset > file->size() || buffer.byteLength > file->size() - uri->fileByteOffset)
+        {
+            throw std::runtime_error(std::string("Error loading GLTF buffer at path: ") + path.string());
+        }
+
+        fastgltf::sources::ByteView view;
+        view.bytes = fastgltf::span<const std::byte>(
+            reinterpret_cast<const std::byte*>(file->data() + uri->fileByteOffset),
+            buffer.byteLength
+        );
+        view.mimeType = uri->mimeType;
+        buffer.data = view;
+        files.push_back(std::move(file));
+    }
+}
+
+// Decodes the buffer views compressed with EXT_meshopt_compression, in parallel. Each decoded
+// view is stored in a new buffer, and the view is updated to reference it, so the accessors
+// are read in the same way as the uncompressed ones
+static void decodeMeshoptBuffers(fastgltf::Asset& gltf)
+{
+    std::vector<size_t> compressedViews;
+    for (size_t i = 0; i < gltf.bufferViews.size(); ++i)
+    {
+        if (gltf.bufferViews[i].meshoptCompression)
+        {
+            compressedViews.push_back(i);
+        }
+    }
+    if (compressedViews.empty())
+    {
+        return;
+    }
+
+    std::vector<std::vector<uint8_t>> decodedViews(compressedViews.size());
+    tools::ThreadPool::shared().parallelFor(compressedViews.size(), [&](size_t i) {
+        auto& compression = *gltf.bufferViews[compressedViews[i]].meshoptCompression;
+        auto source = reinterpret_cast<const uint8_t*>(fastgltf::DefaultBufferDataAdapter()(gltf.buffers[compression.bufferIndex]));
+        if (source == nullptr || compression.byteOffset + compression.byteLength > gltf.buffers[compression.bufferIndex].byteLength)
+        {
+            throw std::runtime_error("Error decoding GLTF buffer view: the compressed data is not loaded");
+        }
+        source += compression.byteOffset;
+
+        auto& decoded = decodedViews[i];
+        decoded.resize(compression.count * compression.byteStride);
+        bool valid = false;
+        switch (compression.mode)
+        {
+        case fastgltf::MeshoptCompressionMode::Attributes:
+            valid = MeshoptDecoder::decodeVertexBuffer(decoded.data(), compression.count, compression.byteStride, source, compression.byteLength);
+            break;
+        case fastgltf::MeshoptCompressionMode::Triangles:
+            valid = MeshoptDecoder::decodeIndexBuffer(decoded.data(), compression.count, compression.byteStride, source, compression.byteLength);
+            break;
+        case fastgltf::MeshoptCompressionMode::Indices:
+            valid = MeshoptDecoder::decodeIndexSequence(decoded.data(), compression.count, compression.byteStride, source, compression.byteLength);
+            break;
+        default:
+            break;
+        }
+        if (!valid)
+        {
+            throw std::runtime_error("Error decoding GLTF buffer view: invalid meshopt compressed data");
+        }
+
+        switch (compression.filter)
+        {
+        case fastgltf::MeshoptCompressionFilter::Octahedral:
+            MeshoptDecoder::filterOctahedral(decoded.data(), compression.count, compression.byteStride);
+            break;
+        case fastgltf::MeshoptCompressionFilter::Quaternion:
+            MeshoptDecoder::filterQuaternion(decoded.data(), compression.count, compression.byteStride);
+            break;
+        case fastgltf::MeshoptCompressionFilter::Exponential:
+            MeshoptDecoder::filterExponential(decoded.data(), compression.count, compression.byteStride);
+            break;
+        default:
+            break;
+        }
+    });
+
+    for (size_t i = 0; i < compressedViews.size(); ++i)
+    {
+        auto& bufferView = gltf.bufferViews[compressedViews[i]];
+        fastgltf::Buffer buffer;
+        buffer.byteLength = decodedViews[i].size();
+        buffer.data = fastgltf::sources::Vector { std::move(decodedViews[i]), fastgltf::MimeType::None };
+        gltf.buffers.push_back(std::move(buffer));
+
+        bufferView.bufferIndex = gltf.buffers.size() - 1;
+        bufferView.byteOffset = 0;
+        bufferView.byteLength = gltf.buffers.back().byteLength;
+        bufferView.meshoptCompression.reset();
+    }
+}
+
+// Collects the mesh instances of the default scene. If the file has no scenes, all the root nodes are used
+static std::vector<MeshCache::Instance> gltfInstances(const fastgltf::Asset& gltf)
+{
+    std::vector<size_t> rootNodes;
+    if (!gltf.scenes.empty())
+    {
+        size_t sceneIndex = gltf.defaultScene.has_value() ? gltf.defaultScene.value() : 0;
+        auto& scene = gltf.scenes[std::min(sceneIndex, gltf.scenes.size() - 1)];
+        rootNodes.assign(scene.nodeIndices.begin(), scene.nodeIndices.end());
+    }
+    else
+    {
+        std::vector<bool> isChild(gltf.nodes.size(), false);
+        for (auto& node : gltf.nodes)
+        {
+            for (auto child : node.children)
+            {
+                if (child < isChild.size())
+                {
+                    isChild[child] = true;
+                }
+            }
+        }
+        for (size_t i = 0; i < gltf.nodes.size(); ++i)
+        {
+            if (!isChild[i])
+            {
+                rootNodes.push_back(i);
+            }
+        }
+    }
+
+    // The node hierarchy is a tree, but the visited flags protect from malformed files
+    std::vector<MeshCache::Instance> instances;
+    std::vector<bool> visited(gltf.nodes.size(), false);
+    std::vector<std::pair<size_t, glm::mat4>> pending;
+    for (auto it = rootNodes.rbegin(); it != rootNodes.rend(); ++it)
+    {
+        pending.push_back({ *it, glm::mat4(1.0f) });
+    }
+    while (!pending.empty())
+    {
+        auto [nodeIndex, parentTransform] = pending.back();
+        pending.pop_back();
+        if (nodeIndex >= gltf.nodes.size() || visited[nodeIndex])
+        {
+            continue;
+        }
+        visited[nodeIndex] = true;
+
+        auto& node = gltf.nodes[nodeIndex];
+        auto transform = parentTransform * gltfNodeTransform(node);
+        if (node.meshIndex.has_value() && node.meshIndex.value() < gltf.meshes.size())
+        {
+            instances.push_back({ uint32_t(node.meshIndex.value()), transform });
+        }
+        for (auto it = node.children.rbegin(); it != node.children.rend(); ++it)
+        {
+            pending.push_back({ *it, transform });
+        }
+    }
+    return instances;
+}
+
+std::vector<std::shared_ptr<Model>> Model::importGltf(
+    VulkanData* vulkanData,
+    const std::filesystem::path& filePath,
+    bool overrideColors,
+    VertexFormat vertexFormat,
+    bool positionStream,
+    const ImportOptions& importOptions,
+    std::vector<MeshCache::Instance>& instances
+) {
     std::cout << "Loading GLTF model file " << filePath << std::endl;
-    
+
+    tools::MappedFile file;
+    if (!file.open(filePath.string()))
+    {
+        throw std::runtime_error(std::string("Error loading GLTF file at path: ") + filePath.string());
+    }
+
     fastgltf::GltfDataBuffer data;
-    data.loadFromFile(filePath);
+    data.copyBytes(file.data(), file.size());
     
-    constexpr auto gltfOptions = fastgltf::Options::LoadGLBBuffers |
-        fastgltf::Options::LoadExternalBuffers;
-        
+    // The buffers are not loaded by the parser: the GLB buffer is read from the data buffer, and
+    // the external buffers are mapped, because their contents are also part of the cache key
     fastgltf::Asset gltf;
-    fastgltf::Parser parser;
+    // The meshopt compressed assets usually also use the quantized vertex attributes
+    fastgltf::Parser parser(fastgltf::Extensions::EXT_meshopt_compression | fastgltf::Extensions::KHR_mesh_quantization);
     
-    auto load = parser.loadBinaryGLTF(&data, filePath.parent_path(), gltfOptions);
+    auto load = parser.loadBinaryGLTF(&data, filePath.parent_path(), fastgltf::Options::None);
     if (load)
     {
         gltf = std::move(load.get());
@@ -42,22 +308,44 @@ std::vector<std::shared_ptr<Model>> Model::loadGltf(VulkanData* vulkanData, cons
     else {
         throw std::runtime_error(std::string("Error loading GLTF file at path: ") + filePath.string());
     }
+    std::vector<std::unique_ptr<tools::MappedFile>> externalBuffers;
+    mapExternalBuffers(gltf, filePath.parent_path(), externalBuffers);
+
+    // The file and the external buffers identify the meshes
+    MeshCache::KeyBuilder keyBuilder;
+    keyBuilder.add("gltf")
+        .add(file.data(), file.size());
+    for (auto& buffer : externalBuffers)
+    {
+        keyBuilder.addValue(uint64_t(buffer->size()))
+            .add(buffer->data(), buffer->size());
+    }
+    keyBuilder.addValue(overrideColors)
+        .addValue(vertexFormat)
+        .addValue(positionStream)
+        .addValue(importOptions.lods)
+        .addValue(importOptions.meshlets)
+        .addValue(importOptions.optimize);
+    auto cacheKey = keyBuilder.key();
+    file.close();
+
+    std::vector<std::shared_ptr<Model>> meshes;
+    if (loadCachedMeshes(vulkanData, cacheKey, meshes, &instances))
+    {
+        return meshes;
+    }
     
+    decodeMeshoptBuffers(gltf);
     
-    std::vector<std::shared_ptr<Model>> meshes;
-
-    // use the same vectors for all meshes so that the memory doesnt reallocate as
-    // often
-    std::vector<uint32_t> indices;
-    std::vector<Vertex> vertices;
-    for (fastgltf::Mesh& mesh : gltf.meshes) {
-        Model newMesh;
-
-        newMesh._name = mesh.name;
-
-        // clear the mesh arrays each mesh, we dont want to merge them by error
-        indices.clear();
-        vertices.clear();
+    // The meshes are decoded, optimized and encoded in parallel. The asset is only read, so it
+    // can be shared by all the threads
+    std::vector<MeshCache::Mesh> cacheMeshes(gltf.meshes.size());
+    tools::ThreadPool::shared().parallelFor(gltf.meshes.size(), [&](size_t meshIndex) {
+        fastgltf::Mesh& mesh = gltf.meshes[meshIndex];
+        std::string meshName(mesh.name.begin(), mesh.name.end());
+        std::vector<uint32_t> indices;
+        std::vector<Vertex> vertices;
+        std::vector<GeoSurface> surfaces;
 
         for (auto&& p : mesh.primitives) {
             GeoSurface newSurface;
@@ -69,60 +357,35 @@ std::vector<std::shared_ptr<Model>> Model::loadGltf(VulkanData* vulkanData, cons
             // load indexes
             {
                 fastgltf::Accessor& indexaccessor = gltf.accessors[p.indicesAccessor.value()];
-                indices.reserve(indices.size() + indexaccessor.count);
-
-                fastgltf::iterateAccessor<std::uint32_t>(gltf, indexaccessor,
-                    [&](std::uint32_t idx) {
-                        indices.push_back(uint32_t(idx + initialVertexIndex));
-                    });
+                indices.resize(indices.size() + indexaccessor.count);
+                GltfAccessorReader::readIndices(gltf, indexaccessor, uint32_t(initialVertexIndex), indices.data() + newSurface.startIndex);
             }
 
-            // load vertex positions
-            {
-                fastgltf::Accessor& posAccessor = gltf.accessors[p.findAttribute("POSITION")->second];
-                vertices.resize(vertices.size() + posAccessor.count);
-
-                fastgltf::iterateAccessorWithIndex<glm::vec3>(gltf, posAccessor,
-                    [&](glm::vec3 v, size_t index) {
-                        Vertex vertex;
-                        vertex.setPosition(v);
-                        vertex.setNormal({ 1, 0, 0 });
-                        vertex.setColor(glm::vec4 { 1.f });
-                        vertex.setUv1({ 0, 0 });
-                        vertices[initialVertexIndex + index] = vertex;
-                    });
-            }
+            // load vertex positions. The other attributes are optional, so the defaults are set first.
+            // The attributes are written directly to the vertices, so they must have the same count
+            fastgltf::Accessor& posAccessor = gltf.accessors[p.findAttribute("POSITION")->second];
+            vertices.resize(vertices.size() + posAccessor.count, Vertex(glm::vec3(0.0f), { 1, 0, 0 }, { 0, 0 }, glm::vec4 { 1.f }));
+            Vertex* primitiveVertices = vertices.data() + initialVertexIndex;
+            GltfAccessorReader::readPositions(gltf, posAccessor, primitiveVertices);
 
             // load vertex normals
             auto normals = p.findAttribute("NORMAL");
-            if (normals != p.attributes.end()) {
-
-                fastgltf::iterateAccessorWithIndex<glm::vec3>(gltf, gltf.accessors[(*normals).second],
-                    [&](glm::vec3 n, size_t index) {
-                        vertices[initialVertexIndex + index].setNormal(n);
-                    });
+            if (normals != p.attributes.end() && gltf.accessors[(*normals).second].count == posAccessor.count) {
+                GltfAccessorReader::readNormals(gltf, gltf.accessors[(*normals).second], primitiveVertices);
             }
 
             // load UVs
             auto uv = p.findAttribute("TEXCOORD_0");
-            if (uv != p.attributes.end()) {
-
-                fastgltf::iterateAccessorWithIndex<glm::vec2>(gltf, gltf.accessors[(*uv).second],
-                    [&](glm::vec2 v, size_t index) {
-                        vertices[initialVertexIndex + index].setUv1(v);
-                    });
+            if (uv != p.attributes.end() && gltf.accessors[(*uv).second].count == posAccessor.count) {
+                GltfAccessorReader::readUvs(gltf, gltf.accessors[(*uv).second], primitiveVertices);
             }
 
             // load vertex colors
             auto colors = p.findAttribute("COLOR_0");
-            if (colors != p.attributes.end()) {
-
-                fastgltf::iterateAccessorWithIndex<glm::vec4>(gltf, gltf.accessors[(*colors).second],
-                    [&](glm::vec4 c, size_t index) {
-                        vertices[initialVertexIndex + index].setColor(c);
-                    });
+            if (colors != p.attributes.end() && gltf.accessors[(*colors).second].count == posAccessor.count) {
+                GltfAccessorReader::readColors(gltf, gltf.accessors[(*colors).second], primitiveVertices);
             }
-            newMesh._surfaces.push_back(newSurface);
+            surfaces.push_back(newSurface);
         }
 
         // display the vertex normals
@@ -131,18 +394,37 @@ std::vector<std::shared_ptr<Model>> Model::loadGltf(VulkanData* vulkanData, cons
                 vtx.setColor(glm::vec4(vtx.normal(), 1.f));
             }
         }
-        newMesh._meshBuffers = std::unique_ptr<MeshBuffers>(MeshBuffers::uploadMesh(vulkanData, indices, vertices));
-
-        meshes.emplace_back(std::make_shared<Model>(std::move(newMesh)));
-    }
+        if (importOptions.optimize)
+        {
+            optimizeMesh(indices, vertices, surfaces);
+        }
+        updateSurfaceBounds(indices, vertices, surfaces);
+        if (importOptions.lods)
+        {
+            buildLods(indices, vertices, surfaces);
+        }
+        auto encodedMesh = EncodedMesh::encode(indices, vertices, vertexFormat, positionStream);
+        if (importOptions.meshlets)
+        {
+            buildMeshlets(indices, vertices, surfaces, encodedMesh);
+        }
+        cacheMeshes[meshIndex] = cacheMesh(meshName, std::move(encodedMesh), surfaces);
+    });
 
+    // Each mesh is uploaded once, even if several nodes reference it
+    instances = gltfInstances(gltf);
+    meshes = uploadModels(vulkanData, cacheMeshes);
+    MeshCache::store(cacheKey, cacheMeshes, instances);
     return meshes;
 }
 
 std::vector<std::shared_ptr<Model>> Model::loadObj(
     VulkanData* vulkanData,
     const std::filesystem::path& filePath,
-    const std::vector<std::shared_ptr<Modifier>>& modifiers
+    const std::vector<std::shared_ptr<Modifier>>& modifiers,
+    VertexFormat vertexFormat,
+    bool positionStream,
+    const ImportOptions& importOptions
 ) {
     std::ifstream file(filePath);
     if (!file.is_open())
@@ -150,16 +432,70 @@ std::vector<std::shared_ptr<Model>> Model::loadObj(
         throw std::runtime_error(std::string("Could not open OBJ model file: ") + filePath.string());
     }
     
-    return Model::loadObj(vulkanData, file, filePath.filename().string(), modifiers);
+    return Model::loadObj(vulkanData, file, filePath.filename().string(), modifiers, vertexFormat, positionStream, importOptions);
 }
 
+// Position, normal and texture coordinate indexes of an OBJ face corner
+struct ObjVertexKey {
+    int vertexIndex;
+    int normalIndex;
+    int texcoordIndex;
+    
+    bool operator==(const ObjVertexKey& other) const
+    {
+        return vertexIndex == other.vertexIndex &&
+            normalIndex == other.normalIndex &&
+            texcoordIndex == other.texcoordIndex;
+    }
+};
+
+struct ObjVertexKeyHash {
+    size_t operator()(const ObjVertexKey& key) const
+    {
+        size_t hash = std::hash<int>()(key.vertexIndex);
+        hash ^= std::hash<int>()(key.normalIndex) + 0x9E3779B9 + (hash << 6) + (hash >> 2);
+        hash ^= std::hash<int>()(key.texcoordIndex) + 0x9E3779B9 + (hash << 6) + (hash >> 2);
+        return hash;
+    }
+};
+
 std::vector<std::shared_ptr<Model>> Model::loadObj(
     VulkanData* vulkanData,
     std::istream& inputStream,
     const std::string& name,
-    const std::vector<std::shared_ptr<Modifier>>& modifiers
+    const std::vector<std::shared_ptr<Modifier>>& modifiers,
+    VertexFormat vertexFormat,
+    bool positionStream,
+    const ImportOptions& importOptions
 ) {
     std::vector<std::shared_ptr<Model>> result;
+
+    // The whole source is needed to compute the cache key
+    std::string source((std::istreambuf_iterator<char>(inputStream)), std::istreambuf_iterator<char>());
+    MeshCache::KeyBuilder keyBuilder;
+    keyBuilder.add("obj")
+        .add(source)
+        .add(name)
+        .addValue(vertexFormat)
+        .addValue(positionStream)
+        .addValue(importOptions.lods)
+        .addValue(importOptions.meshlets)
+        .addValue(importOptions.optimize);
+    bool useCache = true;
+    for (auto& mod : modifiers)
+    {
+        auto modifierKey = mod->cacheKey();
+        useCache = useCache && !modifierKey.empty();
+        keyBuilder.add(modifierKey);
+    }
+    auto cacheKey = keyBuilder.key();
+
+    if (useCache && loadCachedMeshes(vulkanData, cacheKey, result))
+    {
+        return result;
+    }
+    std::vector<MeshCache::Mesh> cacheMeshes;
+    std::istringstream sourceStream(source);
     
     tinyobj::attrib_t attrib;
     std::vector<tinyobj::shape_t> shapes;
@@ -168,7 +504,7 @@ std::vector<std::shared_ptr<Model>> Model::loadObj(
     std::string warn;
     std::string err;
 
-    tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, &inputStream);
+    tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, &sourceStream);
     if (!warn.empty())
     {
         std::cout << "WARN: " << warn << std::endl;
@@ -179,12 +515,19 @@ std::vector<std::shared_ptr<Model>> Model::loadObj(
         throw std::runtime_error(std::string("Error loading obj file: ") + err);
     }
     
-    for (size_t s = 0; s < shapes.size(); ++s)
-    {
+    // The shapes are welded, optimized and encoded in parallel
+    cacheMeshes.resize(shapes.size());
+    tools::ThreadPool::shared().parallelFor(shapes.size(), [&](size_t shapeIndex) {
 		size_t index_offset = 0;
         std::vector<Vertex> vertexBufferData;
         std::vector<uint32_t> indices;
-		for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++)
+        indices.reserve(shapes[shapeIndex].mesh.indices.size());
+        
+        // The OBJ faces reference the positions, normals and texture coordinates separately. The face
+        // corners that use the same combination are the same vertex, so they share the index
+        std::unordered_map<ObjVertexKey, uint32_t, ObjVertexKeyHash> uniqueVertices;
+        uniqueVertices.reserve(shapes[shapeIndex].mesh.indices.size());
+		for (size_t f = 0; f < shapes[shapeIndex].mesh.num_face_vertices.size(); f++)
         {
             //hardcode loading to triangles
 			int fv = 3;
@@ -192,19 +535,35 @@ std::vector<std::shared_ptr<Model>> Model::loadObj(
 			// Loop over vertices in the face.
 			for (size_t v = 0; v < fv; v++) {
 				// access to vertex
-				tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
+				tinyobj::index_t idx = shapes[shapeIndex].mesh.indices[index_offset + v];
+                
+                ObjVertexKey key { idx.vertex_index, idx.normal_index, idx.texcoord_index };
+                auto existing = uniqueVertices.find(key);
+                if (existing != uniqueVertices.end())
+                {
+                    indices.push_back(existing->second);
+                    continue;
+                }
 
                 // vertex position
 				tinyobj::real_t vx = attrib.vertices[3 * idx.vertex_index];
 				tinyobj::real_t vy = attrib.vertices[3 * idx.vertex_index + 1];
 				tinyobj::real_t vz = attrib.vertices[3 * idx.vertex_index + 2];
                 // vertex normal
-            	tinyobj::real_t nx = attrib.normals[3 * idx.normal_index];
-				tinyobj::real_t ny = attrib.normals[3 * idx.normal_index + 1];
-				tinyobj::real_t nz = attrib.normals[3 * idx.normal_index + 2];
+                tinyobj::real_t nx = 0.0f, ny = 0.0f, nz = 0.0f;
+                if (idx.normal_index >= 0)
+                {
+                    nx = attrib.normals[3 * idx.normal_index];
+                    ny = attrib.normals[3 * idx.normal_index + 1];
+                    nz = attrib.normals[3 * idx.normal_index + 2];
+                }
                 // vertex uv
-                tinyobj::real_t s = attrib.texcoords[2 * idx.texcoord_index];
-                tinyobj::real_t t = attrib.texcoords[2 * idx.texcoord_index + 1];
+                tinyobj::real_t s = 0.0f, t = 0.0f;
+                if (idx.texcoord_index >= 0)
+                {
+                    s = attrib.texcoords[2 * idx.texcoord_index];
+                    t = attrib.texcoords[2 * idx.texcoord_index + 1];
+                }
 
                 //copy it into our vertex
 				Vertex newVert(
@@ -214,30 +573,293 @@ std::vector<std::shared_ptr<Model>> Model::loadObj(
                     { 1.0f, 1.0f, 1.0f, 1.0f }
                 );
 
+                auto newIndex = uint32_t(vertexBufferData.size());
+                uniqueVertices.emplace(key, newIndex);
                 vertexBufferData.push_back(newVert);
-                indices.push_back(uint32_t(indices.size()));
+                indices.push_back(newIndex);
 			}
 			index_offset += fv;
 		}
-        GeoSurface surface = {};
-        surface.startIndex = 0;
-        surface.indexCount = uint32_t(indices.size());
+        std::vector<GeoSurface> surfaces(1);
+        surfaces[0].startIndex = 0;
+        surfaces[0].indexCount = uint32_t(indices.size());
         for (auto& mod : modifiers)
         {
             mod->apply(indices, vertexBufferData);
         }
-        MeshBuffers * meshBuffer = MeshBuffers::uploadMesh(vulkanData, indices, vertexBufferData);
+        if (importOptions.optimize)
+        {
+            optimizeMesh(indices, vertexBufferData, surfaces);
+        }
+        updateSurfaceBounds(indices, vertexBufferData, surfaces);
+        if (importOptions.lods)
+        {
+            buildLods(indices, vertexBufferData, surfaces);
+        }
+        auto encodedMesh = EncodedMesh::encode(indices, vertexBufferData, vertexFormat, positionStream);
+        if (importOptions.meshlets)
+        {
+            buildMeshlets(indices, vertexBufferData, surfaces, encodedMesh);
+        }
+        cacheMeshes[shapeIndex] = cacheMesh(name, std::move(encodedMesh), surfaces);
+	});
+    result = uploadModels(vulkanData, cacheMeshes);
+
+    if (useCache)
+    {
+        MeshCache::store(cacheKey, cacheMeshes);
+    }
+    return result;
+}
+
+bool Model::loadCachedMeshes(
+    VulkanData* vulkanData,
+    uint64_t cacheKey,
+    std::vector<std::shared_ptr<Model>>& result,
+    std::vector<MeshCache::Instance>* instances
+) {
+    MeshCache cache;
+    if (!cache.open(cacheKey))
+    {
+        return false;
+    }
+
+    std::vector<MeshUploadData> uploadData;
+    for (auto& mesh : cache.meshes())
+    {
+        uploadData.push_back(mesh.uploadData);
+    }
+    auto meshBuffers = MeshBuffers::uploadMeshes(vulkanData, uploadData);
+
+    for (size_t i = 0; i < meshBuffers.size(); ++i)
+    {
+        auto& mesh = cache.meshes()[i];
         result.push_back(std::shared_ptr<Model>(
-            new Model(name, { surface }, meshBuffer)
+            new Model(mesh.name, geoSurfaces(mesh.surfaces), meshBuffers[i])
         ));
-	}
-    
+    }
+    if (instances)
+    {
+        *instances = cache.instances();
+    }
+    return true;
+}
+
+std::vector<std::shared_ptr<Model>> Model::uploadModels(VulkanData* vulkanData, const std::vector<MeshCache::Mesh>& meshes)
+{
+    std::vector<MeshUploadData> uploadData;
+    for (auto& mesh : meshes)
+    {
+        uploadData.push_back(mesh.encodedMesh.uploadData());
+    }
+    auto meshBuffers = MeshBuffers::uploadMeshes(vulkanData, uploadData);
+
+    std::vector<std::shared_ptr<Model>> result;
+    for (size_t i = 0; i < meshBuffers.size(); ++i)
+    {
+        result.push_back(std::shared_ptr<Model>(
+            new Model(meshes[i].name, geoSurfaces(meshes[i].surfaces), meshBuffers[i])
+        ));
+    }
+    return result;
+}
+
+std::vector<Model::GeoSurface> Model::geoSurfaces(const std::vector<MeshCache::Surface>& surfaces)
+{
+    std::vector<GeoSurface> result(surfaces.size());
+    for (size_t i = 0; i < surfaces.size(); ++i)
+    {
+        auto& surface = surfaces[i];
+        auto& geoSurface = result[i];
+        geoSurface.startIndex = surface.startIndex;
+        geoSurface.indexCount = surface.indexCount;
+        geoSurface.boundingSphere = surface.boundingSphere;
+        geoSurface.boundingBox = surface.boundingBox;
+        geoSurface.meshletOffset = surface.meshletOffset;
+        geoSurface.meshletCount = surface.meshletCount;
+        geoSurface.lodCount = std::min(surface.lodCount, LodLevel::MaxLevels);
+        std::copy(surface.lods, surface.lods + geoSurface.lodCount, geoSurface.lods);
+    }
     return result;
 }
 
+MeshCache::Mesh Model::cacheMesh(const std::string& name, EncodedMesh&& encodedMesh, const std::vector<GeoSurface>& surfaces)
+{
+    MeshCache::Mesh result;
+    result.name = name;
+    result.encodedMesh = std::move(encodedMesh);
+    for (auto& geoSurface : surfaces)
+    {
+        MeshCache::Surface surface = {};
+        surface.startIndex = geoSurface.startIndex;
+        surface.indexCount = geoSurface.indexCount;
+        surface.boundingSphere = geoSurface.boundingSphere;
+        surface.boundingBox = geoSurface.boundingBox;
+        surface.meshletOffset = geoSurface.meshletOffset;
+        surface.meshletCount = geoSurface.meshletCount;
+        surface.lodCount = geoSurface.lodCount;
+        std::copy(geoSurface.lods, geoSurface.lods + geoSurface.lodCount, surface.lods);
+        result.surfaces.push_back(surface);
+    }
+    return result;
+}
+
+void Model::optimizeMesh(std::vector<uint32_t>& indices, std::vector<Vertex>& vertices, const std::vector<GeoSurface>& surfaces)
+{
+    if (indices.empty())
+    {
+        return;
+    }
+
+    // The surfaces are drawn with separate draw calls, so the triangles can't be moved between them
+    for (auto& surface : surfaces)
+    {
+        auto surfaceIndices = indices.data() + surface.startIndex;
+        MeshOptimizer::optimizeVertexCache(surfaceIndices, surface.indexCount, vertices.size());
+        MeshOptimizer::optimizeOverdraw(surfaceIndices, surface.indexCount, vertices);
+    }
+    MeshOptimizer::optimizeVertexFetch(indices, vertices);
+}
+
+void Model::updateSurfaceBounds(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, std::vector<GeoSurface>& surfaces)
+{
+    for (auto& surface : surfaces)
+    {
+        surface.boundingSphere = BoundingSphere::fromIndexedVertices(indices.data() + surface.startIndex, surface.indexCount, vertices);
+        surface.boundingBox = BoundingBox::fromIndexedVertices(indices.data() + surface.startIndex, surface.indexCount, vertices);
+    }
+}
+
+void Model::buildLods(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, std::vector<GeoSurface>& surfaces)
+{
+    for (auto& surface : surfaces)
+    {
+        surface.lodCount = 0;
+
+        // Each level is simplified from the previous one, so the errors are accumulated
+        std::vector<uint32_t> previous(indices.begin() + surface.startIndex, indices.begin() + surface.startIndex + surface.indexCount);
+        float error = 0.0f;
+        while (surface.lodCount < LodLevel::MaxLevels)
+        {
+            size_t targetTriangles = previous.size() / 6;
+            if (targetTriangles < MIN_LOD_TRIANGLES)
+            {
+                break;
+            }
+
+            float stepError = 0.0f;
+            auto lodIndices = MeshSimplifier::simplify(
+                previous.data(), previous.size(), vertices, targetTriangles * 3, MAX_LOD_STEP_ERROR, &stepError
+            );
+            if (lodIndices.empty() || lodIndices.size() > previous.size() * MIN_LOD_REDUCTION)
+            {
+                break;
+            }
+            MeshOptimizer::optimizeVertexCache(lodIndices.data(), lodIndices.size(), vertices.size());
+
+            error += stepError;
+            auto& lod = surface.lods[surface.lodCount++];
+            lod.startIndex = uint32_t(indices.size());
+            lod.indexCount = uint32_t(lodIndices.size());
+            lod.error = error;
+            indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+            previous = std::move(lodIndices);
+        }
+    }
+}
+
+void Model::buildMeshlets(
+    const std::vector<uint32_t>& indices,
+    const std::vector<Vertex>& vertices,
+    std::vector<GeoSurface>& surfaces,
+    EncodedMesh& encodedMesh
+) {
+    MeshletData meshlets;
+    for (auto& surface : surfaces)
+    {
+        surface.meshletOffset = meshlets.build(indices.data() + surface.startIndex, surface.indexCount, vertices);
+        surface.meshletCount = uint32_t(meshlets.meshlets.size()) - surface.meshletOffset;
+        for (uint32_t i = 0; i < surface.lodCount; ++i)
+        {
+            auto& lod = surface.lods[i];
+            lod.meshletOffset = meshlets.build(indices.data() + lod.startIndex, lod.indexCount, vertices);
+            lod.meshletCount = uint32_t(meshlets.meshlets.size()) - lod.meshletOffset;
+        }
+    }
+    encodedMesh.meshletData = meshlets.encode();
+    encodedMesh.meshletCount = uint32_t(meshlets.meshlets.size());
+}
+
+LodLevel Model::GeoSurface::level(uint32_t index) const
+{
+    if (index == 0 || lodCount == 0)
+    {
+        return { startIndex, indexCount, meshletOffset, meshletCount, 0.0f };
+    }
+    return lods[std::min(index, lodCount) - 1];
+}
+
+uint32_t Model::GeoSurface::selectLevel(float errorScale) const
+{
+    // The errors grow with the level
+    uint32_t result = 0;
+    for (uint32_t i = 0; i < lodCount && lods[i].error * errorScale <= 1.0f; ++i)
+    {
+        result = i + 1;
+    }
+    return result;
+}
+
+BoundingBox Model::bounds() const
+{
+    BoundingBox result;
+    for (auto& surface : _surfaces)
+    {
+        result.expand(surface.boundingBox);
+    }
+    return result;
+}
+
+std::shared_ptr<Model> Model::createInstance(const glm::mat4& modelMatrix) const
+{
+    auto instance = std::shared_ptr<Model>(new Model(_name, _surfaces, _meshBuffers));
+    instance->setModelMatrix(modelMatrix);
+    return instance;
+}
+
+ModelHandle Model::createInstance(ModelPool& pool, const glm::mat4& modelMatrix) const
+{
+    Model instance(_name, _surfaces, _meshBuffers);
+    instance.setModelMatrix(modelMatrix);
+    return pool.insert(std::move(instance));
+}
+
 void Model::cleanup()
 {
-    _meshBuffers->cleanup();
+    _meshBuffers.reset();
+}
+
+void Model::selectLods(const glm::mat4& view, const glm::mat4& proj, float viewportHeight, float maxScreenError)
+{
+    // Pixels per world unit at distance 1. The projection can be flipped in the y axis
+    float pixelsPerUnit = std::abs(proj[1][1]) * 0.5f * viewportHeight / maxScreenError;
+    glm::vec3 cameraPosition(glm::inverse(view)[3]);
+
+    _surfaceLods.resize(_surfaces.size());
+    for (size_t i = 0; i < _surfaces.size(); ++i)
+    {
+        auto& surface = _surfaces[i];
+        auto bounds = surface.boundingSphere.transform(modelMatrix());
+        float distance = glm::length(bounds.center - cameraPosition) - bounds.radius;
+        if (distance <= 0.0f)
+        {
+            _surfaceLods[i] = 0;
+            continue;
+        }
+        // The errors are in object space, and they are scaled as the radius
+        float scale = surface.boundingSphere.radius > 0.0f ? bounds.radius / surface.boundingSphere.radius : 1.0f;
+        _surfaceLods[i] = surface.selectLevel(scale * pixelsPerUnit / distance);
+    }
 }
 
 void Model::allocateMaterialDescriptorSets(core::DescriptorSetAllocator* allocator, VkDescriptorSetLayout descriptorLayout)
@@ -263,8 +885,14 @@ void Model::updateDescriptorSets(std::function<void(core::DescriptorSet*)>&& upd
     }
 }
 
-void Model::draw(VkCommandBuffer cmd, VkPipelineLayout pipelineLayout, core::DescriptorSet* descriptorSets[], uint32_t numDescriptorSets, int32_t pushConstantIndex)
-{
+void Model::draw(
+    VkCommandBuffer cmd,
+    VkPipelineLayout pipelineLayout,
+    core::DescriptorSet* descriptorSets[],
+    uint32_t numDescriptorSets,
+    int32_t pushConstantIndex,
+    VertexStream vertexStream
+) {
     vkme::geo::MeshPushConstants pushConstants;
     pushConstants.modelMatrix = modelMatrix();
 	pushConstants.index = pushConstantIndex;
@@ -272,23 +900,25 @@ void Model::draw(VkCommandBuffer cmd, VkPipelineLayout pipelineLayout, core::Des
     // TODO: Do not use push constants
     //pushConstants.normalMatrix = glm::mat3(glm::transpose(glm::inverse(modelMatrix())));
     
-    pushConstants.vertexBufferAddress = meshBuffers()->vertexBufferAddress;
+    pushConstants.vertexBufferAddress = meshBuffers()->streamAddress(vertexStream);
+    pushConstants.setVertexFormat(meshBuffers());
     vkCmdPushConstants(cmd, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(vkme::geo::MeshPushConstants), &pushConstants);
-    vkCmdBindIndexBuffer(cmd, meshBuffers()->indexBuffer->buffer(), 0, VK_INDEX_TYPE_UINT32);
+    meshBuffers()->bindIndexBuffer(cmd);
+    auto firstIndex = meshBuffers()->firstIndex();
     
+    // The shared descriptor sets are copied once, and only the material set changes for each surface
+    uint32_t descriptorSetCount = _useMaterialDescriptorSets ? 1 + numDescriptorSets : numDescriptorSets;
+    std::vector<VkDescriptorSet> sets(descriptorSetCount);
+    for (uint32_t j = 0; j < numDescriptorSets; ++j)
+    {
+        sets[j] = descriptorSets[j]->descriptorSet();
+    }
+
     auto i = 0;
-    for (auto s : surfaces())
+    for (auto& s : surfaces())
     {
-        uint32_t descriptorSetCount = _useMaterialDescriptorSets ? 1 + numDescriptorSets : numDescriptorSets;
         if (descriptorSetCount > 0)
         {
-            std::vector<VkDescriptorSet> sets;
-            sets.resize(descriptorSetCount);
-            for (uint32_t j = 0; j < numDescriptorSets; ++j)
-            {
-                sets[j] = descriptorSets[j]->descriptorSet();
-            }
-
             if (_useMaterialDescriptorSets)
             {
                 sets[numDescriptorSets] = _materialDescriptorSets[i]->descriptorSet();
@@ -304,7 +934,8 @@ void Model::draw(VkCommandBuffer cmd, VkPipelineLayout pipelineLayout, core::Des
             );
         }
         
-        vkCmdDrawIndexed(cmd, s.indexCount, 1, s.startIndex, 0, 0);
+        auto level = s.level(size_t(i) < _surfaceLods.size() ? _surfaceLods[i] : 0);
+        vkCmdDrawIndexed(cmd, level.indexCount, 1, firstIndex + level.startIndex, 0, 0);
         ++i;
     }
 }
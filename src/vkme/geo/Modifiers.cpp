@@ -1,5 +1,8 @@
 #include <vkme/geo/Modifiers.hpp>
 
+#include <sstream>
+#include <iomanip>
+
 namespace vkme {
 namespace geo {
 
@@ -14,6 +17,11 @@ void FlipFacesModifier::apply(std::vector<uint32_t>& indices, std::vector<Vertex
     }
 }
 
+std::string FlipFacesModifier::cacheKey() const
+{
+    return "FlipFaces";
+}
+
 void FlipNormalsModifier::apply(std::vector<uint32_t>& indices, std::vector<Vertex>& vertices)
 {
     for (auto& v : vertices)
@@ -23,6 +31,11 @@ void FlipNormalsModifier::apply(std::vector<uint32_t>& indices, std::vector<Vert
     }
 }
 
+std::string FlipNormalsModifier::cacheKey() const
+{
+    return "FlipNormals";
+}
+
 void ScaleModifier::apply(std::vector<uint32_t>& indices, std::vector<Vertex>& vertices)
 {
     for (auto& v : vertices)
@@ -32,6 +45,13 @@ void ScaleModifier::apply(std::vector<uint32_t>& indices, std::vector<Vertex>& v
     }
 }
 
+std::string ScaleModifier::cacheKey() const
+{
+    std::ostringstream key;
+    key << std::setprecision(9) << "Scale(" << _sx << "," << _sy << "," << _sz << ")";
+    return key.str();
+}
+
 void OverrideColorsModifier::apply(std::vector<uint32_t>& indices, std::vector<Vertex>& vertices)
 {
     for (auto& v : vertices)
@@ -40,6 +60,11 @@ void OverrideColorsModifier::apply(std::vector<uint32_t>& indices, std::vector<V
         v.setColor({ n.x, n.y, n.z, 1.0f });
     }
 }
+
+std::string OverrideColorsModifier::cacheKey() const
+{
+    return "OverrideColors";
+}
     
 }
 }
@@ -0,0 +1,445 @@
+#include <vkme/geo/SceneBVH.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace vkme {
+namespace geo {
+
+// Number of bins of the centroids in each axis, to evaluate the surface area heuristic
+constexpr uint32_t SAH_BIN_COUNT = 16;
+
+// Cost of visiting an interior node, relative to the cost of testing a model
+constexpr float SAH_TRAVERSAL_COST = 1.0f;
+
+// The leaves with more models are always split, even if the heuristic does not find a better split
+constexpr uint32_t MAX_LEAF_MODELS = 4;
+
+uint32_t SceneBVH::add(ModelHandle model)
+{
+    // Throws if the model is not in the pool
+    auto& modelData = _modelPool->at(model);
+    _models.push_back(model);
+    _modelBounds.push_back(modelData.bounds().transform(modelData.modelMatrix()));
+    _built = false;
+    return uint32_t(_models.size() - 1);
+}
+
+void SceneBVH::clear()
+{
+    _models.clear();
+    _modelBounds.clear();
+    _leafModels.clear();
+    _nodes.clear();
+    _built = false;
+}
+
+void SceneBVH::build()
+{
+    updateModelBounds();
+    _nodes.clear();
+    _leafModels.resize(_models.size());
+    for (uint32_t i = 0; i < _leafModels.size(); ++i)
+    {
+        _leafModels[i] = i;
+    }
+    if (!_models.empty())
+    {
+        // Each interior node adds two nodes, so there are at most 2n - 1 nodes
+        _nodes.reserve(_models.size() * 2);
+        _nodes.emplace_back();
+        buildNode(0, 0, uint32_t(_models.size()));
+    }
+    _built = true;
+}
+
+void SceneBVH::refit()
+{
+    checkBuilt();
+    updateModelBounds();
+
+    // The children are always after their parent, so the nodes are updated in reverse order
+    for (size_t n = _nodes.size(); n-- > 0;)
+    {
+        auto& node = _nodes[n];
+        node.bounds = BoundingBox();
+        if (node.count > 0)
+        {
+            for (uint32_t i = 0; i < node.count; ++i)
+            {
+                node.bounds.expand(_modelBounds[_leafModels[node.first + i]]);
+            }
+        }
+        else
+        {
+            node.bounds.expand(_nodes[node.first].bounds);
+            node.bounds.expand(_nodes[node.first + 1].bounds);
+        }
+    }
+}
+
+void SceneBVH::queryFrustum(const glm::mat4& viewProjection, std::vector<uint32_t>& result) const
+{
+    checkBuilt();
+    if (_nodes.empty())
+    {
+        return;
+    }
+
+    // Gribb and Hartmann: the planes are combinations of the rows of the view projection matrix,
+    // with the depth range of Vulkan (0 <= z <= w). The far plane of an infinite projection
+    // has a null normal, and it's ignored
+    auto m = glm::transpose(viewProjection);
+    glm::vec4 planes[6] = { m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[2], m[3] - m[2] };
+    uint32_t planeCount = 0;
+    for (auto& plane : planes)
+    {
+        float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f)
+        {
+            planes[planeCount++] = plane / length;
+        }
+    }
+
+    // 0: outside, 1: intersects, 2: inside
+    auto classify = [&](const BoundingBox& box) {
+        int classification = 2;
+        for (uint32_t i = 0; i < planeCount; ++i)
+        {
+            glm::vec3 normal(planes[i]);
+            // The corners of the box that are furthest along and against the normal
+            glm::vec3 positive(
+                normal.x >= 0.0f ? box.max.x : box.min.x,
+                normal.y >= 0.0f ? box.max.y : box.min.y,
+                normal.z >= 0.0f ? box.max.z : box.min.z
+            );
+            glm::vec3 negative(
+                normal.x >= 0.0f ? box.min.x : box.max.x,
+                normal.y >= 0.0f ? box.min.y : box.max.y,
+                normal.z >= 0.0f ? box.min.z : box.max.z
+            );
+            if (glm::dot(normal, positive) + planes[i].w < 0.0f)
+            {
+                return 0;
+            }
+            if (glm::dot(normal, negative) + planes[i].w < 0.0f)
+            {
+                classification = 1;
+            }
+        }
+        return classification;
+    };
+
+    std::vector<uint32_t> stack = { 0 };
+    while (!stack.empty())
+    {
+        auto nodeIndex = stack.back();
+        stack.pop_back();
+        auto& node = _nodes[nodeIndex];
+        auto classification = classify(node.bounds);
+        if (classification == 0)
+        {
+            continue;
+        }
+        if (classification == 2)
+        {
+            // All the models of the subtree are inside
+            collectModels(nodeIndex, result);
+        }
+        else if (node.count > 0)
+        {
+            for (uint32_t i = 0; i < node.count; ++i)
+            {
+                auto model = _leafModels[node.first + i];
+                if (classify(_modelBounds[model]) != 0)
+                {
+                    result.push_back(model);
+                }
+            }
+        }
+        else
+        {
+            stack.push_back(node.first);
+            stack.push_back(node.first + 1);
+        }
+    }
+}
+
+void SceneBVH::queryBox(const BoundingBox& box, std::vector<uint32_t>& result) const
+{
+    query([&](const BoundingBox& bounds) { return bounds.intersects(box); }, result);
+}
+
+void SceneBVH::querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& result) const
+{
+    query([&](const BoundingBox& bounds) {
+        // Distance from the center to the nearest point of the box
+        auto d = center - glm::clamp(center, bounds.min, bounds.max);
+        return glm::dot(d, d) <= radius * radius;
+    }, result);
+}
+
+// Slab test. Returns the distance to the entry point, or a negative value if the ray misses the box
+static float rayBoxDistance(const glm::vec3& origin, const glm::vec3& inverseDirection, const BoundingBox& box, float maxDistance)
+{
+    float tMin = 0.0f;
+    float tMax = maxDistance;
+    for (int a = 0; a < 3; ++a)
+    {
+        float t0 = (box.min[a] - origin[a]) * inverseDirection[a];
+        float t1 = (box.max[a] - origin[a]) * inverseDirection[a];
+        if (t0 > t1)
+        {
+            std::swap(t0, t1);
+        }
+        // The comparisons are false with NaN (origin on the slab plane and parallel direction),
+        // so these cases don't reject the box
+        tMin = t0 > tMin ? t0 : tMin;
+        tMax = t1 < tMax ? t1 : tMax;
+        if (tMin > tMax)
+        {
+            return -1.0f;
+        }
+    }
+    return tMin;
+}
+
+bool SceneBVH::raycast(const Ray& ray, RayHit& hit, float maxDistance) const
+{
+    checkBuilt();
+    if (_nodes.empty())
+    {
+        return false;
+    }
+
+    auto inverseDirection = 1.0f / ray.direction;
+    bool found = false;
+    float nearest = maxDistance;
+
+    // The nearest child is visited first, so the farther nodes are usually rejected by distance
+    std::vector<std::pair<uint32_t, float>> stack = { { 0, 0.0f } };
+    if (rayBoxDistance(ray.origin, inverseDirection, _nodes[0].bounds, nearest) < 0.0f)
+    {
+        return false;
+    }
+    while (!stack.empty())
+    {
+        auto [nodeIndex, distance] = stack.back();
+        stack.pop_back();
+        if (distance > nearest)
+        {
+            continue;
+        }
+
+        auto& node = _nodes[nodeIndex];
+        if (node.count == 0)
+        {
+            float d0 = rayBoxDistance(ray.origin, inverseDirection, _nodes[node.first].bounds, nearest);
+            float d1 = rayBoxDistance(ray.origin, inverseDirection, _nodes[node.first + 1].bounds, nearest);
+            std::pair<uint32_t, float> children[2] = { { node.first, d0 }, { node.first + 1, d1 } };
+            if (d1 >= 0.0f && (d0 < 0.0f || d1 < d0))
+            {
+                std::swap(children[0], children[1]);
+            }
+            // Push the farther child first
+            for (int i = 1; i >= 0; --i)
+            {
+                if (children[i].second >= 0.0f)
+                {
+                    stack.push_back(children[i]);
+                }
+            }
+            continue;
+        }
+
+        for (uint32_t i = 0; i < node.count; ++i)
+        {
+            auto modelIndex = _leafModels[node.first + i];
+            if (rayBoxDistance(ray.origin, inverseDirection, _modelBounds[modelIndex], nearest) < 0.0f)
+            {
+                continue;
+            }
+
+            // The surfaces are tested in object space. The transform is affine, so the distance
+            // along the transformed direction is the same
+            auto& model = _modelPool->at(_models[modelIndex]);
+            auto inverseMatrix = glm::inverse(model.modelMatrix());
+            glm::vec3 origin(inverseMatrix * glm::vec4(ray.origin, 1.0f));
+            glm::vec3 direction(inverseMatrix * glm::vec4(ray.direction, 0.0f));
+            auto objectInverseDirection = 1.0f / direction;
+            auto& surfaces = model.surfaces();
+            for (uint32_t s = 0; s < surfaces.size(); ++s)
+            {
+                float d = rayBoxDistance(origin, objectInverseDirection, surfaces[s].boundingBox, nearest);
+                if (d >= 0.0f && (!found || d < nearest))
+                {
+                    found = true;
+                    nearest = d;
+                    hit.model = modelIndex;
+                    hit.surface = s;
+                    hit.distance = d;
+                }
+            }
+        }
+    }
+    return found;
+}
+
+void SceneBVH::updateModelBounds()
+{
+    for (size_t i = 0; i < _models.size(); ++i)
+    {
+        auto& model = _modelPool->at(_models[i]);
+        _modelBounds[i] = model.bounds().transform(model.modelMatrix());
+    }
+}
+
+void SceneBVH::buildNode(uint32_t nodeIndex, uint32_t begin, uint32_t end)
+{
+    uint32_t count = end - begin;
+    BoundingBox bounds;
+    BoundingBox centroidBounds;
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        auto& modelBounds = _modelBounds[_leafModels[i]];
+        bounds.expand(modelBounds);
+        centroidBounds.expand(modelBounds.center());
+    }
+    _nodes[nodeIndex].bounds = bounds;
+
+    auto makeLeaf = [&]() {
+        _nodes[nodeIndex].first = begin;
+        _nodes[nodeIndex].count = count;
+    };
+    if (count <= 1)
+    {
+        makeLeaf();
+        return;
+    }
+
+    // Binned SAH: the cost of a split is the number of models of each side weighted by the
+    // probability of visiting it, that is proportional to the surface area
+    struct Bin
+    {
+        BoundingBox bounds;
+        uint32_t count = 0;
+    };
+    float bestCost = std::numeric_limits<float>::max();
+    int bestAxis = -1;
+    uint32_t bestSplit = 0;
+    auto extent = centroidBounds.size();
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        if (extent[axis] <= 0.0f)
+        {
+            continue;
+        }
+
+        Bin bins[SAH_BIN_COUNT];
+        float binScale = float(SAH_BIN_COUNT) / extent[axis];
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            auto& modelBounds = _modelBounds[_leafModels[i]];
+            auto bin = std::min(uint32_t((modelBounds.center()[axis] - centroidBounds.min[axis]) * binScale), SAH_BIN_COUNT - 1);
+            bins[bin].bounds.expand(modelBounds);
+            ++bins[bin].count;
+        }
+
+        // Cost of the right side of each split, accumulated from the right
+        float rightCost[SAH_BIN_COUNT] = {};
+        BoundingBox rightBounds;
+        uint32_t rightCount = 0;
+        for (uint32_t b = SAH_BIN_COUNT - 1; b > 0; --b)
+        {
+            rightBounds.expand(bins[b].bounds);
+            rightCount += bins[b].count;
+            rightCost[b] = rightBounds.surfaceArea() * float(rightCount);
+        }
+
+        BoundingBox leftBounds;
+        uint32_t leftCount = 0;
+        for (uint32_t b = 0; b + 1 < SAH_BIN_COUNT; ++b)
+        {
+            leftBounds.expand(bins[b].bounds);
+            leftCount += bins[b].count;
+            if (leftCount == 0 || leftCount == count)
+            {
+                continue;
+            }
+            float cost = leftBounds.surfaceArea() * float(leftCount) + rightCost[b + 1];
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = b + 1;
+            }
+        }
+    }
+
+    float area = bounds.surfaceArea();
+    float splitCost = area > 0.0f ? SAH_TRAVERSAL_COST + bestCost / area : SAH_TRAVERSAL_COST;
+    if (bestAxis < 0 || (count <= MAX_LEAF_MODELS && splitCost >= float(count)))
+    {
+        if (count <= MAX_LEAF_MODELS)
+        {
+            makeLeaf();
+            return;
+        }
+        // All the centroids are in the same place: split in the middle of the list
+        bestAxis = -1;
+    }
+
+    uint32_t middle;
+    if (bestAxis >= 0)
+    {
+        float binScale = float(SAH_BIN_COUNT) / extent[bestAxis];
+        auto it = std::partition(_leafModels.begin() + begin, _leafModels.begin() + end, [&](uint32_t model) {
+            auto center = _modelBounds[model].center()[bestAxis];
+            return std::min(uint32_t((center - centroidBounds.min[bestAxis]) * binScale), SAH_BIN_COUNT - 1) < bestSplit;
+        });
+        middle = uint32_t(it - _leafModels.begin());
+    }
+    else
+    {
+        middle = begin + count / 2;
+    }
+
+    uint32_t first = uint32_t(_nodes.size());
+    _nodes.emplace_back();
+    _nodes.emplace_back();
+    _nodes[nodeIndex].first = first;
+    _nodes[nodeIndex].count = 0;
+    buildNode(first, begin, middle);
+    buildNode(first + 1, middle, end);
+}
+
+void SceneBVH::collectModels(uint32_t nodeIndex, std::vector<uint32_t>& result) const
+{
+    std::vector<uint32_t> stack = { nodeIndex };
+    while (!stack.empty())
+    {
+        auto& node = _nodes[stack.back()];
+        stack.pop_back();
+        if (node.count > 0)
+        {
+            result.insert(result.end(), _leafModels.begin() + node.first, _leafModels.begin() + node.first + node.count);
+        }
+        else
+        {
+            stack.push_back(node.first);
+            stack.push_back(node.first + 1);
+        }
+    }
+}
+
+void SceneBVH::checkBuilt() const
+{
+    if (!_built)
+    {
+        throw std::runtime_error("SceneBVH: the tree must be built after adding models");
+    }
+}
+
+}
+}
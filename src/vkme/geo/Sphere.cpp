@@ -808,7 +808,7 @@ f 177/205/182 176/204/180 5/5/13 181/209/18
 f 174/202/174 173/201/181 180/208/15 3/3/2
 )"""";
 
-std::shared_ptr<Model> Sphere::createUvSphere(VulkanData* vulkanData, float radius, const std::string& name, const std::vector<std::shared_ptr<Modifier>>& mods)
+std::shared_ptr<Model> Sphere::createUvSphere(VulkanData* vulkanData, float radius, const std::string& name, const std::vector<std::shared_ptr<Modifier>>& mods, VertexFormat vertexFormat, bool positionStream)
 {
     std::stringstream objStream(sphere_objData);
     
@@ -818,7 +818,7 @@ std::shared_ptr<Model> Sphere::createUvSphere(VulkanData* vulkanData, float radi
         modifiers.push_back(std::unique_ptr<Modifier>(new ScaleModifier(radius)));
     }
     
-    auto result = Model::loadObj(vulkanData, objStream, name, modifiers)[0];
+    auto result = Model::loadObj(vulkanData, objStream, name, modifiers, vertexFormat, positionStream)[0];
     
     return result;
 }
@@ -1,83 +1,393 @@
 
 #include <vkme/geo/mesh_data.hpp>
 #include <vkme/core/Buffer.hpp>
+#include <vkme/VulkanData.hpp>
 
 #include "vk_mem_alloc.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 namespace vkme {
 namespace geo {
 
+static uint16_t quantizeUnorm16(float value)
+{
+    return uint16_t(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+static uint8_t quantizeUnorm8(float value)
+{
+    return uint8_t(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+}
+
+static int8_t quantizeSnorm8(float value)
+{
+    return int8_t(std::lround(std::clamp(value, -1.0f, 1.0f) * 127.0f));
+}
+
+VertexQuantization VertexQuantization::fromVertices(const std::vector<Vertex>& vertices)
+{
+    VertexQuantization result;
+    if (vertices.empty())
+    {
+        return result;
+    }
+
+    glm::vec3 minPosition(std::numeric_limits<float>::max());
+    glm::vec3 maxPosition(std::numeric_limits<float>::lowest());
+    glm::vec2 minUv(std::numeric_limits<float>::max());
+    glm::vec2 maxUv(std::numeric_limits<float>::lowest());
+    for (auto& v : vertices)
+    {
+        minPosition = glm::min(minPosition, v.position());
+        maxPosition = glm::max(maxPosition, v.position());
+        minUv = glm::min(minUv, v.uv1());
+        maxUv = glm::max(maxUv, v.uv1());
+    }
+
+    // Flat meshes have a zero size axis, that is quantized to zero
+    result.positionOffset = minPosition;
+    result.positionScale = glm::max(maxPosition - minPosition, glm::vec3(1e-20f)) / 65535.0f;
+    result.uvOffset = minUv;
+    result.uvScale = glm::max(maxUv - minUv, glm::vec2(1e-20f)) / 65535.0f;
+    return result;
+}
+
+PackedVertex VertexQuantization::pack(const Vertex& vertex) const
+{
+    PackedVertex result;
+
+    auto position = (vertex.position() - positionOffset) / (positionScale * 65535.0f);
+    result.position[0] = quantizeUnorm16(position.x);
+    result.position[1] = quantizeUnorm16(position.y);
+    result.position[2] = quantizeUnorm16(position.z);
+
+    // Octahedral encoding: project the normal on the octahedron, and fold the lower hemisphere
+    auto n = vertex.normal();
+    float length = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    glm::vec2 octahedral(0.0f);
+    if (length > 0.0f)
+    {
+        n /= length;
+        octahedral = glm::vec2(n.x, n.y);
+        if (n.z < 0.0f)
+        {
+            octahedral.x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+            octahedral.y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+        }
+    }
+    result.normal[0] = quantizeSnorm8(octahedral.x);
+    result.normal[1] = quantizeSnorm8(octahedral.y);
+
+    auto uv = (vertex.uv1() - uvOffset) / (uvScale * 65535.0f);
+    result.uv[0] = quantizeUnorm16(uv.x);
+    result.uv[1] = quantizeUnorm16(uv.y);
+
+    auto& color = vertex.color();
+    for (int i = 0; i < 4; ++i)
+    {
+        result.color[i] = quantizeUnorm8(color[i]);
+    }
+    return result;
+}
+
+void MeshPushConstants::setVertexFormat(const MeshBuffers* meshBuffers)
+{
+    switch (meshBuffers->vertexFormat)
+    {
+    case VertexFormat::Standard:
+        packedVertexStride = 0;
+        break;
+    case VertexFormat::Packed:
+        packedVertexStride = 3;
+        break;
+    case VertexFormat::PackedColor:
+        packedVertexStride = 4;
+        break;
+    }
+    auto& q = meshBuffers->quantization;
+    positionOffset = glm::vec4(q.positionOffset, 0.0f);
+    positionScale = glm::vec4(q.positionScale, 0.0f);
+    uvTransform = glm::vec4(q.uvOffset, q.uvScale);
+}
+
+EncodedMesh EncodedMesh::encode(
+    const std::vector<uint32_t>& indices,
+    const std::vector<Vertex>& vertices,
+    VertexFormat vertexFormat,
+    bool positionStream
+) {
+    EncodedMesh result;
+    result.vertexFormat = vertexFormat;
+    result.indexCount = uint32_t(indices.size());
+    result.indexType = vertices.size() < 65536 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+
+    if (vertexFormat == VertexFormat::Standard)
+    {
+        result.vertexData.resize(vertices.size() * sizeof(Vertex));
+        memcpy(result.vertexData.data(), vertices.data(), result.vertexData.size());
+    }
+    else
+    {
+        result.quantization = VertexQuantization::fromVertices(vertices);
+        // The packed vertex without color is the PackedVertex struct without the last word
+        size_t stride = vertexFormat == VertexFormat::PackedColor ? sizeof(PackedVertex) : sizeof(PackedVertex) - 4;
+        result.vertexData.resize(vertices.size() * stride);
+        for (size_t i = 0; i < vertices.size(); ++i)
+        {
+            auto packed = result.quantization.pack(vertices[i]);
+            memcpy(result.vertexData.data() + i * stride, &packed, stride);
+        }
+    }
+
+    if (result.indexType == VK_INDEX_TYPE_UINT16)
+    {
+        result.indexData.resize(indices.size() * sizeof(uint16_t));
+        auto shortIndices = reinterpret_cast<uint16_t*>(result.indexData.data());
+        for (size_t i = 0; i < indices.size(); ++i)
+        {
+            shortIndices[i] = uint16_t(indices[i]);
+        }
+    }
+    else
+    {
+        result.indexData.resize(indices.size() * sizeof(uint32_t));
+        memcpy(result.indexData.data(), indices.data(), result.indexData.size());
+    }
+
+    if (positionStream)
+    {
+        result.positionData = PositionStreamLayout::build(vertices);
+    }
+
+    return result;
+}
+
+MeshUploadData EncodedMesh::uploadData() const
+{
+    MeshUploadData result;
+    result.vertexData = vertexData.data();
+    result.vertexDataSize = vertexData.size();
+    result.indexData = indexData.data();
+    result.indexDataSize = indexData.size();
+    result.positionData = positionData.empty() ? nullptr : positionData.data();
+    result.positionDataSize = positionData.size();
+    result.meshletData = meshletData.empty() ? nullptr : meshletData.data();
+    result.meshletDataSize = meshletData.size();
+    result.meshletCount = meshletCount;
+    result.indexCount = indexCount;
+    result.indexType = indexType;
+    result.vertexFormat = vertexFormat;
+    result.quantization = quantization;
+    return result;
+}
+
 MeshBuffers* MeshBuffers::uploadMesh(
     VulkanData* vulkanData,
     const std::vector<uint32_t>& indices,
-    const std::vector<Vertex>& vertices
+    const std::vector<Vertex>& vertices,
+    VertexFormat vertexFormat,
+    bool positionStream
 ) {
-    auto meshBuffers = new MeshBuffers();
-    
-    auto vertexBufferSize = vertices.size() * sizeof(Vertex);
-    auto indexBufferSize = indices.size() * sizeof(uint32_t);
-    
-    meshBuffers->vertexBuffer = core::Buffer::createAllocatedBuffer(
-        vulkanData,
-        vertexBufferSize,
-        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-        VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-        VMA_MEMORY_USAGE_GPU_ONLY
-    );
-    
-    meshBuffers->vertexBufferAddress = meshBuffers->vertexBuffer->deviceAddress();
-    
-    meshBuffers->indexBuffer = core::Buffer::createAllocatedBuffer(
-        vulkanData,
-        indexBufferSize,
-        VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-        VMA_MEMORY_USAGE_GPU_ONLY
-    );
+    auto encodedMesh = EncodedMesh::encode(indices, vertices, vertexFormat, positionStream);
+    return uploadMeshData(vulkanData, encodedMesh.uploadData());
+}
+
+MeshBuffers* MeshBuffers::uploadMeshData(VulkanData* vulkanData, const MeshUploadData& meshData)
+{
+    return uploadMeshes(vulkanData, { meshData })[0];
+}
 
-    meshBuffers->indexCount = uint32_t(indices.size());
+std::vector<MeshBuffers*> MeshBuffers::uploadMeshes(VulkanData* vulkanData, const std::vector<MeshUploadData>& meshes)
+{
+    std::vector<MeshBuffers*> result;
+    if (meshes.empty())
+    {
+        return result;
+    }
+
+    // The heaps are relocated at most once for the whole batch
+    auto& arena = vulkanData->geometryArena();
+    VkDeviceSize vertexHeapSize = 0;
+    VkDeviceSize indexHeapSize = 0;
+    for (auto& meshData : meshes)
+    {
+        vertexHeapSize += meshData.vertexDataSize + (meshData.positionData ? meshData.positionDataSize : 0) +
+            (meshData.meshletData ? meshData.meshletDataSize : 0) + 48;
+        indexHeapSize += meshData.indexDataSize + 4;
+    }
+    arena.reserve(core::ArenaHeap::Vertex, vertexHeapSize);
+    arena.reserve(core::ArenaHeap::Index, indexHeapSize);
+
+    // Offsets of the streams of each mesh in the staging buffer
+    struct StagingRegion {
+        size_t vertexOffset;
+        size_t indexOffset;
+        size_t positionOffset;
+        size_t meshletOffset;
+    };
+    std::vector<StagingRegion> regions;
+    size_t stagingSize = 0;
+
+    for (auto& meshData : meshes)
+    {
+        auto meshBuffers = new MeshBuffers();
+        meshBuffers->_vulkanData = vulkanData;
+        meshBuffers->vertexFormat = meshData.vertexFormat;
+        meshBuffers->indexType = meshData.indexType;
+        meshBuffers->quantization = meshData.quantization;
+        meshBuffers->indexCount = meshData.indexCount;
+        meshBuffers->meshletCount = meshData.meshletData ? meshData.meshletCount : 0;
+
+        meshBuffers->vertexRegion = arena.allocate(core::ArenaHeap::Vertex, meshData.vertexDataSize);
+        meshBuffers->indexRegion = arena.allocate(core::ArenaHeap::Index, meshData.indexDataSize);
+        if (meshData.positionData)
+        {
+            meshBuffers->positionRegion = arena.allocate(core::ArenaHeap::Vertex, meshData.positionDataSize);
+        }
+        if (meshData.meshletData)
+        {
+            meshBuffers->meshletRegion = arena.allocate(core::ArenaHeap::Vertex, meshData.meshletDataSize);
+        }
+
+        StagingRegion region;
+        region.vertexOffset = stagingSize;
+        region.indexOffset = region.vertexOffset + meshData.vertexDataSize;
+        region.positionOffset = region.indexOffset + meshData.indexDataSize;
+        region.meshletOffset = region.positionOffset + (meshData.positionData ? meshData.positionDataSize : 0);
+        stagingSize = region.meshletOffset + (meshData.meshletData ? meshData.meshletDataSize : 0);
+        regions.push_back(region);
+
+        result.push_back(meshBuffers);
+    }
     
-    auto stagingBuffer = core::Buffer::createAllocatedBuffer(
+    auto stagingBuffer = std::unique_ptr<core::Buffer>(core::Buffer::createAllocatedBuffer(
         vulkanData,
-        vertexBufferSize + indexBufferSize,
+        stagingSize,
         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
         VMA_MEMORY_USAGE_CPU_ONLY
-    );
-    
-    void* data = stagingBuffer->allocatedData();
-    
-    memcpy(data, vertices.data(), vertexBufferSize);
-    memcpy(reinterpret_cast<char*>(data) + vertexBufferSize, indices.data(), indexBufferSize);
+    ));
+    auto data = reinterpret_cast<char*>(stagingBuffer->allocatedData());
+
+    // One copy region for each stream, grouped by destination heap
+    std::vector<VkBufferCopy> vertexCopies;
+    std::vector<VkBufferCopy> indexCopies;
+    for (size_t i = 0; i < meshes.size(); ++i)
+    {
+        auto& meshData = meshes[i];
+        auto& region = regions[i];
+        auto meshBuffers = result[i];
+
+        if (meshData.vertexDataSize > 0)
+        {
+            memcpy(data + region.vertexOffset, meshData.vertexData, meshData.vertexDataSize);
+            vertexCopies.push_back({ region.vertexOffset, arena.offset(meshBuffers->vertexRegion), meshData.vertexDataSize });
+        }
+
+        if (meshData.indexDataSize > 0)
+        {
+            memcpy(data + region.indexOffset, meshData.indexData, meshData.indexDataSize);
+            indexCopies.push_back({ region.indexOffset, arena.offset(meshBuffers->indexRegion), meshData.indexDataSize });
+        }
+
+        if (meshData.positionData && meshData.positionDataSize > 0)
+        {
+            memcpy(data + region.positionOffset, meshData.positionData, meshData.positionDataSize);
+            vertexCopies.push_back({ region.positionOffset, arena.offset(meshBuffers->positionRegion), meshData.positionDataSize });
+        }
+
+        if (meshData.meshletData && meshData.meshletDataSize > 0)
+        {
+            memcpy(data + region.meshletOffset, meshData.meshletData, meshData.meshletDataSize);
+            vertexCopies.push_back({ region.meshletOffset, arena.offset(meshBuffers->meshletRegion), meshData.meshletDataSize });
+        }
+    }
     
+    // All the meshes are copied in the same submit
     vulkanData->command().immediateSubmit([&](VkCommandBuffer cmd) {
-        VkBufferCopy vertexCopy = {};
-        vertexCopy.dstOffset = 0;
-        vertexCopy.srcOffset = 0;
-        vertexCopy.size = vertexBufferSize;
-        vkCmdCopyBuffer(cmd, stagingBuffer->buffer(), meshBuffers->vertexBuffer->buffer(), 1, &vertexCopy);
-        
-        VkBufferCopy indexCopy = {};
-        indexCopy.dstOffset = 0;
-        indexCopy.srcOffset = vertexBufferSize;
-        indexCopy.size = indexBufferSize;
-        vkCmdCopyBuffer(cmd, stagingBuffer->buffer(), meshBuffers->indexBuffer->buffer(), 1, &indexCopy);
+        if (!vertexCopies.empty())
+        {
+            vkCmdCopyBuffer(
+                cmd,
+                stagingBuffer->buffer(),
+                arena.buffer(core::ArenaHeap::Vertex)->buffer(),
+                uint32_t(vertexCopies.size()),
+                vertexCopies.data()
+            );
+        }
+        if (!indexCopies.empty())
+        {
+            vkCmdCopyBuffer(
+                cmd,
+                stagingBuffer->buffer(),
+                arena.buffer(core::ArenaHeap::Index)->buffer(),
+                uint32_t(indexCopies.size()),
+                indexCopies.data()
+            );
+        }
     });
 
     stagingBuffer->cleanup();
     
-    return meshBuffers;
+    return result;
+}
+
+VkDeviceAddress MeshBuffers::vertexBufferAddress() const
+{
+    return _vulkanData ? _vulkanData->geometryArena().deviceAddress(vertexRegion) : 0;
+}
+
+VkDeviceAddress MeshBuffers::positionBufferAddress() const
+{
+    return _vulkanData && positionRegion ? _vulkanData->geometryArena().deviceAddress(positionRegion) : 0;
+}
+
+VkDeviceAddress MeshBuffers::meshletBufferAddress() const
+{
+    return _vulkanData && meshletRegion ? _vulkanData->geometryArena().deviceAddress(meshletRegion) : 0;
+}
+
+VkDeviceAddress MeshBuffers::streamAddress(VertexStream stream) const
+{
+    if (stream == VertexStream::Positions)
+    {
+        auto address = positionBufferAddress();
+        if (address == 0)
+        {
+            throw std::runtime_error("MeshBuffers::streamAddress(): the mesh does not have a position stream");
+        }
+        return address;
+    }
+    return vertexBufferAddress();
+}
+
+void MeshBuffers::bindIndexBuffer(VkCommandBuffer cmd) const
+{
+    _vulkanData->geometryArena().bindIndexBuffer(cmd, indexType);
+}
+
+uint32_t MeshBuffers::firstIndex() const
+{
+    auto indexSize = indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+    return uint32_t(_vulkanData->geometryArena().offset(indexRegion) / indexSize);
 }
 
 void MeshBuffers::cleanup()
 {
-    if (indexBuffer != nullptr)
+    if (_vulkanData != nullptr)
     {
-        indexBuffer->cleanup();
-        vertexBuffer->cleanup();
-        vertexBufferAddress = 0;
+        auto& arena = _vulkanData->geometryArena();
+        arena.free(indexRegion);
+        arena.free(vertexRegion);
+        arena.free(positionRegion);
+        arena.free(meshletRegion);
+        indexRegion = {};
+        vertexRegion = {};
+        positionRegion = {};
+        meshletRegion = {};
     }
-    
 }
     
 }
@@ -0,0 +1,182 @@
+#include <vkme/tools/CompositeRenderer.hpp>
+#include <vkme/factory/DescriptorSetLayout.hpp>
+#include <vkme/factory/GraphicsPipeline.hpp>
+#include <vkme/factory/Sampler.hpp>
+#include <vkme/core/Info.hpp>
+
+namespace vkme::tools {
+
+CompositeRenderer::CompositeRenderer(VulkanData* vulkanData)
+    :_vulkanData(vulkanData)
+{
+
+}
+
+void CompositeRenderer::getFrameResourcesRequirements(std::vector<core::DescriptorSetAllocator::PoolSizeRatio>& requiredRatios)
+{
+    requiredRatios.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 });
+}
+
+void CompositeRenderer::initFrameResources(
+    core::DescriptorSetAllocator* allocator,
+    std::vector<core::DescriptorSetAllocator::PoolSizeRatio> ratios,
+    uint32_t maxSets
+) {
+    getFrameResourcesRequirements(ratios);
+    allocator->initPool(maxSets, ratios);
+}
+
+std::unique_ptr<CompositeRenderer> CompositeRenderer::create(VulkanData* vulkanData, Tonemap tonemap)
+{
+    auto compositeRenderer = std::unique_ptr<CompositeRenderer>(new CompositeRenderer(vulkanData));
+    compositeRenderer->init(vulkanData->swapchain().imageFormat());
+    compositeRenderer->setTonemap(tonemap);
+    return compositeRenderer;
+}
+
+static bool isSrgbFormat(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8_SRGB:
+    case VK_FORMAT_R8G8_SRGB:
+    case VK_FORMAT_R8G8B8_SRGB:
+    case VK_FORMAT_B8G8R8_SRGB:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_A8B8G8R8_SRGB_PACK32:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void CompositeRenderer::init(VkFormat targetFormat)
+{
+    _encodeSrgb = !isSrgbFormat(targetFormat);
+
+    vkme::factory::Sampler sampler(_vulkanData);
+    sampler.createInfo.anisotropyEnable = VK_FALSE;
+    _imageSampler = sampler.build(
+        VK_FILTER_LINEAR,
+        VK_FILTER_LINEAR,
+        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE
+    );
+
+    vkme::factory::DescriptorSetLayout dsFactory;
+    dsFactory.addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+    dsFactory.addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+    _inputImageDSLayout = dsFactory.build(
+        _vulkanData->device(),
+        VK_SHADER_STAGE_FRAGMENT_BIT
+    );
+
+    VkPushConstantRange pushConstantRange = {};
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(CompositePushConstants);
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    auto layoutInfo = vkme::core::Info::pipelineLayoutInfo();
+    layoutInfo.pPushConstantRanges = &pushConstantRange;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pSetLayouts = &_inputImageDSLayout;
+    layoutInfo.setLayoutCount = 1;
+    VK_ASSERT(vkCreatePipelineLayout(_vulkanData->device(), &layoutInfo, nullptr, &_pipelineLayout));
+
+    vkme::factory::GraphicsPipeline plFactory(_vulkanData);
+    plFactory.addShader("composite.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
+    plFactory.addShader("composite.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+    plFactory.setColorAttachmentFormat(targetFormat);
+    plFactory.disableDepthtest();
+    plFactory.inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    plFactory.setCullMode(VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE);
+    _pipeline = plFactory.build(_pipelineLayout);
+
+    _vulkanData->cleanupManager().push([&](VkDevice dev) {
+        vkDestroyPipeline(dev, _pipeline, nullptr);
+        vkDestroyPipelineLayout(dev, _pipelineLayout, nullptr);
+        vkDestroyDescriptorSetLayout(dev, _inputImageDSLayout, nullptr);
+        vkDestroySampler(dev, _imageSampler, nullptr);
+    });
+}
+
+void CompositeRenderer::draw(
+    VkCommandBuffer cmd,
+    uint32_t currentFrame,
+    const core::Image* hdrImage,
+    const core::Image* targetImage,
+    core::FrameResources& frameResources
+) {
+    auto descriptorSet = std::unique_ptr<vkme::core::DescriptorSet>(
+        frameResources.descriptorAllocator->allocate(_inputImageDSLayout)
+    );
+    descriptorSet->updateImage(
+        0,
+        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        hdrImage->imageView(),
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        _imageSampler
+    );
+    // The binding must be valid even if there is no user interface, so the HDR image is used
+    // in its place, and the shader does not read it
+    auto userInterfaceImage = frameResources.userInterfaceImage;
+    descriptorSet->updateImage(
+        1,
+        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        userInterfaceImage ? userInterfaceImage->imageView() : hdrImage->imageView(),
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        _imageSampler
+    );
+
+    // The fullscreen triangle overwrites all the pixels, so the previous contents are not loaded
+    auto colorAttachment = vkme::core::Info::attachmentInfo(targetImage->imageView(), nullptr);
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    auto renderInfo = vkme::core::Info::renderingInfo(targetImage->extent2D(), &colorAttachment, nullptr);
+    vkme::core::cmdBeginRendering(cmd, &renderInfo);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipeline);
+
+    VkViewport viewport = {};
+    viewport.width = float(targetImage->extent().width);
+    viewport.height = float(targetImage->extent().height);
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+    VkRect2D scissor = {};
+    scissor.extent = targetImage->extent2D();
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+    VkDescriptorSet ds = descriptorSet->descriptorSet();
+    vkCmdBindDescriptorSets(
+        cmd,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        _pipelineLayout,
+        0, 1, &ds,
+        0, nullptr
+    );
+
+    CompositePushConstants pushConstants;
+    pushConstants.uvScale = _inputScale;
+    pushConstants.exposure = _exposure;
+    pushConstants.tonemapOperator = int32_t(_tonemap);
+    pushConstants.ditherAmount = _ditherEnabled ? 1.0f / 255.0f : 0.0f;
+    pushConstants.frameIndex = currentFrame;
+    pushConstants.userInterface = userInterfaceImage ? 1 : 0;
+    pushConstants.encodeSrgb = _encodeSrgb ? 1 : 0;
+    vkCmdPushConstants(
+        cmd,
+        _pipelineLayout,
+        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+        0,
+        sizeof(CompositePushConstants),
+        &pushConstants
+    );
+
+    vkCmdDraw(cmd, 3, 1, 0, 0);
+
+    vkme::core::cmdEndRendering(cmd);
+}
+
+}
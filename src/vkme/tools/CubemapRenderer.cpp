@@ -113,10 +113,10 @@ void CubemapRenderer::update(VkCommandBuffer cmd, uint32_t currentFrame, vkme::c
         auto meshBuffers = _cube->meshBuffers();
         SkySpherePushConstant pushConstants;
         pushConstants.currentFace = i;
-        pushConstants.vertexBufferAddress = meshBuffers->vertexBufferAddress;
+        pushConstants.positionBufferAddress = meshBuffers->positionBufferAddress();
 
         vkCmdPushConstants(cmd, _pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(SkySpherePushConstant), &pushConstants);
-        vkCmdBindIndexBuffer(cmd, meshBuffers->indexBuffer->buffer(), 0, VK_INDEX_TYPE_UINT32);
+        meshBuffers->bindIndexBuffer(cmd);
 
         // The sphere has only one surface
         auto surface = _cube->surfaces()[0];
@@ -138,7 +138,7 @@ void CubemapRenderer::update(VkCommandBuffer cmd, uint32_t currentFrame, vkme::c
             0, nullptr
         );
 
-        vkCmdDrawIndexed(cmd, surface.indexCount, 1, surface.startIndex, 0, 0);
+        vkCmdDrawIndexed(cmd, surface.indexCount, 1, meshBuffers->firstIndex() + surface.startIndex, 0, 0);
         
 		vkme::core::cmdEndRendering(cmd);
     }
@@ -283,10 +283,14 @@ void CubemapRenderer::initGeometry()
 		vkDestroySampler(dev, _skyImageSampler, nullptr);
 	});
 
+	// The cubemap shader only needs the vertex positions
 	_cube = vkme::geo::Cube::createCube(
 		_vulkanData,
 		10.0f,
-		"Sky Box"
+		"Sky Box",
+		{},
+		vkme::geo::VertexFormat::Standard,
+		true
 	);
 	
 	_vulkanData->cleanupManager().push([&](VkDevice) {
@@ -0,0 +1,239 @@
+#include <vkme/tools/DepthPyramid.hpp>
+#include <vkme/factory/ComputePipeline.hpp>
+#include <vkme/factory/DescriptorSetLayout.hpp>
+#include <vkme/factory/Sampler.hpp>
+#include <vkme/core/BarrierBatch.hpp>
+#include <vkme/core/Info.hpp>
+
+#include <algorithm>
+
+namespace vkme::tools {
+
+DepthPyramid::DepthPyramid(VulkanData* vulkanData, DepthConvention depthConvention)
+    :_vulkanData(vulkanData)
+    ,_depthConvention(depthConvention)
+{
+
+}
+
+void DepthPyramid::getFrameResourcesRequirements(std::vector<core::DescriptorSetAllocator::PoolSizeRatio>& requiredRatios)
+{
+    // One descriptor set for each level
+    requiredRatios.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 16 });
+    requiredRatios.push_back({ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 16 });
+}
+
+void DepthPyramid::init()
+{
+    // The levels are read with texelFetch(), so the filter is not used
+    vkme::factory::Sampler sampler(_vulkanData);
+    sampler.createInfo.anisotropyEnable = VK_FALSE;
+    sampler.createInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    sampler.createInfo.maxLod = VK_LOD_CLAMP_NONE;
+    _sampler = sampler.build(
+        VK_FILTER_NEAREST,
+        VK_FILTER_NEAREST,
+        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE
+    );
+
+    vkme::factory::DescriptorSetLayout dsFactory;
+    dsFactory.addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+    dsFactory.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+    _descriptorSetLayout = dsFactory.build(_vulkanData->device(), VK_SHADER_STAGE_COMPUTE_BIT);
+
+    VkPushConstantRange range = {};
+    range.offset = 0;
+    range.size = sizeof(PushConstants);
+    range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    auto layoutInfo = vkme::core::Info::pipelineLayoutInfo();
+    layoutInfo.pPushConstantRanges = &range;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pSetLayouts = &_descriptorSetLayout;
+    layoutInfo.setLayoutCount = 1;
+    VK_ASSERT(vkCreatePipelineLayout(_vulkanData->device(), &layoutInfo, nullptr, &_pipelineLayout));
+
+    vkme::factory::ComputePipeline pipelineFactory(_vulkanData);
+    pipelineFactory.setShader("depth_pyramid.comp.spv");
+    _pipeline = pipelineFactory.build(_pipelineLayout);
+
+    // The culling shaders always read the pyramid, so it's created before the first build
+    _vulkanData->command().immediateSubmit([&](VkCommandBuffer cmd) {
+        createImage(cmd, { 1, 1 });
+    });
+
+    _vulkanData->cleanupManager().push([&](VkDevice dev) {
+        cleanup();
+        vkDestroyPipeline(dev, _pipeline, nullptr);
+        vkDestroyPipelineLayout(dev, _pipelineLayout, nullptr);
+        vkDestroyDescriptorSetLayout(dev, _descriptorSetLayout, nullptr);
+        vkDestroySampler(dev, _sampler, nullptr);
+    });
+}
+
+void DepthPyramid::cmdResize(VkCommandBuffer cmd, VkExtent2D depthExtent, core::FrameResources& frameResources)
+{
+    if (depthExtent.width == _depthExtent.width && depthExtent.height == _depthExtent.height)
+    {
+        return;
+    }
+
+    // The frames in flight and the commands of this frame that have already been recorded may
+    // read the previous image, so it's released with the resources of this frame
+    releaseImage(&frameResources.cleanupManager);
+    createImage(cmd, depthExtent);
+}
+
+void DepthPyramid::cmdBuild(VkCommandBuffer cmd, const core::Image* depthImage, core::FrameResources& frameResources)
+{
+    auto depthExtent = depthImage->extent2D();
+    if (depthExtent.width != _depthExtent.width || depthExtent.height != _depthExtent.height)
+    {
+        throw std::runtime_error("DepthPyramid::cmdBuild(): the depth image size does not match the pyramid. Call cmdResize() before recording the commands that read the pyramid.");
+    }
+
+    // The culling pass of this frame may have read the previous contents of the pyramid
+    depthImage->cmdTransition(cmd, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL);
+    core::BarrierBatch barriers;
+    barriers.addMemoryBarrier(
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        VK_ACCESS_2_NONE,
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+    );
+    barriers.flush(cmd);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline);
+    for (uint32_t level = 0; level < _levelViews.size(); ++level)
+    {
+        auto descriptorSet = std::unique_ptr<vkme::core::DescriptorSet>(
+            frameResources.descriptorAllocator->allocate(_descriptorSetLayout)
+        );
+        descriptorSet->beginUpdate();
+        if (level == 0)
+        {
+            descriptorSet->addImage(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, depthImage->imageView(), VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL, _sampler);
+        }
+        else
+        {
+            descriptorSet->addImage(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, _levelViews[level - 1], VK_IMAGE_LAYOUT_GENERAL, _sampler);
+        }
+        descriptorSet->addImage(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, _levelViews[level], VK_IMAGE_LAYOUT_GENERAL);
+        descriptorSet->endUpdate();
+
+        VkDescriptorSet ds = descriptorSet->descriptorSet();
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _pipelineLayout, 0, 1, &ds, 0, nullptr);
+
+        PushConstants pushConstants;
+        auto sourceSize = level == 0 ? _depthExtent : _levelExtents[level - 1];
+        pushConstants.sourceSize = glm::uvec2(sourceSize.width, sourceSize.height);
+        pushConstants.targetSize = glm::uvec2(_levelExtents[level].width, _levelExtents[level].height);
+        pushConstants.reversedDepth = _depthConvention == DepthConvention::Reversed ? 1 : 0;
+        vkCmdPushConstants(cmd, _pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &pushConstants);
+        vkCmdDispatch(cmd, (pushConstants.targetSize.x + 15) / 16, (pushConstants.targetSize.y + 15) / 16, 1);
+
+        // The next level, and the culling after the last one, read this level
+        barriers.addMemoryBarrier(
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            VK_ACCESS_2_SHADER_SAMPLED_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT
+        );
+        barriers.flush(cmd);
+    }
+
+    depthImage->cmdTransition(cmd, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+    _built = true;
+}
+
+void DepthPyramid::cleanup()
+{
+    releaseImage(nullptr);
+    _depthExtent = { 0, 0 };
+}
+
+void DepthPyramid::createImage(VkCommandBuffer cmd, VkExtent2D depthExtent)
+{
+    _depthExtent = depthExtent;
+    _built = false;
+
+    VkExtent2D extent = { std::max(depthExtent.width / 2, 1u), std::max(depthExtent.height / 2, 1u) };
+    _levelExtents.push_back(extent);
+    while (extent.width > 1 || extent.height > 1)
+    {
+        extent = { std::max(extent.width / 2, 1u), std::max(extent.height / 2, 1u) };
+        _levelExtents.push_back(extent);
+    }
+
+    auto imgInfo = vkme::core::Info::imageCreateInfo(
+        VK_FORMAT_R32_SFLOAT,
+        VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+        { _levelExtents[0].width, _levelExtents[0].height, 1 }
+    );
+    imgInfo.mipLevels = uint32_t(_levelExtents.size());
+
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    allocInfo.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    VK_ASSERT(vmaCreateImage(_vulkanData->allocator(), &imgInfo, &allocInfo, &_image, &_allocation, nullptr));
+
+    auto viewInfo = vkme::core::Info::imageViewCreateInfo(VK_FORMAT_R32_SFLOAT, _image, VK_IMAGE_ASPECT_COLOR_BIT);
+    viewInfo.subresourceRange.levelCount = imgInfo.mipLevels;
+    VK_ASSERT(vkCreateImageView(_vulkanData->device(), &viewInfo, nullptr, &_imageView));
+    for (uint32_t level = 0; level < imgInfo.mipLevels; ++level)
+    {
+        viewInfo.subresourceRange.baseMipLevel = level;
+        viewInfo.subresourceRange.levelCount = 1;
+        VkImageView levelView;
+        VK_ASSERT(vkCreateImageView(_vulkanData->device(), &viewInfo, nullptr, &levelView));
+        _levelViews.push_back(levelView);
+    }
+
+    // The pyramid is always in the GENERAL layout, to be written and read by the compute shaders
+    core::Image::cmdTransitionImage(
+        cmd,
+        _image,
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_IMAGE_ASPECT_COLOR_BIT
+    );
+}
+
+void DepthPyramid::releaseImage(core::CleanupManager* cleanupManager)
+{
+    if (_image == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    auto vulkanData = _vulkanData;
+    auto image = _image;
+    auto allocation = _allocation;
+    auto views = _levelViews;
+    views.push_back(_imageView);
+    auto release = [vulkanData, image, allocation, views](VkDevice dev) {
+        for (auto view : views)
+        {
+            vkDestroyImageView(dev, view, nullptr);
+        }
+        vmaDestroyImage(vulkanData->allocator(), image, allocation);
+    };
+    if (cleanupManager)
+    {
+        cleanupManager->push(release);
+    }
+    else
+    {
+        release(_vulkanData->device());
+    }
+
+    _image = VK_NULL_HANDLE;
+    _allocation = VK_NULL_HANDLE;
+    _imageView = VK_NULL_HANDLE;
+    _levelViews.clear();
+    _levelExtents.clear();
+}
+
+}
@@ -0,0 +1,120 @@
+#include <vkme/tools/DynamicResolution.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace vkme::tools {
+
+DynamicResolution::DynamicResolution(VulkanData* vulkanData)
+    :_vulkanData(vulkanData)
+{
+
+}
+
+void DynamicResolution::init()
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(_vulkanData->physicalDevice(), &properties);
+    _timestampsSupported = properties.limits.timestampComputeAndGraphics == VK_TRUE;
+    _timestampPeriod = properties.limits.timestampPeriod;
+    if (!_timestampsSupported)
+    {
+        // Without timestamps the scale is never changed
+        return;
+    }
+
+    VkQueryPoolCreateInfo queryPoolInfo = {};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = core::FRAME_OVERLAP * 2;
+    VK_ASSERT(vkCreateQueryPool(_vulkanData->device(), &queryPoolInfo, nullptr, &_queryPool));
+
+    _vulkanData->cleanupManager().push([&](VkDevice dev) {
+        vkDestroyQueryPool(dev, _queryPool, nullptr);
+    });
+}
+
+void DynamicResolution::cmdBeginFrame(VkCommandBuffer cmd, uint32_t currentFrame)
+{
+    if (!_timestampsSupported)
+    {
+        return;
+    }
+
+    auto frameIndex = currentFrame % core::FRAME_OVERLAP;
+    auto firstQuery = frameIndex * 2;
+    auto& frameQuery = _frameQueries[frameIndex];
+    if (frameQuery.pending)
+    {
+        uint64_t timestamps[2];
+        auto result = vkGetQueryPoolResults(
+            _vulkanData->device(),
+            _queryPool,
+            firstQuery, 2,
+            sizeof(timestamps), timestamps, sizeof(uint64_t),
+            VK_QUERY_RESULT_64_BIT
+        );
+        
+        // The frame fence has been waited, so the results should be available. If they are
+        // not, the sample is lost but the frame does not wait
+        if (result == VK_SUCCESS && timestamps[1] > timestamps[0])
+        {
+            float frameTime = float(double(timestamps[1] - timestamps[0]) * _timestampPeriod / 1000000.0);
+            updateScale(frameTime, frameQuery.scale);
+        }
+    }
+
+    vkCmdResetQueryPool(cmd, _queryPool, firstQuery, 2);
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _queryPool, firstQuery);
+    frameQuery.scale = scale();
+    frameQuery.pending = true;
+}
+
+void DynamicResolution::cmdEndFrame(VkCommandBuffer cmd, uint32_t currentFrame)
+{
+    if (!_timestampsSupported)
+    {
+        return;
+    }
+
+    auto firstQuery = (currentFrame % core::FRAME_OVERLAP) * 2;
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _queryPool, firstQuery + 1);
+}
+
+VkExtent2D DynamicResolution::renderExtent(VkExtent2D maxExtent) const
+{
+    auto s = scale();
+    return {
+        std::clamp(uint32_t(std::lround(maxExtent.width * s)), 1u, maxExtent.width),
+        std::clamp(uint32_t(std::lround(maxExtent.height * s)), 1u, maxExtent.height)
+    };
+}
+
+void DynamicResolution::updateScale(float frameTime, float frameScale)
+{
+    _gpuTime = _gpuTime == 0.0f ? frameTime : _gpuTime * 0.9f + frameTime * 0.1f;
+    if (!_enabled)
+    {
+        return;
+    }
+
+    // The cost of the frame is roughly proportional to the number of pixels, that is, to the
+    // square of the scale. The measured time belongs to a frame rendered FRAME_OVERLAP frames
+    // ago, so the new scale is computed from the scale used in that frame and not from the
+    // current one. Aim a bit below the target to leave room for the spikes
+    float budget = _targetFrameTime * 0.9f;
+    float idealScale = frameScale * std::sqrt(budget / std::max(frameTime, 0.01f));
+    idealScale = std::clamp(idealScale, _minScale, 1.0f);
+
+    // Go down quickly if the frame is over budget, and up slowly to avoid oscillations. The
+    // small changes are ignored, so the resolution does not change in every frame
+    float delta = idealScale - _scale;
+    if (std::abs(delta) < 0.02f)
+    {
+        return;
+    }
+    _scale += delta * (delta < 0.0f ? 0.5f : 0.1f);
+    _scale = std::clamp(_scale, _minScale, 1.0f);
+}
+
+}
@@ -0,0 +1,308 @@
+#include <vkme/tools/FrameCapture.hpp>
+#include <vkme/tools/ImageWriter.hpp>
+#include <vkme/core/extensions.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+namespace vkme::tools {
+
+static uint32_t bytesPerPixel(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+        return 8;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+static bool isEXRPath(const std::string& path)
+{
+    if (path.size() < 4)
+    {
+        return false;
+    }
+    std::string ext = path.substr(path.size() - 4);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+    return ext == ".exr";
+}
+
+FrameCapture::FrameCapture(VulkanData* vulkanData)
+    :_vulkanData(vulkanData)
+{
+
+}
+
+FrameCapture::~FrameCapture()
+{
+    // The Vulkan objects are released in cleanup(), but the thread must be stopped in any case
+    if (_worker.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopWorker = true;
+        }
+        _condition.notify_all();
+        _worker.join();
+    }
+}
+
+void FrameCapture::init(uint32_t ringSize)
+{
+    _slots.resize(ringSize);
+    for (auto& slot : _slots)
+    {
+        auto eventInfo = VkEventCreateInfo{};
+        eventInfo.sType = VK_STRUCTURE_TYPE_EVENT_CREATE_INFO;
+        VK_ASSERT(vkCreateEvent(_vulkanData->device(), &eventInfo, nullptr, &slot.event));
+    }
+
+    _stopWorker = false;
+    _worker = std::thread([this]() { workerMain(); });
+}
+
+void FrameCapture::cleanup()
+{
+    if (_worker.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopWorker = true;
+        }
+        _condition.notify_all();
+        _worker.join();
+    }
+
+    for (auto& slot : _slots)
+    {
+        destroySlot(slot);
+        vkDestroyEvent(_vulkanData->device(), slot.event, nullptr);
+    }
+    _slots.clear();
+    _encodeQueue.clear();
+    _encodedSlots.clear();
+}
+
+bool FrameCapture::cmdCapture(VkCommandBuffer cmd, const core::Image* image, const std::string& path, VkExtent2D region)
+{
+    poll();
+
+    auto pixelSize = bytesPerPixel(image->format());
+    if (pixelSize == 0)
+    {
+        throw std::runtime_error("FrameCapture::cmdCapture(): unsupported image format " + std::string(string_VkFormat(image->format())));
+    }
+
+    auto it = std::find_if(_slots.begin(), _slots.end(), [](const Slot& s) { return s.state == SlotState::Free; });
+    if (it == _slots.end())
+    {
+        // Do not wait for the GPU or the encoder
+        ++_skippedFrames;
+        return false;
+    }
+    auto& slot = *it;
+
+    auto extent = image->extent2D();
+    if (region.width > 0 && region.height > 0)
+    {
+        extent.width = std::min(region.width, extent.width);
+        extent.height = std::min(region.height, extent.height);
+    }
+    VkDeviceSize size = VkDeviceSize(extent.width) * extent.height * pixelSize;
+    if (!slot.buffer || slot.buffer->size() < size)
+    {
+        // The slot is free, so its buffer is not used by the GPU or by the encoder
+        destroySlot(slot);
+        slot.buffer = std::unique_ptr<core::Buffer>(core::Buffer::createAllocatedBuffer(
+            _vulkanData,
+            size,
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VMA_MEMORY_USAGE_GPU_TO_CPU
+        ));
+    }
+
+    VkBufferImageCopy copyRegion = {};
+    copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    copyRegion.imageSubresource.layerCount = 1;
+    copyRegion.imageExtent = { extent.width, extent.height, 1 };
+    vkCmdCopyImageToBuffer(
+        cmd,
+        image->image(),
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        slot.buffer->buffer(),
+        1,
+        &copyRegion
+    );
+
+    // Signal the event that poll() checks. The dependency of the event makes the copy visible
+    // to the host, so there is no separate pipeline barrier
+    VkBufferMemoryBarrier2 bufferBarrier = {};
+    bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+    bufferBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+    bufferBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    bufferBarrier.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+    bufferBarrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+    bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.buffer = slot.buffer->buffer();
+    bufferBarrier.size = VK_WHOLE_SIZE;
+    
+    VkDependencyInfo dependencies = {};
+    dependencies.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependencies.bufferMemoryBarrierCount = 1;
+    dependencies.pBufferMemoryBarriers = &bufferBarrier;
+    core::cmdSetEvent2(cmd, slot.event, &dependencies);
+
+    slot.state = SlotState::Copying;
+    slot.path = path;
+    slot.format = image->format();
+    slot.extent = extent;
+    return true;
+}
+
+void FrameCapture::poll()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (auto index : _encodedSlots)
+        {
+            _slots[index].state = SlotState::Free;
+        }
+        _encodedSlots.clear();
+    }
+
+    bool notify = false;
+    for (uint32_t i = 0; i < _slots.size(); ++i)
+    {
+        auto& slot = _slots[i];
+        if (slot.state != SlotState::Copying ||
+            vkGetEventStatus(_vulkanData->device(), slot.event) != VK_EVENT_SET)
+        {
+            continue;
+        }
+
+        VK_ASSERT(vkResetEvent(_vulkanData->device(), slot.event));
+        vmaInvalidateAllocation(_vulkanData->allocator(), slot.buffer->allocation(), 0, VK_WHOLE_SIZE);
+        slot.state = SlotState::Encoding;
+        ++_capturedFrames;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _encodeQueue.push_back(i);
+        notify = true;
+    }
+
+    if (notify)
+    {
+        _condition.notify_one();
+    }
+}
+
+void FrameCapture::workerMain()
+{
+    while (true)
+    {
+        uint32_t index;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _condition.wait(lock, [&]() { return _stopWorker || !_encodeQueue.empty(); });
+
+            // Finish the pending captures before stopping
+            if (_encodeQueue.empty())
+            {
+                return;
+            }
+            index = _encodeQueue.front();
+            _encodeQueue.pop_front();
+        }
+
+        try
+        {
+            encode(_slots[index]);
+        }
+        catch (std::exception& err)
+        {
+            std::cerr << "FrameCapture: error saving " << _slots[index].path << ": " << err.what() << std::endl;
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _encodedSlots.push_back(index);
+    }
+}
+
+void FrameCapture::encode(const Slot& slot)
+{
+    auto data = slot.buffer->allocationInfo().pMappedData;
+    auto width = slot.extent.width;
+    auto height = slot.extent.height;
+    size_t pixelCount = size_t(width) * height;
+
+    if (isEXRPath(slot.path))
+    {
+        if (slot.format == VK_FORMAT_R16G16B16A16_SFLOAT)
+        {
+            ImageWriter::writeEXR(slot.path, reinterpret_cast<const uint16_t*>(data), width, height);
+            return;
+        }
+
+        auto src = reinterpret_cast<const uint8_t*>(data);
+        std::vector<uint16_t> halfPixels(pixelCount * 4);
+        bool bgra = slot.format == VK_FORMAT_B8G8R8A8_UNORM;
+        for (size_t i = 0; i < pixelCount; ++i)
+        {
+            halfPixels[i * 4 + 0] = ImageWriter::floatToHalf(src[i * 4 + (bgra ? 2 : 0)] / 255.0f);
+            halfPixels[i * 4 + 1] = ImageWriter::floatToHalf(src[i * 4 + 1] / 255.0f);
+            halfPixels[i * 4 + 2] = ImageWriter::floatToHalf(src[i * 4 + (bgra ? 0 : 2)] / 255.0f);
+            halfPixels[i * 4 + 3] = ImageWriter::floatToHalf(src[i * 4 + 3] / 255.0f);
+        }
+        ImageWriter::writeEXR(slot.path, halfPixels.data(), width, height);
+        return;
+    }
+
+    if (slot.format == VK_FORMAT_R8G8B8A8_UNORM)
+    {
+        ImageWriter::writePNG(slot.path, reinterpret_cast<const uint8_t*>(data), width, height);
+        return;
+    }
+
+    std::vector<uint8_t> pixels(pixelCount * 4);
+    if (slot.format == VK_FORMAT_B8G8R8A8_UNORM)
+    {
+        auto src = reinterpret_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < pixelCount; ++i)
+        {
+            pixels[i * 4 + 0] = src[i * 4 + 2];
+            pixels[i * 4 + 1] = src[i * 4 + 1];
+            pixels[i * 4 + 2] = src[i * 4 + 0];
+            pixels[i * 4 + 3] = src[i * 4 + 3];
+        }
+    }
+    else
+    {
+        // HDR to 8 bit: the values are clamped, use EXR to keep the full range
+        auto src = reinterpret_cast<const uint16_t*>(data);
+        for (size_t i = 0; i < pixelCount * 4; ++i)
+        {
+            float value = std::clamp(ImageWriter::halfToFloat(src[i]), 0.0f, 1.0f);
+            pixels[i] = uint8_t(std::lround(value * 255.0f));
+        }
+    }
+    ImageWriter::writePNG(slot.path, pixels.data(), width, height);
+}
+
+void FrameCapture::destroySlot(Slot& slot)
+{
+    if (slot.buffer)
+    {
+        slot.buffer->cleanup();
+        slot.buffer.reset();
+    }
+    slot.state = SlotState::Free;
+}
+
+}
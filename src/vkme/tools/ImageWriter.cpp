@@ -0,0 +1,313 @@
+#include <vkme/tools/ImageWriter.hpp>
+
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+namespace vkme::tools {
+
+struct CRCTable {
+    uint32_t values[256];
+
+    CRCTable()
+    {
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+            {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            values[i] = c;
+        }
+    }
+};
+
+static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+{
+    static const CRCTable table;
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+    {
+        crc = table.values[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void putU32BE(std::vector<uint8_t>& out, uint32_t value)
+{
+    out.push_back(uint8_t(value >> 24));
+    out.push_back(uint8_t(value >> 16));
+    out.push_back(uint8_t(value >> 8));
+    out.push_back(uint8_t(value));
+}
+
+template <class T>
+static void putLE(std::vector<uint8_t>& out, T value)
+{
+    uint8_t bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    // All the supported platforms are little endian
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+static void putString(std::vector<uint8_t>& out, const char* str)
+{
+    out.insert(out.end(), str, str + std::strlen(str) + 1);
+}
+
+static void writeChunk(std::ofstream& file, const char* type, const std::vector<uint8_t>& data)
+{
+    std::vector<uint8_t> chunk;
+    chunk.reserve(data.size() + 12);
+    putU32BE(chunk, uint32_t(data.size()));
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    putU32BE(chunk, crc32(chunk.data() + 4, data.size() + 4));
+    file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+}
+
+void ImageWriter::writePNG(const std::string& path, const uint8_t* rgba, uint32_t width, uint32_t height)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("ImageWriter::writePNG(): could not open file " + path);
+    }
+
+    const uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+    std::vector<uint8_t> header;
+    putU32BE(header, width);
+    putU32BE(header, height);
+    header.push_back(8);    // Bit depth
+    header.push_back(6);    // Color type: RGBA
+    header.push_back(0);    // Compression: deflate
+    header.push_back(0);    // Filter method
+    header.push_back(0);    // No interlace
+    writeChunk(file, "IHDR", header);
+
+    // Scanlines with filter type 0, stored in non compressed deflate blocks
+    size_t rowSize = size_t(width) * 4;
+    std::vector<uint8_t> raw;
+    raw.reserve((rowSize + 1) * height);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        raw.push_back(0);
+        raw.insert(raw.end(), rgba + y * rowSize, rgba + (y + 1) * rowSize);
+    }
+
+    std::vector<uint8_t> zlib;
+    zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+    size_t offset = 0;
+    do
+    {
+        size_t blockSize = std::min(raw.size() - offset, size_t(65535));
+        bool last = offset + blockSize == raw.size();
+        zlib.push_back(last ? 1 : 0);
+        putLE(zlib, uint16_t(blockSize));
+        putLE(zlib, uint16_t(~blockSize));
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+        offset += blockSize;
+    } while (offset < raw.size());
+
+    uint32_t a = 1, b = 0;
+    for (auto byte : raw)
+    {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    putU32BE(zlib, (b << 16) | a);
+    writeChunk(file, "IDAT", zlib);
+
+    writeChunk(file, "IEND", {});
+}
+
+void ImageWriter::writeEXR(const std::string& path, const uint16_t* rgbaHalf, uint32_t width, uint32_t height)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("ImageWriter::writeEXR(): could not open file " + path);
+    }
+
+    std::vector<uint8_t> header;
+    putLE(header, uint32_t(20000630));  // Magic number
+    putLE(header, uint32_t(2));         // Version 2, single part scanline file
+
+    // The channels must be sorted by name
+    const char* channelNames[] = { "A", "B", "G", "R" };
+    putString(header, "channels");
+    putString(header, "chlist");
+    putLE(header, int32_t(4 * 18 + 1));
+    for (auto name : channelNames)
+    {
+        putString(header, name);
+        putLE(header, int32_t(1));      // HALF
+        putLE(header, uint32_t(0));     // pLinear and reserved
+        putLE(header, int32_t(1));      // x sampling
+        putLE(header, int32_t(1));      // y sampling
+    }
+    header.push_back(0);
+
+    putString(header, "compression");
+    putString(header, "compression");
+    putLE(header, int32_t(1));
+    header.push_back(0);                // NO_COMPRESSION
+
+    for (auto windowName : { "dataWindow", "displayWindow" })
+    {
+        putString(header, windowName);
+        putString(header, "box2i");
+        putLE(header, int32_t(16));
+        putLE(header, int32_t(0));
+        putLE(header, int32_t(0));
+        putLE(header, int32_t(width - 1));
+        putLE(header, int32_t(height - 1));
+    }
+
+    putString(header, "lineOrder");
+    putString(header, "lineOrder");
+    putLE(header, int32_t(1));
+    header.push_back(0);                // INCREASING_Y
+
+    putString(header, "pixelAspectRatio");
+    putString(header, "float");
+    putLE(header, int32_t(4));
+    putLE(header, 1.0f);
+
+    putString(header, "screenWindowCenter");
+    putString(header, "v2f");
+    putLE(header, int32_t(8));
+    putLE(header, 0.0f);
+    putLE(header, 0.0f);
+
+    putString(header, "screenWindowWidth");
+    putString(header, "float");
+    putLE(header, int32_t(4));
+    putLE(header, 1.0f);
+
+    header.push_back(0);
+
+    // Offset table: one scanline per chunk
+    size_t lineDataSize = size_t(width) * 4 * sizeof(uint16_t);
+    size_t chunkSize = lineDataSize + 8;
+    uint64_t firstChunk = header.size() + size_t(height) * sizeof(uint64_t);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        putLE(header, uint64_t(firstChunk + y * chunkSize));
+    }
+    file.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+    // Each scanline stores the channels one after the other, in the same order as the channel list
+    std::vector<uint8_t> line;
+    line.reserve(chunkSize);
+    const int channelIndex[] = { 3, 2, 1, 0 };
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        line.clear();
+        putLE(line, int32_t(y));
+        putLE(line, int32_t(lineDataSize));
+        const uint16_t* row = rgbaHalf + size_t(y) * width * 4;
+        for (auto c : channelIndex)
+        {
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                putLE(line, row[x * 4 + c]);
+            }
+        }
+        file.write(reinterpret_cast<const char*>(line.data()), line.size());
+    }
+}
+
+uint16_t ImageWriter::floatToHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    uint32_t sign = (bits >> 16) & 0x8000;
+    int32_t exponent = int32_t((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    if (((bits >> 23) & 0xFF) == 0xFF)
+    {
+        // Inf or NaN
+        return uint16_t(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+    }
+    if (exponent >= 31)
+    {
+        return uint16_t(sign | 0x7C00);
+    }
+    if (exponent <= 0)
+    {
+        if (exponent < -10)
+        {
+            return uint16_t(sign);
+        }
+        mantissa |= 0x800000;
+        uint32_t shift = uint32_t(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        // Round to nearest
+        if ((mantissa >> (shift - 1)) & 1)
+        {
+            ++half;
+        }
+        return uint16_t(sign | half);
+    }
+
+    uint32_t half = sign | (uint32_t(exponent) << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000)
+    {
+        // Round to nearest. An overflow of the mantissa increments the exponent, that is correct
+        ++half;
+    }
+    return uint16_t(half);
+}
+
+float ImageWriter::halfToFloat(uint16_t value)
+{
+    uint32_t sign = uint32_t(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1F;
+    uint32_t mantissa = value & 0x3FF;
+
+    uint32_t bits;
+    if (exponent == 0)
+    {
+        if (mantissa == 0)
+        {
+            bits = sign;
+        }
+        else
+        {
+            // Denormal: normalize it
+            exponent = 127 - 15 + 1;
+            while ((mantissa & 0x400) == 0)
+            {
+                mantissa <<= 1;
+                --exponent;
+            }
+            mantissa &= 0x3FF;
+            bits = sign | (exponent << 23) | (mantissa << 13);
+        }
+    }
+    else if (exponent == 31)
+    {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    }
+    else
+    {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+}
@@ -0,0 +1,768 @@
+#include <vkme/tools/IndirectRenderer.hpp>
+#include <vkme/factory/ComputePipeline.hpp>
+#include <vkme/factory/DescriptorSetLayout.hpp>
+#include <vkme/core/BarrierBatch.hpp>
+#include <vkme/core/Info.hpp>
+#include <vkme/core/extensions.hpp>
+
+#include <algorithm>
+
+namespace vkme::tools {
+
+IndirectRenderer::IndirectRenderer(VulkanData* vulkanData, const geo::ModelPool& modelPool, DepthPyramid::DepthConvention depthConvention)
+    :_vulkanData(vulkanData)
+    ,_modelPool(&modelPool)
+    ,_depthPyramid(vulkanData, depthConvention)
+{
+
+}
+
+void IndirectRenderer::getFrameResourcesRequirements(std::vector<core::DescriptorSetAllocator::PoolSizeRatio>& requiredRatios)
+{
+    // The depth pyramid of the two culling phases
+    requiredRatios.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 });
+    DepthPyramid::getFrameResourcesRequirements(requiredRatios);
+}
+
+void IndirectRenderer::init()
+{
+    if (!_vulkanData->indirectDrawSupported())
+    {
+        throw std::runtime_error("IndirectRenderer::init(): the device does not support the indirect draw features. Check VulkanData::indirectDrawSupported() before creating the renderer.");
+    }
+
+    _depthPyramid.init();
+
+    vkme::factory::DescriptorSetLayout dsFactory;
+    dsFactory.addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+    _cullingDSLayout = dsFactory.build(_vulkanData->device(), VK_SHADER_STAGE_COMPUTE_BIT);
+
+    VkPushConstantRange range = {};
+    range.offset = 0;
+    range.size = uint32_t(std::max(sizeof(CullingPushConstants), sizeof(ClusterCullingPushConstants)));
+    range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    auto layoutInfo = vkme::core::Info::pipelineLayoutInfo();
+    layoutInfo.pPushConstantRanges = &range;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pSetLayouts = &_cullingDSLayout;
+    layoutInfo.setLayoutCount = 1;
+    VK_ASSERT(vkCreatePipelineLayout(_vulkanData->device(), &layoutInfo, nullptr, &_cullingPipelineLayout));
+
+    vkme::factory::ComputePipeline pipelineFactory(_vulkanData);
+    pipelineFactory.setShader("indirect_cull.comp.spv");
+    _cullingPipeline = pipelineFactory.build(_cullingPipelineLayout);
+    pipelineFactory.setShader("indirect_cluster_cull.comp.spv");
+    _clusterCullingPipeline = pipelineFactory.build(_cullingPipelineLayout);
+
+    _vulkanData->cleanupManager().push([&](VkDevice dev) {
+        cleanup();
+        vkDestroyPipeline(dev, _cullingPipeline, nullptr);
+        vkDestroyPipeline(dev, _clusterCullingPipeline, nullptr);
+        vkDestroyPipelineLayout(dev, _cullingPipelineLayout, nullptr);
+        vkDestroyDescriptorSetLayout(dev, _cullingDSLayout, nullptr);
+    });
+}
+
+void IndirectRenderer::update(const glm::mat4& view, const glm::mat4& proj)
+{
+    _view = view;
+    _projection = proj;
+}
+
+void IndirectRenderer::setLodSelection(float viewportHeight, float maxScreenError)
+{
+    _lodViewportHeight = viewportHeight;
+    _lodMaxScreenError = maxScreenError;
+}
+
+uint32_t IndirectRenderer::addPipeline(VkPipeline pipeline, VkPipelineLayout pipelineLayout, VkPipeline meshPipeline)
+{
+    _pipelines.push_back({ pipeline, pipelineLayout, meshPipeline });
+    return uint32_t(_pipelines.size() - 1);
+}
+
+bool IndirectRenderer::meshShading() const
+{
+    if (!_vulkanData->meshShaderSupported() || _pipelines.empty())
+    {
+        return false;
+    }
+    return std::all_of(_pipelines.begin(), _pipelines.end(), [](const Pipeline& p) {
+        return p.meshPipeline != VK_NULL_HANDLE;
+    });
+}
+
+IndirectObjectHandle IndirectRenderer::addObject(
+    geo::ModelHandle model,
+    uint32_t surface,
+    uint32_t pipeline,
+    uint32_t materialIndex
+) {
+    // Throws if the model is not in the pool
+    auto& modelData = _modelPool->at(model);
+    if (surface >= modelData.numSurfaces())
+    {
+        throw std::runtime_error("IndirectRenderer::addObject(): invalid surface index");
+    }
+    if (pipeline >= _pipelines.size())
+    {
+        throw std::runtime_error("IndirectRenderer::addObject(): invalid pipeline index");
+    }
+
+    IndirectObject object;
+    object.model = model;
+    object.surface = surface;
+    object.pipeline = pipeline;
+    object.materialIndex = materialIndex;
+    object.modelMatrix = modelData.modelMatrix();
+    _uploadAll = true;
+    return _objects.insert(std::move(object));
+}
+
+std::vector<IndirectObjectHandle> IndirectRenderer::addModel(
+    geo::ModelHandle model,
+    uint32_t pipeline,
+    uint32_t materialIndex
+) {
+    std::vector<IndirectObjectHandle> result;
+    auto surfaceCount = _modelPool->at(model).numSurfaces();
+    for (uint32_t i = 0; i < surfaceCount; ++i)
+    {
+        result.push_back(addObject(model, i, pipeline, materialIndex));
+    }
+    return result;
+}
+
+void IndirectRenderer::removeObject(IndirectObjectHandle object)
+{
+    // The last object is moved to the position of the removed one, so the buckets change
+    if (_objects.remove(object))
+    {
+        _uploadAll = true;
+    }
+}
+
+void IndirectRenderer::setModelMatrix(IndirectObjectHandle object, const glm::mat4& modelMatrix)
+{
+    _objects.at(object).modelMatrix = modelMatrix;
+    _dirtyObjects.push_back(object);
+}
+
+void IndirectRenderer::prepare(VkCommandBuffer cmd, const core::Image* depthImage, core::FrameResources& frameResources)
+{
+    // The culling descriptor sets of both phases reference the pyramid, so it can't be
+    // recreated after this point
+    _depthPyramid.cmdResize(cmd, depthImage->extent2D(), frameResources);
+
+    auto& arena = _vulkanData->geometryArena();
+    if (arena.generation() != _arenaGeneration)
+    {
+        // The vertex addresses and the first indices have changed
+        _arenaGeneration = arena.generation();
+        _uploadAll = true;
+    }
+    if (_uploadAll)
+    {
+        updateDrawBuckets();
+    }
+    if (_objects.empty())
+    {
+        _dirtyObjects.clear();
+        _uploadAll = false;
+        return;
+    }
+    if (reserveBuffers())
+    {
+        _uploadAll = true;
+    }
+
+    auto& bufferPool = _vulkanData->bufferPool();
+    VkPipelineStageFlags2 drawStages = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT;
+    if (meshShading())
+    {
+        drawStages |= VK_PIPELINE_STAGE_2_TASK_SHADER_BIT_EXT | VK_PIPELINE_STAGE_2_MESH_SHADER_BIT_EXT;
+    }
+
+    // The previous frames may still read the buffers
+    core::BarrierBatch barriers;
+    barriers.addMemoryBarrier(
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | drawStages,
+        VK_ACCESS_2_NONE,
+        VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT,
+        VK_ACCESS_2_TRANSFER_WRITE_BIT
+    );
+    barriers.flush(cmd);
+
+    // The dense indices have changed, so all the objects and clusters are drawn in the first
+    // phase and the second phase computes the new visibility
+    if (_uploadAll)
+    {
+        vkCmdFillBuffer(cmd, bufferPool.at(_visibilityBuffer).buffer(), 0, _objects.size() * sizeof(uint32_t), 1);
+        uploadClusters(cmd, frameResources);
+    }
+    uploadObjects(cmd, frameResources);
+    vkCmdFillBuffer(cmd, bufferPool.at(_countBuffer).buffer(), 0, 2 * _bucketCapacity * sizeof(uint32_t), 0);
+    // The task commands start with one work group in each dimension: the cluster culling adds a
+    // work group for each 32 clusters after the first 32. The task shader reads the cluster
+    // count, so an empty bucket does not emit any mesh task
+    vkCmdFillBuffer(cmd, bufferPool.at(_taskCommandBuffer).buffer(), 0, 2 * _bucketCapacity * 4 * sizeof(uint32_t), 1);
+
+    barriers.addMemoryBarrier(
+        VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT,
+        VK_ACCESS_2_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | drawStages,
+        VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+    );
+    barriers.flush(cmd);
+
+    cmdCull(cmd, 0, frameResources);
+}
+
+void IndirectRenderer::cmdCullLate(VkCommandBuffer cmd, const core::Image* depthImage, core::FrameResources& frameResources)
+{
+    if (_objects.empty() || _drawBuckets.empty())
+    {
+        return;
+    }
+
+    _depthPyramid.cmdBuild(cmd, depthImage, frameResources);
+    cmdCull(cmd, 1, frameResources);
+}
+
+void IndirectRenderer::cmdCull(VkCommandBuffer cmd, uint32_t phase, core::FrameResources& frameResources)
+{
+    auto& bufferPool = _vulkanData->bufferPool();
+
+    CullData cullData = {};
+    cullData.view = _view;
+    cullData.projection = _projection;
+    // Gribb and Hartmann: the planes are combinations of the rows of the view projection matrix,
+    // with the depth range of Vulkan (0 <= z <= w)
+    auto m = glm::transpose(_projection * _view);
+    glm::vec4 planes[6] = { m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[2], m[3] - m[2] };
+    for (int i = 0; i < 6; ++i)
+    {
+        cullData.frustumPlanes[i] = planes[i] / glm::length(glm::vec3(planes[i]));
+    }
+    cullData.cameraPosition = glm::inverse(_view)[3];
+    auto depthSize = _depthPyramid.depthExtent();
+    cullData.depthSize = glm::uvec2(depthSize.width, depthSize.height);
+    cullData.pyramidLevels = _depthPyramid.levelCount();
+    cullData.occlusionEnabled = phase == 1 && _depthPyramid.built() ? 1 : 0;
+    cullData.reversedDepth = _depthPyramid.depthConvention() == DepthPyramid::DepthConvention::Reversed ? 1 : 0;
+    // See geo::Model::selectLods()
+    cullData.lodErrorScale = std::abs(_projection[1][1]) * 0.5f * _lodViewportHeight / _lodMaxScreenError;
+
+    auto cullDataBuffer = core::Buffer::createAllocatedBuffer(
+        _vulkanData,
+        sizeof(CullData),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+        VMA_MEMORY_USAGE_CPU_TO_GPU
+    );
+    *reinterpret_cast<CullData*>(cullDataBuffer->allocatedData()) = cullData;
+    frameResources.cleanupManager.push([cullDataBuffer](VkDevice) {
+        cullDataBuffer->cleanup();
+        delete cullDataBuffer;
+    });
+
+    auto descriptorSet = std::unique_ptr<vkme::core::DescriptorSet>(
+        frameResources.descriptorAllocator->allocate(_cullingDSLayout)
+    );
+    descriptorSet->beginUpdate();
+    descriptorSet->addImage(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, _depthPyramid.imageView(), VK_IMAGE_LAYOUT_GENERAL, _depthPyramid.sampler());
+    descriptorSet->endUpdate();
+    VkDescriptorSet ds = descriptorSet->descriptorSet();
+
+    // Each phase writes its own range of the command and count buffers
+    CullingPushConstants pushConstants;
+    pushConstants.objectBufferAddress = bufferPool.at(_objectBuffer).deviceAddress();
+    pushConstants.commandBufferAddress = bufferPool.at(_commandBuffer).deviceAddress() +
+        phase * _commandCapacity * sizeof(VkDrawIndexedIndirectCommand);
+    pushConstants.countBufferAddress = bufferPool.at(_countBuffer).deviceAddress() +
+        phase * _bucketCapacity * sizeof(uint32_t);
+    pushConstants.visibilityBufferAddress = bufferPool.at(_visibilityBuffer).deviceAddress();
+    pushConstants.cullDataAddress = cullDataBuffer->deviceAddress();
+    pushConstants.objectCount = _objects.size();
+    pushConstants.phase = phase;
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _cullingPipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _cullingPipelineLayout, 0, 1, &ds, 0, nullptr);
+    vkCmdPushConstants(cmd, _cullingPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullingPushConstants), &pushConstants);
+    vkCmdDispatch(cmd, (_objects.size() + 63) / 64, 1, 1);
+
+    core::BarrierBatch barriers;
+    if (_clusterCount > 0)
+    {
+        // The cluster culling reads the object visibility of this phase
+        barriers.addMemoryBarrier(
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+        );
+        barriers.flush(cmd);
+
+        ClusterCullingPushConstants clusterConstants;
+        clusterConstants.objectBufferAddress = pushConstants.objectBufferAddress;
+        clusterConstants.commandBufferAddress = pushConstants.commandBufferAddress;
+        clusterConstants.countBufferAddress = pushConstants.countBufferAddress;
+        clusterConstants.visibilityBufferAddress = pushConstants.visibilityBufferAddress;
+        clusterConstants.cullDataAddress = pushConstants.cullDataAddress;
+        clusterConstants.clusterBufferAddress = bufferPool.at(_clusterBuffer).deviceAddress();
+        clusterConstants.clusterVisibilityBufferAddress = bufferPool.at(_clusterVisibilityBuffer).deviceAddress();
+        clusterConstants.clusterDrawBufferAddress = bufferPool.at(_clusterDrawBuffer).deviceAddress() +
+            phase * _commandCapacity * sizeof(glm::uvec2);
+        clusterConstants.taskCommandBufferAddress = bufferPool.at(_taskCommandBuffer).deviceAddress() +
+            phase * _bucketCapacity * 4 * sizeof(uint32_t);
+        clusterConstants.clusterCount = _clusterCount;
+        clusterConstants.phase = phase;
+        clusterConstants.meshShading = meshShading() ? 1 : 0;
+
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _clusterCullingPipeline);
+        vkCmdPushConstants(cmd, _cullingPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ClusterCullingPushConstants), &clusterConstants);
+        vkCmdDispatch(cmd, (_clusterCount + 63) / 64, 1, 1);
+    }
+
+    VkPipelineStageFlags2 drawStages = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
+    if (meshShading())
+    {
+        drawStages |= VK_PIPELINE_STAGE_2_TASK_SHADER_BIT_EXT;
+    }
+    barriers.addMemoryBarrier(
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+        drawStages | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+    );
+    barriers.flush(cmd);
+    _drawPhase = phase;
+}
+
+void IndirectRenderer::draw(
+    VkCommandBuffer cmd,
+    core::DescriptorSet* descriptorSets[],
+    uint32_t numDescriptorSets
+) {
+    if (_drawBuckets.empty())
+    {
+        return;
+    }
+
+    auto& bufferPool = _vulkanData->bufferPool();
+    auto commandBuffer = bufferPool.at(_commandBuffer).buffer();
+    auto countBuffer = bufferPool.at(_countBuffer).buffer();
+    auto countBufferAddress = bufferPool.at(_countBuffer).deviceAddress();
+    auto clusterDrawBufferAddress = bufferPool.at(_clusterDrawBuffer).deviceAddress();
+    auto taskCommandBuffer = bufferPool.at(_taskCommandBuffer).buffer();
+    bool useMeshShading = meshShading();
+
+    PushConstants pushConstants = {};
+    pushConstants.viewProjection = _projection * _view;
+    pushConstants.objectBufferAddress = bufferPool.at(_objectBuffer).deviceAddress();
+
+    std::vector<VkDescriptorSet> sets(numDescriptorSets);
+    for (uint32_t i = 0; i < numDescriptorSets; ++i)
+    {
+        sets[i] = descriptorSets[i]->descriptorSet();
+    }
+
+    // The buckets are sorted by pipeline, index type and clustering. The pipeline changes when
+    // the clustered buckets are drawn with the mesh pipeline
+    VkPipeline boundPipeline = VK_NULL_HANDLE;
+    const DrawBucket* previous = nullptr;
+    for (uint32_t i = 0; i < _drawBuckets.size(); ++i)
+    {
+        auto& bucket = _drawBuckets[i];
+        auto& pipeline = _pipelines[bucket.pipeline];
+        bool meshBucket = useMeshShading && bucket.clustered;
+        VkShaderStageFlags pushConstantStages = VK_SHADER_STAGE_VERTEX_BIT;
+        if (pipeline.meshPipeline != VK_NULL_HANDLE)
+        {
+            pushConstantStages |= VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT;
+        }
+
+        auto bucketPipeline = meshBucket ? pipeline.meshPipeline : pipeline.pipeline;
+        if (bucketPipeline != boundPipeline)
+        {
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, bucketPipeline);
+            if (!sets.empty() && (previous == nullptr || previous->pipeline != bucket.pipeline))
+            {
+                vkCmdBindDescriptorSets(
+                    cmd,
+                    VK_PIPELINE_BIND_POINT_GRAPHICS,
+                    pipeline.layout, 0,
+                    uint32_t(sets.size()),
+                    sets.data(),
+                    0, nullptr
+                );
+            }
+            boundPipeline = bucketPipeline;
+        }
+
+        if (meshBucket)
+        {
+            // The task shader reads the visible clusters of the bucket
+            pushConstants.clusterBufferAddress = clusterDrawBufferAddress +
+                (_drawPhase * _commandCapacity + bucket.commandOffset) * sizeof(glm::uvec2);
+            pushConstants.clusterCountAddress = countBufferAddress + (_drawPhase * _bucketCapacity + i) * sizeof(uint32_t);
+            vkCmdPushConstants(cmd, pipeline.layout, pushConstantStages, 0, sizeof(PushConstants), &pushConstants);
+            core::cmdDrawMeshTasksIndirect(
+                _vulkanData->device(),
+                cmd,
+                taskCommandBuffer,
+                (_drawPhase * _bucketCapacity + i) * 4 * sizeof(uint32_t),
+                1,
+                4 * sizeof(uint32_t)
+            );
+            previous = &bucket;
+            continue;
+        }
+
+        if (previous == nullptr || previous->pipeline != bucket.pipeline || previous->indexType != bucket.indexType)
+        {
+            vkCmdPushConstants(cmd, pipeline.layout, pushConstantStages, 0, sizeof(PushConstants), &pushConstants);
+            _vulkanData->geometryArena().bindIndexBuffer(cmd, bucket.indexType);
+        }
+
+        vkCmdDrawIndexedIndirectCount(
+            cmd,
+            commandBuffer,
+            (_drawPhase * _commandCapacity + bucket.commandOffset) * sizeof(VkDrawIndexedIndirectCommand),
+            countBuffer,
+            (_drawPhase * _bucketCapacity + i) * sizeof(uint32_t),
+            bucket.commandCount,
+            sizeof(VkDrawIndexedIndirectCommand)
+        );
+        previous = &bucket;
+    }
+}
+
+void IndirectRenderer::cleanup()
+{
+    releaseBuffers();
+    _objects.clear();
+    _drawBuckets.clear();
+    _dirtyObjects.clear();
+    _uploadAll = true;
+    _drawPhase = 0;
+    _clusterCount = 0;
+}
+
+void IndirectRenderer::updateDrawBuckets()
+{
+    _drawBuckets.clear();
+    _clusterCount = 0;
+    for (auto& object : _objects)
+    {
+        auto indexType = model(object).meshBuffers()->indexType;
+        auto clusters = clusterCount(object);
+        auto commands = commandCount(object);
+        _clusterCount += clusters;
+        auto bucket = std::find_if(_drawBuckets.begin(), _drawBuckets.end(), [&](const DrawBucket& b) {
+            return b.pipeline == object.pipeline && b.indexType == indexType && b.clustered == (clusters > 0);
+        });
+        if (bucket == _drawBuckets.end())
+        {
+            _drawBuckets.push_back({ object.pipeline, indexType, clusters > 0, 0, commands });
+        }
+        else
+        {
+            bucket->commandCount += commands;
+        }
+    }
+
+    std::sort(_drawBuckets.begin(), _drawBuckets.end(), [](const DrawBucket& a, const DrawBucket& b) {
+        if (a.pipeline != b.pipeline)
+        {
+            return a.pipeline < b.pipeline;
+        }
+        return a.indexType != b.indexType ? a.indexType < b.indexType : a.clustered < b.clustered;
+    });
+    uint32_t commandOffset = 0;
+    for (auto& bucket : _drawBuckets)
+    {
+        bucket.commandOffset = commandOffset;
+        commandOffset += bucket.commandCount;
+    }
+}
+
+uint32_t IndirectRenderer::clusterCount(const IndirectObject& object) const
+{
+    auto& surface = model(object).surfaces()[object.surface];
+    if (model(object).meshBuffers()->meshletCount == 0 || surface.meshletCount < MinClusterMeshlets)
+    {
+        return 0;
+    }
+
+    uint32_t result = 0;
+    for (uint32_t i = 0; i < std::min(surface.levelCount(), MaxLods); ++i)
+    {
+        result += surface.level(i).meshletCount;
+    }
+    return result;
+}
+
+uint32_t IndirectRenderer::commandCount(const IndirectObject& object) const
+{
+    if (clusterCount(object) == 0)
+    {
+        return 1;
+    }
+
+    auto& surface = model(object).surfaces()[object.surface];
+    uint32_t result = 1;
+    for (uint32_t i = 0; i < std::min(surface.levelCount(), MaxLods); ++i)
+    {
+        result = std::max(result, surface.level(i).meshletCount);
+    }
+    return result;
+}
+
+IndirectRenderer::ObjectData IndirectRenderer::objectData(const IndirectObject& object) const
+{
+    auto meshBuffers = model(object).meshBuffers();
+    auto& surface = model(object).surfaces()[object.surface];
+
+    // The vertex format is encoded in the same way as in the push constants of Model::draw()
+    geo::MeshPushConstants vertexFormat;
+    vertexFormat.setVertexFormat(meshBuffers);
+
+    ObjectData data = {};
+    data.modelMatrix = object.modelMatrix;
+    data.vertexBufferAddress = meshBuffers->vertexBufferAddress();
+    auto clustered = clusterCount(object) > 0;
+    for (uint32_t i = 0; i < _drawBuckets.size(); ++i)
+    {
+        auto& bucket = _drawBuckets[i];
+        if (bucket.pipeline == object.pipeline && bucket.indexType == meshBuffers->indexType && bucket.clustered == clustered)
+        {
+            data.drawBucket = i;
+            data.commandOffset = bucket.commandOffset;
+            break;
+        }
+    }
+    data.packedVertexStride = vertexFormat.packedVertexStride;
+    data.materialIndex = object.materialIndex;
+    data.meshletBufferAddress = meshBuffers->meshletBufferAddress();
+    data.positionOffset = vertexFormat.positionOffset;
+    data.positionScale = vertexFormat.positionScale;
+    data.uvTransform = vertexFormat.uvTransform;
+    data.boundingSphere = surface.boundingSphere;
+    data.lodCount = std::min(surface.levelCount(), MaxLods);
+    for (uint32_t i = 0; i < data.lodCount; ++i)
+    {
+        auto level = surface.level(i);
+        data.lods[i] = glm::uvec4(
+            meshBuffers->firstIndex() + level.startIndex,
+            level.indexCount,
+            level.meshletOffset,
+            clustered ? level.meshletCount : 0
+        );
+        data.lodErrors[i] = level.error;
+    }
+    return data;
+}
+
+bool IndirectRenderer::reserveBuffers()
+{
+    uint32_t commandCount = _drawBuckets.empty() ? 0 : _drawBuckets.back().commandOffset + _drawBuckets.back().commandCount;
+    if (_objects.size() <= _objectCapacity && commandCount <= _commandCapacity &&
+        _drawBuckets.size() <= _bucketCapacity && _clusterCount <= _clusterCapacity)
+    {
+        return false;
+    }
+
+    releaseBuffers();
+    auto capacity = [](size_t count, uint32_t minimum) {
+        uint32_t result = minimum;
+        while (result < count)
+        {
+            result *= 2;
+        }
+        return result;
+    };
+    _objectCapacity = capacity(_objects.size(), 64);
+    _commandCapacity = capacity(commandCount, 64);
+    _bucketCapacity = capacity(_drawBuckets.size(), 16);
+    _clusterCapacity = capacity(_clusterCount, 64);
+
+    // All the buffers are read and written by the shaders with device addresses
+    auto createBuffer = [&](VkDeviceSize size, VkBufferUsageFlags usage) {
+        return core::Buffer::createPooledBuffer(
+            _vulkanData,
+            size,
+            usage | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            VMA_MEMORY_USAGE_GPU_ONLY
+        );
+    };
+    _objectBuffer = createBuffer(_objectCapacity * sizeof(ObjectData), VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+    _commandBuffer = createBuffer(2 * _commandCapacity * sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+    _countBuffer = createBuffer(
+        2 * _bucketCapacity * sizeof(uint32_t),
+        VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT
+    );
+    _visibilityBuffer = createBuffer(_objectCapacity * sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+    _clusterBuffer = createBuffer(_clusterCapacity * sizeof(glm::uvec2), VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+    _clusterVisibilityBuffer = createBuffer(_clusterCapacity * sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+    _clusterDrawBuffer = createBuffer(2 * _commandCapacity * sizeof(glm::uvec2), 0);
+    _taskCommandBuffer = createBuffer(
+        2 * _bucketCapacity * 4 * sizeof(uint32_t),
+        VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT
+    );
+    return true;
+}
+
+void IndirectRenderer::releaseBuffers()
+{
+    if (!_objectBuffer)
+    {
+        return;
+    }
+
+    // The frames in flight may still use the buffers
+    auto vulkanData = _vulkanData;
+    core::BufferHandle buffers[] = {
+        _objectBuffer, _commandBuffer, _countBuffer, _visibilityBuffer,
+        _clusterBuffer, _clusterVisibilityBuffer, _clusterDrawBuffer, _taskCommandBuffer
+    };
+    _vulkanData->releaseAfterFramesInFlight([vulkanData, buffers](VkDevice) {
+        for (auto buffer : buffers)
+        {
+            vulkanData->bufferPool().destroy(buffer);
+        }
+    });
+    _objectBuffer = {};
+    _commandBuffer = {};
+    _countBuffer = {};
+    _visibilityBuffer = {};
+    _clusterBuffer = {};
+    _clusterVisibilityBuffer = {};
+    _clusterDrawBuffer = {};
+    _taskCommandBuffer = {};
+    _objectCapacity = 0;
+    _commandCapacity = 0;
+    _bucketCapacity = 0;
+    _clusterCapacity = 0;
+}
+
+void IndirectRenderer::uploadObjects(VkCommandBuffer cmd, core::FrameResources& frameResources)
+{
+    std::vector<uint32_t> indices;
+    if (_uploadAll)
+    {
+        indices.resize(_objects.size());
+        for (uint32_t i = 0; i < _objects.size(); ++i)
+        {
+            indices[i] = i;
+        }
+    }
+    else
+    {
+        // The handles are translated to dense indices, that are the positions in the object buffer
+        for (auto handle : _dirtyObjects)
+        {
+            auto object = _objects.get(handle);
+            if (object != nullptr)
+            {
+                indices.push_back(uint32_t(object - &_objects[0]));
+            }
+        }
+        std::sort(indices.begin(), indices.end());
+        indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+    }
+    _dirtyObjects.clear();
+    _uploadAll = false;
+    if (indices.empty())
+    {
+        return;
+    }
+
+    auto stagingBuffer = core::Buffer::createAllocatedBuffer(
+        _vulkanData,
+        indices.size() * sizeof(ObjectData),
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VMA_MEMORY_USAGE_CPU_TO_GPU
+    );
+    frameResources.cleanupManager.push([stagingBuffer](VkDevice) {
+        stagingBuffer->cleanup();
+        delete stagingBuffer;
+    });
+
+    // The consecutive objects are copied with one region
+    auto data = reinterpret_cast<ObjectData*>(stagingBuffer->allocatedData());
+    std::vector<VkBufferCopy> copies;
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        data[i] = objectData(_objects[indices[i]]);
+        if (!copies.empty() && copies.back().dstOffset + copies.back().size == indices[i] * sizeof(ObjectData))
+        {
+            copies.back().size += sizeof(ObjectData);
+        }
+        else
+        {
+            VkBufferCopy copy = {};
+            copy.srcOffset = i * sizeof(ObjectData);
+            copy.dstOffset = indices[i] * sizeof(ObjectData);
+            copy.size = sizeof(ObjectData);
+            copies.push_back(copy);
+        }
+    }
+
+    vkCmdCopyBuffer(
+        cmd,
+        stagingBuffer->buffer(),
+        _vulkanData->bufferPool().at(_objectBuffer).buffer(),
+        uint32_t(copies.size()),
+        copies.data()
+    );
+}
+
+void IndirectRenderer::uploadClusters(VkCommandBuffer cmd, core::FrameResources& frameResources)
+{
+    if (_clusterCount == 0)
+    {
+        return;
+    }
+
+    auto stagingBuffer = core::Buffer::createAllocatedBuffer(
+        _vulkanData,
+        _clusterCount * sizeof(glm::uvec2),
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VMA_MEMORY_USAGE_CPU_TO_GPU
+    );
+    frameResources.cleanupManager.push([stagingBuffer](VkDevice) {
+        stagingBuffer->cleanup();
+        delete stagingBuffer;
+    });
+
+    // The meshlet index is relative to the meshlet stream of the mesh. The culling skips the
+    // meshlets of the levels that are not selected
+    auto data = reinterpret_cast<glm::uvec2*>(stagingBuffer->allocatedData());
+    uint32_t cluster = 0;
+    for (uint32_t i = 0; i < _objects.size(); ++i)
+    {
+        auto& object = _objects[i];
+        if (clusterCount(object) == 0)
+        {
+            continue;
+        }
+        auto& surface = model(object).surfaces()[object.surface];
+        for (uint32_t l = 0; l < std::min(surface.levelCount(), MaxLods); ++l)
+        {
+            auto level = surface.level(l);
+            for (uint32_t m = 0; m < level.meshletCount; ++m)
+            {
+                data[cluster++] = glm::uvec2(i, level.meshletOffset + m);
+            }
+        }
+    }
+
+    auto& bufferPool = _vulkanData->bufferPool();
+    VkBufferCopy copy = {};
+    copy.size = _clusterCount * sizeof(glm::uvec2);
+    vkCmdCopyBuffer(cmd, stagingBuffer->buffer(), bufferPool.at(_clusterBuffer).buffer(), 1, &copy);
+    vkCmdFillBuffer(cmd, bufferPool.at(_clusterVisibilityBuffer).buffer(), 0, _clusterCount * sizeof(uint32_t), 1);
+}
+
+}
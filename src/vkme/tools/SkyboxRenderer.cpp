@@ -88,7 +88,7 @@ void SkyboxRenderer::init(std::shared_ptr<core::Image>&& skyImage)
         
         // This one is actually not needed, because the sky shader does not do lighting calculations.
         std::shared_ptr<vkme::geo::Modifier>(new vkme::geo::FlipNormalsModifier())
-    }));
+    }, vkme::geo::VertexFormat::Standard, true));
     
     _skyCube->allocateMaterialDescriptorSets(_descriptorSetAllocator, _inputImageDSLayout);
     
@@ -147,7 +147,8 @@ void SkyboxRenderer::draw(VkCommandBuffer cmd, uint32_t currentFrame, vkme::core
     vkme::core::DescriptorSet* ds[] = {
         descriptorSet.get()
     };
-    _skyCube->draw(cmd, _pipelineLayout, ds, 1);
+    // The sky shader only reads the vertex positions
+    _skyCube->draw(cmd, _pipelineLayout, ds, 1, 0, vkme::geo::VertexStream::Positions);
 }
 
 }
@@ -118,10 +118,10 @@ void SphereToCubemapRenderer::update(VkCommandBuffer cmd, uint32_t)
         auto meshBuffers = _sphere->meshBuffers();
         SkySpherePushConstant pushConstants;
         pushConstants.currentFace = i;
-        pushConstants.vertexBufferAddress = meshBuffers->vertexBufferAddress;
+        pushConstants.vertexBufferAddress = meshBuffers->vertexBufferAddress();
 
         vkCmdPushConstants(cmd, _pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(SkySpherePushConstant), &pushConstants);
-        vkCmdBindIndexBuffer(cmd, meshBuffers->indexBuffer->buffer(), 0, VK_INDEX_TYPE_UINT32);
+        meshBuffers->bindIndexBuffer(cmd);
 
         // The sphere has only one surface
         auto surface = _sphere->surfaces()[0];
@@ -140,7 +140,7 @@ void SphereToCubemapRenderer::update(VkCommandBuffer cmd, uint32_t)
             0, nullptr
         );
 
-        vkCmdDrawIndexed(cmd, surface.indexCount, 1, surface.startIndex, 0, 0);
+        vkCmdDrawIndexed(cmd, surface.indexCount, 1, meshBuffers->firstIndex() + surface.startIndex, 0, 0);
         
 		vkme::core::cmdEndRendering(cmd);
     }
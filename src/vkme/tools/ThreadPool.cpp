@@ -0,0 +1,118 @@
+#include <vkme/tools/ThreadPool.hpp>
+
+#include <algorithm>
+
+namespace vkme::tools {
+
+ThreadPool::ThreadPool(uint32_t workerCount)
+{
+    if (workerCount == 0)
+    {
+        workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+
+    for (uint32_t i = 0; i < workerCount; ++i)
+    {
+        _workers.emplace_back([this]() { workerMain(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _workAvailable.notify_all();
+    for (auto& worker : _workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& func)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _func = &func;
+    _count = count;
+    _nextIndex = 0;
+    _pendingIndices = count;
+    _exception = nullptr;
+    ++_generation;
+    _workAvailable.notify_all();
+
+    // The calling thread also runs jobs
+    runIndices(lock);
+    _workFinished.wait(lock, [&]() { return _pendingIndices == 0; });
+
+    _func = nullptr;
+    if (_exception)
+    {
+        auto exception = _exception;
+        _exception = nullptr;
+        std::rethrow_exception(exception);
+    }
+}
+
+ThreadPool& ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::workerMain()
+{
+    uint64_t generation = 0;
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true)
+    {
+        _workAvailable.wait(lock, [&]() { return _stop || (_generation != generation && _nextIndex < _count); });
+        if (_stop)
+        {
+            return;
+        }
+        generation = _generation;
+        runIndices(lock);
+    }
+}
+
+void ThreadPool::runIndices(std::unique_lock<std::mutex>& lock)
+{
+    while (_nextIndex < _count)
+    {
+        auto index = _nextIndex++;
+        auto func = _func;
+        bool skip = _exception != nullptr;
+
+        lock.unlock();
+        std::exception_ptr exception;
+        if (!skip)
+        {
+            try
+            {
+                (*func)(index);
+            }
+            catch (...)
+            {
+                exception = std::current_exception();
+            }
+        }
+        lock.lock();
+
+        if (exception && !_exception)
+        {
+            _exception = exception;
+        }
+        if (--_pendingIndices == 0)
+        {
+            _workFinished.notify_all();
+        }
+    }
+}
+
+}